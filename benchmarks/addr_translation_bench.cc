@@ -0,0 +1,159 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Measures the throughput of ELFBinary::OffsetFromAddr and
+// ELFBinary::AddrFromOffset compared with a linear scan over PT_LOADs.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "elf_binary.h"
+
+namespace {
+
+constexpr int kIterations = 20;
+
+__attribute__((noinline)) Elf_Addr LinearOffsetFromAddr(const ELFBinary& b, Elf_Addr addr) {
+    for (Elf_Phdr* phdr : b.loads()) {
+        if (phdr->p_vaddr <= addr && addr < phdr->p_vaddr + phdr->p_memsz) {
+            return addr - phdr->p_vaddr + phdr->p_offset;
+        }
+    }
+    LOG(FATAL) << "Address " << HexString(addr, 16) << " cannot be resolved";
+}
+
+__attribute__((noinline)) Elf_Addr LinearAddrFromOffset(const ELFBinary& b, Elf_Addr offset) {
+    for (Elf_Phdr* phdr : b.loads()) {
+        if (phdr->p_offset <= offset && offset < phdr->p_offset + phdr->p_filesz) {
+            return offset - phdr->p_offset + phdr->p_vaddr;
+        }
+    }
+    LOG(FATAL) << "Offset " << HexString(offset, 16) << " cannot be resolved";
+}
+
+// Returns nanoseconds per call of f.
+template <class F>
+double Measure(const std::vector<Elf_Addr>& queries, F f, uint64_t* checksum) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        for (Elf_Addr q : queries) {
+            *checksum += f(q);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return ns / (static_cast<double>(queries.size()) * kIterations);
+}
+
+// Makes queries in [start, start + size) of each segment. When sequential is
+// true, queries walk each segment in order like parsing .eh_frame does.
+// Otherwise, they are shuffled.
+std::vector<Elf_Addr> MakeQueries(const std::vector<std::pair<Elf_Addr, Elf_Addr>>& segments, bool sequential) {
+    std::vector<Elf_Addr> queries;
+    for (const auto& s : segments) {
+        for (Elf_Addr a = s.first; a < s.first + s.second; a += 8) {
+            queries.push_back(a);
+        }
+    }
+    if (!sequential) {
+        std::mt19937 rng(42);
+        std::shuffle(queries.begin(), queries.end(), rng);
+    }
+    return queries;
+}
+
+template <class F, class G>
+void Run(const std::string& name, const std::vector<Elf_Addr>& queries, F indexed, G linear) {
+    for (Elf_Addr q : queries) {
+        CHECK_EQ(indexed(q), linear(q)) << SOLD_LOG_64BITS(q);
+    }
+
+    uint64_t checksum = 0;
+    double indexed_ns = Measure(queries, indexed, &checksum);
+    double linear_ns = Measure(queries, linear, &checksum);
+    std::cout << name << ": queries=" << queries.size() << " indexed=" << indexed_ns << "ns/op linear=" << linear_ns
+              << "ns/op speedup=" << linear_ns / indexed_ns << " checksum=" << HexString(checksum) << std::endl;
+}
+
+// Translation over many synthetic segments, where the binary search of
+// SegmentIndex matters more than for the few PT_LOADs of real inputs.
+void RunSynthetic(size_t num_segments) {
+    const uintptr_t kSegmentSize = 0x1000;
+    SegmentIndex index;
+    std::vector<std::pair<Elf_Addr, Elf_Addr>> segments;
+    for (size_t i = 0; i < num_segments; ++i) {
+        // Leave gaps between segments like PT_LOADs aligned to pages.
+        const uintptr_t start = i * kSegmentSize * 2;
+        index.Add(start, kSegmentSize, start / 2);
+        segments.emplace_back(start, kSegmentSize);
+    }
+    index.Build();
+
+    size_t hint = 0;
+    auto indexed = [&index, &hint](Elf_Addr a) {
+        uintptr_t out;
+        CHECK(index.Translate(a, &out, &hint));
+        return out;
+    };
+    auto linear = [&segments](Elf_Addr a) {
+        for (const auto& s : segments) {
+            if (s.first <= a && a < s.first + s.second) return s.first / 2 + a - s.first;
+        }
+        LOG(FATAL) << "Address " << HexString(a, 16) << " cannot be resolved";
+    };
+
+    const std::string name = "Synthetic " + std::to_string(num_segments) + " segments";
+    Run(name + " sequential", MakeQueries(segments, true), indexed, linear);
+    Run(name + " random", MakeQueries(segments, false), indexed, linear);
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <in-elf>\nThis program measures address translation throughput of the given ELF file."
+                  << std::endl;
+        return 1;
+    }
+
+    auto b = ReadELF(argv[1]);
+    std::cout << "file=" << argv[1] << " loads=" << b->loads().size() << std::endl;
+
+    std::vector<std::pair<Elf_Addr, Elf_Addr>> vaddrs;
+    std::vector<std::pair<Elf_Addr, Elf_Addr>> offsets;
+    for (Elf_Phdr* phdr : b->loads()) {
+        vaddrs.emplace_back(phdr->p_vaddr, phdr->p_memsz);
+        offsets.emplace_back(phdr->p_offset, phdr->p_filesz);
+    }
+
+    const ELFBinary& bin = *b;
+    auto indexed_o = [&bin](Elf_Addr a) { return bin.OffsetFromAddr(a); };
+    auto linear_o = [&bin](Elf_Addr a) { return LinearOffsetFromAddr(bin, a); };
+    auto indexed_a = [&bin](Elf_Addr o) { return bin.AddrFromOffset(o); };
+    auto linear_a = [&bin](Elf_Addr o) { return LinearAddrFromOffset(bin, o); };
+
+    Run("OffsetFromAddr sequential", MakeQueries(vaddrs, true), indexed_o, linear_o);
+    Run("OffsetFromAddr random", MakeQueries(vaddrs, false), indexed_o, linear_o);
+    Run("AddrFromOffset sequential", MakeQueries(offsets, true), indexed_a, linear_a);
+    Run("AddrFromOffset random", MakeQueries(offsets, false), indexed_a, linear_a);
+
+    RunSynthetic(16);
+    RunSynthetic(256);
+    return 0;
+}
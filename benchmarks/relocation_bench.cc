@@ -0,0 +1,110 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Measures the throughput of RebaseRelativeRelocations compared with
+// rebasing RELATIVE relocations one by one as RelocateSymbol_* does.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "elf_binary.h"
+#include "relative_rebase.h"
+
+namespace {
+
+constexpr size_t kNumRelocations = 4 * 1000 * 1000;
+constexpr int kIterations = 10;
+
+__attribute__((noinline)) void RebaseOneByOne(const std::vector<Elf_Rel>& rels, uintptr_t offset, std::vector<Elf_Rel>* out) {
+    for (const Elf_Rel& rel : rels) {
+        Elf_Rel newrel = rel;
+        newrel.r_offset += offset;
+        newrel.r_addend += offset;
+        out->push_back(newrel);
+    }
+}
+
+void RebaseBatched(const std::vector<Elf_Rel>& rels, uintptr_t offset, std::vector<Elf_Rel>* out) {
+    const size_t pos = out->size();
+    out->resize(pos + rels.size());
+    RebaseRelativeRelocations(rels.data(), rels.size(), offset, &(*out)[pos]);
+}
+
+// Returns nanoseconds per relocation of f.
+template <class F>
+double Measure(const std::vector<Elf_Rel>& rels, F f, std::vector<Elf_Rel>* out) {
+    // We reuse the output buffer so that page faults on it are not measured.
+    out->reserve(rels.size());
+    double best = 0;
+    for (int i = 0; i < kIterations; ++i) {
+        out->clear();
+        auto start = std::chrono::steady_clock::now();
+        f(rels, 0x10000000, out);
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        if (i == 0 || ns < best) best = ns;
+    }
+    return best / rels.size();
+}
+
+void Run(const std::string& name, const std::vector<Elf_Rel>& rels) {
+    std::vector<Elf_Rel> batched, one_by_one;
+    double batched_ns = Measure(rels, RebaseBatched, &batched);
+    double one_by_one_ns = Measure(rels, RebaseOneByOne, &one_by_one);
+    CHECK_EQ(batched.size(), one_by_one.size());
+    for (size_t i = 0; i < batched.size(); ++i) {
+        CHECK(batched[i].r_offset == one_by_one[i].r_offset && batched[i].r_info == one_by_one[i].r_info &&
+              batched[i].r_addend == one_by_one[i].r_addend)
+            << SOLD_LOG_KEY(i);
+    }
+    std::cout << name << ": relocations=" << rels.size() << " batched=" << batched_ns << "ns/rel one_by_one=" << one_by_one_ns
+              << "ns/rel speedup=" << one_by_one_ns / batched_ns << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    if (argc > 2) {
+        std::cerr << "Usage: " << argv[0] << " [<in-elf>]\nThis program measures throughput of rebasing RELATIVE relocations. "
+                  << "When an ELF file is given, its RELATIVE relocations are repeated to make the input." << std::endl;
+        return 1;
+    }
+
+    std::vector<Elf_Rel> rels;
+    if (argc == 2) {
+        auto b = ReadELF(argv[1]);
+        const uint16_t machine = b->ehdr()->e_machine;
+        std::vector<Elf_Rel> relatives;
+        for (size_t i = 0; i < b->num_rels(); ++i) {
+            if (IsPlainRelative(b->rel()[i], machine)) relatives.push_back(b->rel()[i]);
+        }
+        std::cout << "file=" << argv[1] << " rels=" << b->num_rels() << " relatives=" << relatives.size() << std::endl;
+        CHECK(!relatives.empty()) << argv[1] << " has no RELATIVE relocations.";
+        while (rels.size() < kNumRelocations) {
+            rels.insert(rels.end(), relatives.begin(), relatives.end());
+        }
+    } else {
+        std::mt19937_64 rng(42);
+        for (size_t i = 0; i < kNumRelocations; ++i) {
+            rels.push_back(Elf_Rel{0x1000 + i * 8, ELF_R_INFO(0, R_X86_64_RELATIVE), static_cast<Elf64_Sxword>(rng() & 0xffffff)});
+        }
+    }
+
+    Run(argc == 2 ? "File" : "Synthetic", rels);
+    return 0;
+}
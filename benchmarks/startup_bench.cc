@@ -0,0 +1,424 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Compares the startup cost of a shared object and its sold output, e.g.
+//
+//   startup_bench --runs 50 libfoo.so libfoo.sold.so
+//
+// Each input is loaded by startup_probe in a fresh process, either with
+// LD_PRELOAD, which measures exec-to-main, or with dlopen. Every combination
+// runs with a warm and a cold page cache and is printed as a line of JSON with
+// the latency distribution, page faults, VMAs, PSS and the relocation
+// statistics of ld.so. The statistics are available only when the input is
+// loaded at startup. They are taken with LD_BIND_NOW so that they count PLT
+// relocations, which sold may bind eagerly, for both inputs.
+//
+// With --check, startup_bench fails when the sold output cannot be loaded,
+// maps more files, processes more relocations or looks up more symbols than
+// the original, which ctest uses to catch regressions. Latencies are too noisy
+// to be checked and VMAs are only reported.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "elf_binary.h"
+#include "json_writer.h"
+
+extern char** environ;
+
+namespace {
+
+enum class Mode { kExec, kDlopen };
+enum class Cache { kWarm, kCold };
+
+// A line printed by startup_probe.
+struct ProbeResult {
+    double latency_us;
+    int64_t minor_faults;
+    int64_t major_faults;
+    int64_t vmas;
+    int64_t vmas_created;
+    int64_t pss_kb;
+    std::vector<std::string> files;
+};
+
+// Relocation statistics of ld.so at startup. ld.so prints symbol lookups as
+// "number of relocations". Relocations from cache reuse the result of the
+// previous symbol lookup. ld.so counts only relative relocations covered by
+// DT_RELACOUNT as relative.
+struct LoaderStats {
+    int64_t symbol_lookups{-1};
+    int64_t relocations_from_cache{-1};
+    int64_t relative_relocations{-1};
+
+    int64_t relocations() const { return symbol_lookups + relocations_from_cache + relative_relocations; }
+};
+
+struct Row {
+    std::string input;
+    Mode mode;
+    Cache cache;
+    std::vector<ProbeResult> runs;
+    LoaderStats stats;
+};
+
+std::string ProbePath() {
+    char buf[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    CHECK(len > 0) << "readlink(/proc/self/exe) failed";
+    buf[len] = '\0';
+    std::string dir(buf);
+    return dir.substr(0, dir.rfind('/') + 1) + "startup_probe";
+}
+
+int64_t JSONInt(const std::string& line, const std::string& key) {
+    size_t pos = line.find("\"" + key + "\":");
+    CHECK(pos != std::string::npos) << "No " << key << " in " << line;
+    return std::stoll(line.substr(pos + key.size() + 3));
+}
+
+double JSONDouble(const std::string& line, const std::string& key) {
+    size_t pos = line.find("\"" + key + "\":");
+    CHECK(pos != std::string::npos) << "No " << key << " in " << line;
+    return std::stod(line.substr(pos + key.size() + 3));
+}
+
+// startup_probe does not escape paths, so strings are delimited by quotes.
+std::vector<std::string> JSONStrings(const std::string& line, const std::string& key) {
+    size_t pos = line.find("\"" + key + "\":[");
+    CHECK(pos != std::string::npos) << "No " << key << " in " << line;
+    const size_t end = line.find(']', pos);
+    std::vector<std::string> strs;
+    for (pos = line.find('"', pos + key.size() + 3); pos < end; pos = line.find('"', pos + 1)) {
+        const size_t close = line.find('"', pos + 1);
+        strs.push_back(line.substr(pos + 1, close - pos - 1));
+        pos = close;
+    }
+    return strs;
+}
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Runs startup_probe once and returns its output. input can be empty to
+// measure the probe itself.
+std::string RunProbe(const std::string& probe, const std::string& input, Mode mode, const std::string& debug_output) {
+    // Variables such as LD_LIBRARY_PATH are passed through to find dependencies.
+    std::vector<std::string> env;
+    for (char** e = environ; *e; ++e) {
+        const std::string v(*e);
+        const std::string name = v.substr(0, v.find('='));
+        if (name != "LD_PRELOAD" && name != "LD_DEBUG" && name != "LD_DEBUG_OUTPUT" && name != "LD_BIND_NOW" &&
+            name != "STARTUP_PROBE_START_NS") {
+            env.push_back(v);
+        }
+    }
+    if (mode == Mode::kExec && !input.empty()) env.push_back("LD_PRELOAD=" + input);
+    if (!debug_output.empty()) {
+        env.push_back("LD_DEBUG=statistics");
+        env.push_back("LD_DEBUG_OUTPUT=" + debug_output);
+        env.push_back("LD_BIND_NOW=1");
+    }
+    std::vector<std::string> args = {probe};
+    if (mode == Mode::kDlopen) {
+        args.push_back("--dlopen");
+        args.push_back(input);
+    }
+
+    int fds[2];
+    CHECK(pipe(fds) == 0);
+    pid_t pid = fork();
+    CHECK(pid >= 0) << "fork failed";
+    if (pid == 0) {
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        std::vector<char*> argv;
+        for (std::string& a : args) argv.push_back(&a[0]);
+        argv.push_back(nullptr);
+        env.push_back("STARTUP_PROBE_START_NS=" + std::to_string(NowNs()));
+        std::vector<char*> envp;
+        for (std::string& e : env) envp.push_back(&e[0]);
+        envp.push_back(nullptr);
+        execve(probe.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) out.append(buf, n);
+    close(fds[0]);
+    int status;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0) << "startup_probe failed for " << input;
+    return out;
+}
+
+ProbeResult ParseProbe(const std::string& line) {
+    ProbeResult r;
+    r.latency_us = JSONDouble(line, "latency_us");
+    r.minor_faults = JSONInt(line, "minor_faults");
+    r.major_faults = JSONInt(line, "major_faults");
+    r.vmas = JSONInt(line, "vmas");
+    r.vmas_created = JSONInt(line, "vmas_created");
+    r.pss_kb = JSONInt(line, "pss_kb");
+    r.files = JSONStrings(line, "files");
+    return r;
+}
+
+// Parses the statistics which ld.so prints after relocating at startup. Lines
+// starting with "final" are printed at exit and include lazy binding.
+LoaderStats ParseLoaderStats(const std::string& filename) {
+    LoaderStats stats;
+    std::ifstream ifs(filename);
+    std::string line;
+    while (std::getline(ifs, line)) {
+        size_t pos = line.find_first_not_of(" \t", line.find(':') + 1);
+        if (pos == std::string::npos) continue;
+        const std::string l = line.substr(pos);
+        size_t colon = l.find(": ");
+        if (colon == std::string::npos) continue;
+        const std::string key = l.substr(0, colon);
+        int64_t* field = nullptr;
+        if (key == "number of relocations") {
+            field = &stats.symbol_lookups;
+        } else if (key == "number of relocations from cache") {
+            field = &stats.relocations_from_cache;
+        } else if (key == "number of relative relocations") {
+            field = &stats.relative_relocations;
+        }
+        if (field && *field < 0) *field = std::stoll(l.substr(colon + 2));
+    }
+    return stats;
+}
+
+LoaderStats MeasureLoaderStats(const std::string& probe, const std::string& input) {
+    char dir[] = "/tmp/startup_bench.XXXXXX";
+    CHECK(mkdtemp(dir)) << "mkdtemp failed";
+    const std::string prefix = std::string(dir) + "/ld_debug";
+    RunProbe(probe, input, Mode::kExec, prefix);
+    // ld.so appends the pid to LD_DEBUG_OUTPUT.
+    LoaderStats stats;
+    DIR* d = opendir(dir);
+    CHECK(d) << "opendir failed: " << dir;
+    while (struct dirent* e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        const std::string path = std::string(dir) + "/" + e->d_name;
+        stats = ParseLoaderStats(path);
+        unlink(path.c_str());
+    }
+    closedir(d);
+    rmdir(dir);
+    return stats;
+}
+
+// Drops files from the page cache. Pages which other processes map, such as
+// those of libc, stay in the cache, so cold runs mainly evict the inputs.
+void DropCaches(const std::vector<std::string>& files) {
+    for (const std::string& f : files) {
+        int fd = open(f.c_str(), O_RDONLY);
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+Row Measure(const std::string& probe, const std::string& input, Mode mode, Cache cache, int runs) {
+    Row row{input, mode, cache, {}, {}};
+    // The first run warms the cache and tells us which files to drop.
+    const std::vector<std::string> files = ParseProbe(RunProbe(probe, input, mode, "")).files;
+    for (int i = 0; i < runs; ++i) {
+        if (cache == Cache::kCold) DropCaches(files);
+        row.runs.push_back(ParseProbe(RunProbe(probe, input, mode, "")));
+    }
+    if (mode == Mode::kExec) row.stats = MeasureLoaderStats(probe, input);
+    return row;
+}
+
+template <class T>
+T Percentile(std::vector<T> v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+template <class F>
+auto MedianOf(const Row& row, F f) -> decltype(f(row.runs[0])) {
+    std::vector<decltype(f(row.runs[0]))> v;
+    for (const ProbeResult& r : row.runs) v.push_back(f(r));
+    return Percentile(v, 0.5);
+}
+
+void PrintRow(const Row& row) {
+    JSONWriter w(std::cout);
+    w.BeginObject();
+    w.Key("input");
+    w.String(row.input.empty() ? "(none)" : row.input);
+    w.Key("mode");
+    w.String(row.mode == Mode::kExec ? "exec" : "dlopen");
+    w.Key("cache");
+    w.String(row.cache == Cache::kWarm ? "warm" : "cold");
+    w.Key("runs");
+    w.Int(row.runs.size());
+
+    std::vector<double> latencies;
+    for (const ProbeResult& r : row.runs) latencies.push_back(r.latency_us);
+    w.Key("latency_us");
+    w.BeginObject();
+    for (const auto& p : std::vector<std::pair<const char*, double>>{{"min", 0.0}, {"median", 0.5}, {"p90", 0.9}, {"max", 1.0}}) {
+        w.Key(p.first);
+        w.Double(Percentile(latencies, p.second));
+    }
+    w.EndObject();
+
+    w.Key("minor_faults");
+    w.Int(MedianOf(row, [](const ProbeResult& r) { return r.minor_faults; }));
+    w.Key("major_faults");
+    w.Int(MedianOf(row, [](const ProbeResult& r) { return r.major_faults; }));
+    w.Key("vmas");
+    w.Int(MedianOf(row, [](const ProbeResult& r) { return r.vmas; }));
+    w.Key("vmas_created");
+    w.Int(MedianOf(row, [](const ProbeResult& r) { return r.vmas_created; }));
+    w.Key("pss_kb");
+    w.Int(MedianOf(row, [](const ProbeResult& r) { return r.pss_kb; }));
+
+    if (row.mode == Mode::kExec) {
+        w.Key("relocations");
+        w.Int(row.stats.relocations());
+        w.Key("relocations_from_cache");
+        w.Int(row.stats.relocations_from_cache);
+        w.Key("relative_relocations");
+        w.Int(row.stats.relative_relocations);
+        w.Key("symbol_lookups");
+        w.Int(row.stats.symbol_lookups);
+    }
+    w.EndObject();
+    std::cout << std::endl;
+}
+
+const Row& FindRow(const std::vector<Row>& rows, const std::string& input, Mode mode, Cache cache) {
+    for (const Row& row : rows) {
+        if (row.input == input && row.mode == mode && row.cache == cache) return row;
+    }
+    LOG(FATAL) << "No row for " << input;
+    abort();
+}
+
+void CheckSharedObject(const std::string& filename) {
+    auto b = ReadELF(filename);
+    CHECK(b->ehdr()->e_type == ET_DYN) << filename << " is not a shared object";
+    for (const Elf_Phdr* phdr : b->phdrs()) {
+        CHECK(phdr->p_type != PT_INTERP) << filename << " is an executable. startup_bench supports only shared objects.";
+    }
+}
+
+void PrintHelp(std::ostream& os) {
+    os << R"(usage: startup_bench [option]... ORIGINAL BUNDLED
+
+Measures the startup cost of ORIGINAL and its sold output BUNDLED.
+
+--runs N     Runs of each configuration (default: 20)
+--check      Fail when BUNDLED maps more files, processes more relocations or
+             looks up more symbols than ORIGINAL
+
+Each configuration is printed as a line of JSON. The first line measures
+startup_probe without any input.
+)";
+}
+
+}  // namespace
+
+int main(int argc, char* const argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"runs", required_argument, nullptr, 1},
+        {"check", no_argument, nullptr, 2},
+        {0, 0, 0, 0},
+    };
+
+    int runs = 20;
+    bool check = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 1:
+                runs = std::stoi(optarg);
+                break;
+            case 2:
+                check = true;
+                break;
+            case 'h':
+                PrintHelp(std::cout);
+                return 0;
+            default:
+                PrintHelp(std::cerr);
+                return 1;
+        }
+    }
+    if (argc - optind != 2 || runs <= 0) {
+        PrintHelp(std::cerr);
+        return 1;
+    }
+    const std::string original = argv[optind];
+    const std::string bundled = argv[optind + 1];
+    CheckSharedObject(original);
+    CheckSharedObject(bundled);
+
+    const std::string probe = ProbePath();
+    CHECK(access(probe.c_str(), X_OK) == 0) << probe << " is not found";
+
+    PrintRow(Measure(probe, "", Mode::kExec, Cache::kWarm, runs));
+    std::vector<Row> rows;
+    for (const std::string& input : {original, bundled}) {
+        for (Mode mode : {Mode::kExec, Mode::kDlopen}) {
+            for (Cache cache : {Cache::kWarm, Cache::kCold}) {
+                rows.push_back(Measure(probe, input, mode, cache, runs));
+                PrintRow(rows.back());
+            }
+        }
+    }
+
+    if (!check) return 0;
+    bool ok = true;
+    auto check_le = [&ok](const char* what, int64_t b, int64_t o) {
+        if (b <= o) return;
+        std::cerr << "Bundled output " << what << " than the original: " << b << " > " << o << std::endl;
+        ok = false;
+    };
+    const Row& o_dlopen = FindRow(rows, original, Mode::kDlopen, Cache::kWarm);
+    const Row& b_dlopen = FindRow(rows, bundled, Mode::kDlopen, Cache::kWarm);
+    check_le("maps more files", b_dlopen.runs[0].files.size(), o_dlopen.runs[0].files.size());
+    // Relocation statistics do not depend on runs or the page cache.
+    const LoaderStats& o_stats = FindRow(rows, original, Mode::kExec, Cache::kWarm).stats;
+    const LoaderStats& b_stats = FindRow(rows, bundled, Mode::kExec, Cache::kWarm).stats;
+    check_le("processes more relocations", b_stats.relocations(), o_stats.relocations());
+    check_le("looks up more symbols", b_stats.symbol_lookups, o_stats.symbol_lookups);
+    return ok ? 0 : 1;
+}
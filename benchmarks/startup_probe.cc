@@ -0,0 +1,135 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// startup_probe is executed by startup_bench to measure the load of a shared
+// object from inside a fresh process. It uses only libc so that its own
+// startup cost is small and the same for every input.
+//
+//   STARTUP_PROBE_START_NS=<CLOCK_MONOTONIC> LD_PRELOAD=lib.so startup_probe
+//     measures exec-to-main latency of a process which loads lib.so.
+//   startup_probe --dlopen lib.so
+//     measures dlopen of lib.so.
+//
+// The result is printed as a line of JSON.
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+namespace {
+
+struct Sample {
+    long minor_faults;
+    long major_faults;
+    int vmas;
+};
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+Sample TakeSample() {
+    Sample s;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    s.minor_faults = usage.ru_minflt;
+    s.major_faults = usage.ru_majflt;
+    s.vmas = 0;
+
+    FILE* fp = fopen("/proc/self/maps", "r");
+    if (!fp) return s;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp)) s.vmas++;
+    fclose(fp);
+    return s;
+}
+
+// Prints files mapped in this process as a JSON array. VMAs of a file are
+// adjacent in /proc/self/maps, so we skip repeated paths.
+void PrintFiles() {
+    printf("[");
+    FILE* fp = fopen("/proc/self/maps", "r");
+    if (fp) {
+        char line[4096];
+        char prev[4096] = "";
+        bool first = true;
+        while (fgets(line, sizeof(line), fp)) {
+            char* path = strchr(line, '/');
+            if (!path) continue;
+            path[strcspn(path, "\n")] = '\0';
+            if (strcmp(path, prev) == 0) continue;
+            snprintf(prev, sizeof(prev), "%s", path);
+            printf("%s\"%s\"", first ? "" : ",", path);
+            first = false;
+        }
+        fclose(fp);
+    }
+    printf("]");
+}
+
+long PssKb() {
+    FILE* fp = fopen("/proc/self/smaps_rollup", "r");
+    if (!fp) return -1;
+    char line[256];
+    long pss = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "Pss: %ld kB", &pss) == 1) break;
+    }
+    fclose(fp);
+    return pss;
+}
+
+// Paths are printed without escaping because startup_bench only passes paths
+// which appear in /proc/self/maps back to posix_fadvise.
+void Print(double latency_us, const Sample& before, const Sample& after) {
+    printf("{\"latency_us\":%.3f,\"minor_faults\":%ld,\"major_faults\":%ld,\"vmas\":%d,\"vmas_created\":%d,\"pss_kb\":%ld,\"files\":",
+           latency_us, after.minor_faults - before.minor_faults, after.major_faults - before.major_faults, after.vmas,
+           after.vmas - before.vmas, PssKb());
+    PrintFiles();
+    printf("}\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--dlopen") == 0) {
+        const Sample before = TakeSample();
+        const uint64_t start = NowNs();
+        void* handle = dlopen(argv[2], RTLD_NOW | RTLD_LOCAL);
+        const uint64_t end = NowNs();
+        if (!handle) {
+            fprintf(stderr, "dlopen failed: %s\n", dlerror());
+            return 1;
+        }
+        Print((end - start) / 1000.0, before, TakeSample());
+        return 0;
+    }
+
+    const uint64_t now = NowNs();
+    const char* start = getenv("STARTUP_PROBE_START_NS");
+    if (argc != 1 || !start) {
+        fprintf(stderr, "usage: STARTUP_PROBE_START_NS=<ns> LD_PRELOAD=<lib> %s\n       %s --dlopen <lib>\n", argv[0], argv[0]);
+        return 1;
+    }
+    // Everything since exec counts, so the baseline is zero.
+    Print((now - strtoull(start, nullptr, 10)) / 1000.0, Sample{0, 0, 0}, TakeSample());
+    return 0;
+}
@@ -0,0 +1,266 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Generates a graph of synthetic shared objects, links them with Sold::Link
+// and reports time and memory of each phase as JSON lines, e.g.
+//
+//   synthetic_link_bench --libs 10,100,300 --symbols 200 --relocs 4
+//
+// syn0 is the root and synK depends on synK+1, ..., synK+fanout. Each
+// library has the given number of functions, each of which calls the
+// functions with the same index in the dependencies and has a table of
+// pointers, i.e. relocations, to functions of itself and its dependencies.
+// Shared objects are compiled with $CC (default: cc).
+
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "json_writer.h"
+#include "sold.h"
+#include "trace.h"
+
+namespace {
+
+struct Config {
+    int libs;
+    int symbols{100};
+    int relocs{4};
+    int tls{4};
+    int versioned{0};
+    int fdes{0};
+    int fanout{2};
+};
+
+std::string LibName(int k) { return "syn" + std::to_string(k); }
+
+std::vector<int> Deps(const Config& c, int k) {
+    std::vector<int> deps;
+    for (int j = k + 1; j <= k + c.fanout && j < c.libs; ++j) deps.push_back(j);
+    return deps;
+}
+
+std::string GenerateSource(const Config& c, int k) {
+    const std::string name = LibName(k);
+    const std::vector<int> deps = Deps(c, k);
+    std::ostringstream ss;
+    for (int j : deps) {
+        for (int m = 0; m < c.symbols; ++m) ss << "extern int " << LibName(j) << "_f" << m << "(void);\n";
+    }
+    // Half of TLS variables are in .tdata and the others are in .tbss.
+    for (int t = 0; t < c.tls; ++t) {
+        ss << "__thread int " << name << "_tls" << t << (t % 2 == 0 ? " = " + std::to_string(t + 1) : "") << ";\n";
+    }
+    // Each static function has its own FDE.
+    for (int f = 0; f < c.fdes; ++f) {
+        ss << "__attribute__((noinline, used)) static int " << name << "_frame" << f << "(int x) { return x * " << f + 1 << "; }\n";
+    }
+    for (int m = 0; m < c.symbols; ++m) {
+        ss << "__attribute__((noinline)) int " << name << "_f" << m << "(void) {\n  int r = " << m << ";\n";
+        for (int j : deps) ss << "  r += " << LibName(j) << "_f" << m << "();\n";
+        if (c.tls > 0) ss << "  r += " << name << "_tls" << m % c.tls << "++;\n";
+        if (m == 0) {
+            for (int f = 0; f < c.fdes; ++f) ss << "  r += " << name << "_frame" << f << "(r);\n";
+        }
+        ss << "  return r;\n}\n";
+    }
+    // Tables of pointers alternate local functions, which need RELATIVE
+    // relocations, and functions of dependencies, which need symbolic ones.
+    for (int m = 0; m < c.symbols; ++m) {
+        ss << "void* " << name << "_tab" << m << "[] = {";
+        for (int r = 0; r < c.relocs; ++r) {
+            const int f = (m + r) % c.symbols;
+            if (r % 2 == 0 || deps.empty()) {
+                ss << "(void*)&" << name << "_f" << f << ", ";
+            } else {
+                ss << "(void*)&" << LibName(deps[r % deps.size()]) << "_f" << f << ", ";
+            }
+        }
+        ss << "0};\n";
+    }
+    return ss.str();
+}
+
+// The first c.versioned functions are in version SYNK_1.0 and the others
+// are in SYNK_2.0. Note that sold does not emit version definitions yet, so
+// ld.so cannot load outputs linked from versioned inputs. They are still
+// useful to measure VersionBuilder.
+std::string GenerateVersionScript(const Config& c, int k) {
+    const std::string name = LibName(k);
+    std::ostringstream ss;
+    ss << "SYN" << k << "_1.0 {\n  global:\n";
+    for (int m = 0; m < c.versioned && m < c.symbols; ++m) ss << "    " << name << "_f" << m << ";\n";
+    ss << "};\nSYN" << k << "_2.0 {\n  global:\n    *;\n};\n";
+    return ss.str();
+}
+
+void Run(const std::string& command) {
+    LOG(INFO) << command;
+    CHECK(system(command.c_str()) == 0) << "Failed: " << command;
+}
+
+// Returns the filename of the root shared object.
+std::string Generate(const Config& c, const std::string& dir) {
+    const char* cc = getenv("CC") ? getenv("CC") : "cc";
+    Run("mkdir -p " + dir);
+    for (int k = c.libs - 1; k >= 0; --k) {
+        const std::string base = dir + "/lib" + LibName(k);
+        std::ofstream(base + ".c") << GenerateSource(c, k);
+        std::string command = std::string(cc) + " -shared -fPIC -O1 -o " + base + ".so " + base + ".c -L" + dir + " -Wl,-soname,lib" + LibName(k) +
+                              ".so -Wl,-rpath,'$ORIGIN'";
+        if (c.versioned > 0) {
+            std::ofstream(base + ".map") << GenerateVersionScript(c, k);
+            command += " -Wl,--version-script=" + base + ".map";
+        }
+        for (int j : Deps(c, k)) command += " -l" + LibName(j);
+        Run(command);
+    }
+    return dir + "/lib" + LibName(0) + ".so";
+}
+
+std::vector<int> ParseInts(const std::string& s) {
+    std::vector<int> r;
+    for (const std::string& v : SplitString(s, ",")) r.push_back(std::stoi(v));
+    return r;
+}
+
+void PrintHelp(std::ostream& os) {
+    os << R"(usage: synthetic_link_bench [option]
+Options:
+--libs N[,N...]      Numbers of shared objects (default: 10,30,100)
+--symbols N          Functions per shared object (default: 100)
+--relocs N           Relocations per function (default: 4)
+--tls N              TLS variables per shared object (default: 4)
+--versioned N        Functions per shared object in a non-default version (default: 0)
+--fdes N             Extra FDEs per shared object (default: 0)
+--fanout N           Dependencies per shared object (default: 2)
+--work-dir DIR       Where shared objects are generated (default: synthetic_link_bench_work)
+
+Each configuration is printed as a line of JSON.
+)";
+}
+
+}  // namespace
+
+int main(int argc, char* const argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},         {"libs", required_argument, nullptr, 1},
+        {"symbols", required_argument, nullptr, 2},  {"relocs", required_argument, nullptr, 3},
+        {"tls", required_argument, nullptr, 4},      {"versioned", required_argument, nullptr, 5},
+        {"fdes", required_argument, nullptr, 6},     {"fanout", required_argument, nullptr, 7},
+        {"work-dir", required_argument, nullptr, 8}, {0, 0, 0, 0},
+    };
+
+    Config base;
+    std::vector<int> libs = {10, 30, 100};
+    std::string work_dir = "synthetic_link_bench_work";
+    int opt;
+    while ((opt = getopt_long(argc, argv, "h", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 1:
+                libs = ParseInts(optarg);
+                break;
+            case 2:
+                base.symbols = std::stoi(optarg);
+                break;
+            case 3:
+                base.relocs = std::stoi(optarg);
+                break;
+            case 4:
+                base.tls = std::stoi(optarg);
+                break;
+            case 5:
+                base.versioned = std::stoi(optarg);
+                break;
+            case 6:
+                base.fdes = std::stoi(optarg);
+                break;
+            case 7:
+                base.fanout = std::stoi(optarg);
+                break;
+            case 8:
+                work_dir = optarg;
+                break;
+            case 'h':
+                PrintHelp(std::cout);
+                return 0;
+            default:
+                PrintHelp(std::cerr);
+                return 1;
+        }
+    }
+
+    Tracer::Get().Enable();
+    for (int n : libs) {
+        Config c = base;
+        c.libs = n;
+        const std::string dir = work_dir + "/libs" + std::to_string(n) + "_s" + std::to_string(c.symbols) + "_r" +
+                                std::to_string(c.relocs) + "_t" + std::to_string(c.tls) + "_v" + std::to_string(c.versioned) +
+                                "_f" + std::to_string(c.fdes) + "_o" + std::to_string(c.fanout);
+        const std::string root = Generate(c, dir);
+
+        // Each configuration links in its own process so that it starts
+        // neither with the peak RSS of the previous one nor with the strings
+        // which they interned.
+        std::cout.flush();
+        const pid_t pid = fork();
+        CHECK(pid >= 0);
+        if (pid > 0) {
+            int status;
+            CHECK(waitpid(pid, &status, 0) == pid);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Linking " << root << " failed" << std::endl;
+                return 1;
+            }
+            continue;
+        }
+
+        Tracer::Get().Clear();
+        {
+            TraceSpan span("Total");
+            Sold sold(root, {}, {}, {}, false);
+            sold.Link(dir + "/out.so");
+        }
+
+        JSONWriter w(std::cout);
+        w.BeginObject();
+        w.Key("config");
+        w.BeginObject();
+        for (const auto& p : std::vector<std::pair<const char*, int>>{{"libs", c.libs},
+                                                                       {"symbols", c.symbols},
+                                                                       {"relocs", c.relocs},
+                                                                       {"tls", c.tls},
+                                                                       {"versioned", c.versioned},
+                                                                       {"fdes", c.fdes},
+                                                                       {"fanout", c.fanout}}) {
+            w.Key(p.first);
+            w.Int(p.second);
+        }
+        w.EndObject();
+        w.Key("phases");
+        Tracer::Get().WritePhases(w);
+        w.EndObject();
+        std::cout << std::endl;
+        _exit(0);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Measures TopologicalSort compared with the original implementation in
+// tests/topological_sort_reference.h for bundles with many libraries.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "tests/topological_sort_reference.h"
+#include "topological_sort.h"
+#include "utils.h"
+
+namespace {
+
+// Returns microseconds of f.
+template <class F>
+double Measure(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000.0;
+}
+
+// Makes n libraries where each library depends on num_neededs libraries,
+// like a Python environment where extension modules depend on a few common
+// libraries. The dependency graph is acyclic, but its topological order is
+// shuffled against the initial order so that _dl_sort_maps moves libraries.
+void Run(int n, int num_neededs) {
+    std::mt19937 rng(42);
+    std::vector<int> rank(n);
+    for (int i = 0; i < n; ++i) rank[i] = i;
+    std::shuffle(rank.begin() + 1, rank.end(), rng);
+
+    std::vector<std::vector<int>> neededs(n);
+    std::vector<std::pair<std::string, std::vector<std::string>>> nodes;
+    std::uniform_int_distribution<int> dist(1, std::max(1, n - 1));
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < num_neededs; ++j) {
+            const int d = dist(rng);
+            if (rank[i] < rank[d]) neededs[i].push_back(d);
+        }
+        // glibc and libstdc++ which are not linked.
+        std::vector<std::string> names = {"libc.so.6", "libstdc++.so.6"};
+        for (int d : neededs[i]) names.push_back("lib" + std::to_string(d) + ".so");
+        nodes.emplace_back("lib" + std::to_string(i) + ".so", names);
+    }
+
+    std::vector<int> expected, actual;
+    double reference_us = Measure([&]() { expected = ReferenceTopologicalSort(nodes); });
+    double new_us = Measure([&]() { actual = TopologicalSort(neededs); });
+    CHECK(expected == actual) << SOLD_LOG_KEY(n) << SOLD_LOG_KEY(num_neededs);
+    std::cout << "libraries=" << n << " neededs=" << num_neededs << " new=" << new_us << "us reference=" << reference_us
+              << "us speedup=" << reference_us / new_us << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    google::InitGoogleLogging(argv[0]);
+    for (int n : {10, 30, 100, 300, 1000}) {
+        Run(n, 6);
+    }
+    return 0;
+}
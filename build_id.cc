@@ -0,0 +1,229 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "build_id.h"
+
+#include <string.h>
+#include <sys/types.h>
+
+#include <algorithm>
+
+#include "utils.h"
+
+constexpr size_t BuildIdHasher::kChunkSize;
+constexpr size_t BuildIdHasher::kSize;
+
+namespace {
+
+const uint64_t kPrime1 = 11400714785074694791ULL;
+const uint64_t kPrime2 = 14029467366897019727ULL;
+const uint64_t kPrime3 = 1609587929392839161ULL;
+const uint64_t kPrime4 = 9650029242287828579ULL;
+const uint64_t kPrime5 = 2870177450012600261ULL;
+
+uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t Read64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t Read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * kPrime2;
+    acc = Rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t acc, uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * kPrime1 + kPrime4;
+}
+
+ssize_t CookieWrite(void* cookie, const char* buf, size_t size) {
+    static_cast<BuildIdHasher*>(cookie)->Update(buf, size);
+    return size;
+}
+
+// ftell calls this with SEEK_CUR and 0.
+int CookieSeek(void* cookie, off64_t* pos, int whence) {
+    const off64_t cur = static_cast<BuildIdHasher*>(cookie)->size();
+    if ((whence == SEEK_CUR && *pos == 0) || (whence == SEEK_SET && *pos == cur)) {
+        *pos = cur;
+        return 0;
+    }
+    return -1;
+}
+
+int CookieClose(void*) {
+    return 0;
+}
+
+}  // namespace
+
+uint64_t XXH64(const void* buf, size_t size, uint64_t seed) {
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        uint64_t v1 = seed + kPrime1 + kPrime2;
+        uint64_t v2 = seed + kPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kPrime1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+        }
+        h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h = MergeRound(h, v1);
+        h = MergeRound(h, v2);
+        h = MergeRound(h, v3);
+        h = MergeRound(h, v4);
+    } else {
+        h = seed + kPrime5;
+    }
+
+    h += size;
+    for (; p + 8 <= end; p += 8) {
+        h ^= Round(0, Read64(p));
+        h = Rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        h ^= Read32(p) * kPrime1;
+        h = Rotl(h, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= *p * kPrime5;
+        h = Rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+BuildIdHasher::~BuildIdHasher() {
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        finished_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& t : workers_) {
+        t.join();
+    }
+}
+
+FILE* BuildIdHasher::Wrap(FILE* fp) {
+    out_ = fp;
+    cookie_io_functions_t funcs = {nullptr, CookieWrite, CookieSeek, CookieClose};
+    FILE* wrapped = fopencookie(this, "wb", funcs);
+    CHECK(wrapped);
+    // Make CookieWrite see large blocks.
+    CHECK(setvbuf(wrapped, nullptr, _IOFBF, kChunkSize) == 0);
+    return wrapped;
+}
+
+void BuildIdHasher::Update(const char* buf, size_t size) {
+    if (out_) WriteBuf(out_, buf, size);
+    size_ += size;
+    while (size) {
+        const size_t n = std::min(size, kChunkSize - chunk_.size());
+        chunk_.append(buf, n);
+        buf += n;
+        size -= n;
+        if (chunk_.size() == kChunkSize) Submit();
+    }
+}
+
+void BuildIdHasher::Submit() {
+    std::unique_lock<std::mutex> lock(mu_);
+    if (leaves_.empty()) {
+        // The thread calling Update is busy with Emit, so we leave a core to
+        // it. With a single core, we hash chunks in this thread.
+        const unsigned num_cores = std::min(8U, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < num_cores; ++i) {
+            workers_.emplace_back(&BuildIdHasher::Work, this);
+        }
+    }
+    if (workers_.empty()) {
+        leaves_.push_back(XXH64(chunk_.data(), chunk_.size(), leaves_.size()));
+        chunk_.clear();
+        return;
+    }
+
+    // Bound the memory for chunks waiting for workers.
+    cv_.wait(lock, [this] { return queue_.size() < workers_.size() * 2; });
+    queue_.push_back(Chunk{leaves_.size(), std::string()});
+    queue_.back().data.swap(chunk_);
+    leaves_.push_back(0);
+    // Reuse a buffer hashed by a worker to avoid page faults of new one.
+    if (!free_.empty()) {
+        chunk_.swap(free_.back());
+        free_.pop_back();
+    }
+    chunk_.clear();
+    cv_.notify_all();
+}
+
+void BuildIdHasher::Work() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+        cv_.wait(lock, [this] { return finished_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+        Chunk chunk = std::move(queue_.front());
+        queue_.pop_front();
+        cv_.notify_all();
+
+        lock.unlock();
+        const uint64_t hash = XXH64(chunk.data.data(), chunk.data.size(), chunk.index);
+        lock.lock();
+        leaves_[chunk.index] = hash;
+        free_.push_back(std::move(chunk.data));
+    }
+}
+
+std::string BuildIdHasher::Finish() {
+    // The last chunk is hashed here since most outputs fit in a chunk.
+    const uint64_t last = XXH64(chunk_.data(), chunk_.size(), leaves_.size());
+    {
+        std::lock_guard<std::mutex> lock(mu_);
+        finished_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& t : workers_) {
+        t.join();
+    }
+    workers_.clear();
+    leaves_.push_back(last);
+
+    const uint64_t root[2] = {XXH64(leaves_.data(), leaves_.size() * sizeof(uint64_t), 0),
+                              XXH64(leaves_.data(), leaves_.size() * sizeof(uint64_t), size_)};
+    return std::string(reinterpret_cast<const char*>(root), sizeof(root));
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// BuildIdHasher computes NT_GNU_BUILD_ID of the output while Emit writes it,
+// so that we never read the output again. The output is split into chunks
+// of kChunkSize bytes which worker threads hash with XXH64 seeded by their
+// index. The build-id is two XXH64 of the concatenated chunk hashes.
+//
+// Chunks are hashed as soon as they are filled and at most a few of them are
+// buffered, so the memory use does not depend on the size of the output.
+class BuildIdHasher {
+public:
+    static constexpr size_t kChunkSize = 1 << 20;
+    // The size of the build-id in bytes.
+    static constexpr size_t kSize = 16;
+
+    ~BuildIdHasher();
+
+    // Returns a stream which writes to fp and hashes what is written. It
+    // supports only sequential writes and ftell. Closing it does not close
+    // fp.
+    FILE* Wrap(FILE* fp);
+
+    // Hashes buf and writes it to the wrapped file, if any.
+    void Update(const char* buf, size_t size);
+
+    // Returns the build-id of everything passed to Update.
+    std::string Finish();
+
+    uint64_t size() const { return size_; }
+
+private:
+    struct Chunk {
+        size_t index;
+        std::string data;
+    };
+
+    void Submit();
+    void Work();
+
+    FILE* out_{nullptr};
+    uint64_t size_{0};
+    std::string chunk_;
+    // Hashes of chunks by their index.
+    std::vector<uint64_t> leaves_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::deque<Chunk> queue_;
+    // Buffers of chunks already hashed.
+    std::vector<std::string> free_;
+    std::vector<std::thread> workers_;
+    bool finished_{false};
+};
+
+uint64_t XXH64(const void* buf, size_t size, uint64_t seed);
@@ -0,0 +1,251 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "debug_file.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <memory>
+
+namespace {
+
+// A read-only mapping of a separate debug file.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                head_ = static_cast<const char*>(p);
+                size_ = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (head_) munmap(const_cast<char*>(head_), size_);
+    }
+
+    const char* head() const { return head_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* head_{nullptr};
+    size_t size_{0};
+};
+
+bool IsRegularFile(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// Returns DWARF sections of the ELF file at head. We give up all of them when
+// one is compressed because DwarfMerger cannot patch compressed sections.
+DwarfMerger::Sections ReadDebugSections(const char* head, size_t size, const std::string& name) {
+    DwarfMerger::Sections sections;
+    if (size < sizeof(Elf_Ehdr) || !ELFBinary::IsELF(head) || head[EI_CLASS] != ELFCLASS64) return sections;
+    const Elf_Ehdr* ehdr = reinterpret_cast<const Elf_Ehdr*>(head);
+    if (ehdr->e_shoff == 0 || ehdr->e_shentsize != sizeof(Elf_Shdr) || ehdr->e_shoff + sizeof(Elf_Shdr) * ehdr->e_shnum > size ||
+        ehdr->e_shstrndx >= ehdr->e_shnum) {
+        return sections;
+    }
+    const Elf_Shdr* shdrs = reinterpret_cast<const Elf_Shdr*>(head + ehdr->e_shoff);
+    const char* shstrtab = head + shdrs[ehdr->e_shstrndx].sh_offset;
+
+    for (int i = 0; i < ehdr->e_shnum; ++i) {
+        const Elf_Shdr& shdr = shdrs[i];
+        const std::string section = shstrtab + shdr.sh_name;
+        if (!DwarfMerger::IsSupported(section) || shdr.sh_type == SHT_NOBITS) continue;
+        if (shdr.sh_flags & SHF_COMPRESSED) {
+            LOG(WARNING) << section << " of " << name << " is compressed, which is not supported";
+            return DwarfMerger::Sections();
+        }
+        if (shdr.sh_offset + shdr.sh_size > size) {
+            LOG(WARNING) << section << " of " << name << " is out of the file";
+            return DwarfMerger::Sections();
+        }
+        sections.emplace(section, DwarfMerger::Section{head + shdr.sh_offset, shdr.sh_size});
+    }
+    return sections;
+}
+
+}  // namespace
+
+std::string FindSeparateDebugFile(const ELFBinary& bin) {
+    const std::string& build_id = bin.build_id();
+    if (build_id.size() > 2) {
+        const std::string path = "/usr/lib/debug/.build-id/" + build_id.substr(0, 2) + "/" + build_id.substr(2) + ".debug";
+        if (IsRegularFile(path)) return path;
+    }
+
+    std::string debuglink;
+    for (const Elf_Shdr* shdr : bin.shdrs()) {
+        if (std::string(bin.ShName(*shdr)) == ".gnu_debuglink" && shdr->sh_offset + shdr->sh_size <= bin.size()) {
+            debuglink = std::string(bin.head() + shdr->sh_offset, strnlen(bin.head() + shdr->sh_offset, shdr->sh_size));
+        }
+    }
+    if (debuglink.empty()) return "";
+
+    char resolved[PATH_MAX];
+    std::string dir = realpath(bin.filename().c_str(), resolved) ? resolved : bin.filename();
+    const size_t slash = dir.rfind('/');
+    dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+    for (const std::string& path : {dir + "/" + debuglink, dir + "/.debug/" + debuglink, "/usr/lib/debug" + dir + "/" + debuglink}) {
+        if (path != bin.filename() && IsRegularFile(path)) return path;
+    }
+    return "";
+}
+
+uint32_t GnuDebuglinkCRC(const std::string& filename) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+    }
+
+    FILE* fp = fopen(filename.c_str(), "rb");
+    CHECK(fp) << "Failed to open " << filename;
+    uint32_t crc = 0xffffffff;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            crc = table[(crc ^ static_cast<uint8_t>(buf[i])) & 0xff] ^ (crc >> 8);
+        }
+    }
+    fclose(fp);
+    return crc ^ 0xffffffff;
+}
+
+void DebugFileBuilder::AddInput(const ELFBinary& bin, uintptr_t offset, const std::function<uint64_t(uint64_t)>& remap_tls) {
+    DwarfMerger::Sections sections = ReadDebugSections(bin.head(), bin.size(), bin.name());
+    std::unique_ptr<MappedFile> separate;
+    if (!sections.count(".debug_info")) {
+        const std::string path = FindSeparateDebugFile(bin);
+        if (path.empty()) {
+            LOG(INFO) << "No debug info for " << bin.name();
+            return;
+        }
+        LOG(INFO) << "Debug info of " << bin.name() << " is in " << path;
+        separate = std::make_unique<MappedFile>(path);
+        sections = ReadDebugSections(separate->head(), separate->size(), path);
+        if (!sections.count(".debug_info")) return;
+    }
+    dwarf_.Add(bin.name(), sections, [offset](uint64_t addr) { return addr + offset; }, remap_tls);
+}
+
+void DebugFileBuilder::Write(const std::string& filename, const std::string& output_filename, const Elf_Ehdr& ehdr,
+                             const std::vector<Elf_Shdr>& shdrs, const std::string& shstrtab, const std::vector<Elf_Sym>& symtab,
+                             const std::string& strtab) const {
+    struct Blob {
+        size_t index;
+        std::string data;
+    };
+    std::vector<Blob> blobs;
+    std::vector<Elf_Shdr> out_shdrs = shdrs;
+    std::string out_shstrtab = shstrtab;
+    auto add_section = [&out_shdrs, &out_shstrtab, &blobs](const std::string& name, Elf_Shdr shdr, std::string data) {
+        shdr.sh_name = out_shstrtab.size();
+        out_shstrtab += name;
+        out_shstrtab += '\0';
+        out_shdrs.push_back(shdr);
+        blobs.push_back(Blob{out_shdrs.size() - 1, std::move(data)});
+    };
+
+    // Keep the indices of sections of the output so that st_shndx in symtab
+    // is valid.
+    FILE* out = fopen(output_filename.c_str(), "rb");
+    CHECK(out) << "Failed to open " << output_filename;
+    for (size_t i = 1; i < out_shdrs.size(); ++i) {
+        Elf_Shdr& shdr = out_shdrs[i];
+        if (i == ehdr.e_shstrndx) continue;
+        if (shdr.sh_type == SHT_NOTE) {
+            std::string data(shdr.sh_size, '\0');
+            CHECK(fseek(out, shdr.sh_offset, SEEK_SET) == 0 && fread(&data[0], data.size(), 1, out) == 1);
+            blobs.push_back(Blob{i, data});
+        } else {
+            shdr.sh_type = SHT_NOBITS;
+            shdr.sh_offset = sizeof(Elf_Ehdr);
+        }
+    }
+    fclose(out);
+
+    Elf_Shdr symtab_shdr = {0};
+    symtab_shdr.sh_type = SHT_SYMTAB;
+    symtab_shdr.sh_entsize = sizeof(Elf_Sym);
+    symtab_shdr.sh_addralign = 8;
+    symtab_shdr.sh_link = out_shdrs.size() + 1;
+    while (symtab_shdr.sh_info < symtab.size() && ELF_ST_BIND(symtab[symtab_shdr.sh_info].st_info) == STB_LOCAL) {
+        symtab_shdr.sh_info++;
+    }
+    add_section(".symtab", symtab_shdr, std::string(reinterpret_cast<const char*>(symtab.data()), sizeof(Elf_Sym) * symtab.size()));
+
+    Elf_Shdr strtab_shdr = {0};
+    strtab_shdr.sh_type = SHT_STRTAB;
+    strtab_shdr.sh_addralign = 1;
+    add_section(".strtab", strtab_shdr, strtab);
+
+    for (const auto& p : dwarf_.sections()) {
+        if (p.second.empty()) continue;
+        Elf_Shdr shdr = {0};
+        shdr.sh_type = SHT_PROGBITS;
+        shdr.sh_addralign = 1;
+        add_section(p.first, shdr, p.second);
+    }
+
+    blobs.push_back(Blob{ehdr.e_shstrndx, out_shstrtab});
+
+    uintptr_t offset = sizeof(Elf_Ehdr);
+    for (const Blob& blob : blobs) {
+        Elf_Shdr& shdr = out_shdrs[blob.index];
+        if (shdr.sh_addralign > 1) offset = AlignNext(offset, shdr.sh_addralign - 1);
+        shdr.sh_offset = offset;
+        shdr.sh_size = blob.data.size();
+        offset += blob.data.size();
+    }
+
+    Elf_Ehdr out_ehdr = ehdr;
+    out_ehdr.e_phoff = 0;
+    out_ehdr.e_phnum = 0;
+    out_ehdr.e_shoff = AlignNext(offset, 7);
+    out_ehdr.e_shnum = out_shdrs.size();
+
+    FILE* fp = fopen(filename.c_str(), "wb");
+    CHECK(fp) << "Failed to open " << filename;
+    ::Write(fp, out_ehdr);
+    for (const Blob& blob : blobs) {
+        EmitPad(fp, out_shdrs[blob.index].sh_offset);
+        WriteBuf(fp, blob.data.data(), blob.data.size());
+    }
+    EmitPad(fp, out_ehdr.e_shoff);
+    for (const Elf_Shdr& shdr : out_shdrs) {
+        ::Write(fp, shdr);
+    }
+    fclose(fp);
+}
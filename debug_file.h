@@ -0,0 +1,52 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "dwarf_merger.h"
+#include "elf_binary.h"
+#include "utils.h"
+
+// DebugFileBuilder writes a separate debug file of the output like
+// `objcopy --only-keep-debug`. It has the section headers of the output,
+// where sections other than SHT_NOTE have no contents, followed by .symtab
+// and DWARF merged from the inputs.
+class DebugFileBuilder {
+public:
+    // Merges DWARF of bin, which is placed at offset in the output. We use
+    // the DWARF in bin itself or in its separate debug file. remap_tls maps
+    // an offset in the TLS block of bin to the merged one.
+    void AddInput(const ELFBinary& bin, uintptr_t offset, const std::function<uint64_t(uint64_t)>& remap_tls);
+
+    // Writes the debug file. ehdr, shdrs and shstrtab are those of the
+    // output, whose SHT_NOTE sections are copied from output_filename.
+    // Local symbols must precede global ones in symtab.
+    void Write(const std::string& filename, const std::string& output_filename, const Elf_Ehdr& ehdr, const std::vector<Elf_Shdr>& shdrs,
+               const std::string& shstrtab, const std::vector<Elf_Sym>& symtab, const std::string& strtab) const;
+
+private:
+    DwarfMerger dwarf_;
+};
+
+// Returns the separate debug file of bin found by its build-id or
+// .gnu_debuglink in the same way as gdb, or an empty string.
+std::string FindSeparateDebugFile(const ELFBinary& bin);
+
+// Returns the CRC32 of filename stored in .gnu_debuglink.
+uint32_t GnuDebuglinkCRC(const std::string& filename);
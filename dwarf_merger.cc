@@ -0,0 +1,1228 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "dwarf_merger.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "utils.h"
+
+namespace {
+
+// DWARF constants which we use. We do not depend on dwarf.h of elfutils.
+enum : uint8_t {
+    DW_UT_skeleton = 0x04,
+    DW_UT_split_compile = 0x05,
+    DW_UT_type = 0x02,
+    DW_UT_split_type = 0x06,
+};
+
+enum : uint64_t {
+    DW_FORM_addr = 0x01,
+    DW_FORM_block2 = 0x03,
+    DW_FORM_block4 = 0x04,
+    DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06,
+    DW_FORM_data8 = 0x07,
+    DW_FORM_string = 0x08,
+    DW_FORM_block = 0x09,
+    DW_FORM_block1 = 0x0a,
+    DW_FORM_data1 = 0x0b,
+    DW_FORM_flag = 0x0c,
+    DW_FORM_sdata = 0x0d,
+    DW_FORM_strp = 0x0e,
+    DW_FORM_udata = 0x0f,
+    DW_FORM_ref_addr = 0x10,
+    DW_FORM_ref1 = 0x11,
+    DW_FORM_ref2 = 0x12,
+    DW_FORM_ref4 = 0x13,
+    DW_FORM_ref8 = 0x14,
+    DW_FORM_ref_udata = 0x15,
+    DW_FORM_indirect = 0x16,
+    DW_FORM_sec_offset = 0x17,
+    DW_FORM_exprloc = 0x18,
+    DW_FORM_flag_present = 0x19,
+    DW_FORM_strx = 0x1a,
+    DW_FORM_addrx = 0x1b,
+    DW_FORM_data16 = 0x1e,
+    DW_FORM_line_strp = 0x1f,
+    DW_FORM_ref_sig8 = 0x20,
+    DW_FORM_implicit_const = 0x21,
+    DW_FORM_loclistx = 0x22,
+    DW_FORM_rnglistx = 0x23,
+    DW_FORM_strx1 = 0x25,
+    DW_FORM_strx2 = 0x26,
+    DW_FORM_strx3 = 0x27,
+    DW_FORM_strx4 = 0x28,
+    DW_FORM_addrx1 = 0x29,
+    DW_FORM_addrx2 = 0x2a,
+    DW_FORM_addrx3 = 0x2b,
+    DW_FORM_addrx4 = 0x2c,
+    DW_FORM_GNU_addr_index = 0x1f01,
+    DW_FORM_GNU_str_index = 0x1f02,
+};
+
+enum : uint64_t {
+    DW_AT_location = 0x02,
+    DW_AT_stmt_list = 0x10,
+    DW_AT_low_pc = 0x11,
+    DW_AT_string_length = 0x19,
+    DW_AT_return_addr = 0x2a,
+    DW_AT_start_scope = 0x2c,
+    DW_AT_data_member_location = 0x38,
+    DW_AT_frame_base = 0x40,
+    DW_AT_macro_info = 0x43,
+    DW_AT_segment = 0x46,
+    DW_AT_static_link = 0x48,
+    DW_AT_use_location = 0x4a,
+    DW_AT_vtable_elem_location = 0x4d,
+    DW_AT_ranges = 0x55,
+    DW_AT_str_offsets_base = 0x72,
+    DW_AT_addr_base = 0x73,
+    DW_AT_rnglists_base = 0x74,
+    DW_AT_macros = 0x79,
+    DW_AT_loclists_base = 0x8c,
+    DW_AT_GNU_macros = 0x2119,
+    DW_AT_GNU_addr_base = 0x2133,
+    DW_AT_GNU_locviews = 0x2137,
+};
+
+enum : uint8_t {
+    DW_OP_addr = 0x03,
+    DW_OP_const1u = 0x08,
+    DW_OP_const1s = 0x09,
+    DW_OP_const2u = 0x0a,
+    DW_OP_const2s = 0x0b,
+    DW_OP_const4u = 0x0c,
+    DW_OP_const4s = 0x0d,
+    DW_OP_const8u = 0x0e,
+    DW_OP_const8s = 0x0f,
+    DW_OP_constu = 0x10,
+    DW_OP_consts = 0x11,
+    DW_OP_pick = 0x15,
+    DW_OP_plus_uconst = 0x23,
+    DW_OP_skip = 0x2f,
+    DW_OP_bra = 0x28,
+    DW_OP_breg0 = 0x70,
+    DW_OP_breg31 = 0x8f,
+    DW_OP_regx = 0x90,
+    DW_OP_fbreg = 0x91,
+    DW_OP_bregx = 0x92,
+    DW_OP_piece = 0x93,
+    DW_OP_deref_size = 0x94,
+    DW_OP_xderef_size = 0x95,
+    DW_OP_call2 = 0x98,
+    DW_OP_call4 = 0x99,
+    DW_OP_call_ref = 0x9a,
+    DW_OP_form_tls_address = 0x9b,
+    DW_OP_bit_piece = 0x9d,
+    DW_OP_implicit_value = 0x9e,
+    DW_OP_implicit_pointer = 0xa0,
+    DW_OP_addrx = 0xa1,
+    DW_OP_constx = 0xa2,
+    DW_OP_entry_value = 0xa3,
+    DW_OP_const_type = 0xa4,
+    DW_OP_regval_type = 0xa5,
+    DW_OP_deref_type = 0xa6,
+    DW_OP_xderef_type = 0xa7,
+    DW_OP_convert = 0xa8,
+    DW_OP_reinterpret = 0xa9,
+    DW_OP_GNU_push_tls_address = 0xe0,
+    DW_OP_GNU_implicit_pointer = 0xf2,
+    DW_OP_GNU_entry_value = 0xf3,
+    DW_OP_GNU_const_type = 0xf4,
+    DW_OP_GNU_regval_type = 0xf5,
+    DW_OP_GNU_deref_type = 0xf6,
+    DW_OP_GNU_convert = 0xf7,
+    DW_OP_GNU_reinterpret = 0xf9,
+    DW_OP_GNU_parameter_ref = 0xfa,
+    DW_OP_GNU_addr_index = 0xfb,
+    DW_OP_GNU_const_index = 0xfc,
+    DW_OP_GNU_variable_value = 0xfd,
+};
+
+enum : uint8_t {
+    DW_LNS_fixed_advance_pc = 0x09,
+    DW_LNE_set_address = 0x02,
+};
+
+enum : uint8_t {
+    DW_RLE_end_of_list = 0x00,
+    DW_RLE_base_addressx = 0x01,
+    DW_RLE_startx_endx = 0x02,
+    DW_RLE_startx_length = 0x03,
+    DW_RLE_offset_pair = 0x04,
+    DW_RLE_base_address = 0x05,
+    DW_RLE_start_end = 0x06,
+    DW_RLE_start_length = 0x07,
+};
+
+enum : uint8_t {
+    DW_LLE_end_of_list = 0x00,
+    DW_LLE_base_addressx = 0x01,
+    DW_LLE_startx_endx = 0x02,
+    DW_LLE_startx_length = 0x03,
+    DW_LLE_offset_pair = 0x04,
+    DW_LLE_default_location = 0x05,
+    DW_LLE_base_address = 0x06,
+    DW_LLE_start_end = 0x07,
+    DW_LLE_start_length = 0x08,
+    DW_LLE_GNU_view_pair = 0x09,
+};
+
+enum : uint8_t {
+    DW_MACRO_define = 0x01,
+    DW_MACRO_undef = 0x02,
+    DW_MACRO_start_file = 0x03,
+    DW_MACRO_end_file = 0x04,
+    DW_MACRO_define_strp = 0x05,
+    DW_MACRO_undef_strp = 0x06,
+    DW_MACRO_import = 0x07,
+    DW_MACRO_define_strx = 0x0b,
+    DW_MACRO_undef_strx = 0x0c,
+};
+
+const char* const kSupportedSections[] = {
+    ".debug_abbrev",   ".debug_addr",     ".debug_aranges",      ".debug_frame",        ".debug_info",   ".debug_line",
+    ".debug_line_str", ".debug_loc",      ".debug_loclists",     ".debug_macinfo",      ".debug_macro",  ".debug_pubnames",
+    ".debug_pubtypes", ".debug_gnu_pubnames", ".debug_gnu_pubtypes", ".debug_ranges", ".debug_rnglists", ".debug_str",
+    ".debug_str_offsets", ".debug_types",
+};
+
+// Cursor reads a range of a merged section and rewrites values in place.
+// Reading out of the range makes ok() false instead of aborting because
+// broken debug info must not break the link.
+class Cursor {
+public:
+    Cursor(std::string* buf, size_t pos, size_t end) : buf_(buf), pos_(pos), end_(end) {}
+
+    bool ok() const { return ok_; }
+    bool AtEnd() const { return !ok_ || pos_ >= end_; }
+    size_t pos() const { return pos_; }
+    size_t end() const { return end_; }
+
+    void Seek(size_t pos) {
+        if (pos > end_) {
+            ok_ = false;
+        } else {
+            pos_ = pos;
+        }
+    }
+
+    void Skip(size_t n) {
+        if (Check(n)) pos_ += n;
+    }
+
+    uint64_t Read(size_t n) {
+        uint64_t v = 0;
+        if (Check(n)) {
+            memcpy(&v, &(*buf_)[pos_], n);
+            pos_ += n;
+        }
+        return v;
+    }
+
+    uint8_t U8() { return Read(1); }
+    uint16_t U16() { return Read(2); }
+
+    uint64_t Uleb() {
+        uint64_t v = 0;
+        for (int shift = 0; Check(1); shift += 7) {
+            const uint8_t b = (*buf_)[pos_++];
+            if (shift < 64) v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) break;
+        }
+        return v;
+    }
+
+    void SkipLeb() { Uleb(); }
+
+    void SkipString() {
+        const size_t found = buf_->find('\0', pos_);
+        if (found == std::string::npos || found >= end_) {
+            ok_ = false;
+        } else {
+            pos_ = found + 1;
+        }
+    }
+
+    // Reads the initial length of a unit. Returns the end of the unit.
+    size_t ReadUnitLength(int* offset_size) {
+        uint64_t len = Read(4);
+        *offset_size = 4;
+        if (len == 0xffffffff) {
+            len = Read(8);
+            *offset_size = 8;
+        }
+        if (!ok_ || len > end_ - pos_) {
+            ok_ = false;
+            return end_;
+        }
+        return pos_ + len;
+    }
+
+    uint64_t Peek(size_t at, size_t n) const {
+        uint64_t v = 0;
+        memcpy(&v, &(*buf_)[at], n);
+        return v;
+    }
+
+    void Write(size_t at, size_t n, uint64_t v) { memcpy(&(*buf_)[at], &v, n); }
+
+    void Fail() { ok_ = false; }
+
+private:
+    bool Check(size_t n) {
+        if (!ok_ || n > end_ - pos_) {
+            ok_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    std::string* buf_;
+    size_t pos_;
+    size_t end_;
+    bool ok_{true};
+};
+
+// Merges DWARF of one input into merged sections.
+class InputMerger {
+public:
+    InputMerger(std::map<std::string, std::string>* merged, const std::function<uint64_t(uint64_t)>& rebase,
+                const std::function<uint64_t(uint64_t)>& remap_tls)
+        : merged_(merged), rebase_(rebase), remap_tls_(remap_tls) {}
+
+    // Appends sections to merged_ and patches them. Returns false when the
+    // DWARF is broken or unsupported. error() tells why.
+    bool Merge(const DwarfMerger::Sections& sections);
+
+    // Removes what Merge appended.
+    void Revert();
+
+    const std::string& error() const { return error_; }
+
+private:
+    struct Attr {
+        uint64_t name;
+        uint64_t form;
+    };
+    using Abbrevs = std::map<uint64_t, std::vector<Attr>>;
+
+    struct Unit {
+        uint16_t version;
+        int offset_size;
+        int addr_size;
+    };
+
+    enum ListKind { kRanges, kRnglists, kLoc, kLoclists };
+
+    struct ListRef {
+        ListKind kind;
+        // An index for DW_FORM_rnglistx and DW_FORM_loclistx.
+        bool is_index;
+        uint64_t value;
+    };
+
+    // Attributes of the unit DIE which we need to walk lists.
+    struct UnitDIE {
+        uint64_t low_pc{0};
+        bool low_pc_is_index{false};
+        uint64_t addr_base{0};
+        bool has_rnglists_base{false};
+        uint64_t rnglists_base{0};
+        bool has_loclists_base{false};
+        uint64_t loclists_base{0};
+    };
+
+    Cursor Open(const std::string& name) { return Cursor(&(*merged_)[name], bases_[name], ends_[name]); }
+
+    bool Fail(const std::string& error) {
+        if (error_.empty()) error_ = error;
+        return false;
+    }
+
+    static bool IsTombstone(uint64_t v, int size) { return v == 0 || v >= (size == 4 ? 0xfffffffeULL : 0xfffffffffffffffeULL); }
+
+    // Rebases the address at at. Returns the original value.
+    uint64_t PatchAddrAt(Cursor& c, size_t at, int size) {
+        const uint64_t v = c.Peek(at, size);
+        if (!IsTombstone(v, size)) c.Write(at, size, rebase_(v));
+        return v;
+    }
+
+    uint64_t PatchAddr(Cursor& c, int size) {
+        const size_t at = c.pos();
+        c.Skip(size);
+        return c.ok() ? PatchAddrAt(c, at, size) : 0;
+    }
+
+    // Adds the base of target to the offset at the cursor. Returns the
+    // original value.
+    uint64_t PatchOffset(Cursor& c, int size, const std::string& target) {
+        const size_t at = c.pos();
+        const uint64_t v = c.Read(size);
+        if (!c.ok()) return 0;
+        const uint64_t patched = v + bases_[target];
+        if (size == 4 && patched > 0xffffffff) {
+            c.Fail();
+            Fail(target + " is too large for 32-bit DWARF");
+            return v;
+        }
+        c.Write(at, size, patched);
+        return v;
+    }
+
+    void PatchExpr(Cursor& c, size_t len, const Unit& u);
+    bool ReadAbbrevs(uint64_t offset, Abbrevs* abbrevs);
+    bool MergeInfo(const std::string& name);
+    void MergeAttr(Cursor& c, const Unit& u, uint64_t name, uint64_t form, UnitDIE* die, std::vector<ListRef>* lists);
+    void MergeSecOffset(Cursor& c, const Unit& u, uint64_t name, int size, UnitDIE* die, std::vector<ListRef>* lists);
+    bool WalkList(const ListRef& ref, const Unit& u, const UnitDIE& die, uint64_t base);
+    bool MergeLine();
+    bool MergeLineForm(Cursor& c, uint64_t form, int offset_size);
+    bool MergeAranges();
+    bool MergePubnames(const std::string& name);
+    bool MergeFrame();
+    bool MergeMacro();
+    bool MergeStrOffsets();
+    bool MergeAddr();
+
+    std::map<std::string, std::string>* merged_;
+    const std::function<uint64_t(uint64_t)>& rebase_;
+    const std::function<uint64_t(uint64_t)>& remap_tls_;
+    // The range of this input in each merged section.
+    std::map<std::string, size_t> bases_;
+    std::map<std::string, size_t> ends_;
+    std::map<uint64_t, Abbrevs> abbrevs_;
+    // Entries of lists which are already patched.
+    std::set<std::pair<ListKind, size_t>> visited_;
+    bool warned_offset_pair_{false};
+    std::string error_;
+};
+
+bool InputMerger::Merge(const DwarfMerger::Sections& sections) {
+    for (const char* name : kSupportedSections) {
+        std::string& merged = (*merged_)[name];
+        bases_[name] = merged.size();
+        auto found = sections.find(name);
+        if (found != sections.end()) merged.append(found->second.data, found->second.size);
+        ends_[name] = merged.size();
+    }
+
+    return MergeInfo(".debug_info") && MergeInfo(".debug_types") && MergeLine() && MergeAranges() && MergePubnames(".debug_pubnames") &&
+           MergePubnames(".debug_pubtypes") && MergePubnames(".debug_gnu_pubnames") && MergePubnames(".debug_gnu_pubtypes") &&
+           MergeFrame() && MergeMacro() && MergeStrOffsets() && MergeAddr();
+}
+
+void InputMerger::Revert() {
+    for (const auto& p : bases_) {
+        (*merged_)[p.first].resize(p.second);
+    }
+}
+
+bool InputMerger::ReadAbbrevs(uint64_t offset, Abbrevs* abbrevs) {
+    auto found = abbrevs_.find(offset);
+    if (found != abbrevs_.end()) {
+        *abbrevs = found->second;
+        return true;
+    }
+
+    Cursor c = Open(".debug_abbrev");
+    c.Seek(bases_[".debug_abbrev"] + offset);
+    while (c.ok()) {
+        const uint64_t code = c.Uleb();
+        if (code == 0) break;
+        c.SkipLeb();  // tag
+        c.Skip(1);    // has_children
+        std::vector<Attr>& attrs = (*abbrevs)[code];
+        while (c.ok()) {
+            const uint64_t name = c.Uleb();
+            const uint64_t form = c.Uleb();
+            if (name == 0 && form == 0) break;
+            if (form == DW_FORM_implicit_const) c.SkipLeb();
+            attrs.push_back(Attr{name, form});
+        }
+    }
+    if (!c.ok()) return Fail("broken .debug_abbrev");
+    abbrevs_.emplace(offset, *abbrevs);
+    return true;
+}
+
+bool InputMerger::MergeInfo(const std::string& name) {
+    Cursor c = Open(name);
+    while (!c.AtEnd()) {
+        Unit u;
+        const size_t unit_end = c.ReadUnitLength(&u.offset_size);
+        u.version = c.U16();
+        if (u.version < 2 || u.version > 5) return Fail("unsupported DWARF version " + std::to_string(u.version) + " in " + name);
+
+        uint8_t unit_type = 0;
+        uint64_t abbrev_offset;
+        if (u.version >= 5) {
+            unit_type = c.U8();
+            u.addr_size = c.U8();
+            abbrev_offset = PatchOffset(c, u.offset_size, ".debug_abbrev");
+        } else {
+            abbrev_offset = PatchOffset(c, u.offset_size, ".debug_abbrev");
+            u.addr_size = c.U8();
+        }
+        if (unit_type == DW_UT_skeleton || unit_type == DW_UT_split_compile || unit_type == DW_UT_split_type) {
+            return Fail("split DWARF is not supported");
+        }
+        if (unit_type == DW_UT_type || name == ".debug_types") {
+            c.Skip(8);              // type_signature
+            c.Skip(u.offset_size);  // type_offset
+        }
+        if (u.addr_size != 4 && u.addr_size != 8) return Fail("broken address size in " + name);
+
+        Abbrevs abbrevs;
+        if (!c.ok() || !ReadAbbrevs(abbrev_offset, &abbrevs)) return Fail("broken " + name);
+
+        UnitDIE die;
+        std::vector<ListRef> lists;
+        bool is_unit_die = true;
+        while (c.ok() && c.pos() < unit_end) {
+            const uint64_t code = c.Uleb();
+            if (code == 0) continue;
+            auto found = abbrevs.find(code);
+            if (found == abbrevs.end()) return Fail("unknown abbreviation code in " + name);
+            for (const Attr& attr : found->second) {
+                MergeAttr(c, u, attr.name, attr.form, is_unit_die ? &die : nullptr, &lists);
+            }
+            is_unit_die = false;
+        }
+        if (!c.ok()) return Fail("broken " + name);
+
+        // Entries of lists are relative to the base address of the unit.
+        uint64_t base = die.low_pc;
+        if (die.low_pc_is_index) {
+            const size_t at = bases_[".debug_addr"] + die.addr_base + die.low_pc * u.addr_size;
+            base = at + u.addr_size <= ends_[".debug_addr"] ? Open(".debug_addr").Peek(at, u.addr_size) : 1;
+        }
+        for (const ListRef& ref : lists) {
+            if (!WalkList(ref, u, die, base)) return false;
+        }
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken " + name);
+}
+
+void InputMerger::MergeAttr(Cursor& c, const Unit& u, uint64_t name, uint64_t form, UnitDIE* die, std::vector<ListRef>* lists) {
+    auto is_location = [name]() {
+        return name == DW_AT_location || name == DW_AT_string_length || name == DW_AT_return_addr || name == DW_AT_data_member_location ||
+               name == DW_AT_frame_base || name == DW_AT_segment || name == DW_AT_static_link || name == DW_AT_use_location ||
+               name == DW_AT_vtable_elem_location;
+    };
+
+    switch (form) {
+        case DW_FORM_addr: {
+            const uint64_t v = PatchAddr(c, u.addr_size);
+            if (die && name == DW_AT_low_pc) die->low_pc = v;
+            break;
+        }
+        case DW_FORM_block1:
+        case DW_FORM_block2:
+        case DW_FORM_block4:
+        case DW_FORM_block: {
+            const uint64_t len = form == DW_FORM_block1 ? c.U8() : form == DW_FORM_block2 ? c.U16() : form == DW_FORM_block4 ? c.Read(4) : c.Uleb();
+            // Before DWARF 4, location expressions are blocks.
+            if (is_location()) {
+                PatchExpr(c, len, u);
+            } else {
+                c.Skip(len);
+            }
+            break;
+        }
+        case DW_FORM_exprloc:
+            PatchExpr(c, c.Uleb(), u);
+            break;
+        case DW_FORM_data4:
+        case DW_FORM_data8: {
+            const int size = form == DW_FORM_data4 ? 4 : 8;
+            // Before DWARF 4, offsets into other sections are data4 or data8.
+            if (u.version < 4 && (name == DW_AT_stmt_list || name == DW_AT_ranges || name == DW_AT_macro_info || is_location())) {
+                MergeSecOffset(c, u, name, size, die, lists);
+            } else {
+                c.Skip(size);
+            }
+            break;
+        }
+        case DW_FORM_sec_offset:
+            MergeSecOffset(c, u, name, u.offset_size, die, lists);
+            break;
+        case DW_FORM_strp:
+            PatchOffset(c, u.offset_size, ".debug_str");
+            break;
+        case DW_FORM_line_strp:
+            PatchOffset(c, u.offset_size, ".debug_line_str");
+            break;
+        case DW_FORM_ref_addr:
+            PatchOffset(c, u.version <= 2 ? u.addr_size : u.offset_size, ".debug_info");
+            break;
+        case DW_FORM_data1:
+        case DW_FORM_ref1:
+        case DW_FORM_flag:
+        case DW_FORM_strx1:
+        case DW_FORM_addrx1:
+            if (die && name == DW_AT_low_pc && form == DW_FORM_addrx1) {
+                die->low_pc = c.U8();
+                die->low_pc_is_index = true;
+            } else {
+                c.Skip(1);
+            }
+            break;
+        case DW_FORM_data2:
+        case DW_FORM_ref2:
+        case DW_FORM_strx2:
+        case DW_FORM_addrx2:
+            if (die && name == DW_AT_low_pc && form == DW_FORM_addrx2) {
+                die->low_pc = c.U16();
+                die->low_pc_is_index = true;
+            } else {
+                c.Skip(2);
+            }
+            break;
+        case DW_FORM_strx3:
+        case DW_FORM_addrx3:
+            if (die && name == DW_AT_low_pc && form == DW_FORM_addrx3) {
+                die->low_pc = c.Read(3);
+                die->low_pc_is_index = true;
+            } else {
+                c.Skip(3);
+            }
+            break;
+        case DW_FORM_ref4:
+        case DW_FORM_strx4:
+        case DW_FORM_addrx4:
+            if (die && name == DW_AT_low_pc && form == DW_FORM_addrx4) {
+                die->low_pc = c.Read(4);
+                die->low_pc_is_index = true;
+            } else {
+                c.Skip(4);
+            }
+            break;
+        case DW_FORM_ref8:
+        case DW_FORM_ref_sig8:
+            c.Skip(8);
+            break;
+        case DW_FORM_data16:
+            c.Skip(16);
+            break;
+        case DW_FORM_addrx:
+        case DW_FORM_GNU_addr_index:
+            if (die && name == DW_AT_low_pc) {
+                die->low_pc = c.Uleb();
+                die->low_pc_is_index = true;
+            } else {
+                c.SkipLeb();
+            }
+            break;
+        case DW_FORM_sdata:
+        case DW_FORM_udata:
+        case DW_FORM_ref_udata:
+        case DW_FORM_strx:
+        case DW_FORM_GNU_str_index:
+            c.SkipLeb();
+            break;
+        case DW_FORM_rnglistx:
+            lists->push_back(ListRef{kRnglists, true, c.Uleb()});
+            break;
+        case DW_FORM_loclistx:
+            lists->push_back(ListRef{kLoclists, true, c.Uleb()});
+            break;
+        case DW_FORM_string:
+            c.SkipString();
+            break;
+        case DW_FORM_flag_present:
+        case DW_FORM_implicit_const:
+            break;
+        case DW_FORM_indirect:
+            MergeAttr(c, u, name, c.Uleb(), die, lists);
+            break;
+        default:
+            c.Fail();
+            Fail("unsupported form " + HexString(form));
+            break;
+    }
+}
+
+void InputMerger::MergeSecOffset(Cursor& c, const Unit& u, uint64_t name, int size, UnitDIE* die, std::vector<ListRef>* lists) {
+    switch (name) {
+        case DW_AT_stmt_list:
+            PatchOffset(c, size, ".debug_line");
+            break;
+        case DW_AT_ranges:
+        case DW_AT_start_scope:
+            if (u.version >= 5) {
+                lists->push_back(ListRef{kRnglists, false, PatchOffset(c, size, ".debug_rnglists")});
+            } else {
+                lists->push_back(ListRef{kRanges, false, PatchOffset(c, size, ".debug_ranges")});
+            }
+            break;
+        case DW_AT_location:
+        case DW_AT_string_length:
+        case DW_AT_return_addr:
+        case DW_AT_data_member_location:
+        case DW_AT_frame_base:
+        case DW_AT_segment:
+        case DW_AT_static_link:
+        case DW_AT_use_location:
+        case DW_AT_vtable_elem_location:
+            if (u.version >= 5) {
+                lists->push_back(ListRef{kLoclists, false, PatchOffset(c, size, ".debug_loclists")});
+            } else {
+                lists->push_back(ListRef{kLoc, false, PatchOffset(c, size, ".debug_loc")});
+            }
+            break;
+        case DW_AT_GNU_locviews:
+            // View pairs have no addresses.
+            PatchOffset(c, size, u.version >= 5 ? ".debug_loclists" : ".debug_loc");
+            break;
+        case DW_AT_str_offsets_base:
+            PatchOffset(c, size, ".debug_str_offsets");
+            break;
+        case DW_AT_addr_base:
+        case DW_AT_GNU_addr_base: {
+            const uint64_t v = PatchOffset(c, size, ".debug_addr");
+            if (die) die->addr_base = v;
+            break;
+        }
+        case DW_AT_rnglists_base: {
+            const uint64_t v = PatchOffset(c, size, ".debug_rnglists");
+            if (die) {
+                die->rnglists_base = v;
+                die->has_rnglists_base = true;
+            }
+            break;
+        }
+        case DW_AT_loclists_base: {
+            const uint64_t v = PatchOffset(c, size, ".debug_loclists");
+            if (die) {
+                die->loclists_base = v;
+                die->has_loclists_base = true;
+            }
+            break;
+        }
+        case DW_AT_macros:
+        case DW_AT_GNU_macros:
+            PatchOffset(c, size, ".debug_macro");
+            break;
+        case DW_AT_macro_info:
+            PatchOffset(c, size, ".debug_macinfo");
+            break;
+        default:
+            c.Fail();
+            Fail("unsupported DW_FORM_sec_offset for attribute " + HexString(name));
+            break;
+    }
+}
+
+// Patches DW_OP_addr and TLS offsets, i.e. DW_OP_const4u, DW_OP_const8u or
+// DW_OP_addr followed by DW_OP_form_tls_address.
+void InputMerger::PatchExpr(Cursor& c, size_t len, const Unit& u) {
+    const size_t end = c.pos() + len;
+    if (end > c.end()) {
+        c.Fail();
+        return;
+    }
+
+    struct Operand {
+        size_t pos;
+        int size;
+        uint64_t value;
+        bool is_addr;
+    };
+    bool has_operand = false;
+    Operand operand{};
+    auto flush = [&]() {
+        if (has_operand && operand.is_addr && !IsTombstone(operand.value, operand.size)) {
+            c.Write(operand.pos, operand.size, rebase_(operand.value));
+        }
+        has_operand = false;
+    };
+
+    while (c.ok() && c.pos() < end) {
+        const uint8_t op = c.U8();
+        if (op == DW_OP_form_tls_address || op == DW_OP_GNU_push_tls_address) {
+            if (has_operand) c.Write(operand.pos, operand.size, remap_tls_(operand.value));
+            has_operand = false;
+            continue;
+        }
+        flush();
+
+        switch (op) {
+            case DW_OP_addr:
+            case DW_OP_const4u:
+            case DW_OP_const8u: {
+                operand.size = op == DW_OP_addr ? u.addr_size : op == DW_OP_const4u ? 4 : 8;
+                operand.pos = c.pos();
+                operand.value = c.Read(operand.size);
+                operand.is_addr = op == DW_OP_addr;
+                has_operand = true;
+                break;
+            }
+            case DW_OP_const1u:
+            case DW_OP_const1s:
+            case DW_OP_pick:
+            case DW_OP_deref_size:
+            case DW_OP_xderef_size:
+                c.Skip(1);
+                break;
+            case DW_OP_const2u:
+            case DW_OP_const2s:
+            case DW_OP_skip:
+            case DW_OP_bra:
+            case DW_OP_call2:
+                c.Skip(2);
+                break;
+            case DW_OP_const4s:
+            case DW_OP_call4:
+            case DW_OP_GNU_parameter_ref:
+                c.Skip(4);
+                break;
+            case DW_OP_const8s:
+                c.Skip(8);
+                break;
+            case DW_OP_constu:
+            case DW_OP_consts:
+            case DW_OP_plus_uconst:
+            case DW_OP_regx:
+            case DW_OP_fbreg:
+            case DW_OP_piece:
+            case DW_OP_addrx:
+            case DW_OP_constx:
+            case DW_OP_convert:
+            case DW_OP_reinterpret:
+            case DW_OP_GNU_convert:
+            case DW_OP_GNU_reinterpret:
+            case DW_OP_GNU_addr_index:
+            case DW_OP_GNU_const_index:
+                c.SkipLeb();
+                break;
+            case DW_OP_bregx:
+            case DW_OP_bit_piece:
+            case DW_OP_regval_type:
+            case DW_OP_GNU_regval_type:
+                c.SkipLeb();
+                c.SkipLeb();
+                break;
+            case DW_OP_deref_type:
+            case DW_OP_xderef_type:
+            case DW_OP_GNU_deref_type:
+                c.Skip(1);
+                c.SkipLeb();
+                break;
+            case DW_OP_implicit_value:
+                c.Skip(c.Uleb());
+                break;
+            case DW_OP_entry_value:
+            case DW_OP_GNU_entry_value:
+                PatchExpr(c, c.Uleb(), u);
+                break;
+            case DW_OP_const_type:
+            case DW_OP_GNU_const_type:
+                c.SkipLeb();
+                c.Skip(c.U8());
+                break;
+            case DW_OP_call_ref:
+            case DW_OP_GNU_variable_value:
+                PatchOffset(c, u.offset_size, ".debug_info");
+                break;
+            case DW_OP_implicit_pointer:
+            case DW_OP_GNU_implicit_pointer:
+                PatchOffset(c, u.version <= 2 ? u.addr_size : u.offset_size, ".debug_info");
+                c.SkipLeb();
+                break;
+            default:
+                if (DW_OP_breg0 <= op && op <= DW_OP_breg31) {
+                    c.SkipLeb();
+                } else if (op < 0x30 || op > 0x6f) {
+                    // Other opcodes below DW_OP_lit0 or above DW_OP_reg31
+                    // without operands are listed here. We give up the rest
+                    // of the expression for unknown ones.
+                    static const uint8_t kNoOperands[] = {0x06, 0x12, 0x13, 0x14, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+                                                          0x1e, 0x1f, 0x20, 0x21, 0x22, 0x24, 0x25, 0x26, 0x27, 0x29, 0x2a, 0x2b,
+                                                          0x2c, 0x2d, 0x2e, 0x96, 0x97, 0x9c, 0x9f, 0xf0};
+                    if (std::find(std::begin(kNoOperands), std::end(kNoOperands), op) == std::end(kNoOperands)) {
+                        LOG(INFO) << "Unknown DW_OP " << HexString(op) << " in a location expression";
+                        c.Seek(end);
+                    }
+                }
+                break;
+        }
+    }
+    flush();
+    c.Seek(end);
+}
+
+bool InputMerger::WalkList(const ListRef& ref, const Unit& u, const UnitDIE& die, uint64_t base) {
+    const char* name = ref.kind == kRanges ? ".debug_ranges" : ref.kind == kRnglists ? ".debug_rnglists" : ref.kind == kLoc ? ".debug_loc" : ".debug_loclists";
+    Cursor c = Open(name);
+    uint64_t offset = ref.value;
+    if (ref.is_index) {
+        // DW_AT_rnglists_base and DW_AT_loclists_base point after the header
+        // of the first unit by default.
+        const uint64_t default_base = u.offset_size == 4 ? 12 : 20;
+        const uint64_t list_base = ref.kind == kRnglists ? (die.has_rnglists_base ? die.rnglists_base : default_base)
+                                                         : (die.has_loclists_base ? die.loclists_base : default_base);
+        c.Seek(bases_[name] + list_base + ref.value * u.offset_size);
+        offset = list_base + c.Read(u.offset_size);
+    }
+    c.Seek(bases_[name] + offset);
+    const int as = u.addr_size;
+    const uint64_t max_addr = as == 4 ? 0xffffffffULL : ~0ULL;
+
+    while (c.ok()) {
+        if (!visited_.emplace(ref.kind, c.pos()).second) break;
+
+        if (ref.kind == kRanges || ref.kind == kLoc) {
+            const size_t at = c.pos();
+            const uint64_t begin = c.Read(as);
+            const uint64_t end = c.Read(as);
+            if (!c.ok() || (begin == 0 && end == 0)) break;
+            if (begin == max_addr) {
+                // A base address selection entry.
+                base = PatchAddrAt(c, at + as, as);
+                continue;
+            }
+            // Without the base address, entries are absolute.
+            if (base == 0) {
+                PatchAddrAt(c, at, as);
+                PatchAddrAt(c, at + as, as);
+            }
+            if (ref.kind == kLoc) PatchExpr(c, c.U16(), u);
+            continue;
+        }
+
+        const uint8_t kind = c.U8();
+        const bool is_rnglists = ref.kind == kRnglists;
+        if (kind == DW_RLE_end_of_list) break;
+        switch (kind) {
+            case DW_RLE_base_addressx:
+                c.SkipLeb();
+                // We do not need the value but it is not 0.
+                base = 1;
+                break;
+            case DW_RLE_startx_endx:
+            case DW_RLE_startx_length:
+                c.SkipLeb();
+                c.SkipLeb();
+                break;
+            case DW_RLE_offset_pair:
+                c.SkipLeb();
+                c.SkipLeb();
+                if (base == 0 && !warned_offset_pair_) {
+                    LOG(WARNING) << "Offset pairs without base address in " << name << " are not rebased";
+                    warned_offset_pair_ = true;
+                }
+                break;
+            default:
+                if (is_rnglists) {
+                    if (kind == DW_RLE_base_address) {
+                        base = PatchAddr(c, as);
+                    } else if (kind == DW_RLE_start_end) {
+                        PatchAddr(c, as);
+                        PatchAddr(c, as);
+                    } else if (kind == DW_RLE_start_length) {
+                        PatchAddr(c, as);
+                        c.SkipLeb();
+                    } else {
+                        return Fail("unknown entry in .debug_rnglists");
+                    }
+                } else {
+                    if (kind == DW_LLE_default_location) {
+                    } else if (kind == DW_LLE_base_address) {
+                        base = PatchAddr(c, as);
+                        continue;
+                    } else if (kind == DW_LLE_start_end) {
+                        PatchAddr(c, as);
+                        PatchAddr(c, as);
+                    } else if (kind == DW_LLE_start_length) {
+                        PatchAddr(c, as);
+                        c.SkipLeb();
+                    } else if (kind == DW_LLE_GNU_view_pair) {
+                        c.SkipLeb();
+                        c.SkipLeb();
+                        continue;
+                    } else {
+                        return Fail("unknown entry in .debug_loclists");
+                    }
+                }
+                break;
+        }
+        // Entries of location lists other than base addresses and view pairs
+        // have expressions.
+        if (!is_rnglists && kind != DW_LLE_base_addressx) PatchExpr(c, c.Uleb(), u);
+    }
+    return c.ok() || Fail("broken " + std::string(name));
+}
+
+bool InputMerger::MergeLineForm(Cursor& c, uint64_t form, int offset_size) {
+    switch (form) {
+        case DW_FORM_string:
+            c.SkipString();
+            break;
+        case DW_FORM_line_strp:
+            PatchOffset(c, offset_size, ".debug_line_str");
+            break;
+        case DW_FORM_strp:
+            PatchOffset(c, offset_size, ".debug_str");
+            break;
+        case DW_FORM_udata:
+        case DW_FORM_strx:
+            c.SkipLeb();
+            break;
+        case DW_FORM_data1:
+        case DW_FORM_strx1:
+            c.Skip(1);
+            break;
+        case DW_FORM_data2:
+        case DW_FORM_strx2:
+            c.Skip(2);
+            break;
+        case DW_FORM_strx3:
+            c.Skip(3);
+            break;
+        case DW_FORM_data4:
+        case DW_FORM_strx4:
+            c.Skip(4);
+            break;
+        case DW_FORM_data8:
+            c.Skip(8);
+            break;
+        case DW_FORM_data16:
+            c.Skip(16);
+            break;
+        case DW_FORM_block:
+            c.Skip(c.Uleb());
+            break;
+        default:
+            return Fail("unsupported form " + HexString(form) + " in .debug_line");
+    }
+    return true;
+}
+
+bool InputMerger::MergeLine() {
+    Cursor c = Open(".debug_line");
+    while (!c.AtEnd()) {
+        int offset_size;
+        const size_t unit_end = c.ReadUnitLength(&offset_size);
+        const uint16_t version = c.U16();
+        if (version < 2 || version > 5) return Fail("unsupported .debug_line version " + std::to_string(version));
+        if (version >= 5) c.Skip(2);  // address_size and segment_selector_size
+        const uint64_t header_length = c.Read(offset_size);
+        const size_t program = c.pos() + header_length;
+        c.Skip(version >= 4 ? 5 : 4);  // From minimum_instruction_length to line_range
+        const uint8_t opcode_base = c.U8();
+        std::vector<uint8_t> opcode_lengths;
+        for (int i = 1; i < opcode_base; ++i) {
+            opcode_lengths.push_back(c.U8());
+        }
+
+        if (version >= 5) {
+            // Directories and then file names.
+            for (int table = 0; table < 2; ++table) {
+                std::vector<uint64_t> forms;
+                const uint8_t format_count = c.U8();
+                for (int i = 0; i < format_count; ++i) {
+                    c.SkipLeb();  // content type
+                    forms.push_back(c.Uleb());
+                }
+                const uint64_t count = c.Uleb();
+                for (uint64_t i = 0; i < count && c.ok(); ++i) {
+                    for (uint64_t form : forms) {
+                        if (!MergeLineForm(c, form, offset_size)) return false;
+                    }
+                }
+            }
+        }
+
+        c.Seek(program);
+        while (c.ok() && c.pos() < unit_end) {
+            const uint8_t op = c.U8();
+            if (op == 0) {
+                const uint64_t len = c.Uleb();
+                const size_t next = c.pos() + len;
+                if (len > 1 && c.U8() == DW_LNE_set_address) PatchAddr(c, len - 1);
+                c.Seek(next);
+            } else if (op == DW_LNS_fixed_advance_pc) {
+                c.Skip(2);
+            } else if (op < opcode_base) {
+                for (int i = 0; i < opcode_lengths[op - 1]; ++i) {
+                    c.SkipLeb();
+                }
+            }
+        }
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken .debug_line");
+}
+
+bool InputMerger::MergeAranges() {
+    Cursor c = Open(".debug_aranges");
+    while (!c.AtEnd()) {
+        const size_t start = c.pos();
+        int offset_size;
+        const size_t unit_end = c.ReadUnitLength(&offset_size);
+        c.Skip(2);  // version
+        PatchOffset(c, offset_size, ".debug_info");
+        const uint8_t as = c.U8();
+        c.Skip(1);  // segment_selector_size
+        if (as != 4 && as != 8) return Fail("broken .debug_aranges");
+        // Tuples are aligned to twice the size of an address.
+        c.Skip((2 * as - (c.pos() - start) % (2 * as)) % (2 * as));
+        while (c.ok() && c.pos() + 2 * as <= unit_end) {
+            PatchAddr(c, as);
+            c.Skip(as);
+        }
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken .debug_aranges");
+}
+
+bool InputMerger::MergePubnames(const std::string& name) {
+    Cursor c = Open(name);
+    while (!c.AtEnd()) {
+        int offset_size;
+        const size_t unit_end = c.ReadUnitLength(&offset_size);
+        c.Skip(2);  // version
+        PatchOffset(c, offset_size, ".debug_info");
+        // Entries are offsets relative to the unit.
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken " + name);
+}
+
+bool InputMerger::MergeFrame() {
+    Cursor c = Open(".debug_frame");
+    while (!c.AtEnd()) {
+        int offset_size;
+        const size_t entry_end = c.ReadUnitLength(&offset_size);
+        if (entry_end == c.pos()) continue;
+        const size_t at = c.pos();
+        const uint64_t id = c.Read(offset_size);
+        if (id != (offset_size == 4 ? 0xffffffffULL : ~0ULL)) {
+            // An FDE. The CIE pointer is an offset in .debug_frame.
+            c.Seek(at);
+            PatchOffset(c, offset_size, ".debug_frame");
+            PatchAddr(c, 8);
+        }
+        c.Seek(entry_end);
+    }
+    return c.ok() || Fail("broken .debug_frame");
+}
+
+bool InputMerger::MergeMacro() {
+    Cursor c = Open(".debug_macro");
+    while (!c.AtEnd()) {
+        const uint16_t version = c.U16();
+        if (version != 4 && version != 5) return Fail("unsupported .debug_macro version " + std::to_string(version));
+        const uint8_t flags = c.U8();
+        const int offset_size = (flags & 1) ? 8 : 4;
+        if (flags & 2) PatchOffset(c, offset_size, ".debug_line");
+        if (flags & 4) {
+            const uint8_t count = c.U8();
+            for (int i = 0; i < count; ++i) {
+                c.Skip(1);
+                c.Skip(c.Uleb());
+            }
+        }
+
+        while (c.ok()) {
+            const uint8_t op = c.U8();
+            if (op == 0) break;
+            switch (op) {
+                case DW_MACRO_define:
+                case DW_MACRO_undef:
+                    c.SkipLeb();
+                    c.SkipString();
+                    break;
+                case DW_MACRO_start_file:
+                case DW_MACRO_define_strx:
+                case DW_MACRO_undef_strx:
+                    c.SkipLeb();
+                    c.SkipLeb();
+                    break;
+                case DW_MACRO_end_file:
+                    break;
+                case DW_MACRO_define_strp:
+                case DW_MACRO_undef_strp:
+                    c.SkipLeb();
+                    PatchOffset(c, offset_size, ".debug_str");
+                    break;
+                case DW_MACRO_import:
+                    PatchOffset(c, offset_size, ".debug_macro");
+                    break;
+                default:
+                    return Fail("unsupported opcode " + HexString(op) + " in .debug_macro");
+            }
+        }
+    }
+    return c.ok() || Fail("broken .debug_macro");
+}
+
+bool InputMerger::MergeStrOffsets() {
+    Cursor c = Open(".debug_str_offsets");
+    while (!c.AtEnd()) {
+        int offset_size;
+        const size_t unit_end = c.ReadUnitLength(&offset_size);
+        c.Skip(4);  // version and padding
+        while (c.ok() && c.pos() + offset_size <= unit_end) {
+            PatchOffset(c, offset_size, ".debug_str");
+        }
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken .debug_str_offsets");
+}
+
+bool InputMerger::MergeAddr() {
+    Cursor c = Open(".debug_addr");
+    while (!c.AtEnd()) {
+        int offset_size;
+        const size_t unit_end = c.ReadUnitLength(&offset_size);
+        const uint16_t version = c.U16();
+        const uint8_t as = c.U8();
+        c.Skip(1);  // segment_selector_size
+        if (version != 5 || (as != 4 && as != 8)) return Fail("unsupported .debug_addr");
+        while (c.ok() && c.pos() + as <= unit_end) {
+            PatchAddr(c, as);
+        }
+        c.Seek(unit_end);
+    }
+    return c.ok() || Fail("broken .debug_addr");
+}
+
+}  // namespace
+
+bool DwarfMerger::IsSupported(const std::string& name) {
+    return std::find(std::begin(kSupportedSections), std::end(kSupportedSections), name) != std::end(kSupportedSections);
+}
+
+bool DwarfMerger::Add(const std::string& name, const Sections& sections, const std::function<uint64_t(uint64_t)>& rebase,
+                      const std::function<uint64_t(uint64_t)>& remap_tls) {
+    InputMerger input(&merged_, rebase, remap_tls);
+    if (!input.Merge(sections)) {
+        LOG(WARNING) << "Dropped debug info of " << name << ": " << input.error();
+        input.Revert();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <string>
+
+// DwarfMerger concatenates the DWARF sections of several shared objects into
+// one set of sections like a linker does. Addresses and references between
+// sections are absolute in each input, so DwarfMerger rewrites
+//   - addresses in .debug_info, .debug_addr, .debug_line, .debug_aranges,
+//     range lists, location lists and .debug_frame,
+//   - TLS offsets in location expressions,
+//   - offsets into other sections, e.g. DW_FORM_strp or DW_AT_stmt_list.
+// All of them keep their sizes, so each section is copied and patched in
+// place.
+//
+// DWARF 2-5 from GCC and Clang is supported. Split DWARF, dwz and compressed
+// sections are not. Indexes such as .debug_names and .gdb_index are dropped
+// because debuggers can rebuild them.
+class DwarfMerger {
+public:
+    struct Section {
+        const char* data;
+        size_t size;
+    };
+
+    // Maps the name of a section such as ".debug_info" to its contents.
+    using Sections = std::map<std::string, Section>;
+
+    // Returns true when DwarfMerger merges sections named name.
+    static bool IsSupported(const std::string& name);
+
+    // Appends DWARF of an input named name. rebase maps an address of the
+    // input to the output and remap_tls maps an offset in the TLS block of
+    // the input to the merged TLS block. When the DWARF of the input is
+    // broken or unsupported, we drop it and return false.
+    bool Add(const std::string& name, const Sections& sections, const std::function<uint64_t(uint64_t)>& rebase,
+             const std::function<uint64_t(uint64_t)>& remap_tls);
+
+    // Merged sections by name.
+    const std::map<std::string, std::string>& sections() const { return merged_; }
+
+private:
+    std::map<std::string, std::string> merged_;
+};
@@ -21,11 +21,12 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstring>
 #include <numeric>
-#include <set>
 #include <sstream>
 
+#include "hash_table.h"
 #include "version_builder.h"
 
 ELFBinary::ELFBinary(const std::string& filename, int fd, char* head, size_t size)
@@ -47,6 +48,7 @@ ELFBinary::ELFBinary(const std::string& filename, int fd, char* head, size_t siz
     }
 
     ParsePhdrs();
+    ParseShdrs();
 }
 
 ELFBinary::~ELFBinary() {
@@ -93,17 +95,28 @@ bool ELFBinary::IsOffsetInTLSBSS(uintptr_t tls_offset) const {
 
 namespace {
 
-std::set<int> CollectSymbolsFromReloc(const Elf_Rel* rels, size_t num) {
-    std::set<int> indices;
+// Symbol indices are dense and bounded by the size of .dynsym, so we collect
+// them into a bitmap.
+typedef std::vector<bool> IndexBitmap;
+
+// Returns true if idx was not in indices.
+bool InsertIndex(IndexBitmap* indices, size_t idx) {
+    if (indices->size() <= idx) {
+        indices->resize(idx + 1, false);
+    }
+    if ((*indices)[idx]) return false;
+    (*indices)[idx] = true;
+    return true;
+}
+
+void CollectSymbolsFromReloc(const Elf_Rel* rels, size_t num, IndexBitmap* indices) {
     for (size_t i = 0; i < num; ++i) {
         const Elf_Rel* rel = &rels[i];
-        indices.insert(ELF_R_SYM(rel->r_info));
+        InsertIndex(indices, ELF_R_SYM(rel->r_info));
     }
-    return indices;
 }
 
-std::set<int> CollectSymbolsFromGnuHash(Elf_GnuHash* gnu_hash) {
-    std::set<int> indices;
+void CollectSymbolsFromGnuHash(Elf_GnuHash* gnu_hash, IndexBitmap* indices) {
     const uint32_t* buckets = gnu_hash->buckets();
     const uint32_t* hashvals = gnu_hash->hashvals();
     for (int i = 0; i < gnu_hash->nbuckets; ++i) {
@@ -112,31 +125,28 @@ std::set<int> CollectSymbolsFromGnuHash(Elf_GnuHash* gnu_hash) {
         const uint32_t* hv = &hashvals[n - gnu_hash->symndx];
         for (;; ++n) {
             uint32_t h2 = *hv++;
-            CHECK(indices.insert(n).second);
+            CHECK(InsertIndex(indices, n));
             if (h2 & 1) break;
         }
     }
     for (size_t n = 0; n < gnu_hash->symndx; ++n) {
-        indices.insert(n);
+        InsertIndex(indices, n);
     }
-    return indices;
 }
 
-std::set<int> CollectSymbolsFromElfHash(const std::string& name, Elf_Hash* hash) {
-    std::set<int> indices;
+void CollectSymbolsFromElfHash(const std::string& name, Elf_Hash* hash, IndexBitmap* indices) {
     const uint32_t* buckets = hash->buckets();
     const uint32_t* chains = hash->chains();
     for (size_t i = 0; i < hash->nbuckets; ++i) {
         for (int n = buckets[i]; n != STN_UNDEF; n = chains[n]) {
-            indices.insert(n);
+            InsertIndex(indices, n);
         }
     }
-    return indices;
 }
 
 }  // namespace
 
-void ELFBinary::ReadDynSymtab(const std::map<std::string, std::string>& filename_to_soname) {
+void ELFBinary::ReadDynSymtab(const VersionTable& versions) {
     CHECK(symtab_);
     LOG(INFO) << "Read dynsymtab of " << name();
 
@@ -144,41 +154,89 @@ void ELFBinary::ReadDynSymtab(const std::map<std::string, std::string>& filename
     // at all, we do not know the exact size of .dynsym section. We collect
     // indices in .dynsym from both (GNU or ELF) hash and relocs.
 
-    std::set<int> indices;
+    IndexBitmap indices;
     if (gnu_hash_) {
-        indices = CollectSymbolsFromGnuHash(gnu_hash_);
+        CollectSymbolsFromGnuHash(gnu_hash_, &indices);
     } else {
         CHECK(hash_);
-        indices = CollectSymbolsFromElfHash(name(), hash_);
+        CollectSymbolsFromElfHash(name(), hash_, &indices);
     }
 
-    for (int idx : CollectSymbolsFromReloc(rel_, num_rels_)) indices.insert(idx);
-    for (int idx : CollectSymbolsFromReloc(plt_rel_, num_plt_rels_)) indices.insert(idx);
+    CollectSymbolsFromReloc(rel_, num_rels_, &indices);
+    CollectSymbolsFromReloc(plt_rel_, num_plt_rels_, &indices);
 
-    std::set<std::tuple<std::string, std::string, std::string>> duplicate_check;
+    syms_.reserve(std::count(indices.begin(), indices.end(), true));
+    OpenHashMap<SymbolKey, bool, SymbolKeyHash> duplicate_check(syms_.capacity());
 
-    for (int idx : indices) {
+    for (size_t idx = 0; idx < indices.size(); ++idx) {
+        if (!indices[idx]) continue;
         Elf_Sym* sym = &symtab_[idx];
         if (sym->st_name == 0) continue;
-        const std::string symname(strtab_ + sym->st_name);
+        const char* symname = strtab_ + sym->st_name;
 
         nsyms_++;
         LOG(INFO) << symname << "@" << name() << " index in .dynsym = " << idx;
 
         // Get version information coresspoinds to idx
-        std::string soname, version;
-        std::tie(soname, version) = GetVersion(idx, filename_to_soname);
+        StrId soname, version;
+        std::tie(soname, version) = GetVersion(idx, versions);
         Elf_Versym v = versym_ ? versym_[idx] : NO_VERSION_INFO;
 
-        syms_.push_back(Syminfo{symname, soname, version, v, sym});
-        CHECK(duplicate_check.insert({symname, soname, version}).second)
-            << SOLD_LOG_KEY(symname) << SOLD_LOG_KEY(soname) << SOLD_LOG_KEY(version);
-        LOG(INFO) << "duplicate_check: " << SOLD_LOG_KEY(symname) << SOLD_LOG_KEY(version);
+        syms_.push_back(Syminfo{symname, SymbolKey::Make(symname, soname, version), v, sym});
+        CHECK(duplicate_check.Insert(syms_.back().key, true).second)
+            << SOLD_LOG_KEY(symname) << SOLD_LOG_KEY(InternedString(soname)) << SOLD_LOG_KEY(InternedString(version));
+        LOG(INFO) << "duplicate_check: " << SOLD_LOG_KEY(symname) << SOLD_LOG_KEY(InternedString(version));
     }
 
     LOG(INFO) << "nsyms_ = " << nsyms_;
 }
 
+size_t ELFBinary::CountDynSyms() const {
+    size_t num = 0;
+    if (gnu_hash_) {
+        num = gnu_hash_->symndx;
+        for (uint32_t b = 0; b < gnu_hash_->nbuckets; ++b) {
+            const size_t len = GnuHashChainLength(*gnu_hash_, b);
+            if (len == 0) continue;
+            CHECK_NE(len, kBrokenGnuHashChain) << name() << ": bucket " << b << " of .gnu.hash points below symndx";
+            num = std::max<size_t>(num, gnu_hash_->buckets()[b] + len);
+        }
+    } else if (hash_) {
+        num = hash_->nchains;
+    }
+    for (size_t i = 0; i < num_rels_; ++i) {
+        num = std::max<size_t>(num, ELF_R_SYM(rel_[i].r_info) + 1);
+    }
+    for (size_t i = 0; i < num_plt_rels_; ++i) {
+        num = std::max<size_t>(num, ELF_R_SYM(plt_rel_[i].r_info) + 1);
+    }
+    return num;
+}
+
+bool ELFBinary::DefinesSymbol(const std::string& name) const {
+    if (!symtab_) return false;
+    auto matches = [this, &name](uint32_t idx) {
+        const Elf_Sym& sym = symtab_[idx];
+        return IsDefined(sym) && name == strtab_ + sym.st_name;
+    };
+
+    if (gnu_hash_) {
+        const uint32_t hash = CalcGnuHash(name);
+        uint32_t n = gnu_hash_->buckets()[hash % gnu_hash_->nbuckets];
+        if (n == 0) return false;
+        for (const uint32_t* hv = &gnu_hash_->hashvals()[n - gnu_hash_->symndx];; ++n, ++hv) {
+            if ((*hv | 1) == (hash | 1) && matches(n)) return true;
+            if (*hv & 1) return false;
+        }
+    }
+
+    CHECK(hash_);
+    for (uint32_t n = hash_->buckets()[CalcHash(name) % hash_->nbuckets]; n != STN_UNDEF; n = hash_->chains()[n]) {
+        if (matches(n)) return true;
+    }
+    return false;
+}
+
 Elf_Phdr* ELFBinary::FindPhdr(uint64_t type) {
     for (Elf_Phdr* phdr : phdrs_) {
         if (phdr->p_type == type) {
@@ -194,70 +252,85 @@ const Elf_Phdr& ELFBinary::GetPhdr(uint64_t type) {
     return *phdr;
 }
 
+const Elf_Shdr* ELFBinary::FindShdr(Elf_Word type) const {
+    for (const Elf_Shdr* shdr : shdrs_) {
+        if (shdr->sh_type == type) {
+            return shdr;
+        }
+    }
+    return nullptr;
+}
+
+const char* ELFBinary::ShName(const Elf_Shdr& shdr) const {
+    return shstrtab_ ? shstrtab_ + shdr.sh_name : "";
+}
+
 // GetVersion returns (soname, version)
-std::pair<std::string, std::string> ELFBinary::GetVersion(int index, const std::map<std::string, std::string>& filename_to_soname) {
-    LOG(INFO) << "GetVersion";
+std::pair<StrId, StrId> ELFBinary::GetVersion(int index, const VersionTable& versions) const {
     if (!versym_) {
-        return std::make_pair("", "");
+        return std::make_pair(EMPTY_STR_ID, EMPTY_STR_ID);
     }
 
-    LOG(INFO) << SOLD_LOG_KEY(versym_[index]);
+    const Elf_Versym versym = versym_[index];
+    if (is_special_ver_ndx(versym) || versym >= versions.size()) {
+        return std::make_pair(EMPTY_STR_ID, EMPTY_STR_ID);
+    }
+    return versions[versym];
+}
 
-    if (is_special_ver_ndx(versym_[index])) {
-        return std::make_pair("", "");
-    } else {
-        if (verneed_) {
-            Elf_Verneed* vn = verneed_;
-            for (int i = 0; i < verneednum_; ++i) {
-                LOG(INFO) << "Elf_Verneed: " << SOLD_LOG_KEY(vn->vn_version) << SOLD_LOG_KEY(vn->vn_cnt)
-                          << SOLD_LOG_KEY(strtab_ + vn->vn_file) << SOLD_LOG_KEY(vn->vn_aux) << SOLD_LOG_KEY(vn->vn_next);
-                Elf_Vernaux* vna = (Elf_Vernaux*)((char*)vn + vn->vn_aux);
-                for (int j = 0; j < vn->vn_cnt; ++j) {
-                    LOG(INFO) << "Elf_Vernaux: " << SOLD_LOG_KEY(vna->vna_hash) << SOLD_LOG_KEY(vna->vna_flags)
-                              << SOLD_LOG_KEY(vna->vna_other) << SOLD_LOG_KEY(strtab_ + vna->vna_name) << SOLD_LOG_KEY(vna->vna_next);
-
-                    if (vna->vna_other == versym_[index]) {
-                        LOG(INFO) << "Find Elf_Vernaux corresponds to " << versym_[index] << SOLD_LOG_KEY(strtab_ + vn->vn_file)
-                                  << SOLD_LOG_KEY(strtab_ + vna->vna_name);
-
-                        std::string filename = std::string(strtab_ + vn->vn_file);
-                        auto found = filename_to_soname.find(filename);
-                        if (found != filename_to_soname.end()) {
-                            return std::make_pair(found->second, std::string(strtab_ + vna->vna_name));
-                        } else {
-                            LOG(FATAL) << "There is no entry for " << filename << " in filename_to_soname.";
-                        }
-                    }
+// BuildVersionTable walks Elf_Verneed and Elf_Verdef once. When both of them
+// have an index, Elf_Verneed precedes.
+VersionTable ELFBinary::BuildVersionTable(const std::map<std::string, std::string>& filename_to_soname) const {
+    VersionTable versions;
+    // Sets (soname, version) of versym unless it has one already.
+    auto add = [&versions](Elf_Versym versym, StrId soname, StrId version) {
+        if (versions.size() <= versym) versions.resize(versym + 1, std::make_pair(EMPTY_STR_ID, EMPTY_STR_ID));
+        if (versions[versym].second != EMPTY_STR_ID) return;
+        versions[versym] = std::make_pair(soname, version);
+    };
 
-                    vna = (Elf_Vernaux*)((char*)vna + vna->vna_next);
-                }
-                vn = (Elf_Verneed*)((char*)vn + vn->vn_next);
+    if (verneed_) {
+        const Elf_Verneed* vn = verneed_;
+        for (int i = 0; i < verneednum_; ++i) {
+            LOG(INFO) << "Elf_Verneed: " << SOLD_LOG_KEY(vn->vn_version) << SOLD_LOG_KEY(vn->vn_cnt)
+                      << SOLD_LOG_KEY(strtab_ + vn->vn_file) << SOLD_LOG_KEY(vn->vn_aux) << SOLD_LOG_KEY(vn->vn_next);
+            const std::string filename = std::string(strtab_ + vn->vn_file);
+            auto found = filename_to_soname.find(filename);
+            if (found == filename_to_soname.end()) {
+                LOG(FATAL) << "There is no entry for " << filename << " in filename_to_soname.";
             }
-        }
-        if (verdef_) {
-            Elf_Verdef* vd = verdef_;
-            std::string soname, version;
-            for (int i = 0; i < verdefnum_; ++i) {
-                Elf_Verdaux* vda = (Elf_Verdaux*)((char*)vd + vd->vd_aux);
+            const StrId soname = InternString(found->second);
 
-                if (vd->vd_flags & VER_FLG_BASE) {
-                    soname = std::string(strtab_ + vda->vda_name);
-                }
-                if (vd->vd_ndx == versym_[index]) {
-                    version = std::string(strtab_ + vda->vda_name);
-                }
-
-                vd = (Elf_Verdef*)((char*)vd + vd->vd_next);
+            const Elf_Vernaux* vna = (const Elf_Vernaux*)((const char*)vn + vn->vn_aux);
+            for (int j = 0; j < vn->vn_cnt; ++j) {
+                LOG(INFO) << "Elf_Vernaux: " << SOLD_LOG_KEY(vna->vna_hash) << SOLD_LOG_KEY(vna->vna_flags)
+                          << SOLD_LOG_KEY(vna->vna_other) << SOLD_LOG_KEY(strtab_ + vna->vna_name) << SOLD_LOG_KEY(vna->vna_next);
+                add(vna->vna_other, soname, InternString(strtab_ + vna->vna_name));
+                vna = (const Elf_Vernaux*)((const char*)vna + vna->vna_next);
             }
-            if (soname != "" && version != "") {
-                LOG(INFO) << "Find Elf_Verdef corresponds to " << versym_[index] << SOLD_LOG_KEY(soname) << SOLD_LOG_KEY(version);
-                return std::make_pair(soname, version);
+            vn = (const Elf_Verneed*)((const char*)vn + vn->vn_next);
+        }
+    }
+    if (verdef_) {
+        // The base version has the soname of this binary.
+        const char* soname = "";
+        const Elf_Verdef* vd = verdef_;
+        for (int i = 0; i < verdefnum_; ++i) {
+            const Elf_Verdaux* vda = (const Elf_Verdaux*)((const char*)vd + vd->vd_aux);
+            if (vd->vd_flags & VER_FLG_BASE) soname = strtab_ + vda->vda_name;
+            vd = (const Elf_Verdef*)((const char*)vd + vd->vd_next);
+        }
+        if (*soname != '\0') {
+            vd = verdef_;
+            for (int i = 0; i < verdefnum_; ++i) {
+                const Elf_Verdaux* vda = (const Elf_Verdaux*)((const char*)vd + vd->vd_aux);
+                const char* version = strtab_ + vda->vda_name;
+                if (*version != '\0') add(vd->vd_ndx, InternString(soname), InternString(version));
+                vd = (const Elf_Verdef*)((const char*)vd + vd->vd_next);
             }
         }
-
-        LOG(WARNING) << "Find no entry corresponds to " << versym_[index];
-        return std::make_pair("", "");
     }
+    return versions;
 }
 
 void ELFBinary::PrintVersyms() {
@@ -316,6 +389,13 @@ void ELFBinary::ParsePhdrs() {
         }
     }
 
+    for (Elf_Phdr* phdr : loads_) {
+        addr_to_offset_.Add(phdr->p_vaddr, phdr->p_memsz, phdr->p_offset);
+        offset_to_addr_.Add(phdr->p_offset, phdr->p_filesz, phdr->p_vaddr);
+    }
+    addr_to_offset_.Build();
+    offset_to_addr_.Build();
+
     for (Elf_Phdr* phdr : phdrs_) {
         if (phdr->p_type == PT_DYNAMIC) {
             ParseDynamic(phdr->p_offset, phdr->p_filesz);
@@ -327,11 +407,49 @@ void ELFBinary::ParsePhdrs() {
             gnu_stack_ = phdr;
         } else if (phdr->p_type == PT_GNU_RELRO) {
             gnu_relro_ = phdr;
+        } else if (phdr->p_type == PT_NOTE) {
+            ParseNotes(phdr->p_offset, phdr->p_filesz);
         }
     }
     CHECK(!phdrs_.empty());
 }
 
+// Section headers are optional for ld.so, so we ignore them when they are
+// broken instead of aborting.
+void ELFBinary::ParseShdrs() {
+    if (ehdr_->e_shoff == 0 || ehdr_->e_shnum == 0 || ehdr_->e_shentsize != sizeof(Elf_Shdr) ||
+        ehdr_->e_shoff + sizeof(Elf_Shdr) * ehdr_->e_shnum > size_) {
+        LOG(INFO) << "No section headers in " << name_;
+        return;
+    }
+    for (int i = 0; i < ehdr_->e_shnum; ++i) {
+        shdrs_.push_back(reinterpret_cast<Elf_Shdr*>(head_ + ehdr_->e_shoff + sizeof(Elf_Shdr) * i));
+    }
+    if (ehdr_->e_shstrndx < shdrs_.size()) {
+        const Elf_Shdr* shstrtab = shdrs_[ehdr_->e_shstrndx];
+        if (shstrtab->sh_offset + shstrtab->sh_size <= size_) shstrtab_ = head_ + shstrtab->sh_offset;
+    }
+}
+
+void ELFBinary::ParseNotes(size_t off, size_t size) {
+    // Both name and desc are padded to 4 bytes in 64-bit ELF files too.
+    size_t pos = off;
+    while (pos + sizeof(Elf_Nhdr) <= off + size && pos + sizeof(Elf_Nhdr) <= size_) {
+        const Elf_Nhdr* nhdr = reinterpret_cast<const Elf_Nhdr*>(head_ + pos);
+        const char* name = head_ + pos + sizeof(Elf_Nhdr);
+        const uint8_t* desc = reinterpret_cast<const uint8_t*>(name + AlignNext(nhdr->n_namesz, 3));
+        if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+            build_id_.clear();
+            for (size_t i = 0; i < nhdr->n_descsz; ++i) {
+                char buf[3];
+                snprintf(buf, sizeof(buf), "%02x", desc[i]);
+                build_id_ += buf;
+            }
+        }
+        pos += sizeof(Elf_Nhdr) + AlignNext(nhdr->n_namesz, 3) + AlignNext(nhdr->n_descsz, 3);
+    }
+}
+
 void ELFBinary::ParseEHFrameHeader(size_t off, size_t size) {
     const char* const efh_base = head_ + off;
     int efh_offset = 0;
@@ -570,10 +688,12 @@ void ELFBinary::ParseFuncArray(uintptr_t* array, uintptr_t size, std::vector<uin
 }
 
 Elf_Addr ELFBinary::OffsetFromAddr(Elf_Addr addr) const {
-    for (Elf_Phdr* phdr : loads_) {
-        if (phdr->p_vaddr <= addr && addr < phdr->p_vaddr + phdr->p_memsz) {
-            return addr - phdr->p_vaddr + phdr->p_offset;
-        }
+    // The hint is per thread so that threads can share an ELFBinary. It may
+    // come from another ELFBinary, which only makes the first check miss.
+    static thread_local size_t hint = 0;
+    uintptr_t offset;
+    if (addr_to_offset_.Translate(addr, &offset, &hint)) {
+        return offset;
     }
     if (tls() != nullptr && tls()->p_vaddr == addr) {
         return tls()->p_offset;
@@ -582,10 +702,11 @@ Elf_Addr ELFBinary::OffsetFromAddr(Elf_Addr addr) const {
 }
 
 Elf_Addr ELFBinary::AddrFromOffset(Elf_Addr offset) const {
-    for (Elf_Phdr* phdr : loads_) {
-        if (phdr->p_offset <= offset && offset < phdr->p_offset + phdr->p_filesz) {
-            return offset - phdr->p_offset + phdr->p_vaddr;
-        }
+    // See OffsetFromAddr.
+    static thread_local size_t hint = 0;
+    uintptr_t addr;
+    if (offset_to_addr_.Translate(offset, &addr, &hint)) {
+        return addr;
     }
     if (tls() != nullptr && tls()->p_offset == offset) {
         return tls()->p_vaddr;
@@ -596,7 +717,7 @@ Elf_Addr ELFBinary::AddrFromOffset(Elf_Addr offset) const {
 std::string ELFBinary::ShowDynSymtab() {
     LOG(INFO) << "ShowDynSymtab";
     std::stringstream ss;
-    for (auto it : syms_) {
+    for (const auto& it : syms_) {
         ss << it.name << ": ";
 
         if (it.versym == NO_VERSION_INFO) {
@@ -604,7 +725,7 @@ std::string ELFBinary::ShowDynSymtab() {
         } else if (is_special_ver_ndx(it.versym)) {
             ss << special_ver_ndx_to_str(it.versym);
         } else {
-            ss << it.soname << " " << it.version;
+            ss << InternedString(it.key.soname) << " " << InternedString(it.key.version);
         }
         ss << "\n";
     }
@@ -652,7 +773,8 @@ std::unique_ptr<ELFBinary> ReadELF(const std::string& filename) {
 
     size_t mapped_size = (size + 0xfff) & ~0xfff;
 
-    char* p = (char*)mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    // Inputs are never modified. Sold keeps changes to them in its overlays.
+    char* p = (char*)mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
     if (p == MAP_FAILED) err(1, "mmap failed: %s", filename.c_str());
 
     if (ELFBinary::IsELF(p)) {
@@ -16,6 +16,8 @@
 #pragma once
 
 #include "hash.h"
+#include "hash_table.h"
+#include "segment_index.h"
 #include "utils.h"
 
 #include <cassert>
@@ -23,6 +25,9 @@
 #include <map>
 #include <memory>
 
+// (soname, version) indexed by version indices in .gnu.version.
+typedef std::vector<std::pair<StrId, StrId>> VersionTable;
+
 class ELFBinary {
 public:
     ELFBinary(const std::string& filename, int fd, char* head, size_t size);
@@ -34,16 +39,20 @@ public:
     const std::string& filename() const { return filename_; }
 
     const Elf_Ehdr* ehdr() const { return ehdr_; }
-    const std::vector<Elf_Phdr*> phdrs() const { return phdrs_; }
-    const std::vector<Elf_Phdr*> loads() const { return loads_; }
+    const std::vector<Elf_Phdr*>& phdrs() const { return phdrs_; }
+    const std::vector<Elf_Phdr*>& loads() const { return loads_; }
     const Elf_Phdr* tls() const { return tls_; }
     const Elf_Phdr* gnu_stack() const { return gnu_stack_; }
     const Elf_Phdr* gnu_relro() const { return gnu_relro_; }
+    // Section headers. Empty when the binary has none, e.g. after sstrip.
+    const std::vector<Elf_Shdr*>& shdrs() const { return shdrs_; }
 
     const std::vector<std::string>& neededs() const { return neededs_; }
     const std::string& soname() const { return soname_; }
     const std::string& runpath() const { return runpath_; }
     const std::string& rpath() const { return rpath_; }
+    // NT_GNU_BUILD_ID in hex. Empty when the binary has no build-id.
+    const std::string& build_id() const { return build_id_; }
 
     const Elf_Sym* symtab() const { return symtab_; }
     const Elf_Rel* rel() const { return rel_; }
@@ -51,6 +60,13 @@ public:
     const Elf_Rel* plt_rel() const { return plt_rel_; }
     size_t num_plt_rels() const { return num_plt_rels_; }
     const EHFrameHeader* eh_frame_header() const { return &eh_frame_header_; }
+    const Elf_GnuHash* gnu_hash() const { return gnu_hash_; }
+    const Elf_Hash* hash() const { return hash_; }
+    const Elf_Versym* versym() const { return versym_; }
+    const Elf_Verneed* verneed() const { return verneed_; }
+    Elf_Xword verneednum() const { return verneednum_; }
+    const Elf_Verdef* verdef() const { return verdef_; }
+    Elf_Xword verdefnum() const { return verdefnum_; }
 
     const char* head() const { return head_; }
     size_t size() const { return size_; }
@@ -70,9 +86,23 @@ public:
     bool IsOffsetInTLSData(uintptr_t offset) const;
     bool IsOffsetInTLSBSS(uintptr_t offset) const;
 
-    void ReadDynSymtab(const std::map<std::string, std::string>& filename_to_soname);
+    // Returns (soname, version) for each version index in .gnu.version_r and
+    // .gnu.version_d. Other indices, e.g. hidden ones, are missing or map to
+    // empty strings. filename_to_soname maps DT_NEEDED to sonames.
+    VersionTable BuildVersionTable(const std::map<std::string, std::string>& filename_to_soname) const;
+
+    // versions must be the result of BuildVersionTable.
+    void ReadDynSymtab(const VersionTable& versions);
+
+    // Returns the number of entries in .dynsym, which we know from the hash
+    // table and relocations. This works without ReadDynSymtab.
+    size_t CountDynSyms() const;
 
-    const char* Str(uintptr_t name) { return strtab_ + name; }
+    // Returns true when .dynsym has a defined symbol named name. We look it up
+    // in the hash table like ld.so, so this works without ReadDynSymtab.
+    bool DefinesSymbol(const std::string& name) const;
+
+    const char* Str(uintptr_t name) const { return strtab_ + name; }
 
     char* GetPtr(uintptr_t offset) { return head_ + OffsetFromAddr(offset); }
 
@@ -80,6 +110,12 @@ public:
 
     const Elf_Phdr& GetPhdr(uint64_t type);
 
+    // Returns the first section header of type or nullptr.
+    const Elf_Shdr* FindShdr(Elf_Word type) const;
+
+    // Name of shdr in .shstrtab.
+    const char* ShName(const Elf_Shdr& shdr) const;
+
     void PrintVerneeds();
 
     void PrintVersyms();
@@ -90,15 +126,19 @@ public:
     std::string ShowTLS();
     std::string ShowEHFrame();
 
-    std::pair<std::string, std::string> GetVersion(int index, const std::map<std::string, std::string>& filename_to_soname);
+    // Returns (soname, version) of the index-th symbol in .dynsym. versions
+    // must be the result of BuildVersionTable.
+    std::pair<StrId, StrId> GetVersion(int index, const VersionTable& versions) const;
 
     Elf_Addr OffsetFromAddr(Elf_Addr addr) const;
     Elf_Addr AddrFromOffset(Elf_Addr offset) const;
 
 private:
     void ParsePhdrs();
+    void ParseShdrs();
     void ParseEHFrameHeader(size_t off, size_t size);
     void ParseDynamic(size_t off, size_t size);
+    void ParseNotes(size_t off, size_t size);
     void ParseFuncArray(uintptr_t* array, uintptr_t size, std::vector<uintptr_t>* out);
 
     const std::string filename_;
@@ -109,9 +149,14 @@ private:
     Elf_Ehdr* ehdr_{nullptr};
     std::vector<Elf_Phdr*> phdrs_;
     std::vector<Elf_Phdr*> loads_;
+    // Index of loads_ for OffsetFromAddr and AddrFromOffset.
+    SegmentIndex addr_to_offset_;
+    SegmentIndex offset_to_addr_;
     Elf_Phdr* tls_{nullptr};
     Elf_Phdr* gnu_stack_{nullptr};
     Elf_Phdr* gnu_relro_{nullptr};
+    std::vector<Elf_Shdr*> shdrs_;
+    const char* shstrtab_{nullptr};
     const char* strtab_{nullptr};
     Elf_Sym* symtab_{nullptr};
 
@@ -122,6 +167,7 @@ private:
     std::string soname_;
     std::string runpath_;
     std::string rpath_;
+    std::string build_id_;
 
     Elf_Rel* rel_{nullptr};
     size_t num_rels_{0};
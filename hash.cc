@@ -16,9 +16,21 @@
 #include "hash.h"
 
 uint32_t CalcGnuHash(const std::string& name) {
+    return CalcGnuHash(name.data(), name.size());
+}
+
+uint32_t CalcGnuHash(const char* name) {
     uint32_t h = 5381;
-    for (unsigned char c : name) {
-        h = h * 33 + c;
+    for (const unsigned char* p = reinterpret_cast<const unsigned char*>(name); *p; ++p) {
+        h = h * 33 + *p;
+    }
+    return h;
+}
+
+uint32_t CalcGnuHash(const char* name, size_t len) {
+    uint32_t h = 5381;
+    for (size_t i = 0; i < len; ++i) {
+        h = h * 33 + static_cast<unsigned char>(name[i]);
     }
     return h;
 }
@@ -33,3 +45,43 @@ uint32_t CalcHash(const std::string& name) {
     }
     return h;
 }
+
+size_t GnuHashChainLength(const Elf_GnuHash& gnu_hash, uint32_t b, size_t num_hashvals) {
+    const uint32_t n = gnu_hash.buckets()[b];
+    if (n == 0) return 0;
+    if (n < gnu_hash.symndx) return kBrokenGnuHashChain;
+    const uint32_t* hashvals = gnu_hash.hashvals();
+    for (size_t i = n - gnu_hash.symndx; i < num_hashvals; ++i) {
+        if (hashvals[i] & 1) return i + gnu_hash.symndx - n + 1;
+    }
+    return kBrokenGnuHashChain;
+}
+
+void HashChainStats::Add(size_t len) {
+    if (histogram.size() <= len) histogram.resize(len + 1);
+    histogram[len]++;
+    symbols += len;
+    nonempty_buckets += len > 0;
+    probes += len * (len + 1) / 2;
+}
+
+HashChainStats CollectHashChainStats(const Elf_GnuHash& gnu_hash) {
+    HashChainStats stats;
+    for (uint32_t b = 0; b < gnu_hash.nbuckets; ++b) {
+        const size_t len = GnuHashChainLength(gnu_hash, b);
+        CHECK_NE(len, kBrokenGnuHashChain) << "bucket " << b << " of .gnu.hash points below symndx";
+        stats.Add(len);
+    }
+    return stats;
+}
+
+HashChainStats CollectHashChainStats(const Elf_Hash& hash) {
+    HashChainStats stats;
+    for (uint32_t b = 0; b < hash.nbuckets; ++b) {
+        size_t len = 0;
+        // Broken chains may have a loop.
+        for (uint32_t n = hash.buckets()[b]; n != STN_UNDEF && n < hash.nchains && len < hash.nchains; n = hash.chains()[n]) len++;
+        stats.Add(len);
+    }
+    return stats;
+}
@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include "utils.h"
 
 struct Elf_GnuHash {
@@ -29,10 +31,20 @@ struct Elf_GnuHash {
     uint32_t* buckets() { return reinterpret_cast<uint32_t*>(&bloom_filter()[maskwords]); }
 
     uint32_t* hashvals() { return reinterpret_cast<uint32_t*>(&buckets()[nbuckets]); }
+
+    const Elf_Addr* bloom_filter() const { return reinterpret_cast<const Elf_Addr*>(tail); }
+
+    const uint32_t* buckets() const { return reinterpret_cast<const uint32_t*>(&bloom_filter()[maskwords]); }
+
+    const uint32_t* hashvals() const { return reinterpret_cast<const uint32_t*>(&buckets()[nbuckets]); }
 };
 
 uint32_t CalcGnuHash(const std::string& name);
 
+uint32_t CalcGnuHash(const char* name);
+
+uint32_t CalcGnuHash(const char* name, size_t len);
+
 uint32_t CalcHash(const std::string& name);
 
 struct Elf_Hash {
@@ -44,3 +56,31 @@ struct Elf_Hash {
 
     const uint32_t* chains() const { return buckets() + nbuckets; }
 };
+
+constexpr size_t kBrokenGnuHashChain = SIZE_MAX;
+
+// Returns the number of symbols in the chain of bucket b, or 0 for an empty
+// bucket. Reads at most num_hashvals hash values and returns
+// kBrokenGnuHashChain when the chain does not end in them or the bucket
+// points below symndx.
+size_t GnuHashChainLength(const Elf_GnuHash& gnu_hash, uint32_t b, size_t num_hashvals = SIZE_MAX);
+
+// Lengths of chains of a DT_GNU_HASH or DT_HASH table.
+struct HashChainStats {
+    // The number of buckets indexed by the length of their chains.
+    std::vector<uint64_t> histogram;
+    size_t symbols{0};
+    size_t nonempty_buckets{0};
+    // The sum of positions in chains of all symbols.
+    size_t probes{0};
+
+    void Add(size_t len);
+
+    // Returns the number of hash values compared to find a symbol in the
+    // table, averaged over its symbols.
+    double AverageSuccessfulProbes() const { return symbols ? static_cast<double>(probes) / symbols : 0; }
+};
+
+HashChainStats CollectHashChainStats(const Elf_GnuHash& gnu_hash);
+
+HashChainStats CollectHashChainStats(const Elf_Hash& hash);
@@ -0,0 +1,119 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+// OpenHashMap is a hash map with open addressing and linear probing. All
+// slots live in one flat array, so a lookup touches a few adjacent cache
+// lines and an insertion allocates nothing unless the table grows. We never
+// erase entries while linking, so OpenHashMap does not support erasure.
+//
+// Pointers returned by Find and Insert are invalidated when the table grows.
+// OpenHashMap has no iterator because its slot order depends on hash values;
+// callers which need a deterministic order must keep it by themselves.
+template <class K, class V, class Hash = std::hash<K>>
+class OpenHashMap {
+public:
+    explicit OpenHashMap(size_t expected_size = 0) { reserve(expected_size); }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    // Makes the table large enough to keep n entries without growing.
+    void reserve(size_t n) {
+        size_t capacity = kMinCapacity;
+        while (capacity * kMaxLoadNum < n * kMaxLoadDen) capacity *= 2;
+        if (capacity > slots_.size()) Rehash(capacity);
+    }
+
+    const V* Find(const K& key) const {
+        if (slots_.empty()) return nullptr;
+        const Slot& slot = slots_[Probe(key)];
+        return slot.used ? &slot.value : nullptr;
+    }
+
+    V* Find(const K& key) { return const_cast<V*>(static_cast<const OpenHashMap*>(this)->Find(key)); }
+
+    // Inserts (key, value) when key is not in the table. Returns the pointer
+    // to the value for key and whether the insertion took place.
+    std::pair<V*, bool> Insert(const K& key, const V& value) {
+        if ((size_ + 1) * kMaxLoadDen > slots_.size() * kMaxLoadNum) {
+            Rehash(slots_.empty() ? static_cast<size_t>(kMinCapacity) : slots_.size() * 2);
+        }
+        Slot& slot = slots_[Probe(key)];
+        if (slot.used) return std::make_pair(&slot.value, false);
+        slot.used = true;
+        slot.key = key;
+        slot.value = value;
+        size_++;
+        return std::make_pair(&slot.value, true);
+    }
+
+    V& operator[](const K& key) { return *Insert(key, V()).first; }
+
+private:
+    struct Slot {
+        bool used{false};
+        K key{};
+        V value{};
+    };
+
+    // The load factor is kept below kMaxLoadNum / kMaxLoadDen.
+    static constexpr size_t kMaxLoadNum = 3;
+    static constexpr size_t kMaxLoadDen = 4;
+    static constexpr size_t kMinCapacity = 16;
+
+    // Returns the index of the slot which has key or the empty slot where key
+    // should be inserted.
+    size_t Probe(const K& key) const {
+        const size_t mask = slots_.size() - 1;
+        // Fibonacci hashing spreads hash values with poor low bits such as
+        // sequential StrIds.
+        size_t i = (static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15ULL) >> shift_;
+        while (slots_[i].used && !(slots_[i].key == key)) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void Rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.resize(capacity);
+        shift_ = 64;
+        for (size_t c = capacity; c > 1; c >>= 1) shift_--;
+        for (Slot& s : old) {
+            if (!s.used) continue;
+            Slot& slot = slots_[Probe(s.key)];
+            slot.used = true;
+            slot.key = std::move(s.key);
+            slot.value = std::move(s.value);
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_{0};
+    // 64 - log2(slots_.size())
+    int shift_{64};
+    Hash hash_;
+};
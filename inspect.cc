@@ -0,0 +1,438 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "inspect.h"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+
+std::string SymbolType(const Elf_Sym& sym) {
+    switch (ELF_ST_TYPE(sym.st_info)) {
+        case STT_NOTYPE:
+            return "NOTYPE";
+        case STT_OBJECT:
+            return "OBJECT";
+        case STT_FUNC:
+            return "FUNC";
+        case STT_SECTION:
+            return "SECTION";
+        case STT_FILE:
+            return "FILE";
+        case STT_COMMON:
+            return "COMMON";
+        case STT_TLS:
+            return "TLS";
+        case STT_GNU_IFUNC:
+            return "GNU_IFUNC";
+        default:
+            return std::to_string(ELF_ST_TYPE(sym.st_info));
+    }
+}
+
+std::string SymbolBind(const Elf_Sym& sym) {
+    switch (ELF_ST_BIND(sym.st_info)) {
+        case STB_LOCAL:
+            return "LOCAL";
+        case STB_GLOBAL:
+            return "GLOBAL";
+        case STB_WEAK:
+            return "WEAK";
+        case STB_GNU_UNIQUE:
+            return "GNU_UNIQUE";
+        default:
+            return std::to_string(ELF_ST_BIND(sym.st_info));
+    }
+}
+
+std::string SymbolVisibility(const Elf_Sym& sym) {
+    switch (ELF64_ST_VISIBILITY(sym.st_other)) {
+        case STV_DEFAULT:
+            return "DEFAULT";
+        case STV_INTERNAL:
+            return "INTERNAL";
+        case STV_HIDDEN:
+            return "HIDDEN";
+        default:
+            return "PROTECTED";
+    }
+}
+
+// Returns names of version indices in .gnu.version_r and .gnu.version_d.
+std::map<Elf_Versym, std::string> VersionNames(const ELFBinary& bin) {
+    std::map<Elf_Versym, std::string> names;
+    const char* vn = reinterpret_cast<const char*>(bin.verneed());
+    for (Elf_Xword i = 0; vn && i < bin.verneednum(); ++i) {
+        const Elf_Verneed* verneed = reinterpret_cast<const Elf_Verneed*>(vn);
+        const char* vna = vn + verneed->vn_aux;
+        for (Elf_Half j = 0; j < verneed->vn_cnt; ++j) {
+            const Elf_Vernaux* vernaux = reinterpret_cast<const Elf_Vernaux*>(vna);
+            names[vernaux->vna_other & VERSYM_VERSION] = bin.Str(vernaux->vna_name);
+            vna += vernaux->vna_next;
+        }
+        vn += verneed->vn_next;
+    }
+    const char* vd = reinterpret_cast<const char*>(bin.verdef());
+    for (Elf_Xword i = 0; vd && i < bin.verdefnum(); ++i) {
+        const Elf_Verdef* verdef = reinterpret_cast<const Elf_Verdef*>(vd);
+        const Elf_Verdaux* verdaux = reinterpret_cast<const Elf_Verdaux*>(vd + verdef->vd_aux);
+        names[verdef->vd_ndx & VERSYM_VERSION] = bin.Str(verdaux->vda_name);
+        vd += verdef->vd_next;
+    }
+    return names;
+}
+
+size_t Popcount(uint64_t v) {
+    return __builtin_popcountll(v);
+}
+
+// Writes the chain length statistics of a hash table with nbuckets buckets.
+void WriteChainStats(const HashChainStats& stats, size_t nbuckets, InspectWriter* w) {
+    w->Uint("symbols", stats.symbols);
+    w->Uint("nonempty_buckets", stats.nonempty_buckets);
+    w->Double("bucket_fill", nbuckets ? static_cast<double>(stats.nonempty_buckets) / nbuckets : 0);
+    w->Uint("max_chain_length", stats.histogram.empty() ? 0 : stats.histogram.size() - 1);
+    // Hash values compared to find a symbol in the table.
+    w->Double("average_successful_probes", stats.AverageSuccessfulProbes());
+    // Hash values compared for an absent symbol, which is the average
+    // length of chains.
+    w->Double("average_unsuccessful_probes", nbuckets ? static_cast<double>(stats.symbols) / nbuckets : 0);
+    w->UintList("chain_length_histogram", stats.histogram);
+}
+
+}  // namespace
+
+void InspectWriter::BeginReport(const std::string& report, const std::string& filename) {
+    if (json_) {
+        writer_.BeginObject();
+        writer_.Key("report");
+        writer_.String(report);
+        writer_.Key("file");
+        writer_.String(filename);
+        writer_.Key("records");
+        writer_.BeginArray();
+        in_records_ = true;
+    } else {
+        os_ << "# " << report << " " << filename << "\n";
+    }
+}
+
+void InspectWriter::EndReport() {
+    if (json_) {
+        if (in_records_) writer_.EndArray();
+        in_records_ = false;
+        writer_.EndObject();
+        os_ << "\n";
+    }
+}
+
+void InspectWriter::BeginRecord() {
+    if (json_) {
+        writer_.BeginObject();
+    } else {
+        has_field_ = false;
+    }
+}
+
+void InspectWriter::EndRecord() {
+    if (json_) {
+        writer_.EndObject();
+    } else {
+        os_ << "\n";
+    }
+}
+
+void InspectWriter::BeginSummary() {
+    if (json_) {
+        CHECK(in_records_);
+        writer_.EndArray();
+        in_records_ = false;
+        writer_.Key("summary");
+        writer_.BeginObject();
+    } else {
+        os_ << "summary:";
+        has_field_ = true;
+    }
+}
+
+void InspectWriter::EndSummary() {
+    EndRecord();
+}
+
+void InspectWriter::TextKey(const std::string& key) {
+    if (has_field_) os_ << ' ';
+    os_ << key << '=';
+    has_field_ = true;
+}
+
+void InspectWriter::String(const std::string& key, const std::string& value) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.String(value);
+    } else {
+        TextKey(key);
+        os_ << value;
+    }
+}
+
+void InspectWriter::Uint(const std::string& key, uint64_t value) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.Uint(value);
+    } else {
+        TextKey(key);
+        os_ << value;
+    }
+}
+
+void InspectWriter::Int(const std::string& key, int64_t value) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.Int(value);
+    } else {
+        TextKey(key);
+        os_ << value;
+    }
+}
+
+void InspectWriter::Double(const std::string& key, double value) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.Double(value);
+    } else {
+        TextKey(key);
+        os_ << value;
+    }
+}
+
+void InspectWriter::Hex(const std::string& key, uint64_t value) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.Uint(value);
+    } else {
+        TextKey(key);
+        os_ << HexString(value);
+    }
+}
+
+void InspectWriter::UintList(const std::string& key, const std::vector<uint64_t>& values) {
+    if (json_) {
+        writer_.Key(key);
+        writer_.BeginArray();
+        for (uint64_t v : values) writer_.Uint(v);
+        writer_.EndArray();
+    } else {
+        TextKey(key);
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (i) os_ << ',';
+            os_ << values[i];
+        }
+    }
+}
+
+void InspectDynSymtab(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("dynsym", bin.filename());
+    const std::map<Elf_Versym, std::string> versions = VersionNames(bin);
+    const size_t num_syms = bin.CountDynSyms();
+    size_t num_defined = 0;
+    for (size_t i = 0; i < num_syms; ++i) {
+        const Elf_Sym& sym = bin.symtab()[i];
+        num_defined += sym.st_shndx != SHN_UNDEF;
+        w->BeginRecord();
+        w->Uint("index", i);
+        w->String("name", bin.Str(sym.st_name));
+        w->Hex("value", sym.st_value);
+        w->Uint("size", sym.st_size);
+        w->String("type", SymbolType(sym));
+        w->String("bind", SymbolBind(sym));
+        w->String("visibility", SymbolVisibility(sym));
+        w->Uint("shndx", sym.st_shndx);
+        if (bin.versym()) {
+            const Elf_Versym v = bin.versym()[i];
+            auto found = versions.find(v & VERSYM_VERSION);
+            w->String("version", found != versions.end() ? found->second : special_ver_ndx_to_str(v & VERSYM_VERSION));
+            w->Uint("hidden", (v & VERSYM_HIDDEN) != 0);
+        }
+        w->EndRecord();
+    }
+    w->BeginSummary();
+    w->Uint("symbols", num_syms);
+    w->Uint("defined", num_defined);
+    w->EndSummary();
+    w->EndReport();
+}
+
+void InspectRelocs(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("relocs", bin.filename());
+    const Elf_Half machine = bin.ehdr()->e_machine;
+    std::map<std::string, size_t> counts;
+    size_t num_with_symbol = 0;
+    auto inspect = [&](const char* table, const Elf_Rel* rels, size_t num) {
+        for (size_t i = 0; i < num; ++i) {
+            const Elf_Rel& rel = rels[i];
+            const uint32_t sym = ELF_R_SYM(rel.r_info);
+            const std::string type = ShowRelocationType(machine, ELF_R_TYPE(rel.r_info));
+            counts[type]++;
+            num_with_symbol += sym != 0;
+            w->BeginRecord();
+            w->String("table", table);
+            w->Uint("index", i);
+            w->Hex("offset", rel.r_offset);
+            w->String("type", type);
+            w->Uint("sym", sym);
+            w->String("sym_name", sym ? bin.Str(bin.symtab()[sym].st_name) : "");
+            w->Int("addend", rel.r_addend);
+            w->EndRecord();
+        }
+    };
+    inspect(".rela.dyn", bin.rel(), bin.num_rels());
+    inspect(".rela.plt", bin.plt_rel(), bin.num_plt_rels());
+    w->BeginSummary();
+    w->Uint("relocs", bin.num_rels() + bin.num_plt_rels());
+    w->Uint("with_symbol", num_with_symbol);
+    for (const auto& p : counts) {
+        w->Uint(p.first, p.second);
+    }
+    w->EndSummary();
+    w->EndReport();
+}
+
+void InspectTLS(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("tls", bin.filename());
+    if (const Elf_Phdr* tls = bin.tls()) {
+        w->BeginRecord();
+        w->Hex("offset", tls->p_offset);
+        w->Hex("vaddr", tls->p_vaddr);
+        w->Uint("filesz", tls->p_filesz);
+        w->Uint("memsz", tls->p_memsz);
+        w->Uint("align", tls->p_align);
+        w->EndRecord();
+    }
+    w->EndReport();
+}
+
+void InspectVersions(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("versions", bin.filename());
+    const char* vn = reinterpret_cast<const char*>(bin.verneed());
+    for (Elf_Xword i = 0; vn && i < bin.verneednum(); ++i) {
+        const Elf_Verneed* verneed = reinterpret_cast<const Elf_Verneed*>(vn);
+        const char* vna = vn + verneed->vn_aux;
+        for (Elf_Half j = 0; j < verneed->vn_cnt; ++j) {
+            const Elf_Vernaux* vernaux = reinterpret_cast<const Elf_Vernaux*>(vna);
+            w->BeginRecord();
+            w->String("kind", "verneed");
+            w->String("file", bin.Str(verneed->vn_file));
+            w->String("name", bin.Str(vernaux->vna_name));
+            w->Uint("index", vernaux->vna_other);
+            w->Hex("hash", vernaux->vna_hash);
+            w->Uint("flags", vernaux->vna_flags);
+            w->EndRecord();
+            vna += vernaux->vna_next;
+        }
+        vn += verneed->vn_next;
+    }
+    const char* vd = reinterpret_cast<const char*>(bin.verdef());
+    for (Elf_Xword i = 0; vd && i < bin.verdefnum(); ++i) {
+        const Elf_Verdef* verdef = reinterpret_cast<const Elf_Verdef*>(vd);
+        const char* vda = vd + verdef->vd_aux;
+        for (Elf_Half j = 0; j < verdef->vd_cnt; ++j) {
+            const Elf_Verdaux* verdaux = reinterpret_cast<const Elf_Verdaux*>(vda);
+            w->BeginRecord();
+            // The first Verdaux is the version itself and others are its parents.
+            w->String("kind", j == 0 ? "verdef" : "verdef_parent");
+            w->String("name", bin.Str(verdaux->vda_name));
+            w->Uint("index", verdef->vd_ndx);
+            w->Hex("hash", verdef->vd_hash);
+            w->Uint("flags", verdef->vd_flags);
+            w->EndRecord();
+            vda += verdaux->vda_next;
+        }
+        vd += verdef->vd_next;
+    }
+    w->EndReport();
+}
+
+void InspectEHFrame(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("ehframe", bin.filename());
+    const EHFrameHeader& header = *bin.eh_frame_header();
+    Elf_Addr hdr = 0;
+    for (const Elf_Phdr* phdr : bin.phdrs()) {
+        if (phdr->p_type == PT_GNU_EH_FRAME) hdr = phdr->p_vaddr;
+    }
+    for (size_t i = 0; i < header.table.size(); ++i) {
+        w->BeginRecord();
+        w->Uint("index", i);
+        w->Hex("initial_loc", hdr + header.table[i].initial_loc);
+        w->Hex("fde", hdr + header.table[i].fde_ptr);
+        w->Uint("fde_length", header.fdes[i].length);
+        w->Uint("cie_version", header.cies[i].version);
+        w->String("fde_encoding", ShowDW_EH_PE(header.cies[i].FDE_encoding));
+        w->String("lsda_encoding", ShowDW_EH_PE(header.cies[i].LSDA_encoding));
+        w->EndRecord();
+    }
+    w->BeginSummary();
+    w->Uint("present", hdr != 0);
+    if (hdr) {
+        w->Uint("version", header.version);
+        w->String("eh_frame_ptr_enc", ShowDW_EH_PE(header.eh_frame_ptr_enc));
+        w->String("fde_count_enc", ShowDW_EH_PE(header.fde_count_enc));
+        w->String("table_enc", ShowDW_EH_PE(header.table_enc));
+        w->Hex("eh_frame", hdr + 4 + header.eh_frame_ptr);
+        w->Uint("fde_count", header.fde_count);
+    }
+    w->EndSummary();
+    w->EndReport();
+}
+
+void InspectHashTables(const ELFBinary& bin, InspectWriter* w) {
+    w->BeginReport("hash", bin.filename());
+    if (const Elf_GnuHash* gnu_hash = bin.gnu_hash()) {
+        const HashChainStats stats = CollectHashChainStats(*gnu_hash);
+
+        // A lookup of an absent symbol passes the bloom filter when both of
+        // its two bits in a word are set.
+        const size_t bits_per_word = sizeof(Elf_Addr) * 8;
+        size_t bits_set = 0;
+        double false_positive = 0;
+        for (uint32_t i = 0; i < gnu_hash->maskwords; ++i) {
+            const size_t n = Popcount(gnu_hash->bloom_filter()[i]);
+            bits_set += n;
+            const double fill = static_cast<double>(n) / bits_per_word;
+            false_positive += fill * fill;
+        }
+
+        w->BeginRecord();
+        w->String("table", ".gnu.hash");
+        w->Uint("nbuckets", gnu_hash->nbuckets);
+        w->Uint("symndx", gnu_hash->symndx);
+        w->Uint("maskwords", gnu_hash->maskwords);
+        w->Uint("shift2", gnu_hash->shift2);
+        WriteChainStats(stats, gnu_hash->nbuckets, w);
+        w->Double("bloom_bits_set", gnu_hash->maskwords ? static_cast<double>(bits_set) / (gnu_hash->maskwords * bits_per_word) : 0);
+        w->Double("bloom_false_positive_rate", gnu_hash->maskwords ? false_positive / gnu_hash->maskwords : 0);
+        w->EndRecord();
+    }
+    if (const Elf_Hash* hash = bin.hash()) {
+        const HashChainStats stats = CollectHashChainStats(*hash);
+        w->BeginRecord();
+        w->String("table", ".hash");
+        w->Uint("nbuckets", hash->nbuckets);
+        w->Uint("nchains", hash->nchains);
+        WriteChainStats(stats, hash->nbuckets, w);
+        w->EndRecord();
+    }
+    w->EndReport();
+}
@@ -0,0 +1,79 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "elf_binary.h"
+#include "json_writer.h"
+
+// InspectWriter streams a report as text or JSON. A report is a list of
+// records followed by an optional summary, and each of them is a flat list
+// of fields. Records are written as soon as they are complete, so reports of
+// huge libraries need no memory for their whole output.
+//
+// Text reports have a record per line such as "index=1 name=foo". JSON
+// reports are one object per line:
+//
+//   {"report":"dynsym","file":"libfoo.so","records":[{...},...],"summary":{...}}
+class InspectWriter {
+public:
+    InspectWriter(std::ostream& os, bool json) : os_(os), json_(json), writer_(os) {}
+
+    void BeginReport(const std::string& report, const std::string& filename);
+    void EndReport();
+
+    void BeginRecord();
+    void EndRecord();
+    // Must be called after all records.
+    void BeginSummary();
+    void EndSummary();
+
+    void String(const std::string& key, const std::string& value);
+    void Uint(const std::string& key, uint64_t value);
+    void Int(const std::string& key, int64_t value);
+    void Double(const std::string& key, double value);
+    // A number shown in hex in text reports.
+    void Hex(const std::string& key, uint64_t value);
+    void UintList(const std::string& key, const std::vector<uint64_t>& values);
+
+private:
+    void TextKey(const std::string& key);
+
+    std::ostream& os_;
+    bool json_;
+    JSONWriter writer_;
+    bool in_records_{false};
+    // Whether the current text line has a field.
+    bool has_field_{false};
+};
+
+// Symbols in .dynsym with their versions.
+void InspectDynSymtab(const ELFBinary& bin, InspectWriter* w);
+// Relocations in .rela.dyn and .rela.plt and their counts by type.
+void InspectRelocs(const ELFBinary& bin, InspectWriter* w);
+void InspectTLS(const ELFBinary& bin, InspectWriter* w);
+// .gnu.version_r and .gnu.version_d.
+void InspectVersions(const ELFBinary& bin, InspectWriter* w);
+// Entries of .eh_frame_hdr and their CIEs and FDEs.
+void InspectEHFrame(const ELFBinary& bin, InspectWriter* w);
+// Quality of .gnu.hash and .hash: how full buckets are, how long chains are
+// and how often the bloom filter of .gnu.hash lets absent symbols through.
+void InspectHashTables(const ELFBinary& bin, InspectWriter* w);
@@ -0,0 +1,133 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include "utils.h"
+
+void JSONWriter::Separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!has_element_.empty()) {
+        if (has_element_.back()) os_ << ',';
+        has_element_.back() = true;
+    }
+}
+
+void JSONWriter::BeginObject() {
+    Separate();
+    os_ << '{';
+    has_element_.push_back(false);
+}
+
+void JSONWriter::EndObject() {
+    CHECK(!has_element_.empty() && !after_key_);
+    has_element_.pop_back();
+    os_ << '}';
+}
+
+void JSONWriter::BeginArray() {
+    Separate();
+    os_ << '[';
+    has_element_.push_back(false);
+}
+
+void JSONWriter::EndArray() {
+    CHECK(!has_element_.empty() && !after_key_);
+    has_element_.pop_back();
+    os_ << ']';
+}
+
+void JSONWriter::Key(const std::string& key) {
+    CHECK(!after_key_);
+    Separate();
+    os_ << '"' << Escape(key) << "\":";
+    after_key_ = true;
+}
+
+void JSONWriter::String(const std::string& value) {
+    Separate();
+    os_ << '"' << Escape(value) << '"';
+}
+
+void JSONWriter::Int(int64_t value) {
+    Separate();
+    os_ << value;
+}
+
+void JSONWriter::Uint(uint64_t value) {
+    Separate();
+    os_ << value;
+}
+
+void JSONWriter::Double(double value) {
+    Separate();
+    // JSON has neither NaN nor infinity.
+    if (!isfinite(value)) {
+        os_ << "null";
+        return;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", value);
+    os_ << buf;
+}
+
+void JSONWriter::Bool(bool value) {
+    Separate();
+    os_ << (value ? "true" : "false");
+}
+
+void JSONWriter::Null() {
+    Separate();
+    os_ << "null";
+}
+
+std::string JSONWriter::Escape(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
@@ -0,0 +1,61 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// JSONWriter writes a JSON document to a stream without building it in
+// memory. Callers are responsible for the nesting, e.g.
+//
+//   JSONWriter w(os);
+//   w.BeginObject();
+//   w.Key("name");
+//   w.String("libfoo.so");
+//   w.EndObject();
+class JSONWriter {
+public:
+    explicit JSONWriter(std::ostream& os) : os_(os) {}
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    // Must be followed by exactly one value.
+    void Key(const std::string& key);
+
+    void String(const std::string& value);
+    void Int(int64_t value);
+    void Uint(uint64_t value);
+    void Double(double value);
+    void Bool(bool value);
+    void Null();
+
+    static std::string Escape(const std::string& s);
+
+private:
+    // Emits a separator before a value or a key if needed.
+    void Separate();
+
+    std::ostream& os_;
+    // Whether the current object or array already has an element.
+    std::vector<bool> has_element_;
+    bool after_key_{false};
+};
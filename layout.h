@@ -0,0 +1,71 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Layout is the file layout of the output. The sizes of the sections which
+// come from the input ELF files are decided in Sold::ComputeInputSizes before
+// Sold::DecideMemOffset because they are also used for the memory layout.
+// All other offsets and sizes are decided at once in Sold::PlanLayout after
+// symbols, relocations and strings are collected. Build*, Emit* and
+// ShdrBuilder read them from Layout and never recompute them.
+struct Layout {
+    struct Section {
+        uintptr_t offset{0};
+        uintptr_t size{0};
+
+        uintptr_t end() const { return offset + size; }
+    };
+
+    // The number of program headers.
+    size_t num_phdrs{0};
+
+    Section gnu_hash;
+    Section dynsym;
+    Section versym;
+    Section verneed;
+    Section rela_dyn;
+    Section init_array;
+    Section fini_array;
+    Section dynstr;
+    Section dynamic;
+    // NT_GNU_BUILD_ID. It is empty with Sold::DisableBuildId.
+    Section build_id;
+    Section shstrtab;
+
+    // Contents of PT_LOADs of the input ELF files. The offset of each PT_LOAD
+    // is in Sold::loads_.
+    Section code;
+
+    // TLS initialization image. Its size is the sum of p_filesz of PT_TLS.
+    Section tls;
+    // The sum of p_memsz of PT_TLS.
+    uintptr_t tls_mem_size{0};
+    Section ehframe;
+    Section mprotect;
+    // The code and the data of Sold::EnableTimeInit. They are empty without it.
+    Section time_init;
+    Section time_init_data;
+    // .symtab and .strtab are emitted only with section headers.
+    Section symtab;
+    Section strtab;
+    // .gnu_debuglink is emitted only with a debug file.
+    Section debuglink;
+
+    uintptr_t shdr_offset{0};
+};
@@ -15,9 +15,12 @@
 
 #include "ldsoconf.h"
 
+#include <elf.h>
 #include <glob.h>
+#include <string.h>
 
 #include <fstream>
+#include <iterator>
 
 namespace ldsoconf {
 namespace {
@@ -48,8 +51,128 @@ void read_ldsoconf_dfs(std::vector<std::string>& res, const std::string& filenam
     }
 }
 
+// These are the same as glibc/sysdeps/generic/dl-cache.h.
+constexpr char kCacheMagic[] = "ld.so-1.7.0";
+constexpr char kCacheMagicNew[] = "glibc-ld.so.cache";
+constexpr char kCacheVersion[] = "1.1";
+
+constexpr int32_t kFlagElfLibc6 = 0x0003;
+constexpr int32_t kFlagX8664Lib64 = 0x0300;
+constexpr int32_t kFlagAArch64Lib64 = 0x0a00;
+
+struct FileEntry {
+    int32_t flags;
+    uint32_t key;
+    uint32_t value;
+};
+
+struct CacheFile {
+    char magic[sizeof(kCacheMagic) - 1];
+    uint32_t nlibs;
+    FileEntry libs[0];
+};
+
+struct FileEntryNew {
+    int32_t flags;
+    uint32_t key;
+    uint32_t value;
+    uint32_t osversion_unused;
+    uint64_t hwcap;
+};
+
+struct CacheFileNew {
+    char magic[sizeof(kCacheMagicNew) - 1];
+    char version[sizeof(kCacheVersion) - 1];
+    uint32_t nlibs;
+    uint32_t len_strings;
+    uint8_t flags;
+    uint8_t padding_unused[3];
+    uint32_t extension_offset;
+    uint32_t unused[3];
+    FileEntryNew libs[0];
+};
+
+// Same as _DL_CACHE_DEFAULT_ID in glibc/sysdeps/*/dl-cache.h. Returns 0 for
+// unsupported machines.
+int32_t cache_flags_for(uint16_t machine) {
+    switch (machine) {
+        case EM_X86_64:
+            return kFlagElfLibc6 | kFlagX8664Lib64;
+        case EM_AARCH64:
+            return kFlagElfLibc6 | kFlagAArch64Lib64;
+        default:
+            return 0;
+    }
+}
+
+uint64_t hwcap_of(const FileEntry&) { return 0; }
+
+uint64_t hwcap_of(const FileEntryNew& e) { return e.hwcap; }
+
+// Adds entries to res. String offsets in entries are relative to strings.
+// Entries with hwcap are for glibc-hwcaps subdirectories, which ld.so chooses
+// by the running CPU. We use only the baseline ones so that the output does
+// not depend on the machine where sold runs.
+template <class Entry>
+void add_cache_entries(const std::string& cache, const Entry* libs, uint32_t nlibs, size_t strings, int32_t flags,
+                       std::unordered_map<std::string, std::string>& res) {
+    auto get_str = [&cache, strings](uint32_t offset, std::string* out) {
+        if (strings + offset >= cache.size()) return false;
+        const char* p = cache.data() + strings + offset;
+        *out = std::string(p, strnlen(p, cache.size() - strings - offset));
+        return true;
+    };
+
+    for (uint32_t i = 0; i < nlibs; i++) {
+        if (libs[i].flags != flags || hwcap_of(libs[i]) != 0) continue;
+        std::string key, value;
+        if (!get_str(libs[i].key, &key) || !get_str(libs[i].value, &value)) continue;
+        res.emplace(key, value);
+    }
+}
+
 }  // namespace
 
+std::unordered_map<std::string, std::string> read_ldsocache(const std::string& filename, uint16_t machine) {
+    std::unordered_map<std::string, std::string> res;
+    const int32_t flags = cache_flags_for(machine);
+    if (flags == 0) return res;
+
+    std::ifstream f(filename, std::ios::binary);
+    if (!f) return res;
+    const std::string cache((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    // The old format may be followed by the new format like ld.so reads it
+    // in glibc/elf/dl-cache.c.
+    size_t new_offset = 0;
+    if (cache.size() >= sizeof(CacheFile) && memcmp(cache.data(), kCacheMagic, sizeof(kCacheMagic) - 1) == 0) {
+        const CacheFile* old = reinterpret_cast<const CacheFile*>(cache.data());
+        const size_t entries_end = sizeof(CacheFile) + static_cast<size_t>(old->nlibs) * sizeof(FileEntry);
+        if (entries_end > cache.size()) return res;
+        new_offset = (entries_end + alignof(CacheFileNew) - 1) & ~(alignof(CacheFileNew) - 1);
+        if (new_offset + sizeof(CacheFileNew) > cache.size() ||
+            memcmp(cache.data() + new_offset, kCacheMagicNew, sizeof(kCacheMagicNew) - 1) != 0) {
+            // Strings of the old format are relative to the end of the entries.
+            add_cache_entries(cache, old->libs, old->nlibs, entries_end, flags, res);
+            return res;
+        }
+    }
+
+    if (new_offset + sizeof(CacheFileNew) > cache.size()) return res;
+    const CacheFileNew* cache_new = reinterpret_cast<const CacheFileNew*>(cache.data() + new_offset);
+    if (memcmp(cache_new->magic, kCacheMagicNew, sizeof(kCacheMagicNew) - 1) != 0 ||
+        memcmp(cache_new->version, kCacheVersion, sizeof(kCacheVersion) - 1) != 0) {
+        return res;
+    }
+    if (new_offset + sizeof(CacheFileNew) + static_cast<size_t>(cache_new->nlibs) * sizeof(FileEntryNew) > cache.size()) {
+        return res;
+    }
+
+    // Strings of the new format are relative to the head of the new format.
+    add_cache_entries(cache, cache_new->libs, cache_new->nlibs, new_offset, flags, res);
+    return res;
+}
+
 std::vector<std::string> read_ldsoconf() {
     std::vector<std::string> res;
     read_ldsoconf_dfs(res, "/etc/ld.so.conf");
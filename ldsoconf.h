@@ -15,9 +15,21 @@
 
 #pragma once
 
+#include <stdint.h>
+
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ldsoconf {
 std::vector<std::string> read_ldsoconf();
-}
+
+// Reads ld.so.cache generated by ldconfig and returns the map from names of
+// shared objects to their paths. Only entries which ld.so would accept for
+// an ELF file of the given e_machine are returned. When the same name appears
+// more than once, the first one wins like ld.so. Both the new format
+// (glibc-ld.so.cache1.1) and the old one (ld.so-1.7.0) are supported. Returns
+// an empty map when filename is missing or malformed because ld.so ignores
+// such a cache.
+std::unordered_map<std::string, std::string> read_ldsocache(const std::string& filename, uint16_t machine);
+}  // namespace ldsoconf
@@ -0,0 +1,145 @@
+// Measures dlopen and the first call of test() of libtorch_test.so, e.g.
+//
+//   torch_test_bench --runs 10 ./libtorch_test.so.original ./libtorch_test.so.soldout
+//
+// Each run is a fresh process. Results are printed as lines of JSON with
+// sorted keys, one per library.
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Result {
+    double dlopen_us;
+    double first_call_us;
+    int files;
+};
+
+uint64_t NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Shared objects mapped in this process.
+std::set<std::string> MappedObjects() {
+    std::set<std::string> objs;
+    FILE* fp = fopen("/proc/self/maps", "r");
+    char line[4096];
+    while (fp && fgets(line, sizeof(line), fp)) {
+        const char* path = strchr(line, '/');
+        if (path && strstr(path, ".so")) objs.insert(std::string(path, strcspn(path, "\n")));
+    }
+    if (fp) fclose(fp);
+    return objs;
+}
+
+// Runs in a child process and writes Result to fd.
+void RunChild(const char* lib, int fd) {
+    // test() prints its results, which we are not interested in.
+    freopen("/dev/null", "w", stdout);
+
+    const std::set<std::string> before = MappedObjects();
+    const uint64_t t0 = NowNs();
+    void* handle = dlopen(lib, RTLD_LAZY);
+    const uint64_t t1 = NowNs();
+    if (!handle) {
+        fprintf(stderr, "%s\n", dlerror());
+        exit(1);
+    }
+    void (*test)() = reinterpret_cast<void (*)()>(dlsym(handle, "test"));
+    if (!test) {
+        fprintf(stderr, "%s\n", dlerror());
+        exit(1);
+    }
+    test();
+    const uint64_t t2 = NowNs();
+
+    Result r;
+    r.dlopen_us = (t1 - t0) / 1000.0;
+    r.first_call_us = (t2 - t1) / 1000.0;
+    r.files = 0;
+    for (const std::string& o : MappedObjects()) r.files += !before.count(o);
+    if (write(fd, &r, sizeof(r)) != sizeof(r)) exit(1);
+    exit(0);
+}
+
+Result Run(const char* lib) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        RunChild(lib, fds[1]);
+    }
+    close(fds[1]);
+    Result r;
+    const bool ok = read(fds[0], &r, sizeof(r)) == sizeof(r);
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!ok || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "Failed to load %s\n", lib);
+        exit(1);
+    }
+    return r;
+}
+
+double Percentile(std::vector<double> v, double p) {
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+void PrintDistribution(const char* key, const std::vector<double>& v) {
+    printf("\"%s\": {\"max\": %.3f, \"median\": %.3f, \"min\": %.3f, \"p90\": %.3f}", key, Percentile(v, 1.0), Percentile(v, 0.5),
+           Percentile(v, 0.0), Percentile(v, 0.9));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int runs = 10;
+    int i = 1;
+    if (argc > 2 && strcmp(argv[1], "--runs") == 0) {
+        runs = atoi(argv[2]);
+        i = 3;
+    }
+    if (i == argc || runs <= 0) {
+        fprintf(stderr, "usage: %s [--runs N] LIB...\n", argv[0]);
+        return 1;
+    }
+
+    for (; i < argc; ++i) {
+        // The first run warms the page cache.
+        Run(argv[i]);
+        std::vector<double> dlopen_us, first_call_us, files;
+        for (int j = 0; j < runs; ++j) {
+            const Result r = Run(argv[i]);
+            dlopen_us.push_back(r.dlopen_us);
+            first_call_us.push_back(r.first_call_us);
+            files.push_back(r.files);
+        }
+        printf("{\"benchmark\": \"libtorch_dlopen\", ");
+        PrintDistribution("dlopen_us", dlopen_us);
+        printf(", \"files\": %d, ", static_cast<int>(Percentile(files, 0.5)));
+        PrintDistribution("first_call_us", first_call_us);
+        printf(", \"library\": \"%s\", \"runs\": %d}\n", argv[i], runs);
+        fflush(stdout);
+    }
+    return 0;
+}
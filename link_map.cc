@@ -0,0 +1,97 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "link_map.h"
+
+#include "json_writer.h"
+
+namespace {
+
+// Bump this when a field is removed or changes its meaning.
+constexpr int kLinkMapVersion = 1;
+
+void WriteLibrary(JSONWriter& w, const LinkMap::Library& library) {
+    w.Key("path");
+    w.String(library.path);
+    w.Key("soname");
+    w.String(library.soname);
+    w.Key("build_id");
+    w.String(library.build_id);
+}
+
+void WriteUint(JSONWriter& w, const char* key, uint64_t value) {
+    w.Key(key);
+    w.Uint(value);
+}
+
+std::string OrDash(const std::string& s) { return s.empty() ? "-" : s; }
+
+}  // namespace
+
+void LinkMap::WriteJSON(std::ostream& os) const {
+    JSONWriter w(os);
+    w.BeginObject();
+    WriteUint(w, "version", kLinkMapVersion);
+    w.Key("output");
+    w.String(output);
+    WriteUint(w, "output_tls_vaddr", output_tls_vaddr);
+
+    w.Key("segments");
+    w.BeginArray();
+    for (const Segment& s : segments) {
+        w.BeginObject();
+        WriteLibrary(w, s.library);
+        WriteUint(w, "input_vaddr", s.input_vaddr);
+        WriteUint(w, "input_offset", s.input_offset);
+        WriteUint(w, "output_vaddr", s.output_vaddr);
+        WriteUint(w, "output_offset", s.output_offset);
+        WriteUint(w, "filesz", s.filesz);
+        WriteUint(w, "memsz", s.memsz);
+        WriteUint(w, "input_flags", s.input_flags);
+        w.EndObject();
+    }
+    w.EndArray();
+
+    w.Key("tls");
+    w.BeginArray();
+    for (const TLS& t : tls) {
+        w.BeginObject();
+        WriteLibrary(w, t.library);
+        WriteUint(w, "input_vaddr", t.input_vaddr);
+        WriteUint(w, "filesz", t.filesz);
+        WriteUint(w, "memsz", t.memsz);
+        WriteUint(w, "tdata_offset", t.tdata_offset);
+        WriteUint(w, "tbss_offset", t.tbss_offset);
+        w.EndObject();
+    }
+    w.EndArray();
+    w.EndObject();
+    os << std::endl;
+}
+
+void LinkMap::WriteTSV(std::ostream& os) const {
+    os << "# sold link map version " << kLinkMapVersion << " output=" << output << " output_tls_vaddr=" << output_tls_vaddr << "\n";
+    os << "kind\tpath\tsoname\tbuild_id\tinput_vaddr\tinput_offset\toutput_vaddr\toutput_offset\tfilesz\tmemsz\ttdata_offset\ttbss_offset"
+       << "\tinput_flags\n";
+    for (const Segment& s : segments) {
+        os << "load\t" << s.library.path << "\t" << OrDash(s.library.soname) << "\t" << OrDash(s.library.build_id) << "\t" << s.input_vaddr
+           << "\t" << s.input_offset << "\t" << s.output_vaddr << "\t" << s.output_offset << "\t" << s.filesz << "\t" << s.memsz
+           << "\t-\t-\t" << s.input_flags << "\n";
+    }
+    for (const TLS& t : tls) {
+        os << "tls\t" << t.library.path << "\t" << OrDash(t.library.soname) << "\t" << OrDash(t.library.build_id) << "\t" << t.input_vaddr
+           << "\t-\t-\t-\t" << t.filesz << "\t" << t.memsz << "\t" << t.tdata_offset << "\t" << t.tbss_offset << "\t-\n";
+    }
+}
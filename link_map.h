@@ -0,0 +1,73 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LinkMap records where each input segment landed in the output for --map.
+// Profilers and crash symbolizers use it to translate an address in the
+// output back into an address in the original library.
+struct LinkMap {
+    // Identifies the input library.
+    struct Library {
+        std::string path;
+        std::string soname;
+        std::string build_id;
+    };
+
+    // A PT_LOAD of an input and its copy in the output.
+    struct Segment {
+        Library library;
+        uint64_t input_vaddr;
+        uint64_t input_offset;
+        uint64_t output_vaddr;
+        uint64_t output_offset;
+        uint64_t filesz;
+        uint64_t memsz;
+        // p_flags of the input PT_LOAD. sold makes all PT_LOADs writable, so
+        // this tells code from data.
+        uint32_t input_flags;
+    };
+
+    // A PT_TLS of an input. The initialized part of the input template is at
+    // tdata_offset of the output template and the zero-filled part is at
+    // tbss_offset.
+    struct TLS {
+        Library library;
+        uint64_t input_vaddr;
+        uint64_t filesz;
+        uint64_t memsz;
+        uint64_t tdata_offset;
+        uint64_t tbss_offset;
+    };
+
+    std::string output;
+    // The vaddr of PT_TLS in the output.
+    uint64_t output_tls_vaddr{0};
+    std::vector<Segment> segments;
+    std::vector<TLS> tls;
+
+    // Writes a JSON object with "version", "output", "segments" and "tls".
+    void WriteJSON(std::ostream& os) const;
+
+    // Writes a line per segment and TLS with a header line. The first column
+    // is "load" or "tls" and unused columns are "-".
+    void WriteTSV(std::ostream& os) const;
+};
@@ -28,7 +28,6 @@ void MprotectBuilder::EmitX86_64(FILE* fp, uintptr_t mprotect_code_offset) {
     free(mprotect_code);
 }
 
-namespace {
 std::vector<uint32_t> set_immediate_to_register_aarch64(int64_t value, uint8_t reg) {
     std::vector<uint32_t> ret;
     for (int i = 0; i < 4; i++) {
@@ -40,7 +39,6 @@ std::vector<uint32_t> set_immediate_to_register_aarch64(int64_t value, uint8_t r
     }
     return ret;
 }
-}  // namespace
 
 void MprotectBuilder::EmitAarch64(FILE* fp, uintptr_t mprotect_code_offset) {
     long int old_pos = ftell(fp);
@@ -20,6 +20,9 @@
 
 #include "utils.h"
 
+// Returns 4 movk instructions which set value to the register xN of reg.
+std::vector<uint32_t> set_immediate_to_register_aarch64(int64_t value, uint8_t reg);
+
 class MprotectBuilder {
 public:
     void SetMachineType(const Elf64_Half machine_type) {
@@ -0,0 +1,146 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "page_report.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+constexpr uintptr_t kPageSize = 0x1000;
+
+// Counts of a library or a relocation type.
+struct Count {
+    size_t loads{0};
+    size_t mapped_pages{0};
+    size_t relocs{0};
+    size_t dirty_pages{0};
+    // Pages dirtied only by relocations of this type.
+    size_t sole_pages{0};
+};
+
+std::string Ratio(size_t num, size_t den) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << (den ? static_cast<double>(num) / den : 0.0);
+    return ss.str();
+}
+
+}  // namespace
+
+void PageReport::AddLoad(const std::string& library, uintptr_t vaddr, uintptr_t memsz) {
+    Load load;
+    load.library = library;
+    load.vaddr = vaddr;
+    load.memsz = memsz;
+    auto pos = std::upper_bound(loads_.begin(), loads_.end(), vaddr, [](uintptr_t v, const Load& l) { return v < l.vaddr; });
+    loads_.insert(pos, load);
+}
+
+void PageReport::AddReloc(const Elf_Rel& rel) {
+    auto found = std::upper_bound(loads_.begin(), loads_.end(), rel.r_offset, [](uintptr_t v, const Load& l) { return v < l.vaddr; });
+    if (found == loads_.begin() || rel.r_offset >= (found - 1)->vaddr + (found - 1)->memsz) {
+        unmapped_relocs_++;
+        return;
+    }
+    Load& load = *(found - 1);
+    load.relocs++;
+    load.pages[rel.r_offset / kPageSize][ELF_R_TYPE(rel.r_info)]++;
+}
+
+void PageReport::Print(std::ostream& os, size_t top_n) const {
+    std::vector<std::string> libraries;
+    std::map<std::string, Count> by_library;
+    std::map<int, Count> by_type;
+    // The number of dirty pages by the number of relocations in them. Bucket
+    // i has pages with [2^i, 2^(i+1)) relocations.
+    std::vector<size_t> histogram;
+    size_t dirty_pages = 0;
+    size_t mapped_pages = 0;
+    for (const Load& load : loads_) {
+        if (!by_library.count(load.library)) libraries.push_back(load.library);
+        Count& library = by_library[load.library];
+        const size_t pages = (AlignNext(load.vaddr + load.memsz) - load.vaddr / kPageSize * kPageSize) / kPageSize;
+        library.loads++;
+        library.mapped_pages += pages;
+        library.relocs += load.relocs;
+        library.dirty_pages += load.pages.size();
+        dirty_pages += load.pages.size();
+        mapped_pages += pages;
+        for (const auto& page : load.pages) {
+            size_t relocs = 0;
+            for (const auto& type : page.second) {
+                Count& count = by_type[type.first];
+                count.relocs += type.second;
+                count.dirty_pages++;
+                if (page.second.size() == 1) count.sole_pages++;
+                relocs += type.second;
+            }
+            size_t bucket = 0;
+            while (relocs >> (bucket + 1)) bucket++;
+            if (histogram.size() <= bucket) histogram.resize(bucket + 1);
+            histogram[bucket]++;
+        }
+    }
+
+    std::stable_sort(libraries.begin(), libraries.end(),
+                     [&by_library](const std::string& a, const std::string& b) { return by_library[a].dirty_pages > by_library[b].dirty_pages; });
+    os << std::left << std::setw(40) << "library" << std::right << std::setw(8) << "loads" << std::setw(14) << "mapped_pages"
+       << std::setw(14) << "dirty_pages" << std::setw(14) << "dirty_bytes" << std::setw(10) << "relocs" << std::setw(16)
+       << "relocs_per_page" << std::endl;
+    for (const std::string& library : libraries) {
+        const Count& c = by_library[library];
+        os << std::left << std::setw(40) << library << std::right << std::setw(8) << c.loads << std::setw(14) << c.mapped_pages
+           << std::setw(14) << c.dirty_pages << std::setw(14) << c.dirty_pages * kPageSize << std::setw(10) << c.relocs << std::setw(16)
+           << Ratio(c.relocs, c.dirty_pages) << std::endl;
+    }
+    os << std::endl
+       << "Dirty pages: " << dirty_pages << " of " << mapped_pages << " mapped pages (" << dirty_pages * kPageSize << " bytes per process)"
+       << std::endl;
+    if (unmapped_relocs_) os << "Relocations outside of PT_LOADs: " << unmapped_relocs_ << std::endl;
+    os << std::endl;
+
+    std::vector<const Load*> loads;
+    for (const Load& load : loads_) {
+        if (!load.pages.empty()) loads.push_back(&load);
+    }
+    std::stable_sort(loads.begin(), loads.end(), [](const Load* a, const Load* b) { return a->pages.size() > b->pages.size(); });
+    if (loads.size() > top_n) loads.resize(top_n);
+    os << std::left << std::setw(40) << "library" << std::setw(20) << "vaddr" << std::right << std::setw(14) << "memsz" << std::setw(14)
+       << "dirty_pages" << std::setw(10) << "relocs" << std::endl;
+    for (const Load* load : loads) {
+        os << std::left << std::setw(40) << load->library << std::setw(20) << HexString(load->vaddr) << std::right << std::setw(14)
+           << load->memsz << std::setw(14) << load->pages.size() << std::setw(10) << load->relocs << std::endl;
+    }
+    os << std::endl;
+
+    std::vector<std::pair<int, Count>> types(by_type.begin(), by_type.end());
+    std::stable_sort(types.begin(), types.end(),
+                     [](const std::pair<int, Count>& a, const std::pair<int, Count>& b) { return a.second.dirty_pages > b.second.dirty_pages; });
+    os << std::left << std::setw(28) << "type" << std::right << std::setw(10) << "relocs" << std::setw(14) << "dirty_pages" << std::setw(14)
+       << "only_type" << std::endl;
+    for (const auto& p : types) {
+        os << std::left << std::setw(28) << ShowRelocationType(machine_, p.first) << std::right << std::setw(10) << p.second.relocs
+           << std::setw(14) << p.second.dirty_pages << std::setw(14) << p.second.sole_pages << std::endl;
+    }
+    os << std::endl;
+
+    os << std::left << std::setw(20) << "relocs_in_page" << std::right << std::setw(14) << "dirty_pages" << std::endl;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+        const std::string range = i ? std::to_string(1ULL << i) + "-" + std::to_string((2ULL << i) - 1) : "1";
+        os << std::left << std::setw(20) << range << std::right << std::setw(14) << histogram[i] << std::endl;
+    }
+}
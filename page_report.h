@@ -0,0 +1,64 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+// PageReport estimates the memory which relocations of the output make
+// private to each process for --page-report. ld.so writes the word at
+// r_offset of each relocation, so the page which has it becomes a private
+// dirty copy and cannot be shared with other processes mapping the same
+// file.
+class PageReport {
+public:
+    explicit PageReport(Elf_Half machine) : machine_(machine) {}
+
+    // Registers a PT_LOAD of the output. library is the input which it was
+    // copied from. PT_LOADs must not overlap.
+    void AddLoad(const std::string& library, uintptr_t vaddr, uintptr_t memsz);
+
+    // Records a relocation of the output. Must be called after all AddLoad.
+    void AddReloc(const Elf_Rel& rel);
+
+    // Prints dirty pages per library, the top_n PT_LOADs with the most dirty
+    // pages, relocation types which dirty pages and a histogram of the number
+    // of relocations in a dirty page.
+    void Print(std::ostream& os, size_t top_n) const;
+
+private:
+    struct Load {
+        std::string library;
+        uintptr_t vaddr;
+        uintptr_t memsz;
+        size_t relocs{0};
+        // From a page number to the relocation types in it and their counts.
+        std::map<uintptr_t, std::map<int, size_t>> pages;
+    };
+
+    const Elf_Half machine_;
+    // Sorted by vaddr.
+    std::vector<Load> loads_;
+    // Relocations whose r_offset is not in any PT_LOAD.
+    size_t unmapped_relocs_{0};
+};
@@ -0,0 +1,58 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "patch_overlay.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "utils.h"
+
+uint64_t PatchOverlay::Read64(const char* head, uintptr_t offset) const {
+    auto found = words_.find(offset);
+    if (found != words_.end()) return found->second;
+    uint64_t value;
+    memcpy(&value, head + offset, sizeof(value));
+    return value;
+}
+
+void PatchOverlay::Write64(uintptr_t offset, uint64_t value) {
+    auto next = words_.lower_bound(offset);
+    if (next != words_.end() && next->first == offset) {
+        next->second = value;
+        return;
+    }
+    CHECK(next == words_.end() || offset + sizeof(uint64_t) <= next->first) << SOLD_LOG_64BITS(offset) << " overlaps another patch";
+    CHECK(next == words_.begin() || std::prev(next)->first + sizeof(uint64_t) <= offset)
+        << SOLD_LOG_64BITS(offset) << " overlaps another patch";
+    words_.emplace_hint(next, offset, value);
+}
+
+void PatchOverlay::Emit(FILE* fp, const char* head, uintptr_t offset, size_t size) const {
+    const uintptr_t end = offset + size;
+    uintptr_t pos = offset;
+    // A word which starts before offset may still cover offset.
+    auto it = words_.lower_bound(offset >= sizeof(uint64_t) ? offset - sizeof(uint64_t) + 1 : 0);
+    for (; it != words_.end() && it->first < end; ++it) {
+        const uintptr_t word_start = std::max(it->first, pos);
+        const uintptr_t word_end = std::min(it->first + sizeof(uint64_t), end);
+        WriteBuf(fp, head + pos, word_start - pos);
+        WriteBuf(fp, reinterpret_cast<const char*>(&it->second) + (word_start - it->first), word_end - word_start);
+        pos = word_end;
+    }
+    WriteBuf(fp, head + pos, end - pos);
+}
@@ -0,0 +1,43 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+
+// PatchOverlay keeps 64-bit words which sold rewrites in an input ELF file.
+// Inputs are mapped read-only, so we never write to them. Instead, Emit
+// applies the patches while copying a range of the input to the output.
+class PatchOverlay {
+public:
+    // Returns the word at offset of the input whose head is head. The patched
+    // value is returned when there is a patch at offset.
+    uint64_t Read64(const char* head, uintptr_t offset) const;
+
+    // Replaces the word at offset of the input with value.
+    void Write64(uintptr_t offset, uint64_t value);
+
+    // Writes [offset, offset + size) of the input to fp with patches applied.
+    void Emit(FILE* fp, const char* head, uintptr_t offset, size_t size) const;
+
+    bool empty() const { return words_.empty(); }
+
+private:
+    // From offsets of patched words to their values. Words never overlap.
+    std::map<uintptr_t, uint64_t> words_;
+};
@@ -0,0 +1,143 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <getopt.h>
+
+#include <iostream>
+#include <queue>
+#include <set>
+
+#include "json_writer.h"
+#include "sold.h"
+#include "startup_cost.h"
+
+namespace {
+
+void PrintHelp(std::ostream& os) {
+    os << R"(usage: print_startup_cost [option]... FILE...
+
+Estimates the work of ld.so to load each FILE and its dependencies without
+running it, and prints it as a line of JSON per FILE.
+
+-L, --custom-library-path PATH  Use PATH instead of the default path such as /usr/lib
+--compare                       Take ORIGINAL and BUNDLED and fail when BUNDLED needs
+                                more hash probes for symbol lookups than ORIGINAL
+)";
+}
+
+// Returns the main binary and its dependencies in the order of the global
+// lookup scope of ld.so.
+std::vector<const ELFBinary*> LookupScope(const Sold& sold) {
+    std::vector<const ELFBinary*> scope = {sold.main_binary()};
+    std::set<std::string> visited;
+    std::queue<const ELFBinary*> queue;
+    queue.push(sold.main_binary());
+    while (!queue.empty()) {
+        const ELFBinary* bin = queue.front();
+        queue.pop();
+        for (const std::string& needed : bin->neededs()) {
+            if (!visited.insert(needed).second) continue;
+            const ELFBinary* lib = sold.libraries().at(needed).get();
+            scope.push_back(lib);
+            queue.push(lib);
+        }
+    }
+    return scope;
+}
+
+void WriteCost(JSONWriter& w, const StartupCost& c) {
+    w.BeginObject();
+    w.Key("name");
+    w.String(c.name);
+    for (const auto& p : std::vector<std::pair<const char*, size_t>>{{"relocations", c.relocations},
+                                                                      {"relative_relocations", c.relative_relocations},
+                                                                      {"symbol_lookups", c.symbol_lookups},
+                                                                      {"lookup_cache_hits", c.lookup_cache_hits},
+                                                                      {"scope_objects_searched", c.scope_objects_searched},
+                                                                      {"dirty_pages", c.dirty_pages},
+                                                                      {"mmaps", c.mmaps},
+                                                                      {"init_functions", c.init_functions}}) {
+        w.Key(p.first);
+        w.Uint(p.second);
+    }
+    w.Key("hash_probes");
+    w.Double(c.hash_probes);
+    w.EndObject();
+}
+
+}  // namespace
+
+int main(int argc, char* const argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    static option long_options[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"custom-library-path", required_argument, nullptr, 'L'},
+        {"compare", no_argument, nullptr, 1},
+        {0, 0, 0, 0},
+    };
+
+    std::vector<std::string> custome_library_path;
+    bool compare = false;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "hL:", long_options, nullptr)) != -1) {
+        switch (opt) {
+            case 'L':
+                custome_library_path.emplace_back(optarg);
+                break;
+            case 1:
+                compare = true;
+                break;
+            case 'h':
+                PrintHelp(std::cout);
+                return 0;
+            default:
+                PrintHelp(std::cerr);
+                return 1;
+        }
+    }
+    if (optind == argc || (compare && argc - optind != 2)) {
+        PrintHelp(std::cerr);
+        return 1;
+    }
+
+    std::vector<StartupCost> totals;
+    for (int i = optind; i < argc; ++i) {
+        // We use Sold only to find the dependencies.
+        Sold sold(argv[i], {}, {}, custome_library_path, false);
+        StartupCost total;
+        total.name = argv[i];
+        const std::vector<StartupCost> costs = EstimateStartupCost(LookupScope(sold));
+        for (const StartupCost& c : costs) total.Add(c);
+        totals.push_back(total);
+
+        JSONWriter w(std::cout);
+        w.BeginObject();
+        w.Key("total");
+        WriteCost(w, total);
+        w.Key("objects");
+        w.BeginArray();
+        for (const StartupCost& c : costs) WriteCost(w, c);
+        w.EndArray();
+        w.EndObject();
+        std::cout << std::endl;
+    }
+
+    if (compare && totals[1].hash_probes > totals[0].hash_probes) {
+        std::cerr << "Bundling does not pay off: " << totals[1].hash_probes << " hash probes > " << totals[0].hash_probes << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+# Usage:
+#
+# $ python3 benchmark_import.py --runs 20 --original build/pybind_test --soldout build/pybind_test/soldout myadd myobject mynumpy
+#
+# Measures `import` of original and sold'ed extension modules. Each import
+# runs in a fresh interpreter. Results are printed as lines of JSON with
+# sorted keys, one per module and variant.
+
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+
+
+# Runs in the child interpreter. Shared objects mapped by the import are
+# those ld.so opened for the module and its dependencies.
+CHILD = r'''
+import importlib
+import json
+import sys
+import time
+
+
+def mapped_objects():
+    objs = set()
+    for line in open('/proc/self/maps'):
+        toks = line.split()
+        if len(toks) == 6 and '.so' in toks[5]:
+            objs.add(toks[5])
+    return objs
+
+
+before = mapped_objects()
+start = time.perf_counter()
+importlib.import_module(sys.argv[1])
+end = time.perf_counter()
+print(json.dumps({'latency_us': (end - start) * 1e6, 'files': len(mapped_objects() - before)}))
+'''
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p * len(values)))]
+
+
+def run_import(module, directory):
+    env = dict(os.environ)
+    env['PYTHONPATH'] = directory
+    out = subprocess.run([sys.executable, '-c', CHILD, module], env=env, check=True, stdout=subprocess.PIPE,
+                         universal_newlines=True).stdout
+    return json.loads(out.splitlines()[-1])
+
+
+def benchmark(module, variant, directory, runs):
+    # The first import warms the page cache.
+    run_import(module, directory)
+    results = [run_import(module, directory) for _ in range(runs)]
+    latencies = [r['latency_us'] for r in results]
+    return {
+        'benchmark': 'pybind_import',
+        'module': module,
+        'variant': variant,
+        'runs': runs,
+        'latency_us': {
+            'min': round(percentile(latencies, 0.0), 3),
+            'median': round(percentile(latencies, 0.5), 3),
+            'p90': round(percentile(latencies, 0.9), 3),
+            'max': round(percentile(latencies, 1.0), 3),
+        },
+        'files': percentile([r['files'] for r in results], 0.5),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Measure import time of original and sold\'ed extension modules.')
+    parser.add_argument('--runs', type=int, default=20)
+    parser.add_argument('--original', required=True, help='directory of original modules')
+    parser.add_argument('--soldout', required=True, help='directory of sold\'ed modules')
+    parser.add_argument('modules', nargs='+')
+    args = parser.parse_args()
+
+    for module in args.modules:
+        for variant, directory in (('original', args.original), ('soldout', args.soldout)):
+            result = benchmark(module, variant, os.path.abspath(directory), args.runs)
+            print(json.dumps(result, sort_keys=True))
+            sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,61 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "relative_rebase.h"
+
+#include <string.h>
+
+namespace {
+
+// GCC and Clang lower this to SSE2 on x86-64 and to NEON on AArch64.
+typedef uint64_t u64x2 __attribute__((vector_size(16)));
+
+static_assert(sizeof(Elf_Rel) == 3 * sizeof(uint64_t), "Elf_Rel must be {r_offset, r_info, r_addend}");
+
+inline u64x2 Load(const uint64_t* p) {
+    u64x2 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void Store(uint64_t* p, u64x2 v) { memcpy(p, &v, sizeof(v)); }
+
+}  // namespace
+
+void RebaseRelativeRelocations(const Elf_Rel* rels, size_t num, uintptr_t offset, Elf_Rel* out) {
+    const uint64_t* src = reinterpret_cast<const uint64_t*>(rels);
+    uint64_t* dst = reinterpret_cast<uint64_t*>(out);
+
+    // Two relocations are six words
+    //   r_offset0 r_info0 | r_addend0 r_offset1 | r_info1 r_addend1
+    // so we add these three vectors to them.
+    const u64x2 a = {offset, 0};
+    const u64x2 b = {offset, offset};
+    const u64x2 c = {0, offset};
+
+    size_t i = 0;
+    for (; i + 2 <= num; i += 2) {
+        Store(dst, Load(src) + a);
+        Store(dst + 2, Load(src + 2) + b);
+        Store(dst + 4, Load(src + 4) + c);
+        src += 6;
+        dst += 6;
+    }
+    if (i < num) {
+        out[i] = rels[i];
+        out[i].r_offset += offset;
+        out[i].r_addend += offset;
+    }
+}
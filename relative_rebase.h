@@ -0,0 +1,40 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils.h"
+
+// Returns true when RebaseRelativeRelocations can handle rel, i.e. rel is a
+// RELATIVE relocation without a symbol of the given machine.
+inline bool IsPlainRelative(const Elf_Rel& rel, uint16_t machine) {
+    switch (machine) {
+        case EM_X86_64:
+            return rel.r_info == ELF_R_INFO(0, R_X86_64_RELATIVE);
+        case EM_AARCH64:
+            return rel.r_info == ELF_R_INFO(0, R_AARCH64_RELATIVE);
+        default:
+            return false;
+    }
+}
+
+// Writes rels[i] with offset added to r_offset and r_addend to out[i] for
+// i in [0, num). This is what RelocateSymbol_* does for RELATIVE
+// relocations, but it processes two relocations per 128-bit vector
+// operation. in and out must not overlap.
+void RebaseRelativeRelocations(const Elf_Rel* rels, size_t num, uintptr_t offset, Elf_Rel* out);
@@ -0,0 +1,87 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "reloc_report.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+
+bool IsRelative(int type) { return type == R_X86_64_RELATIVE || type == R_AARCH64_RELATIVE; }
+
+}  // namespace
+
+void RelocReport::Add(const std::string& library, const Elf_Rel& in, const Elf_Rel& out, const std::string& symbol,
+                      const std::string& provider) {
+    auto found = counts_.find(library);
+    if (found == counts_.end()) {
+        libraries_.push_back(library);
+        found = counts_.emplace(library, std::map<int, Count>()).first;
+    }
+    const int in_type = ELF_R_TYPE(in.r_info);
+    const int out_type = ELF_R_TYPE(out.r_info);
+    found->second[in_type].before++;
+    found->second[out_type].after++;
+
+    if (ELF_R_SYM(in.r_info) != 0 && !IsRelative(in_type) && IsRelative(out_type)) {
+        converted_++;
+    }
+    if (ELF_R_SYM(out.r_info) != 0) {
+        symbolic_++;
+        providers_[provider]++;
+        auto& s = symbols_[symbol];
+        s.first++;
+        s.second = provider;
+    }
+}
+
+void RelocReport::Print(std::ostream& os, size_t top_n) const {
+    os << std::left << std::setw(40) << "library" << std::setw(28) << "type" << std::right << std::setw(10) << "before"
+       << std::setw(10) << "after" << std::endl;
+    for (const std::string& library : libraries_) {
+        bool first = true;
+        for (const auto& p : counts_.at(library)) {
+            os << std::left << std::setw(40) << (first ? library : "") << std::setw(28) << ShowRelocationType(machine_, p.first) << std::right
+               << std::setw(10) << p.second.before << std::setw(10) << p.second.after << std::endl;
+            first = false;
+        }
+    }
+
+    os << std::endl
+       << "Symbolic relocations resolved to RELATIVE: " << converted_ << std::endl
+       << "Symbolic relocations left for ld.so: " << symbolic_ << std::endl
+       << std::endl;
+
+    std::vector<std::pair<std::string, size_t>> providers(providers_.begin(), providers_.end());
+    std::stable_sort(providers.begin(), providers.end(),
+                     [](const std::pair<std::string, size_t>& a, const std::pair<std::string, size_t>& b) { return a.second > b.second; });
+    os << std::left << std::setw(40) << "provider" << std::right << std::setw(12) << "relocations" << std::endl;
+    for (const auto& p : providers) {
+        os << std::left << std::setw(40) << p.first << std::right << std::setw(12) << p.second << std::endl;
+    }
+
+    std::vector<std::pair<std::string, std::pair<size_t, std::string>>> symbols(symbols_.begin(), symbols_.end());
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [](const std::pair<std::string, std::pair<size_t, std::string>>& a,
+                        const std::pair<std::string, std::pair<size_t, std::string>>& b) { return a.second.first > b.second.first; });
+    if (symbols.size() > top_n) symbols.resize(top_n);
+    os << std::endl << std::left << std::setw(48) << "symbol" << std::setw(32) << "provider" << std::right << std::setw(12) << "relocations"
+       << std::endl;
+    for (const auto& s : symbols) {
+        os << std::left << std::setw(48) << s.first << std::setw(32) << s.second.second << std::right << std::setw(12) << s.second.first
+           << std::endl;
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+// RelocReport summarizes what sold did to relocations and what ld.so still
+// has to do for --reloc-report. Sold records every relocation of its inputs
+// with the relocation it emitted for it.
+class RelocReport {
+public:
+    // machine is e_machine of the inputs, e.g. EM_AARCH64.
+    explicit RelocReport(Elf_Half machine) : machine_(machine) {}
+
+    // Records that sold rewrote in of library into out. symbol and provider
+    // are the name of the symbol and the library expected to define it, and
+    // are used only when out still needs a symbol lookup.
+    void Add(const std::string& library, const Elf_Rel& in, const Elf_Rel& out, const std::string& symbol, const std::string& provider);
+
+    // Prints counts per library and type, how many symbolic relocations
+    // became RELATIVE, the remaining ones per provider, and the top_n most
+    // referenced external symbols.
+    void Print(std::ostream& os, size_t top_n) const;
+
+private:
+    struct Count {
+        size_t before{0};
+        size_t after{0};
+    };
+
+    const Elf_Half machine_;
+    // Libraries in the order of Add.
+    std::vector<std::string> libraries_;
+    // From library to relocation type to counts.
+    std::map<std::string, std::map<int, Count>> counts_;
+    size_t converted_{0};
+    size_t symbolic_{0};
+    std::map<std::string, size_t> providers_;
+    // From symbol to the number of references and its provider.
+    std::map<std::string, std::pair<size_t, std::string>> symbols_;
+};
@@ -0,0 +1,63 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "segment_index.h"
+
+#include <algorithm>
+
+void SegmentIndex::Add(uintptr_t from, uintptr_t size, uintptr_t to) {
+    if (size == 0) return;
+    segments_.push_back(Segment{from, from + size, to});
+}
+
+void SegmentIndex::Build() {
+    sorted_ = segments_;
+    std::stable_sort(sorted_.begin(), sorted_.end(), [](const Segment& a, const Segment& b) { return a.start < b.start; });
+    overlapping_ = false;
+    for (size_t i = 1; i < sorted_.size(); ++i) {
+        if (sorted_[i].start < sorted_[i - 1].end) overlapping_ = true;
+    }
+}
+
+bool SegmentIndex::Search(uintptr_t pos, uintptr_t* out, size_t* hint) const {
+    if (overlapping_) {
+        for (const Segment& s : segments_) {
+            if (s.start <= pos && pos < s.end) {
+                *out = pos - s.start + s.to;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Find the last segment whose start is less than or equal to pos. This
+    // binary search has no data-dependent branch, which matters when
+    // lookups are random.
+    if (sorted_.empty()) return false;
+    const Segment* base = sorted_.data();
+    for (size_t len = sorted_.size(); len > 1;) {
+        const size_t half = len / 2;
+        base = (base[half].start <= pos) ? base + half : base;
+        len -= half;
+    }
+    // The number of segments whose start is less than or equal to pos.
+    const size_t n = (base->start <= pos) ? base - sorted_.data() + 1 : 0;
+    if (n == 0) return false;
+    const Segment& s = sorted_[n - 1];
+    if (pos >= s.end) return false;
+    if (hint) *hint = n - 1;
+    *out = pos - s.start + s.to;
+    return true;
+}
@@ -0,0 +1,76 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// SegmentIndex translates a position in one address space (e.g. virtual
+// addresses) into another (e.g. file offsets) using segments such as PT_LOAD.
+// Segments are sorted by their start so that Translate does a binary search.
+// Since consecutive lookups tend to hit the same segment, e.g. FDEs in
+// .eh_frame or relocations in .data, callers can pass a hint, which keeps the
+// segment found last time and is checked first. SegmentIndex itself is not
+// modified by Translate, so threads can share it with their own hints.
+//
+// Translate returns the same result as a linear scan over segments in the
+// order of Add. When segments overlap, the binary search cannot guarantee
+// it, so we fall back to the linear scan.
+class SegmentIndex {
+public:
+    // Registers [from, from + size) -> [to, to + size).
+    void Add(uintptr_t from, uintptr_t size, uintptr_t to);
+
+    // Must be called after all Add calls and before Translate.
+    void Build();
+
+    // Returns true and fills out when pos is in a segment.
+    bool Translate(uintptr_t pos, uintptr_t* out) const { return Search(pos, out, nullptr); }
+
+    // Same as above, but checks the segment at *hint first and updates *hint
+    // with the segment found. Any value is a valid hint, e.g. one left by
+    // another SegmentIndex. The check of the hint is inline and the search is
+    // out of line.
+    bool Translate(uintptr_t pos, uintptr_t* out, size_t* hint) const {
+        // Search never sets *hint when segments overlap.
+        if (*hint < sorted_.size() && !overlapping_) {
+            const Segment& s = sorted_[*hint];
+            if (s.start <= pos && pos < s.end) {
+                *out = pos - s.start + s.to;
+                return true;
+            }
+        }
+        return Search(pos, out, hint);
+    }
+
+private:
+    struct Segment {
+        uintptr_t start;
+        uintptr_t end;
+        uintptr_t to;
+    };
+
+    // Fills *hint when hint is not nullptr.
+    bool Search(uintptr_t pos, uintptr_t* out, size_t* hint) const;
+
+    // Segments in the order of Add.
+    std::vector<Segment> segments_;
+    // Segments sorted by start.
+    std::vector<Segment> sorted_;
+    bool overlapping_{false};
+};
@@ -18,61 +18,37 @@
 #include <elf.h>
 #include "utils.h"
 
-void ShdrBuilder::EmitShstrtab(FILE* fp) {
-    std::string str = "";
-    str += '\0';
+ShdrBuilder::ShdrBuilder() {
+    // The head of shstrtab is '\0' so names start from 1.
+    shstrtab_ += '\0';
     for (const auto& i : type_to_str) {
-        str += i.second;
-        str += '\0';
+        AddName(i.second);
     }
-
-    CHECK(fwrite(str.c_str(), str.size(), 1, fp) == 1);
 }
 
-uintptr_t ShdrBuilder::ShstrtabSize() const {
-    std::string str = "";
-    str += '\0';
-    for (const auto& i : type_to_str) {
-        str += i.second;
-        str += '\0';
+void ShdrBuilder::EmitShstrtab(FILE* fp) { CHECK(fwrite(shstrtab_.c_str(), shstrtab_.size(), 1, fp) == 1); }
+
+void ShdrBuilder::AddName(const std::string& name) {
+    if (name_to_offset_.emplace(name, shstrtab_.size()).second) {
+        shstrtab_ += name;
+        shstrtab_ += '\0';
     }
-    return str.size();
 }
 
-uint32_t ShdrBuilder::GetShName(ShdrType type) const {
-    // The head of shstrtab is '\0' so we must skip it.
-    uint32_t r = 1;
-    for (const auto& i : type_to_str) {
-        if (i.first == type) {
-            break;
-        } else {
-            r += i.second.size() + 1;
-        }
-    }
-    return r;
+uint32_t ShdrBuilder::GetShName(const std::string& name) const {
+    auto found = name_to_offset_.find(name);
+    CHECK(found != name_to_offset_.end()) << name << " is not in .shstrtab";
+    return found->second;
 }
 
-void ShdrBuilder::EmitShdrs(FILE* fp) {
-    Elf_Shdr shstrtab;
-    bool found_shstrtab = false;
-    int num_not_shstrtab = 0;
+uint32_t ShdrBuilder::GetShName(ShdrType type) const { return GetShName(type_to_str.at(type)); }
 
-    // Emit other than shstrtab
+void ShdrBuilder::EmitShdrs(FILE* fp) {
+    // ehdr_.e_shstrndx is ignored when it is 0.
+    CHECK(Shstrndx() != 0);
     for (const auto& s : shdrs) {
-        if (s.sh_name == GetShName(Shstrtab)) {
-            shstrtab = s;
-            found_shstrtab = true;
-        } else {
-            num_not_shstrtab++;
-            CHECK(fwrite(&s, sizeof(s), 1, fp) == 1);
-        }
+        CHECK(fwrite(&s, sizeof(s), 1, fp) == 1);
     }
-
-    // num_not_shstrtab must not be 0 because ehdr_.e_shstrndx is ignored when it is 0
-    CHECK(found_shstrtab);
-    CHECK(num_not_shstrtab != 0);
-
-    CHECK(fwrite(&shstrtab, sizeof(shstrtab), 1, fp) == 1);
 }
 
 uint32_t ShdrBuilder::GetIndex(ShdrType type) const {
@@ -98,6 +74,27 @@ void ShdrBuilder::Freeze() {
     }
 }
 
+void ShdrBuilder::RegisterSections(const Layout& layout, Elf_Word num_verneed) {
+    RegisterShdr(layout.gnu_hash.offset, layout.gnu_hash.size, GnuHash);
+    RegisterShdr(layout.dynsym.offset, layout.dynsym.size, Dynsym, sizeof(Elf_Sym));
+    if (num_verneed > 0) {
+        RegisterShdr(layout.versym.offset, layout.versym.size, GnuVersion, sizeof(Elf_Versym));
+        RegisterShdr(layout.verneed.offset, layout.verneed.size, GnuVersionR, 0, num_verneed);
+    }
+    RegisterShdr(layout.rela_dyn.offset, layout.rela_dyn.size, RelaDyn, sizeof(Elf_Rel));
+    RegisterShdr(layout.init_array.offset, layout.init_array.size, InitArray);
+    RegisterShdr(layout.fini_array.offset, layout.fini_array.size, FiniArray);
+    RegisterShdr(layout.dynstr.offset, layout.dynstr.size, Dynstr);
+    RegisterShdr(layout.dynamic.offset, layout.dynamic.size, Dynamic, sizeof(Elf_Dyn));
+    RegisterShdr(layout.shstrtab.offset, layout.shstrtab.size, Shstrtab);
+}
+
+Elf_Half ShdrBuilder::RegisterShdr(const std::string& name, Elf_Shdr shdr) {
+    shdr.sh_name = GetShName(name);
+    shdrs.push_back(shdr);
+    return shdrs.size() - 1;
+}
+
 void ShdrBuilder::RegisterShdr(Elf_Off offset, uint64_t size, ShdrType type, uint64_t entsize, Elf_Word info) {
     Elf_Shdr shdr = {0};
     shdr.sh_name = GetShName(type);
@@ -17,17 +17,33 @@
 #include <string>
 #include <vector>
 
+#include "layout.h"
 #include "utils.h"
 
 class ShdrBuilder {
 public:
     enum ShdrType { GnuHash, Dynsym, GnuVersion, GnuVersionR, Dynstr, RelaDyn, InitArray, FiniArray, Strtab, Shstrtab, Dynamic, Text, TLS };
+    ShdrBuilder();
     void EmitShstrtab(FILE* fp);
     void EmitShdrs(FILE* fp);
-    uintptr_t ShstrtabSize() const;
+    uintptr_t ShstrtabSize() const { return shstrtab_.size(); }
     Elf_Half CountShdrs() const { return shdrs.size(); }
     void RegisterShdr(Elf_Off offset, uint64_t size, ShdrType type, uint64_t entsize = 0, Elf_Word info = 0);
-    Elf_Half Shstrndx() const { return shdrs.size() - 1; }
+    // Registers shdrs of all sections in layout.
+    void RegisterSections(const Layout& layout, Elf_Word num_verneed);
+    Elf_Half Shstrndx() const { return GetIndex(Shstrtab); }
+
+    // Adds name to .shstrtab for a section which is not in ShdrType, e.g.
+    // sections of the input ELF files. You must call this before
+    // ShstrtabSize because the size of .shstrtab is used for the layout.
+    void AddName(const std::string& name);
+    // Registers shdr named name and returns its index. name must be added by
+    // AddName or be one of ShdrType.
+    Elf_Half RegisterShdr(const std::string& name, Elf_Shdr shdr);
+
+    const std::vector<Elf_Shdr>& GetShdrs() const { return shdrs; }
+    // Contents of .shstrtab.
+    const std::string& ShstrtabContents() const { return shstrtab_; }
 
     // After register all shdrs, you must call Freeze.
     void Freeze();
@@ -41,6 +57,12 @@ private:
 
     // The first section header must be NULL.
     std::vector<Elf_Shdr> shdrs = {Elf_Shdr{0}};
+    // Contents of .shstrtab. The names of type_to_str come first and names
+    // added by AddName follow them.
+    std::string shstrtab_;
+    // Offset of each name in shstrtab_.
+    std::map<std::string, uint32_t> name_to_offset_;
     uint32_t GetShName(ShdrType type) const;
+    uint32_t GetShName(const std::string& name) const;
     uint32_t GetIndex(ShdrType type) const;
 };
@@ -0,0 +1,53 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "size_report.h"
+
+#include <algorithm>
+#include <iomanip>
+
+void SizeReport::Print(std::ostream& os, size_t top_n) const {
+    std::vector<const Library*> rows;
+    for (const Library& library : libraries) rows.push_back(&library);
+    std::stable_sort(rows.begin(), rows.end(), [](const Library* a, const Library* b) { return a->FileTotal() > b->FileTotal(); });
+
+    const char* columns[] = {"file_total", "segments", "vm", "tls", "symbols", "dynsym", "dynstr", "relocs", "reloc_bytes", "file_pad", "vm_pad"};
+    os << std::left << std::setw(40) << "library" << std::right;
+    for (const char* column : columns) os << std::setw(12) << column;
+    os << std::endl;
+    for (const Library* l : rows) {
+        os << std::left << std::setw(40) << l->name << std::right;
+        for (uint64_t v : {l->FileTotal(), l->file_bytes, l->vm_bytes, l->tls_bytes, l->symbols, l->dynsym_bytes, l->dynstr_bytes, l->relocs,
+                           l->reloc_bytes, l->file_padding, l->vm_padding}) {
+            os << std::setw(12) << v;
+        }
+        os << std::endl;
+    }
+
+    os << std::endl
+       << "Output file bytes: " << file_size << std::endl
+       << "Mapped bytes: " << vm_size << std::endl
+       << "TLS bytes per thread: " << tls_size << std::endl
+       << std::endl;
+
+    std::vector<Symbol> largest = symbols;
+    std::stable_sort(largest.begin(), largest.end(), [](const Symbol& a, const Symbol& b) { return a.size > b.size; });
+    if (largest.size() > top_n) largest.resize(top_n);
+    os << std::right << std::setw(12) << "size" << "  " << std::left << std::setw(40) << "library"
+       << "symbol" << std::endl;
+    for (const Symbol& s : largest) {
+        os << std::right << std::setw(12) << s.size << "  " << std::left << std::setw(40) << s.library << s.name << std::endl;
+    }
+}
@@ -0,0 +1,72 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// SizeReport breaks the output of sold down by the library each byte came
+// from for --size-report. It tells which libraries are worth excluding with
+// --exclude-so and which exports are worth trimming.
+struct SizeReport {
+    // What a bundled library costs in the output. Rows named "(imports)" and
+    // "(sold)" stand for symbols defined outside of the output and for
+    // headers, tables and code which sold itself emits.
+    struct Library {
+        std::string name;
+        // Bytes of PT_LOADs and the TLS image copied from the library.
+        uint64_t file_bytes{0};
+        // Bytes of pages mapped for its PT_LOADs.
+        uint64_t vm_bytes{0};
+        // Bytes of TLS allocated for each thread.
+        uint64_t tls_bytes{0};
+        uint64_t symbols{0};
+        // Entries of .dynsym, .gnu.version and .gnu.hash for symbols.
+        uint64_t dynsym_bytes{0};
+        // Names of symbols in .dynstr. A name shared by libraries is counted
+        // for the first one.
+        uint64_t dynstr_bytes{0};
+        uint64_t relocs{0};
+        uint64_t reloc_bytes{0};
+        // Bytes wasted to align PT_LOADs to pages in the file and in memory.
+        uint64_t file_padding{0};
+        uint64_t vm_padding{0};
+
+        // Bytes of the output file attributed to the library.
+        uint64_t FileTotal() const { return file_bytes + dynsym_bytes + dynstr_bytes + reloc_bytes + file_padding; }
+    };
+
+    // A symbol defined by the output.
+    struct Symbol {
+        std::string name;
+        std::string library;
+        uint64_t size;
+    };
+
+    uint64_t file_size{0};
+    uint64_t vm_size{0};
+    uint64_t tls_size{0};
+    std::vector<Library> libraries;
+    std::vector<Symbol> symbols;
+
+    // Prints a row per library sorted by FileTotal and the top_n largest
+    // symbols.
+    void Print(std::ostream& os, size_t top_n) const;
+};
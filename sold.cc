@@ -15,21 +15,35 @@
 
 #include "sold.h"
 
+#include <dirent.h>
+
 #include <algorithm>
-#include <list>
 #include <queue>
 #include <set>
 
+#include "build_id.h"
+#include "debug_file.h"
+#include "topological_sort.h"
+
+namespace {
+
+// The name of GNU notes such as NT_GNU_BUILD_ID.
+const char kGnuNoteName[] = "GNU";
+
+}  // namespace
+
 Sold::Sold(const std::string& elf_filename, const std::vector<std::string>& exclude_sos, const std::vector<std::string>& exclude_finis,
            const std::vector<std::string> custome_library_path, bool emit_section_header)
     : exclude_sos_(exclude_sos),
       exclude_finis_(exclude_finis),
       custome_library_path_(custome_library_path),
       emit_section_header_(emit_section_header) {
+    TraceSpan resolve_span("Resolve");
     main_binary_ = ReadELF(elf_filename);
     is_executable_ = main_binary_->FindPhdr(PT_INTERP);
     machine_type = main_binary_->ehdr()->e_machine;
     memprotect_builder_.SetMachineType(machine_type);
+    time_init_builder_.SetMachineType(machine_type);
 
     // Register (filename, soname) of main_binary_
     if (main_binary_->name() != "" && main_binary_->soname() != "") {
@@ -42,60 +56,101 @@ Sold::Sold(const std::string& elf_filename, const std::vector<std::string>& excl
     }
 
     InitLdLibraryPaths();
+    InitSystemLibraryPaths();
     ResolveLibraryPaths(main_binary_.get());
 
     version_.SetSonameToFilename(soname_to_filename_);
 }
 
 void Sold::Link(const std::string& out_filename) {
-    DecideMemOffset();
-
-    CollectTLS();
-    CollectArrays();
-    CollectSymbols();
-    CopyPublicSymbols();
-    Relocate();
-
-    syms_.Build(strtab_, version_);
-    syms_.MergePublicSymbols(strtab_, version_);
-
-    // BuildEhdr();
-    if (is_executable_) {
-        BuildInterp();
+    TraceSpan link_span("Link");
+    {
+        TraceSpan span("DecideMemOffset");
+        DecideMemOffset();
     }
-    BuildArrays();
-    BuildDynamic();
-    BuildMprotect();
-
-    strtab_.Freeze();
-    BuildLoads();
-    BuildEHFrameHeader();
-
-    shdr_.RegisterShdr(GnuHashOffset(), GnuHashSize(), ShdrBuilder::ShdrType::GnuHash);
-    shdr_.RegisterShdr(SymtabOffset(), SymtabSize(), ShdrBuilder::ShdrType::Dynsym, sizeof(Elf_Sym));
-    if (version_.NumVerneed() > 0) {
-        shdr_.RegisterShdr(VersymOffset(), VersymSize(), ShdrBuilder::ShdrType::GnuVersion, sizeof(Elf_Versym));
-        shdr_.RegisterShdr(VerneedOffset(), VerneedSize(), ShdrBuilder::ShdrType::GnuVersionR, 0, version_.NumVerneed());
+    {
+        TraceSpan span("CollectTLS");
+        CollectTLS();
     }
-    shdr_.RegisterShdr(RelOffset(), RelSize(), ShdrBuilder::ShdrType::RelaDyn, sizeof(Elf_Rel));
-    shdr_.RegisterShdr(InitArrayOffset(), InitArraySize(), ShdrBuilder::ShdrType::InitArray);
-    shdr_.RegisterShdr(FiniArrayOffset(), FiniArraySize(), ShdrBuilder::ShdrType::FiniArray);
-    shdr_.RegisterShdr(StrtabOffset(), StrtabSize(), ShdrBuilder::ShdrType::Dynstr);
-    shdr_.RegisterShdr(DynamicOffset(), DynamicSize(), ShdrBuilder::ShdrType::Dynamic, sizeof(Elf_Dyn));
-    shdr_.RegisterShdr(ShstrtabOffset(), ShstrtabSize(), ShdrBuilder::ShdrType::Shstrtab);
-    // TODO(akawashiro) .text and .tls
-    shdr_.Freeze();
-
-    // We must call BuildEhdr at the last because of e_shoff
-    BuildEhdr();
+    {
+        TraceSpan span("CollectArrays");
+        CollectArrays();
+    }
+    {
+        TraceSpan span("CollectSymbols");
+        CollectSymbols();
+    }
+    {
+        TraceSpan span("CopyPublicSymbols");
+        CopyPublicSymbols();
+    }
+    {
+        TraceSpan span("Relocate");
+        Relocate();
+    }
+    {
+        TraceSpan span("BuildSymtab");
+        syms_.Build(strtab_, version_);
+        syms_.MergePublicSymbols(strtab_, version_);
+    }
+    {
+        TraceSpan span("BuildStrtab");
+        if (is_executable_) {
+            BuildInterp();
+        }
+        AddDynamicStrings();
+        strtab_.Freeze();
+    }
+    if (emit_section_header_) {
+        TraceSpan span("CollectSections");
+        CollectSections();
+    }
+    {
+        TraceSpan span("PlanLayout");
+        PlanLayout();
+    }
+    {
+        TraceSpan span("BuildArrays");
+        BuildArrays();
+    }
+    {
+        TraceSpan span("BuildDynamic");
+        BuildDynamic();
+    }
+    {
+        TraceSpan span("BuildMprotect");
+        BuildMprotect();
+    }
+    {
+        TraceSpan span("BuildEHFrameHeader");
+        BuildEHFrameHeader();
+    }
+    {
+        TraceSpan span("BuildShdrs");
+        shdr_.RegisterSections(layout_, version_.NumVerneed());
+        if (emit_section_header_) BuildSectionHeaders();
+        shdr_.Freeze();
 
-    Emit(out_filename);
-    CHECK(chmod(out_filename.c_str(), 0755) == 0);
+        // We must call BuildEhdr at the last because of e_shoff
+        BuildEhdr();
+    }
+    {
+        TraceSpan span("Emit");
+        Emit(out_filename);
+        CHECK(chmod(out_filename.c_str(), 0755) == 0);
+    }
+    if (!debug_filename_.empty()) {
+        TraceSpan span("EmitDebugFile");
+        EmitDebugFile(out_filename);
+    }
 }
 
 void Sold::Emit(const std::string& out_filename) {
-    FILE* fp = fopen(out_filename.c_str(), "wb");
-    CHECK(fp);
+    FILE* out = fopen(out_filename.c_str(), "wb");
+    CHECK(out);
+    // The build-id is hashed from what we write, with 0 in its place.
+    BuildIdHasher hasher;
+    FILE* fp = layout_.build_id.size ? hasher.Wrap(out) : out;
     Write(fp, ehdr_);
     EmitPhdrs(fp);
     EmitGnuHash(fp);
@@ -106,6 +161,7 @@ void Sold::Emit(const std::string& out_filename) {
     EmitArrays(fp);
     EmitStrtab(fp);
     EmitDynamic(fp);
+    if (layout_.build_id.size) EmitBuildId(fp);
     EmitShstrtab(fp);
     EmitAlign(fp);
 
@@ -113,25 +169,103 @@ void Sold::Emit(const std::string& out_filename) {
     EmitTLS(fp);
     EmitEHFrame(fp);
     EmitMemprotect(fp);
+    if (layout_.time_init.size) EmitTimeInit(fp);
 
-    if (emit_section_header_) EmitShdr(fp);
+    if (emit_section_header_) {
+        if (layout_.symtab.size) EmitStaticSymtab(fp);
+        if (layout_.debuglink.size) EmitDebuglink(fp);
+        EmitShdr(fp);
+    }
 
-    fclose(fp);
+    if (fp != out) {
+        fclose(fp);
+        const std::string build_id = hasher.Finish();
+        CHECK(fseek(out, layout_.build_id.end() - build_id.size(), SEEK_SET) == 0);
+        WriteBuf(out, build_id.data(), build_id.size());
+    }
+    fclose(out);
 }
 
 // You must call this function after building all stuffs
-// because ShdrOffset() cannot be fixed before it.
+// because shdr_ cannot be fixed before it.
 void Sold::BuildEhdr() {
     ehdr_ = *main_binary_->ehdr();
     ehdr_.e_entry += offsets_[main_binary_.get()];
-    ehdr_.e_shoff = ShdrOffset();
+    ehdr_.e_shoff = layout_.shdr_offset;
     ehdr_.e_shnum = shdr_.CountShdrs();
     ehdr_.e_shstrndx = shdr_.Shstrndx();
-    ehdr_.e_phnum = CountPhdrs();
+    ehdr_.e_phnum = layout_.num_phdrs;
 }
 
-void Sold::BuildLoads() {
-    uintptr_t file_offset = CodeOffset();
+// The file layout of the output is
+//   Ehdr, Phdrs, .gnu.hash, .dynsym, .gnu.version, .gnu.version_r, .rela.dyn,
+//   .init_array, .fini_array, .dynstr, .dynamic, .note.gnu.build-id,
+//   .shstrtab, PT_LOADs, TLS image, .eh_frame_hdr, mprotect code, the code and
+//   the data of EnableTimeInit, .symtab, .strtab, .gnu_debuglink, Shdrs.
+void Sold::PlanLayout() {
+    if (emit_build_id_) layout_.build_id.size = sizeof(Elf_Nhdr) + sizeof(kGnuNoteName) + BuildIdHasher::kSize;
+    layout_.num_phdrs = CountPhdrs();
+
+    layout_.gnu_hash.offset = sizeof(Elf_Ehdr) + sizeof(Elf_Phdr) * layout_.num_phdrs;
+    layout_.gnu_hash.size = syms_.GnuHashSize();
+
+    layout_.dynsym.offset = layout_.gnu_hash.end();
+    layout_.dynsym.size = syms_.size() * sizeof(Elf_Sym);
+
+    layout_.versym.offset = layout_.dynsym.end();
+    layout_.versym.size = version_.SizeVersym();
+
+    layout_.verneed.offset = layout_.versym.end();
+    layout_.verneed.size = version_.SizeVerneed();
+
+    // BuildArrays adds a relocation for each entry of .init_array and .fini_array.
+    layout_.rela_dyn.offset = layout_.verneed.end();
+    layout_.rela_dyn.size = (rels_.size() + init_array_.size() + fini_array_.size()) * sizeof(Elf_Rel);
+
+    layout_.init_array.offset = AlignNext(layout_.rela_dyn.end(), 7);
+    layout_.init_array.size = sizeof(uintptr_t) * init_array_.size();
+
+    layout_.fini_array.offset = layout_.init_array.end();
+    layout_.fini_array.size = sizeof(uintptr_t) * fini_array_.size();
+
+    layout_.dynstr.offset = layout_.fini_array.end();
+    layout_.dynstr.size = strtab_.size();
+
+    layout_.dynamic.offset = layout_.dynstr.end();
+    layout_.dynamic.size = sizeof(Elf_Dyn) * CountDynamic();
+
+    layout_.build_id.offset = layout_.build_id.size ? AlignNext(layout_.dynamic.end(), 3) : layout_.dynamic.end();
+
+    layout_.shstrtab.offset = layout_.build_id.end();
+    layout_.shstrtab.size = shdr_.ShstrtabSize();
+
+    layout_.code.offset = AlignNext(layout_.shstrtab.end());
+    const uintptr_t code_end = BuildLoads();
+    layout_.code.size = code_end - layout_.code.offset;
+
+    // layout_.tls.size, layout_.ehframe.size, layout_.mprotect.size and the
+    // sizes of layout_.time_init* are already computed in ComputeInputSizes.
+    layout_.tls.offset = code_end;
+    layout_.ehframe.offset = AlignNext(layout_.tls.end());
+    layout_.mprotect.offset = AlignNext(layout_.ehframe.end());
+    layout_.time_init.offset = layout_.time_init.size ? AlignNext(layout_.mprotect.end()) : layout_.mprotect.end();
+    layout_.time_init_data.offset = layout_.time_init_data.size ? AlignNext(layout_.time_init.end()) : layout_.time_init.end();
+    const uintptr_t loads_end = layout_.time_init_data.end();
+    // The sizes of .symtab, .strtab and .gnu_debuglink are computed in
+    // CollectSections. They are 0 without section headers.
+    uintptr_t offset = loads_end;
+    if (layout_.symtab.size) offset = AlignNext(offset, 7);
+    layout_.symtab.offset = offset;
+    layout_.strtab.offset = layout_.symtab.end();
+    offset = layout_.strtab.end();
+    if (layout_.debuglink.size) offset = AlignNext(offset, 3);
+    layout_.debuglink.offset = offset;
+    offset = layout_.debuglink.end();
+    layout_.shdr_offset = offset == loads_end ? offset : AlignNext(offset, 7);
+}
+
+uintptr_t Sold::BuildLoads() {
+    uintptr_t file_offset = layout_.code.offset;
     CHECK(file_offset < offsets_[main_binary_.get()]);
     for (ELFBinary* bin : link_binaries_) {
         uintptr_t offset = offsets_[bin];
@@ -155,17 +289,148 @@ void Sold::BuildLoads() {
             loads_.push_back(load);
         }
     }
-    tls_file_offset_ = file_offset;
-    file_offset = AlignNext(file_offset + TLSFileSize());
-    ehframe_file_offset_ = file_offset;
-    file_offset = AlignNext(file_offset + EHFrameSize());
-    mprotect_file_offset_ = file_offset;
 
     for (const Load& load : loads_) {
         LOG(INFO) << "PT_LOAD mapping: name=" << load.bin->name() << " vaddr=" << load.emit.p_vaddr << " memsz=" << load.emit.p_memsz
                   << " offset=" << load.emit.p_offset << " filesz=" << load.emit.p_filesz << " orig_vaddr=" << load.orig->p_vaddr
                   << " orig_offset=" << load.orig->p_offset;
     }
+    return file_offset;
+}
+
+LinkMap Sold::GetLinkMap(const std::string& out_filename) const {
+    auto library = [](const ELFBinary* bin) { return LinkMap::Library{bin->filename(), bin->soname(), bin->build_id()}; };
+
+    LinkMap map;
+    map.output = out_filename;
+    map.output_tls_vaddr = tls_offset_;
+    for (const Load& load : loads_) {
+        map.segments.push_back(LinkMap::Segment{library(load.bin), load.orig->p_vaddr, load.orig->p_offset, load.emit.p_vaddr,
+                                                load.emit.p_offset, load.emit.p_filesz, load.emit.p_memsz, load.orig->p_flags});
+    }
+    for (const TLS::Data& d : tls_.data) {
+        const Elf_Phdr* tls = d.bin->tls();
+        map.tls.push_back(LinkMap::TLS{library(d.bin), tls->p_vaddr, tls->p_filesz, tls->p_memsz, d.file_offset, d.bss_offset});
+    }
+    return map;
+}
+
+std::vector<Range> Sold::OwnLoads() const {
+    const uintptr_t headers_end = std::max(layout_.dynamic.end(), layout_.build_id.end());
+    std::vector<Range> loads = {Range{0, headers_end}};
+    if (tls_.memsz) loads.push_back(Range{tls_offset_, tls_offset_ + tls_.memsz});
+    loads.push_back(Range{ehframe_offset_, ehframe_offset_ + ehframe_builder_.Size()});
+    loads.push_back(Range{mprotect_offset_, mprotect_offset_ + layout_.mprotect.size});
+    if (layout_.time_init.size) {
+        loads.push_back(Range{time_init_offset_, time_init_offset_ + layout_.time_init.size});
+        loads.push_back(Range{time_init_data_offset_, time_init_data_offset_ + layout_.time_init_data.size});
+    }
+    return loads;
+}
+
+PageReport Sold::GetPageReport() const {
+    PageReport report(machine_type);
+    for (const Load& load : loads_) {
+        report.AddLoad(load.bin->name(), load.emit.p_vaddr, load.emit.p_memsz);
+    }
+    for (const Range& load : OwnLoads()) {
+        report.AddLoad("(sold)", load.start, load.size());
+    }
+    for (const Elf_Rel& rel : rels_) {
+        report.AddReloc(rel);
+    }
+    return report;
+}
+
+SizeReport Sold::GetSizeReport() const {
+    // Bytes of pages which [start, start + size) touches.
+    auto pages = [](uintptr_t start, uintptr_t size) -> uint64_t { return size ? AlignNext(start + size) - (start & ~0xfff) : 0; };
+
+    SizeReport report;
+    std::map<const ELFBinary*, size_t> index;
+    for (ELFBinary* bin : link_binaries_) {
+        index.emplace(bin, report.libraries.size());
+        SizeReport::Library library;
+        library.name = bin->name();
+        if (const Elf_Phdr* tls = bin->tls()) {
+            library.file_bytes += tls->p_filesz;
+            library.tls_bytes = tls->p_memsz;
+        }
+        auto found = num_output_rels_.find(bin);
+        if (found != num_output_rels_.end()) library.relocs = found->second;
+        library.reloc_bytes = library.relocs * sizeof(Elf_Rel);
+        report.libraries.push_back(library);
+    }
+    const size_t imports = report.libraries.size();
+    report.libraries.push_back(SizeReport::Library{"(imports)"});
+    const size_t own = report.libraries.size();
+    report.libraries.push_back(SizeReport::Library{"(sold)"});
+
+    // Padding of PT_LOADs made by BuildLoads. The one before a PT_LOAD keeps
+    // its offset in a page and the one after it aligns the next PT_LOAD.
+    uintptr_t file_offset = layout_.code.offset;
+    for (const Load& load : loads_) {
+        SizeReport::Library& library = report.libraries[index.at(load.bin)];
+        const uintptr_t end = load.emit.p_offset + load.emit.p_filesz;
+        library.file_bytes += load.emit.p_filesz;
+        library.file_padding += load.emit.p_offset - file_offset + AlignNext(end) - end;
+        file_offset = AlignNext(end);
+        library.vm_bytes += pages(load.emit.p_vaddr, load.emit.p_memsz);
+        library.vm_padding += pages(load.emit.p_vaddr, load.emit.p_memsz) - load.emit.p_memsz;
+    }
+    SOLD_CHECK_EQ(file_offset, layout_.tls.offset);
+
+    // Symbols belong to the library whose PT_LOADs or TLS contain them.
+    auto find_library = [&](const Elf_Sym& sym) {
+        if (!IsDefined(sym)) return imports;
+        if (IsTLS(sym)) {
+            for (const TLS::Data& d : tls_.data) {
+                if (d.file_offset <= sym.st_value && sym.st_value < d.file_offset + d.size) return index.at(d.bin);
+                const uintptr_t bss_size = d.bin->tls()->p_memsz - d.size;
+                if (d.bss_offset <= sym.st_value && sym.st_value < d.bss_offset + bss_size) return index.at(d.bin);
+            }
+            return own;
+        }
+        for (ELFBinary* bin : link_binaries_) {
+            const Range range = bin->GetRange() + offsets_.at(bin);
+            if (range.start <= sym.st_value && sym.st_value < range.end) return index.at(bin);
+        }
+        return own;
+    };
+    const std::vector<Syminfo>& exposed_syms = syms_.GetExposedSyms();
+    const std::vector<Elf_Sym>& symtab = syms_.Get();
+    std::set<std::string> names;
+    for (size_t i = 0; i < symtab.size(); ++i) {
+        const std::string name = exposed_syms[i].name;
+        SizeReport::Library& library = report.libraries[name.empty() ? own : find_library(symtab[i])];
+        library.symbols++;
+        library.dynsym_bytes += sizeof(Elf_Sym) + sizeof(Elf_Versym) + sizeof(uint32_t);
+        if (names.insert(name).second) library.dynstr_bytes += name.size() + 1;
+        if (IsDefined(symtab[i]) && !name.empty()) report.symbols.push_back(SizeReport::Symbol{name, library.name, symtab[i].st_size});
+    }
+
+    // Everything else is headers, tables and code of sold.
+    SizeReport::Library& sold = report.libraries[own];
+    sold.relocs = init_array_.size() + fini_array_.size();
+    sold.reloc_bytes = sold.relocs * sizeof(Elf_Rel);
+    sold.file_padding = layout_.code.offset - layout_.shstrtab.end() + layout_.ehframe.offset - layout_.tls.end() + layout_.mprotect.offset -
+                        layout_.ehframe.end() + layout_.time_init.offset - layout_.mprotect.end() + layout_.time_init_data.offset -
+                        layout_.time_init.end();
+    for (const Range& load : OwnLoads()) {
+        sold.vm_bytes += pages(load.start, load.size());
+        sold.vm_padding += pages(load.start, load.size()) - load.size();
+    }
+
+    report.file_size = emit_section_header_ ? layout_.shdr_offset + ehdr_.e_shnum * sizeof(Elf_Shdr) : layout_.shdr_offset;
+    uint64_t attributed = 0;
+    for (const SizeReport::Library& library : report.libraries) {
+        attributed += library.FileTotal();
+        report.vm_size += library.vm_bytes;
+    }
+    CHECK_LE(attributed, report.file_size);
+    sold.file_bytes = report.file_size - attributed;
+    report.tls_size = tls_.memsz;
+    return report;
 }
 
 void Sold::BuildArrays() {
@@ -180,7 +445,7 @@ void Sold::BuildArrays() {
         size_t rel_index = orig_rel_size + i;
         CHECK(rel_index < rels_.size());
         Elf_Rel* rel = &rels_[rel_index];
-        rel->r_offset = InitArrayOffset() + sizeof(uintptr_t) * i;
+        rel->r_offset = layout_.init_array.offset + sizeof(uintptr_t) * i;
         if (machine_type == EM_X86_64) {
             rel->r_info = ELF_R_INFO(0, R_X86_64_RELATIVE);
         } else if (machine_type == EM_AARCH64) {
@@ -190,29 +455,74 @@ void Sold::BuildArrays() {
         }
         rel->r_addend = array[i];
     }
+    SOLD_CHECK_EQ(rels_.size() * sizeof(Elf_Rel), layout_.rela_dyn.size);
 }
 
-void Sold::BuildDynamic() {
-    std::set<ELFBinary*> linked(link_binaries_.begin(), link_binaries_.end());
+std::set<std::string> Sold::CollectNeededs() const {
+    std::set<const ELFBinary*> linked(link_binaries_.begin(), link_binaries_.end());
     std::set<std::string> neededs;
     for (const auto& p : libraries_) {
-        ELFBinary* bin = p.second.get();
+        const ELFBinary* bin = p.second.get();
         if (!linked.count(bin)) {
             neededs.insert(bin->name());
         }
     }
+    return neededs;
+}
+
+// We must add these strings before strtab_.Freeze() in the same order as
+// BuildDynamic refers them.
+void Sold::AddDynamicStrings() {
+    for (const std::string& needed : CollectNeededs()) {
+        AddStr(needed);
+    }
+    if (!main_binary_->soname().empty()) {
+        AddStr(main_binary_->soname());
+    }
+    if (!main_binary_->rpath().empty()) {
+        AddStr(main_binary_->rpath());
+    }
+    if (!main_binary_->runpath().empty()) {
+        AddStr(main_binary_->runpath());
+    }
+}
+
+size_t Sold::CountDynamic() const {
+    size_t n = CollectNeededs().size();
+    if (!main_binary_->soname().empty()) n++;
+    if (!main_binary_->rpath().empty()) n++;
+    if (!main_binary_->runpath().empty()) n++;
+    if (main_binary_->init()) n++;
+    if (main_binary_->fini()) n++;
+    // DT_INIT_ARRAY, DT_INIT_ARRAYSZ, DT_FINI_ARRAY and DT_FINI_ARRAYSZ.
+    n += 4;
+    // DT_GNU_HASH.
+    n++;
+    // DT_STRTAB and DT_STRSZ.
+    n += 2;
+    // DT_SYMTAB and DT_SYMENT.
+    n += 2;
+    // DT_VERSYM, DT_VERNEEDNUM and DT_VERNEED.
+    if (version_.NumVerneed() > 0) n += 3;
+    // DT_RELA, DT_RELAENT and DT_RELASZ.
+    n += 3;
+    // DT_NULL.
+    n++;
+    return n;
+}
 
-    for (const std::string& needed : neededs) {
-        MakeDyn(DT_NEEDED, AddStr(needed));
+void Sold::BuildDynamic() {
+    for (const std::string& needed : CollectNeededs()) {
+        MakeDyn(DT_NEEDED, strtab_.GetPos(needed));
     }
     if (!main_binary_->soname().empty()) {
-        MakeDyn(DT_SONAME, AddStr(main_binary_->soname()));
+        MakeDyn(DT_SONAME, strtab_.GetPos(main_binary_->soname()));
     }
     if (!main_binary_->rpath().empty()) {
-        MakeDyn(DT_RPATH, AddStr(main_binary_->rpath()));
+        MakeDyn(DT_RPATH, strtab_.GetPos(main_binary_->rpath()));
     }
     if (!main_binary_->runpath().empty()) {
-        MakeDyn(DT_RUNPATH, AddStr(main_binary_->runpath()));
+        MakeDyn(DT_RUNPATH, strtab_.GetPos(main_binary_->runpath()));
     }
 
     if (uintptr_t ptr = main_binary_->init()) {
@@ -222,30 +532,31 @@ void Sold::BuildDynamic() {
         MakeDyn(DT_FINI, ptr + offsets_[main_binary_.get()]);
     }
 
-    MakeDyn(DT_INIT_ARRAY, InitArrayOffset());
+    MakeDyn(DT_INIT_ARRAY, layout_.init_array.offset);
     MakeDyn(DT_INIT_ARRAYSZ, init_array_.size() * sizeof(uintptr_t));
-    MakeDyn(DT_FINI_ARRAY, FiniArrayOffset());
+    MakeDyn(DT_FINI_ARRAY, layout_.fini_array.offset);
     MakeDyn(DT_FINI_ARRAYSZ, fini_array_.size() * sizeof(uintptr_t));
 
-    MakeDyn(DT_GNU_HASH, GnuHashOffset());
+    MakeDyn(DT_GNU_HASH, layout_.gnu_hash.offset);
 
-    MakeDyn(DT_STRTAB, StrtabOffset());
+    MakeDyn(DT_STRTAB, layout_.dynstr.offset);
     MakeDyn(DT_STRSZ, strtab_.size());
 
-    MakeDyn(DT_SYMTAB, SymtabOffset());
+    MakeDyn(DT_SYMTAB, layout_.dynsym.offset);
     MakeDyn(DT_SYMENT, sizeof(Elf_Sym));
 
     if (version_.NumVerneed() > 0) {
-        MakeDyn(DT_VERSYM, VersymOffset());
+        MakeDyn(DT_VERSYM, layout_.versym.offset);
         MakeDyn(DT_VERNEEDNUM, version_.NumVerneed());
-        MakeDyn(DT_VERNEED, VerneedOffset());
+        MakeDyn(DT_VERNEED, layout_.verneed.offset);
     }
 
-    MakeDyn(DT_RELA, RelOffset());
+    MakeDyn(DT_RELA, layout_.rela_dyn.offset);
     MakeDyn(DT_RELAENT, sizeof(Elf_Rel));
     MakeDyn(DT_RELASZ, rels_.size() * sizeof(Elf_Rel));
 
     MakeDyn(DT_NULL, 0);
+    SOLD_CHECK_EQ(dynamic_.size() * sizeof(Elf_Dyn), layout_.dynamic.size);
 }
 
 void Sold::EmitPhdrs(FILE* fp) {
@@ -255,12 +566,12 @@ void Sold::EmitPhdrs(FILE* fp) {
     if (is_executable_) {
         phdrs.push_back(main_binary_->GetPhdr(PT_PHDR));
         phdrs.push_back(main_binary_->GetPhdr(PT_INTERP));
-        phdrs[1].p_offset = phdrs[1].p_vaddr = phdrs[1].p_paddr = StrtabOffset() + interp_offset_;
+        phdrs[1].p_offset = phdrs[1].p_vaddr = phdrs[1].p_paddr = layout_.dynstr.offset + interp_offset_;
     }
 
-    size_t dyn_start = DynamicOffset();
+    size_t dyn_start = layout_.dynamic.offset;
     size_t dyn_size = sizeof(Elf_Dyn) * dynamic_.size();
-    size_t seg_start = AlignNext(dyn_start + dyn_size);
+    size_t seg_start = AlignNext(std::max(dyn_start + dyn_size, layout_.build_id.end()));
 
     {
         Elf_Phdr phdr = main_binary_->GetPhdr(PT_LOAD);
@@ -289,7 +600,7 @@ void Sold::EmitPhdrs(FILE* fp) {
 
     if (tls_.memsz) {
         Elf_Phdr phdr;
-        phdr.p_offset = tls_file_offset_;
+        phdr.p_offset = layout_.tls.offset;
         phdr.p_vaddr = tls_offset_;
         phdr.p_paddr = tls_offset_;
         phdr.p_filesz = tls_.filesz;
@@ -304,7 +615,7 @@ void Sold::EmitPhdrs(FILE* fp) {
     }
     {
         Elf_Phdr phdr;
-        phdr.p_offset = ehframe_file_offset_;
+        phdr.p_offset = layout_.ehframe.offset;
         phdr.p_vaddr = ehframe_offset_;
         phdr.p_paddr = ehframe_offset_;
         phdr.p_filesz = ehframe_builder_.Size();
@@ -319,16 +630,35 @@ void Sold::EmitPhdrs(FILE* fp) {
     }
     {
         Elf_Phdr phdr;
-        phdr.p_offset = mprotect_file_offset_;
+        phdr.p_offset = layout_.mprotect.offset;
         phdr.p_vaddr = mprotect_offset_;
         phdr.p_paddr = mprotect_offset_;
-        phdr.p_filesz = MprotectSize();
-        phdr.p_memsz = MprotectSize();
+        phdr.p_filesz = layout_.mprotect.size;
+        phdr.p_memsz = layout_.mprotect.size;
         phdr.p_align = 0x1000;
         phdr.p_type = PT_LOAD;
         phdr.p_flags = PF_R | PF_X;
         phdrs.push_back(phdr);
     }
+    if (layout_.time_init.size) {
+        Elf_Phdr phdr;
+        phdr.p_offset = layout_.time_init.offset;
+        phdr.p_vaddr = time_init_offset_;
+        phdr.p_paddr = time_init_offset_;
+        phdr.p_filesz = layout_.time_init.size;
+        phdr.p_memsz = layout_.time_init.size;
+        phdr.p_align = 0x1000;
+        phdr.p_type = PT_LOAD;
+        phdr.p_flags = PF_R | PF_X;
+        phdrs.push_back(phdr);
+        phdr.p_offset = layout_.time_init_data.offset;
+        phdr.p_vaddr = time_init_data_offset_;
+        phdr.p_paddr = time_init_data_offset_;
+        phdr.p_filesz = layout_.time_init_data.size;
+        phdr.p_memsz = layout_.time_init_data.size;
+        phdr.p_flags = PF_R | PF_W;
+        phdrs.push_back(phdr);
+    }
     {
         Elf_Phdr phdr;
         phdr.p_offset = 0;
@@ -346,15 +676,24 @@ void Sold::EmitPhdrs(FILE* fp) {
         }
         phdrs.push_back(phdr);
     }
+    if (layout_.build_id.size) {
+        Elf_Phdr phdr = {0};
+        phdr.p_type = PT_NOTE;
+        phdr.p_flags = PF_R;
+        phdr.p_offset = phdr.p_vaddr = phdr.p_paddr = layout_.build_id.offset;
+        phdr.p_filesz = phdr.p_memsz = layout_.build_id.size;
+        phdr.p_align = 4;
+        phdrs.push_back(phdr);
+    }
 
-    CHECK(phdrs.size() == CountPhdrs());
+    CHECK(phdrs.size() == layout_.num_phdrs);
     for (const Elf_Phdr& phdr : phdrs) {
         Write(fp, phdr);
     }
 }
 
 void Sold::EmitGnuHash(FILE* fp) {
-    CHECK(ftell(fp) == GnuHashOffset());
+    CHECK(ftell(fp) == layout_.gnu_hash.offset);
     const Elf_GnuHash& gnu_hash = syms_.gnu_hash();
     const std::vector<Syminfo>& exposed_syms = syms_.GetExposedSyms();
 
@@ -369,7 +708,7 @@ void Sold::EmitGnuHash(FILE* fp) {
     Write(fp, bucket);
 
     for (size_t i = gnu_hash.symndx; i < exposed_syms.size(); ++i) {
-        uint32_t h = CalcGnuHash(exposed_syms[i].name) & ~1;
+        uint32_t h = exposed_syms[i].key.name.gnu_hash & ~1;
         if (i == exposed_syms.size() - 1) {
             h |= 1;
         }
@@ -377,22 +716,54 @@ void Sold::EmitGnuHash(FILE* fp) {
     }
 }
 
-uintptr_t Sold::TLSMemSize() const {
-    static uintptr_t s = 0;
-    if (s != 0) return s;
+void Sold::ComputeInputSizes() {
+    layout_.tls.size = 0;
+    layout_.tls_mem_size = 0;
+    size_t n_fdes = 0;
+    size_t n_memprotect = 0;
     for (ELFBinary* bin : link_binaries_) {
         for (Elf_Phdr* phdr : bin->phdrs()) {
             if (phdr->p_type == PT_TLS) {
-                s += phdr->p_memsz;
+                layout_.tls.size += phdr->p_filesz;
+                layout_.tls_mem_size += phdr->p_memsz;
+            } else if (phdr->p_type == PT_GNU_EH_FRAME) {
+                n_fdes += bin->eh_frame_header()->fde_count;
+            } else if (phdr->p_type == PT_GNU_RELRO) {
+                n_memprotect++;
             }
         }
     }
-    return s;
+
+    // We emit EHFrame even when the number of FDEs is 0.
+    layout_.ehframe.size = sizeof(EHFrameHeader::version) + sizeof(EHFrameHeader::eh_frame_ptr_enc) +
+                           sizeof(EHFrameHeader::fde_count_enc) + sizeof(EHFrameHeader::table_enc) +
+                           sizeof(EHFrameHeader::eh_frame_ptr) + sizeof(EHFrameHeader::fde_count) +
+                           n_fdes * (sizeof(EHFrameHeader::FDETableEntry::fde_ptr) + sizeof(EHFrameHeader::FDETableEntry::initial_loc));
+
+    if (machine_type == EM_X86_64) {
+        layout_.mprotect.size = sizeof(MprotectBuilder::memprotect_body_code_x86_64) * n_memprotect +
+                                sizeof(MprotectBuilder::memprotect_end_code_x86_64);
+    } else if (machine_type == EM_AARCH64) {
+        layout_.mprotect.size = MprotectBuilder::body_code_length_aarch64 * n_memprotect + MprotectBuilder::ret_code_length_aarch64;
+    } else {
+        CHECK(false) << SOLD_LOG_KEY(machine_type) << " is not supported.";
+    }
+
+    if (time_init_) {
+        // In the order of .init_array of the output. See CollectArrays.
+        for (auto iter = link_binaries_.rbegin(); iter != link_binaries_.rend(); ++iter) {
+            if (!(*iter)->init_array().empty()) time_init_builder_.Add((*iter)->name());
+        }
+        layout_.time_init.size = time_init_builder_.CodeSize();
+        layout_.time_init_data.size = time_init_builder_.DataSize();
+    }
 }
 
 // Decide locations for each linked shared objects
 // TODO(akawashiro) Is the initial value of offset optimal?
 void Sold::DecideMemOffset() {
+    ComputeInputSizes();
+
     uintptr_t offset = 0x10000000;
     for (ELFBinary* bin : link_binaries_) {
         const Range range = bin->GetRange() + offset;
@@ -402,11 +773,15 @@ void Sold::DecideMemOffset() {
         offset = range.end;
     }
     tls_offset_ = offset;
-    offset = AlignNext(offset + TLSMemSize());
+    offset = AlignNext(offset + layout_.tls_mem_size);
     ehframe_offset_ = offset;
-    offset = AlignNext(offset + EHFrameSize());
+    offset = AlignNext(offset + layout_.ehframe.size);
     mprotect_offset_ = offset;
-    offset = AlignNext(offset + MprotectSize());
+    offset = AlignNext(offset + layout_.mprotect.size);
+    time_init_offset_ = offset;
+    offset = AlignNext(offset + layout_.time_init.size);
+    time_init_data_offset_ = offset;
+    offset = AlignNext(offset + layout_.time_init_data.size);
 }
 
 void Sold::CollectTLS() {
@@ -425,7 +800,8 @@ void Sold::CollectTLS() {
             }
         }
     }
-    SOLD_CHECK_EQ(tls_.memsz, TLSMemSize());
+    SOLD_CHECK_EQ(tls_.memsz, layout_.tls_mem_size);
+    SOLD_CHECK_EQ(tls_.filesz, layout_.tls.size);
 
     for (TLS::Data& d : tls_.data) {
         d.bss_offset += tls_.filesz;
@@ -436,15 +812,229 @@ void Sold::CollectTLS() {
     LOG(INFO) << "TLS: filesz=" << HexString(tls_.filesz) << " memsz=" << HexString(tls_.memsz) << " cnt=" << HexString(tls_.data.size());
 }
 
+namespace {
+
+std::string Basename(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void OverwriteFile(const std::string& filename, uintptr_t offset, const void* buf, size_t size) {
+    FILE* fp = fopen(filename.c_str(), "r+b");
+    CHECK(fp) << "Failed to open " << filename;
+    CHECK(fseek(fp, offset, SEEK_SET) == 0);
+    WriteBuf(fp, buf, size);
+    fclose(fp);
+}
+
+// We give section headers only to sections which have contents in PT_LOAD or
+// PT_TLS. Other sections such as .dynsym are replaced by ours.
+bool IsCarriedSection(const Elf_Shdr& shdr) {
+    return (shdr.sh_flags & SHF_ALLOC) && (shdr.sh_type == SHT_PROGBITS || shdr.sh_type == SHT_NOBITS) && shdr.sh_size > 0;
+}
+
+}  // namespace
+
+void Sold::CollectSections() {
+    std::vector<StaticSymbol> globals;
+    static_syms_.push_back(StaticSymbol{nullptr, Elf_Sym{0}});
+    static_strtab_.Add("");
+
+    for (ELFBinary* bin : link_binaries_) {
+        const std::vector<Elf_Shdr*>& shdrs = bin->shdrs();
+        std::set<Elf_Word> carried;
+        for (Elf_Word i = 0; i < shdrs.size(); ++i) {
+            if (!IsCarriedSection(*shdrs[i])) continue;
+            input_sections_.push_back(InputSection{bin, i});
+            carried.insert(i);
+            shdr_.AddName(bin->ShName(*shdrs[i]));
+        }
+
+        const Elf_Shdr* symtab = bin->FindShdr(SHT_SYMTAB);
+        if (!symtab) symtab = bin->FindShdr(SHT_DYNSYM);
+        if (!symtab || symtab->sh_link >= shdrs.size() || symtab->sh_offset + symtab->sh_size > bin->size()) {
+            LOG(INFO) << "No symbol table in " << bin->name();
+            continue;
+        }
+        const Elf_Sym* syms = reinterpret_cast<const Elf_Sym*>(bin->head() + symtab->sh_offset);
+        const char* strtab = bin->head() + shdrs[symtab->sh_link]->sh_offset;
+        for (size_t i = 1; i < symtab->sh_size / sizeof(Elf_Sym); ++i) {
+            Elf_Sym sym = syms[i];
+            if (sym.st_shndx == SHN_UNDEF || ELF_ST_TYPE(sym.st_info) == STT_SECTION) continue;
+            if (sym.st_shndx < SHN_LORESERVE) {
+                if (!carried.count(sym.st_shndx)) continue;
+                if (IsTLS(sym)) {
+                    sym.st_value = RemapTLS("static symbol", bin, sym.st_value);
+                } else {
+                    sym.st_value += offsets_[bin];
+                }
+            }
+            sym.st_name = static_strtab_.Add(strtab + syms[i].st_name);
+            if (ELF_ST_BIND(sym.st_info) == STB_LOCAL) {
+                static_syms_.push_back(StaticSymbol{bin, sym});
+            } else {
+                globals.push_back(StaticSymbol{bin, sym});
+            }
+        }
+    }
+
+    num_local_static_syms_ = static_syms_.size();
+    static_syms_.insert(static_syms_.end(), globals.begin(), globals.end());
+    static_strtab_.Freeze();
+
+    if (emit_build_id_) shdr_.AddName(".note.gnu.build-id");
+    if (debug_filename_.empty()) {
+        shdr_.AddName(".symtab");
+        shdr_.AddName(".strtab");
+        layout_.symtab.size = sizeof(Elf_Sym) * static_syms_.size();
+        layout_.strtab.size = static_strtab_.size();
+    } else {
+        // .symtab goes to the debug file.
+        shdr_.AddName(".gnu_debuglink");
+        layout_.debuglink.size = AlignNext(Basename(debug_filename_).size() + 1, 3) + sizeof(uint32_t);
+    }
+    LOG(INFO) << "Static symbols: sections=" << input_sections_.size() << " symbols=" << static_syms_.size();
+}
+
+void Sold::BuildSectionHeaders() {
+    std::map<std::pair<const ELFBinary*, Elf_Word>, Elf_Half> indices;
+    // Maps the start address of each section to (end, index). TLS sections
+    // are in [tls_offset_, tls_offset_ + tls_.memsz), which no PT_LOAD covers.
+    std::map<uintptr_t, std::pair<uintptr_t, Elf_Half>> by_addr;
+
+    for (const InputSection& s : input_sections_) {
+        ELFBinary* bin = s.bin;
+        Elf_Shdr shdr = *bin->shdrs()[s.index];
+        if (shdr.sh_flags & SHF_TLS) {
+            const uintptr_t off = RemapTLS("section", bin, shdr.sh_addr - bin->tls()->p_vaddr);
+            shdr.sh_addr = tls_offset_ + off;
+            shdr.sh_offset = shdr.sh_type == SHT_NOBITS ? layout_.tls.end() : layout_.tls.offset + off;
+        } else {
+            auto load = std::find_if(loads_.begin(), loads_.end(), [&shdr, bin](const Load& l) {
+                return l.bin == bin && l.orig->p_vaddr <= shdr.sh_addr && shdr.sh_addr < l.orig->p_vaddr + l.orig->p_memsz;
+            });
+            if (load == loads_.end()) {
+                LOG(WARNING) << bin->ShName(shdr) << " of " << bin->name() << " is not in PT_LOAD";
+                continue;
+            }
+            shdr.sh_offset = load->emit.p_offset + shdr.sh_addr - load->orig->p_vaddr;
+            shdr.sh_addr += offsets_[bin];
+        }
+        shdr.sh_link = 0;
+        shdr.sh_info = 0;
+        const Elf_Half index = shdr_.RegisterShdr(bin->ShName(shdr), shdr);
+        indices.emplace(std::make_pair(bin, s.index), index);
+        by_addr.emplace(shdr.sh_addr, std::make_pair(shdr.sh_addr + shdr.sh_size, index));
+    }
+
+    if (layout_.symtab.size) {
+        Elf_Shdr symtab = {0};
+        symtab.sh_type = SHT_SYMTAB;
+        symtab.sh_offset = layout_.symtab.offset;
+        symtab.sh_size = layout_.symtab.size;
+        symtab.sh_entsize = sizeof(Elf_Sym);
+        symtab.sh_addralign = 8;
+        // .strtab follows .symtab.
+        symtab.sh_link = shdr_.CountShdrs() + 1;
+        symtab.sh_info = num_local_static_syms_;
+        shdr_.RegisterShdr(".symtab", symtab);
+
+        Elf_Shdr strtab = {0};
+        strtab.sh_type = SHT_STRTAB;
+        strtab.sh_offset = layout_.strtab.offset;
+        strtab.sh_size = layout_.strtab.size;
+        strtab.sh_addralign = 1;
+        shdr_.RegisterShdr(".strtab", strtab);
+    }
+
+    if (layout_.build_id.size) {
+        Elf_Shdr note = {0};
+        note.sh_type = SHT_NOTE;
+        note.sh_flags = SHF_ALLOC;
+        note.sh_offset = note.sh_addr = layout_.build_id.offset;
+        note.sh_size = layout_.build_id.size;
+        note.sh_addralign = 4;
+        shdr_.RegisterShdr(".note.gnu.build-id", note);
+    }
+    if (layout_.debuglink.size) {
+        Elf_Shdr debuglink = {0};
+        debuglink.sh_type = SHT_PROGBITS;
+        debuglink.sh_offset = layout_.debuglink.offset;
+        debuglink.sh_size = layout_.debuglink.size;
+        debuglink.sh_addralign = 4;
+        shdr_.RegisterShdr(".gnu_debuglink", debuglink);
+    }
+
+    for (StaticSymbol& s : static_syms_) {
+        if (s.sym.st_shndx == SHN_UNDEF || s.sym.st_shndx >= SHN_LORESERVE) continue;
+        auto found = indices.find(std::make_pair(s.bin, s.sym.st_shndx));
+        s.sym.st_shndx = found == indices.end() ? SHN_ABS : found->second;
+    }
+
+    syms_.SetSectionIndices([this, &by_addr](const Elf_Sym& sym) -> Elf_Half {
+        const uintptr_t addr = IsTLS(sym) ? tls_offset_ + sym.st_value : sym.st_value;
+        auto found = by_addr.upper_bound(addr);
+        if (found == by_addr.begin()) return sym.st_shndx;
+        --found;
+        return addr < found->second.first ? found->second.second : sym.st_shndx;
+    });
+}
+
+void Sold::EmitBuildId(FILE* fp) {
+    EmitPad(fp, layout_.build_id.offset);
+    SOLD_CHECK_EQ(ftell(fp), layout_.build_id.offset);
+    Elf_Nhdr nhdr = {0};
+    nhdr.n_namesz = sizeof(kGnuNoteName);
+    nhdr.n_descsz = BuildIdHasher::kSize;
+    nhdr.n_type = NT_GNU_BUILD_ID;
+    Write(fp, nhdr);
+    WriteBuf(fp, kGnuNoteName, sizeof(kGnuNoteName));
+    // Emit fills the build-id after hashing the output.
+    EmitZeros(fp, BuildIdHasher::kSize);
+}
+
+void Sold::EmitDebuglink(FILE* fp) {
+    EmitPad(fp, layout_.debuglink.offset);
+    SOLD_CHECK_EQ(ftell(fp), layout_.debuglink.offset);
+    const std::string name = Basename(debug_filename_);
+    WriteBuf(fp, name.c_str(), name.size() + 1);
+    // EmitDebugFile fills the CRC after writing the debug file.
+    EmitPad(fp, layout_.debuglink.end());
+}
+
+void Sold::EmitDebugFile(const std::string& out_filename) {
+    // The build-id of the output is copied to the debug file.
+    DebugFileBuilder builder;
+    for (ELFBinary* bin : link_binaries_) {
+        TraceSpan span("MergeDWARF", "library", bin->name());
+        builder.AddInput(*bin, offsets_[bin], [this, bin](uint64_t off) { return bin->tls() ? RemapTLS("debug info", bin, off) : off; });
+    }
+    std::vector<Elf_Sym> symtab;
+    for (const StaticSymbol& s : static_syms_) {
+        symtab.push_back(s.sym);
+    }
+    builder.Write(debug_filename_, out_filename, ehdr_, shdr_.GetShdrs(), shdr_.ShstrtabContents(), symtab,
+                  std::string(static_cast<const char*>(static_strtab_.data()), static_strtab_.size()));
+
+    const uint32_t crc = GnuDebuglinkCRC(debug_filename_);
+    OverwriteFile(out_filename, layout_.debuglink.end() - sizeof(crc), &crc, sizeof(crc));
+    LOG(INFO) << "Wrote " << debug_filename_ << " crc=" << HexString(crc);
+}
+
 // Collect .init_array and .fini_array
 void Sold::CollectArrays() {
+    size_t num_timed = 0;
     for (auto iter = link_binaries_.rbegin(); iter != link_binaries_.rend(); ++iter) {
         ELFBinary* bin = *iter;
         uintptr_t offset = offsets_[bin];
+        const bool timed = time_init_ && !bin->init_array().empty();
+        if (timed) init_array_.emplace_back(time_init_offset_ + time_init_builder_.BeginOffset(num_timed));
         for (uintptr_t ptr : bin->init_array()) {
             init_array_.emplace_back(ptr + offset);
         }
+        if (timed) init_array_.emplace_back(time_init_offset_ + time_init_builder_.EndOffset(num_timed++));
     }
+    SOLD_CHECK_EQ(num_timed, time_init_builder_.NumLibraries());
     // TODO(akawashiro) In case of executables, this code causes SEGV. I don't
     // kwow the reason.
     if (!is_executable_) init_array_.emplace_back(mprotect_offset_);
@@ -471,42 +1061,41 @@ uintptr_t Sold::RemapTLS(const char* msg, ELFBinary* bin, uintptr_t off) {
                   << HexString(off + entry.file_offset);
         off += entry.file_offset;
     } else {
-        LOG(INFO) << "TLS bss " << msg << " in " << bin->name() << " remapped " << HexString(off) << " => "
-                  << HexString(off + entry.bss_offset);
-        off += entry.bss_offset;
+        // entry.bss_offset is where the zero-filled part of bin starts.
+        const uintptr_t remapped = off - tls->p_filesz + entry.bss_offset;
+        LOG(INFO) << "TLS bss " << msg << " in " << bin->name() << " remapped " << HexString(off) << " => " << HexString(remapped);
+        off = remapped;
     }
     return off;
 }
 
 // Push symbols of bin to symtab.
 // When the same symbol is already in symtab, LoadDynSymtab selects a more
-// concretely defined one.
-void Sold::LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab) {
-    bin->ReadDynSymtab(filename_to_soname_);
+// concretely defined one. symtab_index maps the key of each symbol in symtab
+// to its index.
+void Sold::LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab, OpenHashMap<SymbolKey, size_t, SymbolKeyHash>& symtab_index) {
+    const VersionTable& versions = version_tables_[bin] = bin->BuildVersionTable(filename_to_soname_);
+    bin->ReadDynSymtab(versions);
 
     uintptr_t offset = offsets_[bin];
 
-    for (const auto& p : bin->GetSymbolMap()) {
-        const std::string& name = p.name;
-        Elf_Sym* sym = p.sym;
+    std::vector<Syminfo>& symbol_map = symbol_maps_[bin];
+    for (Syminfo p : bin->GetSymbolMap()) {
+        adjusted_syms_.push_back(*p.sym);
+        Elf_Sym* sym = p.sym = &adjusted_syms_.back();
+        symbol_map.push_back(p);
         if (IsTLS(*sym) && sym->st_shndx != SHN_UNDEF) {
             sym->st_value = RemapTLS("symbol", bin, sym->st_value);
         } else if (sym->st_value) {
             sym->st_value += offset;
         }
-        LOG(INFO) << "Symbol " << name << "@" << bin->name() << " " << sym->st_value;
-
-        Syminfo* found = NULL;
-        for (int i = 0; i < symtab.size(); i++) {
-            if (symtab[i].name == p.name && symtab[i].soname == p.soname && symtab[i].version == p.version) {
-                found = &symtab[i];
-                break;
-            }
-        }
+        LOG(INFO) << "Symbol " << p.name << "@" << bin->name() << " " << sym->st_value;
 
-        if (found == NULL) {
+        auto inserted = symtab_index.Insert(p.key, symtab.size());
+        if (inserted.second) {
             symtab.push_back(p);
         } else {
+            Syminfo* found = &symtab[*inserted.first];
             Elf_Sym* sym2 = found->sym;
             int prio = IsDefined(*sym) ? 2 : ELF_ST_BIND(sym->st_info) == STB_WEAK;
             int prio2 = IsDefined(*sym2) ? 2 : ELF_ST_BIND(sym2->st_info) == STB_WEAK;
@@ -515,8 +1104,8 @@ void Sold::LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab) {
             }
 
             if (prio == 2 && prio2 == 2) {
-                LOG(INFO) << "Symbol " << SOLD_LOG_KEY(p.name) << SOLD_LOG_KEY(p.soname) << SOLD_LOG_KEY(p.version)
-                          << " is defined in two shared objects.";
+                LOG(INFO) << "Symbol " << SOLD_LOG_KEY(p.name) << SOLD_LOG_KEY(InternedString(p.key.soname))
+                          << SOLD_LOG_KEY(InternedString(p.key.version)) << " is defined in two shared objects.";
             }
         }
     }
@@ -526,7 +1115,7 @@ void Sold::LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab) {
 // Push all TLS symbols into public_syms_.
 // TODO(akawashiro) Does public_syms_ overlap with exposed_syms_?
 void Sold::CopyPublicSymbols() {
-    for (const auto& p : main_binary_->GetSymbolMap()) {
+    for (const auto& p : symbol_maps_[main_binary_.get()]) {
         const Elf_Sym* sym = p.sym;
 
         // TODO(akawashiro) Do we need this IsDefined check?
@@ -539,7 +1128,7 @@ void Sold::CopyPublicSymbols() {
     }
     for (ELFBinary* bin : link_binaries_) {
         if (bin == main_binary_.get()) continue;
-        for (const auto& p : bin->GetSymbolMap()) {
+        for (const auto& p : symbol_maps_[bin]) {
             const Elf_Sym* sym = p.sym;
             if (IsTLS(*sym)) {
                 LOG(INFO) << "Copy TLS symbol " << p.name;
@@ -547,6 +1136,78 @@ void Sold::CopyPublicSymbols() {
             }
         }
     }
+    if (time_init_) {
+        static const char kName[] = "sold_init_timings";
+        time_init_sym_ = Elf_Sym{};
+        time_init_sym_.st_info = ELF_ST_INFO(STB_GLOBAL, STT_OBJECT);
+        // MergePublicSymbols replaces this with a dummy section index.
+        time_init_sym_.st_shndx = SHN_ABS;
+        time_init_sym_.st_value = time_init_data_offset_;
+        time_init_sym_.st_size = layout_.time_init_data.size;
+        syms_.AddPublicSymbol(Syminfo{kName, SymbolKey::Make(kName, EMPTY_STR_ID, EMPTY_STR_ID), VER_NDX_GLOBAL, &time_init_sym_});
+    }
+}
+
+Sold::ResolvedSymbol& Sold::GetResolvedSymbol(const ELFBinary* bin, uint32_t index) {
+    std::vector<ResolvedSymbol>& resolved = resolved_syms_[bin];
+    if (resolved.size() <= index) {
+        resolved.resize(index + 1);
+    }
+    return resolved[index];
+}
+
+SymbolKey Sold::MakeSymbolKey(ELFBinary* bin, uint32_t index) {
+    StrId soname, version_name;
+    std::tie(soname, version_name) = bin->GetVersion(index, version_tables_.at(bin));
+    return SymbolKey::Make(bin->Str(bin->symtab()[index].st_name), soname, version_name);
+}
+
+bool Sold::ResolveSymbol(ELFBinary* bin, uint32_t index, uintptr_t& val_or_index) {
+    ResolvedSymbol& r = GetResolvedSymbol(bin, index);
+    if (!r.resolved) {
+        r.defined = syms_.Resolve(MakeSymbolKey(bin, index), r.val_or_index);
+        r.resolved = true;
+    }
+    val_or_index = r.val_or_index;
+    return r.defined;
+}
+
+uintptr_t Sold::ResolveCopySymbol(ELFBinary* bin, uint32_t index) {
+    ResolvedSymbol& r = GetResolvedSymbol(bin, index);
+    if (!r.copy_resolved) {
+        r.copy_index = syms_.ResolveCopy(MakeSymbolKey(bin, index));
+        r.copy_resolved = true;
+    }
+    return r.copy_index;
+}
+
+void Sold::RecordRelocation(ELFBinary* bin, const Elf_Rel& in, const Elf_Rel& out) {
+    std::string symbol;
+    std::string provider;
+    if (ELF_R_SYM(out.r_info) != 0) {
+        const SymbolKey key = MakeSymbolKey(bin, ELF_R_SYM(in.r_info));
+        symbol = key.name.str;
+        if (key.version != EMPTY_STR_ID) symbol += "@" + InternedString(key.version);
+        // e.g. TLS relocations refer to symbols which the output defines.
+        provider = syms_.IsResolvedToDefined(key) ? "(output)" : FindProvider(key);
+    }
+    reloc_report_->Add(bin->name(), in, out, symbol, provider);
+}
+
+std::string Sold::FindProvider(const SymbolKey& key) {
+    if (key.soname != EMPTY_STR_ID) return InternedString(key.soname);
+
+    auto found = providers_.find(key.name);
+    if (found != providers_.end()) return found->second;
+    std::string provider = "(unknown)";
+    for (const ELFBinary* bin : excluded_binaries_) {
+        if (bin->DefinesSymbol(key.name.str)) {
+            provider = bin->soname();
+            break;
+        }
+    }
+    providers_.emplace(key.name, provider);
+    return provider;
 }
 
 // Make new relocation table.
@@ -554,8 +1215,6 @@ void Sold::CopyPublicSymbols() {
 // because we decided locations of shared objects in DecideMemOffset.
 void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t offset) {
     const Elf_Sym* sym = &bin->symtab()[ELF_R_SYM(rel->r_info)];
-    std::string soname, version_name;
-    std::tie(soname, version_name) = bin->GetVersion(ELF_R_SYM(rel->r_info), filename_to_soname_);
 
     int type = ELF_R_TYPE(rel->r_info);
     const uintptr_t addend = rel->r_addend;
@@ -588,7 +1247,7 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
         case R_X86_64_GLOB_DAT:
         case R_X86_64_JUMP_SLOT: {
             uintptr_t val_or_index;
-            if (syms_.Resolve(bin->Str(sym->st_name), soname, version_name, val_or_index)) {
+            if (ResolveSymbol(bin, ELF_R_SYM(rel->r_info), val_or_index)) {
                 newrel.r_info = ELF_R_INFO(0, R_X86_64_RELATIVE);
                 newrel.r_addend = val_or_index;
             } else {
@@ -599,7 +1258,7 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
 
         case R_X86_64_64: {
             uintptr_t val_or_index;
-            if (syms_.Resolve(bin->Str(sym->st_name), soname, version_name, val_or_index)) {
+            if (ResolveSymbol(bin, ELF_R_SYM(rel->r_info), val_or_index)) {
                 newrel.r_info = ELF_R_INFO(0, R_X86_64_RELATIVE);
                 newrel.r_addend += val_or_index;
             } else {
@@ -611,8 +1270,7 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
         // TODO(akawashiro) Handle TLS variables in executables.
         case R_X86_64_DTPMOD64: {
             // TODO(akawashiro) Refactor out for Arch64
-            const std::string name = bin->Str(sym->st_name);
-            uintptr_t index = syms_.ResolveCopy(name, soname, version_name);
+            uintptr_t index = ResolveCopySymbol(bin, ELF_R_SYM(rel->r_info));
             newrel.r_info = ELF_R_INFO(index, type);
 
             if (bin->tls() == NULL) {
@@ -620,10 +1278,12 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
                 break;
             }
 
-            uint64_t* mod_on_got =
-                const_cast<uint64_t*>(reinterpret_cast<const uint64_t*>(bin->head() + bin->OffsetFromAddr(rel->r_offset)));
-            uint64_t* offset_on_got = mod_on_got + 1;
-            const bool is_bss = bin->IsOffsetInTLSBSS(*offset_on_got);
+            // The input is read-only, so we rewrite ti_offset in patches_.
+            PatchOverlay& patch = patches_[bin];
+            const uintptr_t mod_on_got = bin->OffsetFromAddr(rel->r_offset);
+            const uintptr_t offset_on_got = mod_on_got + sizeof(uint64_t);
+            const uint64_t ti_offset = patch.Read64(bin->head(), offset_on_got);
+            const bool is_bss = bin->IsOffsetInTLSBSS(ti_offset);
 
             // We assume dl_tls_index exists in GOT. This struct is used as
             // the argument of __tls_get_addr.
@@ -660,8 +1320,8 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
             }
 
             LOG(INFO) << "R_X86_64_DTPMOD64 relocation in TLS local dynamic model. " << SOLD_LOG_KEY(*rel) << SOLD_LOG_KEY(newrel)
-                      << SOLD_LOG_64BITS(bin->OffsetFromAddr(rel->r_offset)) << SOLD_LOG_64BITS(*mod_on_got)
-                      << SOLD_LOG_64BITS(*offset_on_got) << SOLD_LOG_64BITS(bin->tls()->p_filesz) << SOLD_LOG_KEY(is_bss)
+                      << SOLD_LOG_64BITS(bin->OffsetFromAddr(rel->r_offset)) << SOLD_LOG_64BITS(patch.Read64(bin->head(), mod_on_got))
+                      << SOLD_LOG_64BITS(ti_offset) << SOLD_LOG_64BITS(bin->tls()->p_filesz) << SOLD_LOG_KEY(is_bss)
                       << SOLD_LOG_64BITS(tls_.data[tls_.bin_to_index[bin]].file_offset)
                       << SOLD_LOG_64BITS(tls_.data[tls_.bin_to_index[bin]].bss_offset);
 
@@ -673,21 +1333,20 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
                 // [bin->tls()->p_filesz, bin->tls()->p_memsz) to
                 // [tls_.data[tls_.bin_to_index[bin]].bss_offset,
                 //  tls_.data[tls_.bin_to_index[bin]].bss_offset + bin->tls()->p_memsz - bin->tls()->p_filesz)
-                *offset_on_got += tls_.data[tls_.bin_to_index[bin]].bss_offset - bin->tls()->p_filesz;
+                patch.Write64(offset_on_got, ti_offset + tls_.data[tls_.bin_to_index[bin]].bss_offset - bin->tls()->p_filesz);
             } else {
                 // TLS variables with initial values are remapped from
                 // [0, bin->tls()->p_filesz) to
                 // [tls_.data[tls_.bin_to_index[bin]].file_offset,
                 //  tls_.data[tls_.bin_to_index[bin]].file_offset + bin->tls()->p_filesz)
-                *offset_on_got += tls_.data[tls_.bin_to_index[bin]].file_offset;
+                patch.Write64(offset_on_got, ti_offset + tls_.data[tls_.bin_to_index[bin]].file_offset);
             }
             break;
         }
 
         case R_X86_64_DTPOFF64:
         case R_X86_64_TPOFF64: {
-            const std::string name = bin->Str(sym->st_name);
-            uintptr_t index = syms_.ResolveCopy(name, soname, version_name);
+            uintptr_t index = ResolveCopySymbol(bin, ELF_R_SYM(rel->r_info));
             newrel.r_info = ELF_R_INFO(index, type);
             LOG(INFO) << ShowRelocationType(type) << " relocation: " << SOLD_LOG_KEY(*rel) << SOLD_LOG_KEY(newrel)
                       << SOLD_LOG_64BITS(bin->OffsetFromAddr(rel->r_offset));
@@ -695,8 +1354,7 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
         }
 
         case R_X86_64_COPY: {
-            const std::string name = bin->Str(sym->st_name);
-            uintptr_t index = syms_.ResolveCopy(name, soname, version_name);
+            uintptr_t index = ResolveCopySymbol(bin, ELF_R_SYM(rel->r_info));
             newrel.r_info = ELF_R_INFO(index, type);
             break;
         }
@@ -714,8 +1372,6 @@ void Sold::RelocateSymbol_x86_64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t o
 // because we decided locations of shared objects in DecideMemOffset.
 void Sold::RelocateSymbol_aarch64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t offset) {
     const Elf_Sym* sym = &bin->symtab()[ELF_R_SYM(rel->r_info)];
-    std::string soname, version_name;
-    std::tie(soname, version_name) = bin->GetVersion(ELF_R_SYM(rel->r_info), filename_to_soname_);
 
     int type = ELF_R_TYPE(rel->r_info);
     const uintptr_t addend = rel->r_addend;
@@ -748,7 +1404,7 @@ void Sold::RelocateSymbol_aarch64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t
         case R_AARCH64_GLOB_DAT:
         case R_AARCH64_JUMP_SLOT: {
             uintptr_t val_or_index;
-            if (syms_.Resolve(bin->Str(sym->st_name), soname, version_name, val_or_index)) {
+            if (ResolveSymbol(bin, ELF_R_SYM(rel->r_info), val_or_index)) {
                 newrel.r_info = ELF_R_INFO(0, R_AARCH64_RELATIVE);
                 newrel.r_addend = val_or_index;
             } else {
@@ -759,7 +1415,7 @@ void Sold::RelocateSymbol_aarch64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t
 
         case R_AARCH64_ABS64: {
             uintptr_t val_or_index;
-            if (syms_.Resolve(bin->Str(sym->st_name), soname, version_name, val_or_index)) {
+            if (ResolveSymbol(bin, ELF_R_SYM(rel->r_info), val_or_index)) {
                 newrel.r_info = ELF_R_INFO(0, R_AARCH64_RELATIVE);
                 newrel.r_addend += val_or_index;
             } else {
@@ -769,8 +1425,7 @@ void Sold::RelocateSymbol_aarch64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t
         }
 
         case R_AARCH64_COPY: {
-            const std::string name = bin->Str(sym->st_name);
-            uintptr_t index = syms_.ResolveCopy(name, soname, version_name);
+            uintptr_t index = ResolveCopySymbol(bin, ELF_R_SYM(rel->r_info));
             newrel.r_info = ELF_R_INFO(index, type);
             break;
         }
@@ -805,79 +1460,117 @@ std::string Sold::ResolveRunPathVariables(const ELFBinary* binary, const std::st
     return out;
 }
 
-std::vector<std::string> Sold::GetLibraryPaths(const ELFBinary* binary) {
-    std::vector<std::string> library_paths;
+void Sold::InitSystemLibraryPaths() {
+    if (!custome_library_path_.empty()) return;
+    ldsoconf_paths_ = ldsoconf::read_ldsoconf();
+    ldsocache_ = ldsoconf::read_ldsocache("/etc/ld.so.cache", machine_type);
+    LOG(INFO) << SOLD_LOG_KEY(ldsoconf_paths_.size()) << SOLD_LOG_KEY(ldsocache_.size());
+}
+
+// The order is the same as _dl_map_object in glibc/elf/dl-load.c: DT_RPATH,
+// LD_LIBRARY_PATH, DT_RUNPATH, ld.so.cache and the default directories. We
+// also search directories in ld.so.conf after ld.so.cache in case it is
+// stale.
+Sold::LibrarySearchPaths Sold::GetLibraryPaths(const ELFBinary* binary) {
+    LibrarySearchPaths library_paths;
     const std::string& runpath = binary->runpath();
     const std::string& rpath = binary->rpath();
     if (custome_library_path_.empty()) {
         if (runpath.empty() && !rpath.empty()) {
             for (const std::string& path : SplitString(rpath, ":")) {
-                library_paths.push_back(ResolveRunPathVariables(binary, path));
+                library_paths.dirs.push_back(ResolveRunPathVariables(binary, path));
             }
         }
     }
     for (const std::string& path : ld_library_paths_) {
-        library_paths.push_back(path);
+        library_paths.dirs.push_back(path);
     }
     if (!runpath.empty()) {
         for (const std::string& path : SplitString(runpath, ":")) {
-            library_paths.push_back(ResolveRunPathVariables(binary, path));
+            library_paths.dirs.push_back(ResolveRunPathVariables(binary, path));
         }
     }
 
+    std::vector<std::string>& fallback_dirs = library_paths.fallback_dirs;
     if (custome_library_path_.empty()) {
-        std::vector<std::string> ldsoconfs = ldsoconf::read_ldsoconf();
-        library_paths.insert(library_paths.end(), ldsoconfs.begin(), ldsoconfs.end());
+        library_paths.use_cache = true;
+        fallback_dirs.insert(fallback_dirs.end(), ldsoconf_paths_.begin(), ldsoconf_paths_.end());
 
-        library_paths.push_back("/lib");
-        library_paths.push_back("/usr/lib");
-        library_paths.push_back("/usr/lib64");
+        fallback_dirs.push_back("/lib");
+        fallback_dirs.push_back("/usr/lib");
+        fallback_dirs.push_back("/usr/lib64");
     }
 
-    library_paths.insert(library_paths.end(), custome_library_path_.begin(), custome_library_path_.end());
+    fallback_dirs.insert(fallback_dirs.end(), custome_library_path_.begin(), custome_library_path_.end());
 
     return library_paths;
 }
 
-// This implementation is compatible with _dl_sort_maps in glibc/elf/dl-sort-maps.c.
-std::vector<ELFBinary*> TopologicalSort(std::vector<std::pair<std::string, ELFBinary*>> link_binaries_buf) {
-    if (link_binaries_buf.size() < 1) {
-        return {};
+bool Sold::DirectoryHasEntry(const std::string& dir, const std::string& name) {
+    auto found = dir_entries_.find(dir);
+    if (found == dir_entries_.end()) {
+        std::unordered_set<std::string> entries;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (struct dirent* e = readdir(d)) {
+                entries.insert(e->d_name);
+            }
+            closedir(d);
+        }
+        found = dir_entries_.emplace(dir, std::move(entries)).first;
     }
+    return found->second.count(name);
+}
+
+std::unique_ptr<ELFBinary> Sold::FindLibrary(const LibrarySearchPaths& paths, const std::string& needed) {
+    auto read_if_exists = [this](const std::string& filename) -> std::unique_ptr<ELFBinary> {
+        if (Exists(filename)) return ReadELF(filename);
+        return nullptr;
+    };
+    auto find_in = [this, &needed, &read_if_exists](const std::vector<std::string>& dirs) -> std::unique_ptr<ELFBinary> {
+        for (const std::string& dir : dirs) {
+            // The directory listing cannot tell about names with '/'.
+            if (needed.find('/') == std::string::npos && !DirectoryHasEntry(dir, needed)) continue;
+            if (std::unique_ptr<ELFBinary> library = read_if_exists(dir + '/' + needed)) return library;
+        }
+        return nullptr;
+    };
 
-    // The third element of tuple is `seen' variable in glibc/elf/dl-sort-maps.c
-    std::list<std::tuple<std::string, ELFBinary*, int>> buf;
-    for (const auto& p : link_binaries_buf) buf.emplace_back(p.first, p.second, 0);
+    if (std::unique_ptr<ELFBinary> library = find_in(paths.dirs)) return library;
+    if (paths.use_cache) {
+        auto found = ldsocache_.find(needed);
+        if (found != ldsocache_.end()) {
+            if (std::unique_ptr<ELFBinary> library = read_if_exists(found->second)) return library;
+            LOG(WARNING) << "Stale entry in ld.so.cache: " << needed << " => " << found->second;
+        }
+    }
+    return find_in(paths.fallback_dirs);
+}
 
-    auto i_it = buf.begin();
-    int n_rest = buf.size();
-    while (1) {
-        std::get<2>(*i_it)++;
+namespace {
 
-        auto k_it = buf.end();
-        k_it--;
-        while (i_it != k_it) {
-            const auto& neededs = std::get<1>(*k_it)->neededs();
-            if (std::find(neededs.begin(), neededs.end(), std::get<0>(*i_it)) != neededs.end()) {
-                buf.insert(buf.end(), *i_it);
-                i_it = buf.erase(i_it);
-                if (std::get<2>(*i_it) > n_rest) break;
+// Sorts link_binaries_buf, whose elements are (DT_NEEDED name, binary), by
+// ::TopologicalSort on their indices.
+std::vector<ELFBinary*> SortLinkBinaries(const std::vector<std::pair<std::string, ELFBinary*>>& link_binaries_buf) {
+    std::unordered_map<std::string, int> ids;
+    for (size_t i = 0; i < link_binaries_buf.size(); ++i) {
+        ids.emplace(link_binaries_buf[i].first, i);
+    }
 
-                goto next;
-            }
-            --k_it;
+    std::vector<std::vector<int>> neededs(link_binaries_buf.size());
+    for (size_t i = 0; i < link_binaries_buf.size(); ++i) {
+        for (const std::string& needed : link_binaries_buf[i].second->neededs()) {
+            auto found = ids.find(needed);
+            if (found != ids.end()) neededs[i].push_back(found->second);
         }
-        if (i_it == buf.end() || ++i_it == buf.end()) break;
-        for (auto it = i_it; it != buf.end(); it++) std::get<2>(*it) = 0;
-    next:;
     }
 
     std::vector<ELFBinary*> ret;
-    for (const auto& t : buf) ret.emplace_back(std::get<1>(t));
-
+    for (int id : TopologicalSort(neededs)) ret.push_back(link_binaries_buf[id].second);
     return ret;
 }
 
+}  // namespace
+
 void Sold::ResolveLibraryPaths(ELFBinary* root_binary) {
     // We should search for shared objects in BFS order.
     std::queue<const ELFBinary*> bfs_queue;
@@ -890,7 +1583,7 @@ void Sold::ResolveLibraryPaths(ELFBinary* root_binary) {
         const ELFBinary* binary = bfs_queue.front();
         bfs_queue.pop();
 
-        std::vector<std::string> library_paths = GetLibraryPaths(binary);
+        const LibrarySearchPaths library_paths = GetLibraryPaths(binary);
 
         for (const std::string& needed : binary->neededs()) {
             auto found = libraries_.find(needed);
@@ -898,14 +1591,8 @@ void Sold::ResolveLibraryPaths(ELFBinary* root_binary) {
                 continue;
             }
 
-            std::unique_ptr<ELFBinary> library;
-            for (const std::string& path : library_paths) {
-                const std::string& filename = path + '/' + needed;
-                if (Exists(filename)) {
-                    library = ReadELF(filename);
-                    if (library) break;
-                }
-            }
+            TraceSpan span("Load", "library", needed);
+            std::unique_ptr<ELFBinary> library = FindLibrary(library_paths, needed);
             if (!library) {
                 LOG(FATAL) << "Library " << needed << " not found";
                 abort();
@@ -923,6 +1610,8 @@ void Sold::ResolveLibraryPaths(ELFBinary* root_binary) {
 
             if (ShouldLink(library->soname())) {
                 link_binaries_buf.emplace_back(needed, library.get());
+            } else {
+                excluded_binaries_.push_back(library.get());
             }
 
             LOG(INFO) << "Loaded: " << needed << " => " << library->filename();
@@ -933,7 +1622,7 @@ void Sold::ResolveLibraryPaths(ELFBinary* root_binary) {
         }
     }
 
-    link_binaries_ = TopologicalSort(link_binaries_buf);
+    link_binaries_ = SortLinkBinaries(link_binaries_buf);
 }
 
 bool Sold::ShouldLink(const std::string& soname) {
@@ -16,19 +16,33 @@
 #include <libgen.h>
 #include <sys/stat.h>
 
+#include <deque>
 #include <iostream>
 #include <map>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "ehframe_builder.h"
 #include "elf_binary.h"
 #include "hash.h"
+#include "hash_table.h"
+#include "layout.h"
+#include "link_map.h"
 #include "ldsoconf.h"
 #include "mprotect_builder.h"
+#include "page_report.h"
+#include "patch_overlay.h"
+#include "relative_rebase.h"
+#include "reloc_report.h"
 #include "shdr_builder.h"
+#include "size_report.h"
 #include "strtab_builder.h"
 #include "symtab_builder.h"
+#include "time_init_builder.h"
+#include "trace.h"
 #include "utils.h"
 #include "version_builder.h"
 
@@ -41,6 +55,48 @@ public:
 
     const std::map<std::string, std::string> filename_to_soname() { return filename_to_soname_; };
 
+    const ELFBinary* main_binary() const { return main_binary_.get(); }
+
+    // All shared objects which main_binary() depends on directly or
+    // indirectly, including excluded ones, keyed by their DT_NEEDED names.
+    const std::map<std::string, std::unique_ptr<ELFBinary>>& libraries() const { return libraries_; }
+
+    // Makes Link record relocations for PrintRelocReport.
+    void EnableRelocReport() { reloc_report_.reset(new RelocReport(machine_type)); }
+
+    // Makes Link omit .note.gnu.build-id.
+    void DisableBuildId() { emit_build_id_ = false; }
+
+    // Makes Link write a separate debug file to filename and add
+    // .gnu_debuglink which points at it to the output. .symtab goes to the debug file instead of the output. The debug file
+    // needs section headers.
+    void EnableDebugFile(const std::string& filename) {
+        CHECK(emit_section_header_) << "A debug file needs section headers";
+        debug_filename_ = filename;
+    }
+
+    // Makes Link wrap .init_array entries of each input with code which
+    // measures how long they take. The output exports the timings as
+    // sold_init_timings and prints them to stderr when SOLD_TIME_INIT is set.
+    // See TimeInitBuilder.
+    void EnableTimeInit() { time_init_ = true; }
+
+    // Returns where segments of inputs landed in the output of the last Link.
+    LinkMap GetLinkMap(const std::string& out_filename) const;
+
+    // Returns which library each byte of the output of the last Link came
+    // from. See SizeReport.
+    SizeReport GetSizeReport() const;
+
+    // Returns pages which relocations of the output of the last Link dirty.
+    PageReport GetPageReport() const;
+
+    // Prints the relocation report of the last Link. See RelocReport::Print.
+    void PrintRelocReport(std::ostream& os, size_t top_n) const {
+        CHECK(reloc_report_) << "EnableRelocReport was not called";
+        reloc_report_->Print(os, top_n);
+    }
+
 private:
     void Emit(const std::string& out_filename);
 
@@ -57,6 +113,10 @@ private:
         num_phdrs++;
         // GNU_RELRO
         num_phdrs++;
+        // NOTE of .note.gnu.build-id
+        if (layout_.build_id.size) num_phdrs++;
+        // PT_LOADs of the code and the data of EnableTimeInit
+        if (layout_.time_init.size) num_phdrs += 2;
         // Normal PT_LOAD
         for (ELFBinary* bin : link_binaries_) {
             num_phdrs += bin->loads().size();
@@ -64,106 +124,24 @@ private:
         return num_phdrs;
     }
 
-    uintptr_t GnuHashOffset() const { return sizeof(Elf_Ehdr) + sizeof(Elf_Phdr) * CountPhdrs(); }
-    uintptr_t GnuHashSize() const { return syms_.GnuHashSize(); }
-
-    uintptr_t SymtabOffset() const { return GnuHashOffset() + GnuHashSize(); }
-    uintptr_t SymtabSize() const { return syms_.size() * sizeof(Elf_Sym); }
-
-    uintptr_t VersymOffset() const { return SymtabOffset() + SymtabSize(); }
-    uintptr_t VersymSize() const { return version_.SizeVersym(); }
-
-    uintptr_t VerneedOffset() const { return VersymOffset() + VersymSize(); }
-    uintptr_t VerneedSize() const { return version_.SizeVerneed(); }
-
-    uintptr_t RelOffset() const { return VerneedOffset() + VerneedSize(); }
-    uintptr_t RelSize() const { return rels_.size() * sizeof(Elf_Rel); }
-
-    uintptr_t InitArrayOffset() const { return AlignNext(RelOffset() + RelSize(), 7); }
-    uintptr_t InitArraySize() const { return sizeof(uintptr_t) * init_array_.size(); }
-
-    uintptr_t FiniArrayOffset() const { return InitArrayOffset() + InitArraySize(); }
-    uintptr_t FiniArraySize() const { return sizeof(uintptr_t) * fini_array_.size(); }
-
-    uintptr_t StrtabOffset() const { return FiniArrayOffset() + FiniArraySize(); }
-    uintptr_t StrtabSize() const { return strtab_.size(); }
-
-    uintptr_t DynamicOffset() const { return StrtabOffset() + StrtabSize(); }
-    uintptr_t DynamicSize() const { return sizeof(Elf_Dyn) * dynamic_.size(); }
-
-    uintptr_t ShstrtabOffset() const { return DynamicOffset() + DynamicSize(); }
-    uintptr_t ShstrtabSize() const { return shdr_.ShstrtabSize(); }
-
-    uintptr_t CodeOffset() const { return AlignNext(ShstrtabOffset() + ShstrtabSize()); }
-    uintptr_t CodeSize() {
-        uintptr_t p = 0;
-        for (const Load& load : loads_) {
-            ELFBinary* bin = load.bin;
-            Elf_Phdr* phdr = load.orig;
-            p += (load.emit.p_offset + phdr->p_filesz);
-        }
-        return p;
-    }
-
-    uintptr_t TLSOffset() const { return tls_file_offset_; }
-    uintptr_t TLSFileSize() const {
-        static uintptr_t s = 0;
-        if (s != 0) return s;
-        for (ELFBinary* bin : link_binaries_) {
-            for (Elf_Phdr* phdr : bin->phdrs()) {
-                if (phdr->p_type == PT_TLS) {
-                    s += phdr->p_filesz;
-                }
-            }
-        }
-        return s;
-    }
-
-    uintptr_t EHFrameOffset() const { return AlignNext(TLSOffset() + TLSFileSize()); }
-    // We emit EHFrame whenever the number of FDEs is 0.
-    uintptr_t EHFrameSize() const {
-        static uintptr_t s = 0;
-        if (s != 0) return s;
+    // Ranges of the PT_LOADs which sold makes by itself: headers and tables,
+    // the TLS image, .eh_frame_hdr, mprotect code and the code and the data of
+    // EnableTimeInit.
+    std::vector<Range> OwnLoads() const;
 
-        int n_fdes = 0;
-        s = sizeof(EHFrameHeader::version) + sizeof(EHFrameHeader::eh_frame_ptr_enc) + sizeof(EHFrameHeader::fde_count_enc) +
-            sizeof(EHFrameHeader::table_enc) + sizeof(EHFrameHeader::eh_frame_ptr) + sizeof(EHFrameHeader::fde_count);
+    // ComputeInputSizes computes the sizes of sections which depend only on
+    // link_binaries_.
+    void ComputeInputSizes();
 
-        for (ELFBinary* bin : link_binaries_) {
-            for (Elf_Phdr* phdr : bin->phdrs()) {
-                if (phdr->p_type == PT_GNU_EH_FRAME) {
-                    n_fdes += bin->eh_frame_header()->fde_count;
-                }
-            }
-        }
-        s += n_fdes * (sizeof(EHFrameHeader::FDETableEntry::fde_ptr) + sizeof(EHFrameHeader::FDETableEntry::initial_loc));
-        return s;
-    }
-
-    uintptr_t MemprotectOffset() const { return mprotect_file_offset_; }
-    uintptr_t MprotectSize() const {
-        int n_memprotect = 0;
-        for (ELFBinary* bin : link_binaries_) {
-            for (Elf_Phdr* phdr : bin->phdrs()) {
-                if (phdr->p_type == PT_GNU_RELRO) {
-                    n_memprotect++;
-                }
-            }
-        }
-        if (machine_type == EM_X86_64) {
-            return sizeof(MprotectBuilder::memprotect_body_code_x86_64) * n_memprotect +
-                   sizeof(MprotectBuilder::memprotect_end_code_x86_64);
-        } else if (machine_type == EM_AARCH64) {
-            return MprotectBuilder::body_code_length_aarch64 * n_memprotect + MprotectBuilder::ret_code_length_aarch64;
-        } else {
-            CHECK(false) << SOLD_LOG_KEY(machine_type) << " is not supported.";
-        }
-    }
-    uintptr_t ShdrOffset() const { return MemprotectOffset() + MprotectSize(); }
+    // PlanLayout decides all offsets and sizes in layout_. We must call this
+    // after all symbols, relocations and strings are collected.
+    void PlanLayout();
 
     void BuildEhdr();
 
-    void BuildLoads();
+    // BuildLoads places PT_LOADs of link_binaries_ from layout_.code.offset
+    // and returns the end of them.
+    uintptr_t BuildLoads();
 
     void BuildEHFrameHeader() {
         for (const ELFBinary* bin : link_binaries_) {
@@ -177,7 +155,7 @@ private:
                 }
             }
         }
-        SOLD_CHECK_EQ(EHFrameSize(), ehframe_builder_.Size());
+        SOLD_CHECK_EQ(layout_.ehframe.size, ehframe_builder_.Size());
     }
 
     void BuildMprotect() {
@@ -204,6 +182,15 @@ private:
 
     void BuildArrays();
 
+    // Returns the names of shared objects which we do not link.
+    std::set<std::string> CollectNeededs() const;
+
+    // AddDynamicStrings adds strings referred from .dynamic to strtab_.
+    void AddDynamicStrings();
+
+    // Returns the number of entries BuildDynamic makes.
+    size_t CountDynamic() const;
+
     void BuildDynamic();
 
     void EmitPhdrs(FILE* fp);
@@ -211,98 +198,130 @@ private:
     void EmitGnuHash(FILE* fp);
 
     void EmitSymtab(FILE* fp) {
-        CHECK(ftell(fp) == SymtabOffset());
+        CHECK(ftell(fp) == layout_.dynsym.offset);
         for (const Elf_Sym& sym : syms_.Get()) {
             Write(fp, sym);
         }
     }
 
     void EmitVersym(FILE* fp) {
-        CHECK(ftell(fp) == VersymOffset());
+        CHECK(ftell(fp) == layout_.versym.offset);
         version_.EmitVersym(fp);
     }
 
     void EmitVerneed(FILE* fp) {
-        CHECK(ftell(fp) == VerneedOffset());
+        CHECK(ftell(fp) == layout_.verneed.offset);
         version_.EmitVerneed(fp, strtab_);
     }
 
     void EmitStrtab(FILE* fp) {
-        CHECK(ftell(fp) == StrtabOffset());
+        CHECK(ftell(fp) == layout_.dynstr.offset);
         WriteBuf(fp, strtab_.data(), strtab_.size());
     }
 
     void EmitRel(FILE* fp) {
-        CHECK(ftell(fp) == RelOffset());
+        CHECK(ftell(fp) == layout_.rela_dyn.offset);
         for (const Elf_Rel& rel : rels_) {
             Write(fp, rel);
         }
     }
 
     void EmitArrays(FILE* fp) {
-        EmitPad(fp, InitArrayOffset());
+        EmitPad(fp, layout_.init_array.offset);
         for (uintptr_t ptr : init_array_) {
             Write(fp, ptr);
         }
-        CHECK(ftell(fp) == FiniArrayOffset());
+        CHECK(ftell(fp) == layout_.fini_array.offset);
         for (uintptr_t ptr : fini_array_) {
             Write(fp, ptr);
         }
     }
 
     void EmitShstrtab(FILE* fp) {
-        CHECK(ftell(fp) == ShstrtabOffset());
+        CHECK(ftell(fp) == layout_.shstrtab.offset);
         shdr_.EmitShstrtab(fp);
     }
 
     void EmitDynamic(FILE* fp) {
-        CHECK(ftell(fp) == DynamicOffset());
+        CHECK(ftell(fp) == layout_.dynamic.offset);
         for (const Elf_Dyn& dyn : dynamic_) {
             Write(fp, dyn);
         }
     }
 
     void EmitCode(FILE* fp) {
-        CHECK(ftell(fp) == CodeOffset());
+        CHECK(ftell(fp) == layout_.code.offset);
         for (const Load& load : loads_) {
             ELFBinary* bin = load.bin;
             Elf_Phdr* phdr = load.orig;
             LOG(INFO) << "Emitting code of " << bin->name() << " from " << HexString(ftell(fp)) << " => " << HexString(load.emit.p_offset)
                       << " + " << HexString(phdr->p_filesz);
             EmitPad(fp, load.emit.p_offset);
-            WriteBuf(fp, bin->head() + phdr->p_offset, phdr->p_filesz);
+            auto patch = patches_.find(bin);
+            if (patch != patches_.end()) {
+                patch->second.Emit(fp, bin->head(), phdr->p_offset, phdr->p_filesz);
+            } else {
+                WriteBuf(fp, bin->head() + phdr->p_offset, phdr->p_filesz);
+            }
         }
     }
 
     // Emit TLS initialization image
     void EmitTLS(FILE* fp) {
-        EmitPad(fp, TLSOffset());
-        CHECK(ftell(fp) == TLSOffset());
+        EmitPad(fp, layout_.tls.offset);
+        CHECK(ftell(fp) == layout_.tls.offset);
         for (TLS::Data data : tls_.data) {
             WriteBuf(fp, data.start, data.size);
         }
     }
 
     void EmitEHFrame(FILE* fp) {
-        EmitPad(fp, EHFrameOffset());
-        CHECK(ftell(fp) == EHFrameOffset());
-        LOG(INFO) << SOLD_LOG_BITS(ftell(fp)) << SOLD_LOG_BITS(EHFrameOffset()) << SOLD_LOG_BITS(ehframe_builder_.Size());
+        EmitPad(fp, layout_.ehframe.offset);
+        CHECK(ftell(fp) == layout_.ehframe.offset);
+        LOG(INFO) << SOLD_LOG_BITS(ftell(fp)) << SOLD_LOG_BITS(layout_.ehframe.offset) << SOLD_LOG_BITS(ehframe_builder_.Size());
         ehframe_builder_.Emit(fp);
     }
 
     void EmitMemprotect(FILE* fp) {
-        EmitPad(fp, MemprotectOffset());
-        SOLD_CHECK_EQ(ftell(fp), MemprotectOffset());
-        LOG(INFO) << SOLD_LOG_BITS(ftell(fp)) << SOLD_LOG_BITS(MemprotectOffset()) << SOLD_LOG_BITS(MprotectSize());
+        EmitPad(fp, layout_.mprotect.offset);
+        SOLD_CHECK_EQ(ftell(fp), layout_.mprotect.offset);
+        LOG(INFO) << SOLD_LOG_BITS(ftell(fp)) << SOLD_LOG_BITS(layout_.mprotect.offset) << SOLD_LOG_BITS(layout_.mprotect.size);
         memprotect_builder_.Emit(fp, mprotect_offset_);
     }
 
+    void EmitTimeInit(FILE* fp) {
+        EmitPad(fp, layout_.time_init.offset);
+        SOLD_CHECK_EQ(ftell(fp), layout_.time_init.offset);
+        time_init_builder_.EmitCode(fp, time_init_offset_, time_init_data_offset_);
+        EmitPad(fp, layout_.time_init_data.offset);
+        SOLD_CHECK_EQ(ftell(fp), layout_.time_init_data.offset);
+        time_init_builder_.EmitData(fp);
+    }
+
+    void EmitBuildId(FILE* fp);
+
+    void EmitDebuglink(FILE* fp);
+
+    // Writes the debug file and fills the build-id and the CRC of
+    // .gnu_debuglink of the output.
+    void EmitDebugFile(const std::string& out_filename);
+
+    void EmitStaticSymtab(FILE* fp) {
+        EmitPad(fp, layout_.symtab.offset);
+        SOLD_CHECK_EQ(ftell(fp), layout_.symtab.offset);
+        for (const StaticSymbol& s : static_syms_) {
+            Write(fp, s.sym);
+        }
+        SOLD_CHECK_EQ(ftell(fp), layout_.strtab.offset);
+        WriteBuf(fp, static_strtab_.data(), static_strtab_.size());
+    }
+
     void EmitShdr(FILE* fp) {
-        SOLD_CHECK_EQ(ftell(fp), ShdrOffset());
+        EmitPad(fp, layout_.shdr_offset);
+        SOLD_CHECK_EQ(ftell(fp), layout_.shdr_offset);
         shdr_.EmitShdrs(fp);
     }
 
-    uintptr_t TLSMemSize() const;
     void DecideMemOffset();
 
     void CollectArrays();
@@ -316,10 +335,12 @@ private:
         LOG(INFO) << "CollectSymbols";
 
         std::vector<Syminfo> syms;
+        OpenHashMap<SymbolKey, size_t, SymbolKeyHash> syms_index;
         for (ELFBinary* bin : link_binaries_) {
-            LoadDynSymtab(bin, syms);
+            TraceSpan span("LoadDynSymtab", "library", bin->name());
+            LoadDynSymtab(bin, syms, syms_index);
         }
-        for (auto s : syms) {
+        for (const auto& s : syms) {
             LOG(INFO) << "SYM " << s.name;
         }
         syms_.SetSrcSyms(syms);
@@ -327,6 +348,16 @@ private:
 
     void CollectTLS();
 
+    // CollectSections decides which sections of link_binaries_ have section
+    // headers in the output and collects symbols in their .symtab into
+    // static_syms_. When an input has no .symtab, we use its .dynsym instead
+    // so that profilers can still name functions of stripped libraries.
+    void CollectSections();
+
+    // Registers the section headers collected by CollectSections, .symtab and
+    // .strtab, and then fixes st_shndx of .symtab and .dynsym.
+    void BuildSectionHeaders();
+
     void PrintAllVersion() {
         LOG(INFO) << "PrintAllVersion";
 
@@ -345,13 +376,24 @@ private:
 
     uintptr_t RemapTLS(const char* msg, ELFBinary* bin, uintptr_t off);
 
-    void LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab);
+    // LoadDynSymtab copies symbols of bin with their values relocated to
+    // adjusted_syms_ and registers them to symbol_maps_ and symtab.
+    void LoadDynSymtab(ELFBinary* bin, std::vector<Syminfo>& symtab, OpenHashMap<SymbolKey, size_t, SymbolKeyHash>& symtab_index);
 
     void CopyPublicSymbols();
 
     void Relocate() {
+        // Reserve once. Reserving per input copies rels_ for each of them.
+        size_t total = rels_.size();
+        for (const ELFBinary* bin : link_binaries_) {
+            total += bin->num_rels() + bin->num_plt_rels();
+        }
+        rels_.reserve(total);
         for (ELFBinary* bin : link_binaries_) {
+            TraceSpan span("RelocateBinary", "library", bin->name());
+            const size_t num_rels = rels_.size();
             RelocateBinary(bin);
+            num_output_rels_[bin] = rels_.size() - num_rels;
         }
     }
 
@@ -364,16 +406,35 @@ private:
     void RelocateSymbols(ELFBinary* bin, const Elf_Rel* rels, size_t num) {
         if (!rels) CHECK_EQ(0, num);
         uintptr_t offset = offsets_[bin];
-        if (bin->ehdr()->e_machine == EM_X86_64) {
-            for (size_t i = 0; i < num; ++i) {
-                RelocateSymbol_x86_64(bin, &rels[i], offset);
+        const uint16_t machine = bin->ehdr()->e_machine;
+        CHECK(machine == EM_X86_64 || machine == EM_AARCH64) << "sold does not support " << SOLD_LOG_KEY(machine) << ".";
+
+        size_t i = 0;
+        while (i < num) {
+            // RELATIVE relocations outside TLS only need rebasing. We pass
+            // each run of them to RebaseRelativeRelocations at once.
+            size_t end = i;
+            while (end < num && IsPlainRelative(rels[end], machine) && !bin->IsVaddrInTLSData(rels[end].r_offset)) {
+                end++;
+            }
+            if (end > i) {
+                const size_t pos = rels_.size();
+                rels_.resize(pos + end - i);
+                RebaseRelativeRelocations(rels + i, end - i, offset, &rels_[pos]);
+                if (reloc_report_) {
+                    for (size_t j = i; j < end; ++j) reloc_report_->Add(bin->name(), rels[j], rels_[pos + j - i], "", "");
+                }
+                i = end;
+                continue;
             }
-        } else if (bin->ehdr()->e_machine == EM_AARCH64) {
-            for (size_t i = 0; i < num; ++i) {
+
+            if (machine == EM_X86_64) {
+                RelocateSymbol_x86_64(bin, &rels[i], offset);
+            } else {
                 RelocateSymbol_aarch64(bin, &rels[i], offset);
             }
-        } else {
-            CHECK(false) << "sold does not support " << SOLD_LOG_KEY(bin->ehdr()->e_machine) << ".";
+            if (reloc_report_) RecordRelocation(bin, rels[i], rels_.back());
+            i++;
         }
     }
 
@@ -381,6 +442,35 @@ private:
 
     void RelocateSymbol_aarch64(ELFBinary* bin, const Elf_Rel* rel, uintptr_t offset);
 
+    // Memo of SymtabBuilder::Resolve and SymtabBuilder::ResolveCopy for a
+    // symbol in .dynsym of an input. Both of them return the same result for
+    // the same symbol, so we call them at most once per (bin, index).
+    struct ResolvedSymbol {
+        bool resolved{false};
+        bool defined{false};
+        uintptr_t val_or_index{0};
+        bool copy_resolved{false};
+        uintptr_t copy_index{0};
+    };
+
+    ResolvedSymbol& GetResolvedSymbol(const ELFBinary* bin, uint32_t index);
+
+    SymbolKey MakeSymbolKey(ELFBinary* bin, uint32_t index);
+
+    // Same as SymtabBuilder::Resolve for the index-th symbol in .dynsym of bin.
+    bool ResolveSymbol(ELFBinary* bin, uint32_t index, uintptr_t& val_or_index);
+
+    // Same as SymtabBuilder::ResolveCopy for the index-th symbol in .dynsym of bin.
+    uintptr_t ResolveCopySymbol(ELFBinary* bin, uint32_t index);
+
+    // Adds in of bin and its rewritten out to reloc_report_.
+    void RecordRelocation(ELFBinary* bin, const Elf_Rel& in, const Elf_Rel& out);
+
+    // Returns the soname of the library which is expected to define key at
+    // runtime, i.e. the soname in its version requirement or the first
+    // library in excluded_binaries_ which defines it.
+    std::string FindProvider(const SymbolKey& key);
+
     void InitLdLibraryPaths() {
         if (const char* paths = getenv("LD_LIBRARY_PATH")) {
             for (const std::string& path : SplitString(paths, ":")) {
@@ -389,9 +479,28 @@ private:
         }
     }
 
+    // Reads ld.so.conf and ld.so.cache once. They are shared by all binaries
+    // in ResolveLibraryPaths.
+    void InitSystemLibraryPaths();
+
     std::string ResolveRunPathVariables(const ELFBinary* binary, const std::string& runpath);
 
-    std::vector<std::string> GetLibraryPaths(const ELFBinary* binary);
+    // Where to search for DT_NEEDED of a binary. We search dirs, then
+    // ldsocache_ when use_cache is true, and then fallback_dirs.
+    struct LibrarySearchPaths {
+        std::vector<std::string> dirs;
+        bool use_cache{false};
+        std::vector<std::string> fallback_dirs;
+    };
+
+    LibrarySearchPaths GetLibraryPaths(const ELFBinary* binary);
+
+    // Returns nullptr when needed is not found.
+    std::unique_ptr<ELFBinary> FindLibrary(const LibrarySearchPaths& paths, const std::string& needed);
+
+    // Returns true when dir has an entry named name. Listings of directories
+    // are memoized in dir_entries_.
+    bool DirectoryHasEntry(const std::string& dir, const std::string& name);
 
     void ResolveLibraryPaths(ELFBinary* root_binary);
 
@@ -413,6 +522,19 @@ private:
         Elf_Phdr emit;
     };
 
+    struct InputSection {
+        ELFBinary* bin;
+        // Index in bin->shdrs().
+        Elf_Word index;
+    };
+
+    // A symbol of .symtab. st_shndx is the index in bin->shdrs() until
+    // BuildSectionHeaders.
+    struct StaticSymbol {
+        ELFBinary* bin;
+        Elf_Sym sym;
+    };
+
     std::vector<std::string> EXCLUDE_SHARED_OBJECTS = {
         "libc.so",         // GPL (glibc)
         "libm.so",         // GPL (glibc)
@@ -435,30 +557,55 @@ private:
     Elf64_Half machine_type;
     std::unique_ptr<ELFBinary> main_binary_;
     std::vector<std::string> ld_library_paths_;
+    std::vector<std::string> ldsoconf_paths_;
+    std::unordered_map<std::string, std::string> ldsocache_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> dir_entries_;
     const std::vector<std::string> exclude_sos_;
     const std::vector<std::string> exclude_finis_;
     const std::vector<std::string> custome_library_path_;
     std::map<std::string, std::unique_ptr<ELFBinary>> libraries_;
     std::vector<ELFBinary*> link_binaries_;
+    // Libraries which we do not link in the order of ResolveLibraryPaths.
+    std::vector<ELFBinary*> excluded_binaries_;
     std::map<const ELFBinary*, uintptr_t> offsets_;
     std::map<std::string, std::string> filename_to_soname_;
+    // Version tables of link_binaries_ built by LoadDynSymtab.
+    std::map<const ELFBinary*, VersionTable> version_tables_;
     std::map<std::string, std::string> soname_to_filename_;
-    uintptr_t tls_file_offset_{0};
-    uintptr_t ehframe_file_offset_{0};
-    uintptr_t mprotect_file_offset_{0};
     uintptr_t tls_offset_{0};
     uintptr_t ehframe_offset_{0};
     uintptr_t mprotect_offset_{0};
+    bool time_init_{false};
+    uintptr_t time_init_offset_{0};
+    uintptr_t time_init_data_offset_{0};
     bool is_executable_{false};
     bool emit_section_header_;
+    bool emit_build_id_{true};
+    std::string debug_filename_;
 
     uintptr_t interp_offset_;
+    Layout layout_;
     SymtabBuilder syms_;
+    std::map<const ELFBinary*, std::vector<ResolvedSymbol>> resolved_syms_;
+    // Same as ELFBinary::GetSymbolMap but symbols point to adjusted_syms_.
+    std::map<const ELFBinary*, std::vector<Syminfo>> symbol_maps_;
+    // Relocated copies of input symbols. We use deque to keep pointers.
+    std::deque<Elf_Sym> adjusted_syms_;
+    // Words rewritten in PT_LOADs of each input.
+    std::map<const ELFBinary*, PatchOverlay> patches_;
     std::vector<Elf_Rel> rels_;
+    // The number of relocations in rels_ emitted for each input.
+    std::map<const ELFBinary*, size_t> num_output_rels_;
+    std::unique_ptr<RelocReport> reloc_report_;
+    // Memo of FindProvider for unversioned symbols.
+    std::unordered_map<SymbolName, std::string, SymbolNameHash> providers_;
     StrtabBuilder strtab_;
     VersionBuilder version_;
     EHFrameBuilder ehframe_builder_;
     MprotectBuilder memprotect_builder_;
+    TimeInitBuilder time_init_builder_;
+    // sold_init_timings, which points to the data of time_init_builder_.
+    Elf_Sym time_init_sym_;
     ShdrBuilder shdr_;
     Elf_Ehdr ehdr_;
     std::vector<Load> loads_;
@@ -466,4 +613,10 @@ private:
     std::vector<uintptr_t> init_array_;
     std::vector<uintptr_t> fini_array_;
     TLS tls_;
+    std::vector<InputSection> input_sections_;
+    std::vector<StaticSymbol> static_syms_;
+    // The number of local symbols in static_syms_ including the null symbol.
+    // They precede global ones.
+    Elf_Word num_local_static_syms_{0};
+    StrtabBuilder static_strtab_;
 };
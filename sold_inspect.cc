@@ -0,0 +1,103 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <string.h>
+
+#include <iostream>
+#include <map>
+
+#include "inspect.h"
+#include "verifier.h"
+
+namespace {
+
+void print_help(std::ostream& os) {
+    os << R"(usage: sold-inspect [--json] COMMAND FILE...
+Commands:
+dynsym      Symbols in .dynsym with their versions
+relocs      Relocations in .rela.dyn and .rela.plt
+tls         The PT_TLS segment
+versions    .gnu.version_r and .gnu.version_d
+ehframe     Entries of .eh_frame_hdr
+hash        Bucket fill, chain lengths and bloom filter false positives of .gnu.hash and .hash
+verify      Check the structure of the file like sold --check-output
+
+Options:
+-h, --help  Show this help message and exit
+--json      Write each report as a line of JSON
+)" << std::endl;
+}
+
+typedef void (*InspectFunc)(const ELFBinary&, InspectWriter*);
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    google::InitGoogleLogging(argv[0]);
+
+    const std::map<std::string, InspectFunc> commands = {
+        {"dynsym", InspectDynSymtab}, {"relocs", InspectRelocs},     {"tls", InspectTLS},
+        {"versions", InspectVersions}, {"ehframe", InspectEHFrame}, {"hash", InspectHashTables},
+    };
+
+    bool json = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            print_help(strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0 ? std::cout : std::cerr);
+            return strcmp(argv[i], "-h") != 0 && strcmp(argv[i], "--help") != 0;
+        }
+    }
+    if (argc - i < 2) {
+        print_help(std::cerr);
+        return 1;
+    }
+
+    const std::string command = argv[i++];
+    InspectWriter writer(std::cout, json);
+    if (command == "verify") {
+        int status = 0;
+        for (; i < argc; ++i) {
+            size_t num_errors;
+            const std::vector<std::string> errors = VerifyOutput(argv[i], &num_errors);
+            writer.BeginReport("verify", argv[i]);
+            for (const std::string& error : errors) {
+                writer.BeginRecord();
+                writer.String("error", error);
+                writer.EndRecord();
+            }
+            writer.BeginSummary();
+            writer.Uint("errors", num_errors);
+            writer.EndSummary();
+            writer.EndReport();
+            if (!errors.empty()) status = 1;
+        }
+        return status;
+    }
+
+    auto found = commands.find(command);
+    if (found == commands.end()) {
+        std::cerr << "Unknown command: " << command << std::endl;
+        print_help(std::cerr);
+        return 1;
+    }
+    for (; i < argc; ++i) {
+        auto bin = ReadELF(argv[i]);
+        found->second(*bin, &writer);
+    }
+    return 0;
+}
@@ -15,7 +15,13 @@
 
 #include "sold.h"
 
+#include <errno.h>
 #include <getopt.h>
+#include <stdlib.h>
+
+#include <fstream>
+
+#include "verifier.h"
 
 void print_help(std::ostream& os) {
     os << R"(usage: sold [option] [input]
@@ -26,13 +32,41 @@ Options:
 -e, --exclude-so EXCLUDE_FILE   Specify the ELF file to exclude (e.g. libmax.so) 
 -L, --custom-library-path PATH  Use PATH instead of the default path such as /usr/lib
 --section-headers               Emit section headers
---check-output                  Check the output using sold itself
+--debug-file FILE               Write merged DWARF and .symtab to FILE and link it by .gnu_debuglink (implies --section-headers)
+--no-build-id                   Do not emit .note.gnu.build-id
+--check-output                  Check the structure of the output
+--time-init                     Measure constructors of each input library; see sold_init_timings and SOLD_TIME_INIT
 --exclude-from-fini             Do not use .fini_array of the ELF file
+--time-report                   Print wall time, CPU time and peak RSS of each phase
+--trace-json FILE               Write a Chrome trace event file of each phase and library to FILE
+--map FILE                      Write where each input segment landed in the output to FILE
+--map-format FORMAT             Format of --map: json (default) or tsv
+--reloc-report                  Print relocations before and after linking and symbols left for ld.so
+--reloc-report-top N            Show the N most referenced external symbols in --reloc-report (default: 20)
+--size-report                   Print output bytes, mapped bytes, TLS, symbols, relocations and padding of each input library
+--size-report-top N             Show the N largest symbols in --size-report (default: 20)
+--page-report                   Print pages which relocations dirty per input library, PT_LOAD and relocation type
+--page-report-top N             Show the N PT_LOADs with the most dirty pages in --page-report (default: 20)
 
 The last argument is interpreted as SOURCE_FILE when -i option isn't given.
 )" << std::endl;
 }
 
+// Parses a non-negative decimal count of option, e.g. --reloc-report-top.
+// Prints an error and the help message when arg is not one.
+bool parse_count(const char* option, const char* arg, size_t* count) {
+    char* end;
+    errno = 0;
+    const unsigned long long n = strtoull(arg, &end, 10);
+    if (arg[0] < '0' || arg[0] > '9' || *end != '\0' || errno == ERANGE) {
+        std::cerr << "Invalid " << option << ": " << arg << std::endl;
+        print_help(std::cerr);
+        return false;
+    }
+    *count = n;
+    return true;
+}
+
 int main(int argc, char* const argv[]) {
     google::InitGoogleLogging(argv[0]);
 
@@ -45,6 +79,19 @@ int main(int argc, char* const argv[]) {
         {"section-headers", no_argument, nullptr, 1},
         {"check-output", no_argument, nullptr, 2},
         {"exclude-from-fini", required_argument, nullptr, 3},
+        {"time-report", no_argument, nullptr, 4},
+        {"trace-json", required_argument, nullptr, 5},
+        {"reloc-report", no_argument, nullptr, 6},
+        {"reloc-report-top", required_argument, nullptr, 7},
+        {"map", required_argument, nullptr, 8},
+        {"map-format", required_argument, nullptr, 9},
+        {"debug-file", required_argument, nullptr, 10},
+        {"no-build-id", no_argument, nullptr, 11},
+        {"size-report", no_argument, nullptr, 12},
+        {"size-report-top", required_argument, nullptr, 13},
+        {"page-report", no_argument, nullptr, 14},
+        {"page-report-top", required_argument, nullptr, 15},
+        {"time-init", no_argument, nullptr, 16},
         {0, 0, 0, 0},
     };
 
@@ -55,6 +102,19 @@ int main(int argc, char* const argv[]) {
     std::vector<std::string> custome_library_path;
     bool emit_section_header = false;
     bool check_output = false;
+    bool time_report = false;
+    std::string trace_json;
+    bool reloc_report = false;
+    size_t reloc_report_top = 20;
+    bool size_report = false;
+    size_t size_report_top = 20;
+    bool page_report = false;
+    size_t page_report_top = 20;
+    std::string map_file;
+    std::string map_format = "json";
+    std::string debug_file;
+    bool build_id = true;
+    bool time_init = false;
 
     int opt;
     while ((opt = getopt_long(argc, argv, "hi:o:e:", long_options, nullptr)) != -1) {
@@ -68,6 +128,50 @@ int main(int argc, char* const argv[]) {
             case 3:
                 exclude_finis.push_back(optarg);
                 break;
+            case 4:
+                time_report = true;
+                break;
+            case 5:
+                trace_json = optarg;
+                break;
+            case 6:
+                reloc_report = true;
+                break;
+            case 7:
+                if (!parse_count("--reloc-report-top", optarg, &reloc_report_top)) return 1;
+                break;
+            case 8:
+                map_file = optarg;
+                break;
+            case 9:
+                map_format = optarg;
+                if (map_format != "json" && map_format != "tsv") {
+                    std::cerr << "Unknown --map-format: " << map_format << std::endl;
+                    return 1;
+                }
+                break;
+            case 10:
+                debug_file = optarg;
+                emit_section_header = true;
+                break;
+            case 11:
+                build_id = false;
+                break;
+            case 12:
+                size_report = true;
+                break;
+            case 13:
+                if (!parse_count("--size-report-top", optarg, &size_report_top)) return 1;
+                break;
+            case 14:
+                page_report = true;
+                break;
+            case 15:
+                if (!parse_count("--page-report-top", optarg, &page_report_top)) return 1;
+                break;
+            case 16:
+                time_init = true;
+                break;
             case 'e':
                 exclude_sos.push_back(optarg);
                 break;
@@ -98,14 +202,50 @@ int main(int argc, char* const argv[]) {
         return 1;
     }
 
-    Sold sold(input_file, exclude_sos, exclude_finis, custome_library_path, emit_section_header);
-    sold.Link(output_file);
+    if (time_report || !trace_json.empty()) {
+        Tracer::Get().Enable();
+    }
 
+    {
+        TraceSpan span("Total");
+        Sold sold(input_file, exclude_sos, exclude_finis, custome_library_path, emit_section_header);
+        if (reloc_report) sold.EnableRelocReport();
+        if (!build_id) sold.DisableBuildId();
+        if (!debug_file.empty()) sold.EnableDebugFile(debug_file);
+        if (time_init) sold.EnableTimeInit();
+        sold.Link(output_file);
+        if (reloc_report) sold.PrintRelocReport(std::cout, reloc_report_top);
+        if (size_report) sold.GetSizeReport().Print(std::cout, size_report_top);
+        if (page_report) sold.GetPageReport().Print(std::cout, page_report_top);
+        if (!map_file.empty()) {
+            std::ofstream ofs(map_file);
+            CHECK(ofs) << "Failed to open " << map_file;
+            const LinkMap map = sold.GetLinkMap(output_file);
+            if (map_format == "json") {
+                map.WriteJSON(ofs);
+            } else {
+                map.WriteTSV(ofs);
+            }
+        }
+    }
+
+    bool output_ok = true;
     if (check_output) {
-        std::string dummy = output_file + ".dummy-for-check-output";
-        Sold check(output_file, exclude_sos, exclude_finis, custome_library_path, emit_section_header);
-        check.Link(dummy);
-        std::remove(dummy.c_str());
+        TraceSpan span("CheckOutput");
+        const std::vector<std::string> errors = VerifyOutput(output_file);
+        for (const std::string& e : errors) {
+            std::cerr << output_file << ": " << e << std::endl;
+        }
+        output_ok = errors.empty();
+    }
+
+    if (time_report) {
+        Tracer::Get().PrintReport(std::cout);
+    }
+    if (!trace_json.empty()) {
+        std::ofstream ofs(trace_json);
+        CHECK(ofs) << "Failed to open " << trace_json;
+        Tracer::Get().WriteChromeTrace(ofs);
     }
-    return 0;
+    return output_ok ? 0 : 1;
 }
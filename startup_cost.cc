@@ -0,0 +1,173 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "startup_cost.h"
+
+#include <set>
+#include <unordered_map>
+
+namespace {
+
+constexpr uintptr_t kPageSize = 4096;
+
+// Same as elf_machine_type_class of glibc, which keys the lookup cache
+// together with the symbol.
+int TypeClass(uint16_t machine, int type) {
+    if (machine == EM_X86_64) {
+        switch (type) {
+            case R_X86_64_JUMP_SLOT:
+            case R_X86_64_DTPMOD64:
+            case R_X86_64_DTPOFF64:
+            case R_X86_64_TPOFF64:
+            case R_X86_64_TLSDESC:
+                return 1;
+            case R_X86_64_COPY:
+                return 2;
+        }
+    } else if (machine == EM_AARCH64) {
+        switch (type) {
+            case R_AARCH64_JUMP_SLOT:
+            case R_AARCH64_TLS_DTPMOD:
+            case R_AARCH64_TLS_DTPREL:
+            case R_AARCH64_TLS_TPREL:
+            case R_AARCH64_TLSDESC:
+                return 1;
+            case R_AARCH64_COPY:
+                return 2;
+        }
+    }
+    return 0;
+}
+
+bool IsRelativeType(uint16_t machine, int type) {
+    return (machine == EM_X86_64 && type == R_X86_64_RELATIVE) || (machine == EM_AARCH64 && type == R_AARCH64_RELATIVE);
+}
+
+size_t CountMmaps(const ELFBinary& bin) {
+    size_t n = 0;
+    for (const Elf_Phdr* phdr : bin.loads()) {
+        n++;
+        // ld.so maps anonymous pages for .bss beyond the last file page.
+        const uintptr_t file_end = (phdr->p_vaddr + phdr->p_filesz + kPageSize - 1) / kPageSize;
+        const uintptr_t mem_end = (phdr->p_vaddr + phdr->p_memsz + kPageSize - 1) / kPageSize;
+        if (mem_end > file_end) n++;
+    }
+    return n;
+}
+
+class CostEstimator {
+public:
+    explicit CostEstimator(const std::vector<const ELFBinary*>& scope) : scope_(scope) {}
+
+    StartupCost Estimate(const ELFBinary& bin) {
+        StartupCost cost;
+        cost.name = bin.name().empty() ? bin.filename() : bin.name();
+        cost.mmaps = CountMmaps(bin);
+        cost.init_functions = bin.init_array().size() + (bin.init() ? 1 : 0);
+
+        std::set<uintptr_t> pages;
+        // The lookup cache of ld.so keeps the last symbol and its type class.
+        uint32_t cached_sym = 0;
+        int cached_class = -1;
+        const uint16_t machine = bin.ehdr()->e_machine;
+        for (const auto& rels : {std::make_pair(bin.rel(), bin.num_rels()), std::make_pair(bin.plt_rel(), bin.num_plt_rels())}) {
+            for (size_t i = 0; i < rels.second; ++i) {
+                const Elf_Rel& rel = rels.first[i];
+                const int type = ELF_R_TYPE(rel.r_info);
+                const uint32_t sym_index = ELF_R_SYM(rel.r_info);
+                cost.relocations++;
+                pages.insert(rel.r_offset / kPageSize);
+                if (IsRelativeType(machine, type)) cost.relative_relocations++;
+
+                if (sym_index == 0) continue;
+                const Elf_Sym& sym = bin.symtab()[sym_index];
+                if (ELF_ST_BIND(sym.st_info) == STB_LOCAL) continue;
+                const int type_class = TypeClass(machine, type);
+                if (sym_index == cached_sym && type_class == cached_class) {
+                    cost.lookup_cache_hits++;
+                    continue;
+                }
+                cached_sym = sym_index;
+                cached_class = type_class;
+                cost.symbol_lookups++;
+                Lookup(bin.Str(sym.st_name), &cost);
+            }
+        }
+        cost.dirty_pages = pages.size();
+        return cost;
+    }
+
+private:
+    struct Provider {
+        size_t position;
+        double probes;
+    };
+
+    // Searches scope_ for name like ld.so does.
+    void Lookup(const std::string& name, StartupCost* cost) {
+        auto found = providers_.find(name);
+        if (found == providers_.end()) {
+            Provider p{scope_.size(), 0};
+            for (size_t i = 0; i < scope_.size(); ++i) {
+                if (scope_[i]->DefinesSymbol(name)) {
+                    p = Provider{i, ChainLength(scope_[i])};
+                    break;
+                }
+            }
+            found = providers_.emplace(name, p).first;
+        }
+        cost->scope_objects_searched += found->second.position;
+        cost->hash_probes += found->second.probes;
+    }
+
+    double ChainLength(const ELFBinary* bin) {
+        auto found = chain_lengths_.find(bin);
+        if (found != chain_lengths_.end()) return found->second;
+        return chain_lengths_[bin] = ExpectedHashChainLength(*bin);
+    }
+
+    const std::vector<const ELFBinary*>& scope_;
+    std::unordered_map<std::string, Provider> providers_;
+    std::unordered_map<const ELFBinary*, double> chain_lengths_;
+};
+
+}  // namespace
+
+void StartupCost::Add(const StartupCost& c) {
+    relocations += c.relocations;
+    relative_relocations += c.relative_relocations;
+    symbol_lookups += c.symbol_lookups;
+    lookup_cache_hits += c.lookup_cache_hits;
+    scope_objects_searched += c.scope_objects_searched;
+    hash_probes += c.hash_probes;
+    dirty_pages += c.dirty_pages;
+    mmaps += c.mmaps;
+    init_functions += c.init_functions;
+}
+
+double ExpectedHashChainLength(const ELFBinary& bin) {
+    if (const Elf_GnuHash* gnu_hash = bin.gnu_hash()) return CollectHashChainStats(*gnu_hash).AverageSuccessfulProbes();
+    if (const Elf_Hash* hash = bin.hash()) return CollectHashChainStats(*hash).AverageSuccessfulProbes();
+    return 0;
+}
+
+std::vector<StartupCost> EstimateStartupCost(const std::vector<const ELFBinary*>& scope) {
+    CostEstimator estimator(scope);
+    std::vector<StartupCost> costs;
+    for (const ELFBinary* bin : scope) {
+        costs.push_back(estimator.Estimate(*bin));
+    }
+    return costs;
+}
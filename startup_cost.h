@@ -0,0 +1,59 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "elf_binary.h"
+
+// StartupCost estimates the work of ld.so to load an object without running
+// it. All relocations are counted as if they were bound at startup, i.e.
+// RTLD_NOW or LD_BIND_NOW.
+struct StartupCost {
+    std::string name;
+    size_t relocations{0};
+    size_t relative_relocations{0};
+    // Relocations which need a symbol lookup, excluding those which hit the
+    // one-entry lookup cache of ld.so.
+    size_t symbol_lookups{0};
+    size_t lookup_cache_hits{0};
+    // Objects in the lookup scope whose hash tables were checked before the
+    // one defining the symbol. Most of them are rejected by bloom filters.
+    size_t scope_objects_searched{0};
+    // The sum of the expected hash chain positions of symbols in their
+    // providers. Lookups of undefined symbols count nothing.
+    double hash_probes{0};
+    // Pages written by relocations.
+    size_t dirty_pages{0};
+    // mmap calls to map PT_LOADs and zero-filled pages of .bss.
+    size_t mmaps{0};
+    // DT_INIT and entries of DT_INIT_ARRAY.
+    size_t init_functions{0};
+
+    void Add(const StartupCost& c);
+};
+
+// Returns the expected number of hash values compared to find a symbol in
+// the DT_GNU_HASH or DT_HASH table of bin, averaged over its symbols.
+double ExpectedHashChainLength(const ELFBinary& bin);
+
+// Estimates the cost of each object in scope, which must be in the order
+// of the global lookup scope of ld.so, i.e. the main object and then its
+// dependencies in breadth-first order.
+std::vector<StartupCost> EstimateStartupCost(const std::vector<const ELFBinary*>& scope);
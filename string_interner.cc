@@ -0,0 +1,85 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "string_interner.h"
+
+#include <string.h>
+
+#include <deque>
+#include <unordered_map>
+
+#include "hash.h"
+#include "utils.h"
+
+namespace {
+
+class StringInterner {
+public:
+    StringInterner() { CHECK(Intern("", 0) == EMPTY_STR_ID); }
+
+    // Looking up an already interned string does not allocate memory.
+    StrId Intern(const char* s, size_t len) {
+        auto found = ids_.find(Key{s, len});
+        if (found != ids_.end()) {
+            return found->second;
+        }
+        StrId id = strs_.size();
+        // std::deque never moves its elements, so keys can point to them.
+        strs_.emplace_back(s, len);
+        CHECK(ids_.emplace(Key{strs_.back().data(), len}, id).second);
+        return id;
+    }
+
+    const std::string& Get(StrId id) const {
+        CHECK(id < strs_.size()) << SOLD_LOG_KEY(id);
+        return strs_[id];
+    }
+
+private:
+    struct Key {
+        const char* str;
+        size_t len;
+
+        bool operator==(const Key& k) const { return len == k.len && memcmp(str, k.str, len) == 0; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& k) const { return CalcGnuHash(k.str, k.len); }
+    };
+
+    std::unordered_map<Key, StrId, KeyHash> ids_;
+    std::deque<std::string> strs_;
+};
+
+StringInterner& GetInterner() {
+    static StringInterner interner;
+    return interner;
+}
+
+}  // namespace
+
+StrId InternString(const char* s) {
+    if (*s == '\0') return EMPTY_STR_ID;
+    return GetInterner().Intern(s, strlen(s));
+}
+
+StrId InternString(const std::string& s) {
+    if (s.empty()) return EMPTY_STR_ID;
+    return GetInterner().Intern(s.data(), s.size());
+}
+
+const std::string& InternedString(StrId id) {
+    return GetInterner().Get(id);
+}
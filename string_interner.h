@@ -0,0 +1,37 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+// Sonames and version names are shared by thousands of symbols, so we keep
+// one copy of each of them and refer to it with a StrId. The same string
+// always gets the same StrId for the lifetime of the process, which lets us
+// compare and hash StrIds instead of strings. The table is process-wide
+// rather than owned by Sold so that free functions such as
+// operator<<(Syminfo) can turn StrIds back into strings.
+typedef uint32_t StrId;
+
+// InternString("") always returns EMPTY_STR_ID.
+static constexpr StrId EMPTY_STR_ID = 0;
+
+StrId InternString(const char* s);
+
+StrId InternString(const std::string& s);
+
+const std::string& InternedString(StrId id);
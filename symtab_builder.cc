@@ -19,35 +19,35 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
-#include <set>
 
 SymtabBuilder::SymtabBuilder() {
     Syminfo si;
     si.name = "";
-    si.soname = "";
-    si.version = "";
+    si.key = SymbolKey::Make("", EMPTY_STR_ID, EMPTY_STR_ID);
     si.versym = VER_NDX_LOCAL;
     si.sym = NULL;
 
     Symbol sym{};
 
     AddSym(si);
-    CHECK(syms_.emplace(std::make_tuple("", "", ""), sym).second);
+    CHECK(syms_.Insert(si.key, sym).second);
 }
 
-void SymtabBuilder::SetSrcSyms(std::vector<Syminfo> syms) {
+void SymtabBuilder::SetSrcSyms(const std::vector<Syminfo>& syms) {
+    src_syms_.reserve(syms.size());
+    src_fallback_syms_.reserve(syms.size());
     for (const auto& s : syms) {
-        auto found = src_syms_.find({s.name, s.soname, s.version});
+        auto found = src_syms_.Find(s.key);
         // TODO(akirakawata) Do we need this if? LoadDynSymtab should returns
-        // unique symbols therefore found == src_syms_.end() is true always.
-        if (found == src_syms_.end() || found->second.second == NULL || !IsDefined(*found->second.second)) {
-            src_syms_[{s.name, s.soname, s.version}] = {s.versym, s.sym};
+        // unique symbols therefore found == nullptr is true always.
+        if (found == nullptr || found->second == NULL || !IsDefined(*found->second)) {
+            src_syms_[s.key] = {s.versym, s.sym};
         }
 
-        auto found_fallback = src_fallback_syms_.find(s.name);
-        if ((s.versym & VERSYM_HIDDEN) == 0 && (found_fallback == src_fallback_syms_.end() || found_fallback->second.second == NULL ||
-                                                !IsDefined(*found_fallback->second.second))) {
-            src_fallback_syms_[s.name] = {s.versym, s.sym};
+        auto found_fallback = src_fallback_syms_.Find(s.key.name);
+        if ((s.versym & VERSYM_HIDDEN) == 0 &&
+            (found_fallback == nullptr || found_fallback->second == NULL || !IsDefined(*found_fallback->second))) {
+            src_fallback_syms_[s.key.name] = {s.versym, s.sym};
         }
     }
 }
@@ -58,13 +58,27 @@ uintptr_t SymtabBuilder::AddSym(const Syminfo& sym) {
     return index;
 }
 
+// Returns (Versym, Sym*) of the source symbol for key. When there is no
+// symbol with the exact version, returns the fallback one with the same name.
+const std::pair<Elf_Versym, Elf_Sym*>* SymtabBuilder::FindSrcSym(const SymbolKey& key) const {
+    auto found = src_syms_.Find(key);
+    if (found != nullptr) {
+        return found;
+    }
+    auto found_fallback = src_fallback_syms_.Find(key.name);
+    if (found_fallback != nullptr) {
+        LOG(INFO) << "Use fallback version of " << key.name.str;
+    }
+    return found_fallback;
+}
+
 // Returns and fills st_value to value_or_index true when the symbol specified
 // with (name, soname, version) is defined.
 // When the specified symbol is not defined, SymtabBuilder::Resolve pushes it
 // to sym_ and exposed_syms_ and fills the index of the added symbol to
 // val_or_index.
 // TODO(akawashiro) Rename syms_.
-bool SymtabBuilder::Resolve(const std::string& name, const std::string& soname, const std::string version, uintptr_t& val_or_index) {
+bool SymtabBuilder::Resolve(const SymbolKey& key, uintptr_t& val_or_index) {
     Symbol sym{};
     sym.sym.st_name = 0;
     sym.sym.st_info = 0;
@@ -73,26 +87,21 @@ bool SymtabBuilder::Resolve(const std::string& name, const std::string& soname,
     sym.sym.st_value = 0;
     sym.sym.st_size = 0;
 
-    auto found = syms_.find({name, soname, version});
-    if (found != syms_.end()) {
-        sym = found->second;
+    const char* name = key.name.str;
+    const std::string& soname = InternedString(key.soname);
+    const std::string& version = InternedString(key.version);
+
+    auto found = syms_.Find(key);
+    if (found != nullptr) {
+        sym = *found;
     } else {
         Elf_Versym versym = 0;
         Elf_Sym* symp = nullptr;
 
-        {
-            auto found = src_syms_.find({name, soname, version});
-            if (found != src_syms_.end()) {
-                versym = found->second.first;
-                symp = found->second.second;
-            } else {
-                auto found_fallback = src_fallback_syms_.find(name);
-                if (found_fallback != src_fallback_syms_.end()) {
-                    LOG(INFO) << "Use fallback version of " << name;
-                    versym = found_fallback->second.first;
-                    symp = found_fallback->second.second;
-                }
-            }
+        auto found_src = FindSrcSym(key);
+        if (found_src != nullptr) {
+            versym = found_src->first;
+            symp = found_src->second;
         }
 
         if (symp != nullptr) {
@@ -101,15 +110,15 @@ bool SymtabBuilder::Resolve(const std::string& name, const std::string& soname,
                 LOG(INFO) << "Symbol (" << name << ", " << soname << ", " << version << ") found";
             } else {
                 LOG(INFO) << "Symbol (undef/weak) (" << name << ", " << soname << ", " << version << ") found";
-                Syminfo s{name, soname, version, versym, NULL};
+                Syminfo s{name, key, versym, NULL};
                 sym.index = AddSym(s);
-                CHECK(syms_.emplace(std::make_tuple(name, soname, version), sym).second);
+                CHECK(syms_.Insert(key, sym).second);
             }
         } else {
             LOG(INFO) << "Symbol (" << name << ", " << soname << ", " << version << ") not found";
-            Syminfo s{name, soname, version, VER_NDX_LOCAL, NULL};
+            Syminfo s{name, key, VER_NDX_LOCAL, NULL};
             sym.index = AddSym(s);
-            CHECK(syms_.emplace(std::make_tuple(name, soname, version), sym).second);
+            CHECK(syms_.Insert(key, sym).second);
         }
     }
 
@@ -123,7 +132,7 @@ bool SymtabBuilder::Resolve(const std::string& name, const std::string& soname,
 }
 
 // Returns the index of symbol(name, soname, version)
-uintptr_t SymtabBuilder::ResolveCopy(const std::string& name, const std::string& soname, const std::string version) {
+uintptr_t SymtabBuilder::ResolveCopy(const SymbolKey& key) {
     // TODO(hamaji): Refactor.
     Symbol sym{};
     sym.sym.st_name = 0;
@@ -133,34 +142,27 @@ uintptr_t SymtabBuilder::ResolveCopy(const std::string& name, const std::string&
     sym.sym.st_value = 0;
     sym.sym.st_size = 0;
 
-    auto found = syms_.find({name, soname, version});
-    if (found != syms_.end()) {
-        sym = found->second;
+    const char* name = key.name.str;
+
+    auto found = syms_.Find(key);
+    if (found != nullptr) {
+        sym = *found;
     } else {
         Elf_Versym versym = 0;
         Elf_Sym* symp = nullptr;
 
-        {
-            auto found = src_syms_.find({name, soname, version});
-            if (found != src_syms_.end()) {
-                versym = found->second.first;
-                symp = found->second.second;
-            } else {
-                auto found_fallback = src_fallback_syms_.find(name);
-                if (found_fallback != src_fallback_syms_.end()) {
-                    LOG(INFO) << "Use fallback version of " << name;
-                    versym = found_fallback->second.first;
-                    symp = found_fallback->second.second;
-                }
-            }
+        auto found_src = FindSrcSym(key);
+        if (found_src != nullptr) {
+            versym = found_src->first;
+            symp = found_src->second;
         }
 
         if (symp != nullptr) {
             LOG(INFO) << "Symbol " << name << " found for copy";
             sym.sym = *symp;
-            Syminfo s{name, soname, version, versym, NULL};
+            Syminfo s{name, key, versym, NULL};
             sym.index = AddSym(s);
-            CHECK(syms_.emplace(std::make_tuple(name, soname, version), sym).second);
+            CHECK(syms_.Insert(key, sym).second);
         } else {
             LOG(INFO) << "Symbol " << name << " not found for copy";
             CHECK(false);
@@ -175,9 +177,9 @@ void SymtabBuilder::Build(StrtabBuilder& strtab, VersionBuilder& version) {
     for (const Syminfo& s : exposed_syms_) {
         LOG(INFO) << "SymtabBuilder::Build " << SOLD_LOG_KEY(s);
 
-        auto found = syms_.find({s.name, s.soname, s.version});
-        CHECK(found != syms_.end());
-        Elf_Sym sym = found->second.sym;
+        auto found = syms_.Find(s.key);
+        CHECK(found != nullptr);
+        Elf_Sym sym = found->sym;
         sym.st_name = strtab.Add(s.name);
         // TODO(akawashiro)
         // I fill st_shndx with a dummy value which is not special section index.
@@ -185,7 +187,7 @@ void SymtabBuilder::Build(StrtabBuilder& strtab, VersionBuilder& version) {
         if (sym.st_shndx != SHN_UNDEF && sym.st_shndx < SHN_LORESERVE) sym.st_shndx = 1;
         symtab_.push_back(sym);
 
-        version.Add(s.versym, s.soname, s.version, strtab, sym.st_info);
+        version.Add(s.versym, s.key.soname, s.key.version, strtab, sym.st_info);
     }
 }
 
@@ -204,31 +206,29 @@ void SymtabBuilder::MergePublicSymbols(StrtabBuilder& strtab, VersionBuilder& ve
     gnu_hash_.shift2 = 1;
 
     // exposed_sym_name_vers is used to avoid duplicated symbol
-    std::set<std::tuple<std::string, std::string, std::string>> exposed_sym_name_vers;
+    OpenHashMap<SymbolKey, bool, SymbolKeyHash> exposed_sym_name_vers(exposed_syms_.size() + public_syms_.size());
     for (const Syminfo& s : exposed_syms_) {
-        CHECK(exposed_sym_name_vers.insert({s.name, s.soname, s.version}).second) << SOLD_LOG_KEY(s.name);
+        CHECK(exposed_sym_name_vers.Insert(s.key, true).second) << SOLD_LOG_KEY(s.name);
     }
 
     for (const auto& p : public_syms_) {
         LOG(INFO) << "SymtabBuilder::MergePublicSymbols " << p.name;
 
-        const std::string& name = p.name;
-        Elf_Sym* sym = new Elf_Sym;
-        *sym = *p.sym;
-        sym->st_name = strtab.Add(name);
+        if (!exposed_sym_name_vers.Insert(p.key, true).second) continue;
+
+        synthesized_syms_.push_back(*p.sym);
+        Elf_Sym* sym = &synthesized_syms_.back();
+        sym->st_name = strtab.Add(p.name);
         // TODO(akawashiro)
         // I fill st_shndx with a dummy value which is not special section index.
         // After I make complete section headers, I should fill it with the right section index.
         sym->st_shndx = 1;
 
-        Syminfo s{p.name, p.soname, p.version, p.versym, sym};
-
-        if (exposed_sym_name_vers.insert({s.name, s.soname, s.version}).second) {
-            exposed_syms_.push_back(s);
-            symtab_.push_back(*sym);
+        Syminfo s{p.name, p.key, p.versym, sym};
+        exposed_syms_.push_back(s);
+        symtab_.push_back(*sym);
 
-            version.Add(s.versym, s.soname, s.version, strtab, sym->st_info);
-        }
+        version.Add(s.versym, s.key.soname, s.key.version, strtab, sym->st_info);
     }
     public_syms_.clear();
 }
@@ -239,3 +239,9 @@ uintptr_t SymtabBuilder::GnuHashSize() const {
     CHECK(gnu_hash_.nbuckets);
     return (sizeof(uint32_t) * 4 + sizeof(Elf_Addr) + sizeof(uint32_t) * (1 + symtab_.size() - gnu_hash_.symndx));
 }
+
+void SymtabBuilder::SetSectionIndices(const std::function<Elf_Half(const Elf_Sym&)>& section_index) {
+    for (Elf_Sym& sym : symtab_) {
+        if (sym.st_shndx != SHN_UNDEF && sym.st_shndx < SHN_LORESERVE) sym.st_shndx = section_index(sym);
+    }
+}
@@ -15,11 +15,13 @@
 
 #pragma once
 
-#include <map>
+#include <deque>
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "hash.h"
+#include "hash_table.h"
 #include "strtab_builder.h"
 #include "utils.h"
 #include "version_builder.h"
@@ -28,17 +30,23 @@ class SymtabBuilder {
 public:
     SymtabBuilder();
 
-    void SetSrcSyms(std::vector<Syminfo> syms);
+    void SetSrcSyms(const std::vector<Syminfo>& syms);
 
-    bool Resolve(const std::string& name, const std::string& filename, const std::string version_name, uintptr_t& val_or_index);
+    bool Resolve(const SymbolKey& key, uintptr_t& val_or_index);
 
-    uintptr_t ResolveCopy(const std::string& name, const std::string& filename, const std::string version_name);
+    uintptr_t ResolveCopy(const SymbolKey& key);
+
+    // Returns true when key was resolved to a symbol which the output defines.
+    bool IsResolvedToDefined(const SymbolKey& key) const {
+        const Symbol* found = syms_.Find(key);
+        return found && IsDefined(found->sym);
+    }
 
     void Build(StrtabBuilder& strtab, VersionBuilder& version);
 
     void MergePublicSymbols(StrtabBuilder& strtab, VersionBuilder& version);
 
-    void AddPublicSymbol(Syminfo s) { public_syms_.push_back(s); }
+    void AddPublicSymbol(const Syminfo& s) { public_syms_.push_back(s); }
 
     uintptr_t size() const { return symtab_.size() + public_syms_.size(); }
 
@@ -46,7 +54,11 @@ public:
 
     uintptr_t GnuHashSize() const;
 
-    const std::vector<Elf_Sym>& Get() { return symtab_; }
+    const std::vector<Elf_Sym>& Get() const { return symtab_; }
+
+    // Replaces the dummy st_shndx of defined symbols with section_index(sym)
+    // once section headers are decided.
+    void SetSectionIndices(const std::function<Elf_Half(const Elf_Sym&)>& section_index);
 
     const std::vector<Syminfo>& GetExposedSyms() const { return exposed_syms_; }
 
@@ -57,17 +69,22 @@ private:
     };
 
     // map from (name, soname, version) to (Versym, Sym*)
-    std::map<std::tuple<std::string, std::string, std::string>, std::pair<Elf_Versym, Elf_Sym*> > src_syms_;
+    OpenHashMap<SymbolKey, std::pair<Elf_Versym, Elf_Sym*>, SymbolKeyHash> src_syms_;
     // map from name to (Versym, Sym*)
     // We use src_fallback_syms_ when we don't have version information.
-    std::map<std::string, std::pair<Elf_Versym, Elf_Sym*> > src_fallback_syms_;
-    std::map<std::tuple<std::string, std::string, std::string>, Symbol> syms_;
+    OpenHashMap<SymbolName, std::pair<Elf_Versym, Elf_Sym*>, SymbolNameHash> src_fallback_syms_;
+    OpenHashMap<SymbolKey, Symbol, SymbolKeyHash> syms_;
 
     std::vector<Syminfo> exposed_syms_;
     std::vector<Elf_Sym> symtab_;
     std::vector<Syminfo> public_syms_;
+    // Arena of Elf_Syms made in MergePublicSymbols. std::deque never moves
+    // its elements, so exposed_syms_ can point to them.
+    std::deque<Elf_Sym> synthesized_syms_;
 
     Elf_GnuHash gnu_hash_;
 
     uintptr_t AddSym(const Syminfo& sym);
+
+    const std::pair<Elf_Versym, Elf_Sym*>* FindSrcSym(const SymbolKey& key) const;
 };
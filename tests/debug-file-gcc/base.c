@@ -0,0 +1,7 @@
+#include "base.h"
+
+__thread int thread_local_i = 3;
+
+int base_add(int a, int b) {
+    return a + b;
+}
@@ -0,0 +1,3 @@
+extern __thread int thread_local_i;
+
+int base_add(int a, int b);
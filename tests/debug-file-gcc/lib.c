@@ -0,0 +1,5 @@
+#include "lib.h"
+
+int return_tls_i() {
+    return thread_local_i + base_add(1, 2);
+}
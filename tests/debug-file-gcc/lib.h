@@ -0,0 +1,3 @@
+#include "base.h"
+
+int return_tls_i();
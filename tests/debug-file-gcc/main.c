@@ -0,0 +1,7 @@
+#include <stdio.h>
+#include "lib.h"
+
+int main() {
+    printf("i = %d\n", return_tls_i());
+    return 0;
+}
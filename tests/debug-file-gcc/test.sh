@@ -0,0 +1,34 @@
+#! /bin/bash -eu
+
+gcc -g -fPIC -c -o lib.o lib.c
+gcc -g -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -Wl,--build-id -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+# base.so keeps its DWARF in a separate file found by .gnu_debuglink.
+objcopy --only-keep-debug original/base.so original/base.so.debug
+objcopy --strip-debug --add-gnu-debuglink=original/base.so.debug original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --debug-file sold_out/lib.so.debug
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+# The output carries a build-id and a debuglink to the debug file, which
+# has the same build-id.
+readelf --string-dump=.gnu_debuglink sold_out/lib.so | grep -q lib.so.debug
+build_id=$(readelf -n sold_out/lib.so | grep 'Build ID' | awk '{print $3}')
+test -n "${build_id}"
+test "${build_id}" = "$(readelf -n sold_out/lib.so.debug | grep 'Build ID' | awk '{print $3}')"
+
+# The build-id depends only on the contents.
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib2.so --debug-file sold_out/lib2.so.debug
+test "${build_id}" != "$(readelf -n sold_out/lib2.so | grep 'Build ID' | awk '{print $3}')"
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --debug-file sold_out/lib.so.debug
+test "${build_id}" = "$(readelf -n sold_out/lib.so | grep 'Build ID' | awk '{print $3}')"
+
+# Functions from both libraries resolve to their sources.
+for fn in return_tls_i base_add; do
+    addr=$(nm sold_out/lib.so.debug | grep " T ${fn}$" | awk '{print $1}')
+    addr2line -e sold_out/lib.so.debug 0x${addr} | grep "\.c:[0-9]" >&2
+done
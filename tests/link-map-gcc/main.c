@@ -0,0 +1,7 @@
+#include <stdio.h>
+#include "lib.h"
+
+int main() {
+    printf("lib_add3(1, 2, 3) = %d\n", lib_add3(1, 2, 3));
+    return 0;
+}
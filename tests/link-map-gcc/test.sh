@@ -0,0 +1,59 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --map map.json
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --map map.tsv --map-format tsv
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+# The executable PT_LOAD of base.so as readelf sees it before and after bundling.
+readelf -lW original/base.so > base.phdrs
+readelf -lW sold_out/lib.so > sold.phdrs
+
+# Both formats list the same segments, and the executable segment of base.so
+# is at the input and output vaddrs readelf reports.
+python3 - <<'PYEOF'
+import json
+
+def exec_vaddrs(phdrs):
+    loads = [l.split() for l in open(phdrs) if l.split()[:1] == ["LOAD"]]
+    return [int(l[2], 16) for l in loads if "E" in "".join(l[6:-1])]
+
+doc = json.load(open("map.json"))
+assert doc["version"] == 1 and doc["output"] == "sold_out/lib.so", doc
+segments = doc["segments"]
+assert {s["soname"] for s in segments} == {"lib.so", "base.so"}, segments
+
+lines = [l for l in open("map.tsv").read().splitlines() if not l.startswith("#")]
+header = lines[0].split("\t")
+rows = [dict(zip(header, l.split("\t"))) for l in lines[1:]]
+loads = [r for r in rows if r["kind"] == "load"]
+keys = ["path", "soname", "input_vaddr", "input_offset", "output_vaddr", "output_offset", "filesz", "memsz", "input_flags"]
+assert [[str(s[k]) for k in keys] for s in segments] == [[r[k] for k in keys] for r in loads], (segments, loads)
+
+PF_X = 1
+text = [s for s in segments if s["soname"] == "base.so" and s["input_flags"] & PF_X]
+assert len(text) == 1, text
+assert exec_vaddrs("base.phdrs") == [text[0]["input_vaddr"]], text
+assert text[0]["output_vaddr"] in exec_vaddrs("sold.phdrs"), text
+with open("base_text.txt", "w") as f:
+    f.write("%d %d\n" % (text[0]["input_vaddr"], text[0]["output_vaddr"]))
+PYEOF
+
+# resolve_addr.py maps an address in a /proc/<pid>/maps of a process which
+# loaded the bundled library back to base.so.
+read input_vaddr output_vaddr < base_text.txt
+load_base=$((0x7f0000000000))
+printf "%x-%x r-xp 00000000 00:00 0 %s\n" ${load_base} $((load_base + 0x20000000)) "$(pwd)/sold_out/lib.so" > maps.txt
+addr=$(printf "0x%x" $((load_base + output_vaddr + 0x10)))
+expected=$(printf "Address in original/base.so: %x" $((input_vaddr + 0x10)))
+for map in map.json map.tsv; do
+    python3 ../../tools/resolve_addr.py ${map} maps.txt ${addr} > resolved.txt
+    cat resolved.txt
+    grep -qx "${expected}" resolved.txt
+done
@@ -0,0 +1,16 @@
+#include "base.h"
+
+char base_bss[BASE_BSS_PAGES * 4096];
+const char base_rodata[BASE_RODATA_PAGES * 4096] = {1};
+
+void touch_base() {
+    const volatile char* rodata = base_rodata;
+    int sum = 0;
+    for (int i = 0; i < BASE_BSS_PAGES; i++) {
+        base_bss[i * 4096] = i;
+    }
+    for (int i = 0; i < BASE_RODATA_PAGES; i++) {
+        sum += rodata[i * 4096];
+    }
+    base_bss[0] = sum;
+}
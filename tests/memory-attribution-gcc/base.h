@@ -0,0 +1,4 @@
+#define BASE_BSS_PAGES 32
+#define BASE_RODATA_PAGES 16
+
+void touch_base();
@@ -0,0 +1,11 @@
+#include "lib.h"
+#include "base.h"
+
+char lib_data[LIB_DATA_PAGES * 4096] = {1};
+
+void touch_lib_data() {
+    for (int i = 0; i < LIB_DATA_PAGES; i++) {
+        lib_data[i * 4096] = i;
+    }
+    touch_base();
+}
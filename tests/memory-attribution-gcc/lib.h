@@ -0,0 +1,3 @@
+#define LIB_DATA_PAGES 64
+
+void touch_lib_data();
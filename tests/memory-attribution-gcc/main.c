@@ -0,0 +1,12 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "lib.h"
+
+// Runs the tool while pages of lib.so are touched.
+int main() {
+    touch_lib_data();
+    char cmd[256];
+    snprintf(cmd, sizeof(cmd), "python3 ../../tools/memory_attribution.py --json sold_out/lib.map.json %d > attribution.json", getpid());
+    return system(cmd) == 0 ? 0 : 1;
+}
@@ -0,0 +1,32 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --map sold_out/lib.map.json
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+cat attribution.json
+
+# Pages written by main.out are private dirty in the segments they came from
+# and pages only read are resident but clean.
+python3 - <<'PYEOF'
+import json
+
+rows = {}
+for row in json.load(open('attribution.json'))['rows']:
+    rows[(row['library'], row['type'])] = row
+
+page = 4096
+assert rows[('original/lib.so', 'data')]['private_dirty'] >= 64 * page
+# The first page of base_bss may share a page with .data.
+assert rows[('original/base.so', 'bss')]['private_dirty'] >= 31 * page
+assert rows[('original/base.so', 'rodata')]['rss'] >= 16 * page
+assert rows[('original/base.so', 'rodata')]['private_dirty'] == 0
+assert rows[('original/lib.so', 'text')]['private_dirty'] == 0
+for row in rows.values():
+    assert row['private_dirty'] <= row['pss'] <= row['rss'], row
+PYEOF
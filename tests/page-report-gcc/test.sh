@@ -0,0 +1,23 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --page-report > page_report.txt
+cat page_report.txt
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+# --page-report counts each page which has a relocation once.
+pages=$(readelf -rW sold_out/lib.so | awk '/^[0-9a-f]+ /{print substr($1, 1, length($1) - 3)}' | sort -u | wc -l)
+grep -q "^Dirty pages: ${pages} of " page_report.txt
+
+# --page-report-top must be a number.
+if ../../build/sold original/lib.so -o sold_out/bad_top.so --page-report-top ten 2> bad_top.txt; then
+    echo "sold accepted --page-report-top ten"
+    exit 1
+fi
+grep -q "^Invalid --page-report-top: ten$" bad_top.txt
@@ -0,0 +1,36 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers
+
+# print_startup_cost prints a line of JSON per file with the cost of each
+# object in the lookup scope and their total.
+LD_LIBRARY_PATH=original ../../build/print_startup_cost original/lib.so sold_out/lib.so > cost.json
+python3 - <<'PYEOF'
+import json
+
+fields = ["relocations", "relative_relocations", "symbol_lookups", "lookup_cache_hits", "scope_objects_searched",
+          "dirty_pages", "mmaps", "init_functions", "hash_probes"]
+original, bundled = [json.loads(line) for line in open("cost.json")]
+assert [o["name"] for o in original["objects"]] == ["lib.so", "base.so"], original
+assert [o["name"] for o in bundled["objects"]] == ["lib.so"], bundled
+for cost in [original, bundled]:
+    for field in fields:
+        assert cost["total"][field] == sum(o[field] for o in cost["objects"]), (field, cost)
+    assert cost["total"]["relocations"] == cost["total"]["relative_relocations"] + cost["total"]["symbol_lookups"], cost
+# ld.so searches one object less for each symbol of the bundled output.
+assert bundled["total"]["scope_objects_searched"] < original["total"]["scope_objects_searched"]
+assert bundled["total"]["hash_probes"] <= original["total"]["hash_probes"]
+PYEOF
+
+# --compare fails only when the second file needs more hash probes.
+LD_LIBRARY_PATH=original ../../build/print_startup_cost --compare original/lib.so sold_out/lib.so > /dev/null
+if LD_LIBRARY_PATH=original ../../build/print_startup_cost --compare sold_out/lib.so original/lib.so > /dev/null 2> compare.txt; then
+    echo "--compare accepted more hash probes"
+    exit 1
+fi
+grep -q "^Bundling does not pay off: " compare.txt
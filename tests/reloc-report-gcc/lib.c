@@ -0,0 +1,8 @@
+#include <stdio.h>
+
+#include "base.h"
+#include "lib.h"
+
+int lib_add3(int a, int b, int c) { return base_add(base_add(a, b), c); }
+
+void lib_print(const char* s) { puts(s); }
@@ -0,0 +1,2 @@
+int lib_add3(int a, int b, int c);
+void lib_print(const char* s);
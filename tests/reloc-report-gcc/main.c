@@ -0,0 +1,9 @@
+#include <stdio.h>
+
+#include "lib.h"
+
+int main() {
+    lib_print("lib_print");
+    printf("lib_add3(1, 2, 3) = %d\n", lib_add3(1, 2, 3));
+    return 0;
+}
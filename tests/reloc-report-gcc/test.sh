@@ -0,0 +1,64 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --reloc-report > reloc_report.txt
+cat reloc_report.txt
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+readelf -rW original/lib.so > lib.relocs
+readelf -rW original/base.so > base.relocs
+readelf -rW sold_out/lib.so > sold.relocs
+
+# The before column is the relocations of each input and the after column sums
+# up to the symbolic relocations of the output. The output has more
+# R_X86_64_RELATIVE for the merged .init_array and .fini_array. The call from
+# lib.so to base_add is resolved to R_X86_64_RELATIVE, and puts is left for
+# ld.so to look up in libc.so.6.
+python3 - <<'PYEOF'
+import collections
+import re
+
+
+def count_types(relocs):
+    types = [l.split()[2] for l in open(relocs) if re.match(r"^[0-9a-f]+ ", l)]
+    return collections.Counter(types)
+
+
+lines = open("reloc_report.txt").read().splitlines()
+assert lines[0].split() == ["library", "type", "before", "after"], lines[0]
+before = collections.defaultdict(collections.Counter)
+after = collections.Counter()
+library = None
+for line in lines[1:lines.index("")]:
+    toks = line.split()
+    if not line.startswith(" "):
+        library = toks.pop(0)
+    before[library][toks[0]] = int(toks[1])
+    after[toks[0]] += int(toks[2])
+assert before == {"lib.so": count_types("lib.relocs"), "base.so": count_types("base.relocs")}, before
+sold = count_types("sold.relocs")
+relative = "R_X86_64_RELATIVE"
+assert after[relative] < sold[relative], (after, sold)
+del after[relative], sold[relative]
+assert after == sold, (after, sold)
+assert before["lib.so"]["R_X86_64_JUMP_SLOT"] - 1 == sold["R_X86_64_JUMP_SLOT"], sold
+
+symbolic = sum(sold.values())
+assert "Symbolic relocations resolved to RELATIVE: 1" in lines, lines
+assert "Symbolic relocations left for ld.so: %d" % symbolic in lines, lines
+assert re.search(r"^libc\.so\.6 +[1-9][0-9]*$", "\n".join(lines), re.M), lines
+assert re.search(r"^puts@GLIBC_[0-9.]+ +libc\.so\.6 +1$", "\n".join(lines), re.M), lines
+PYEOF
+
+# --reloc-report-top must be a number.
+if ../../build/sold original/lib.so -o sold_out/bad_top.so --reloc-report-top ten 2> bad_top.txt; then
+    echo "sold accepted --reloc-report-top ten"
+    exit 1
+fi
+grep -q "^Invalid --reloc-report-top: ten$" bad_top.txt
@@ -0,0 +1,3 @@
+#include "base.h"
+
+int base_add(int a, int b) { return a + b; }
@@ -0,0 +1,3 @@
+#include "lib.h"
+
+int lib_add3(int a, int b, int c) { return base_add(base_add(a, b), c); }
@@ -0,0 +1,26 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --size-report > size_report.txt
+cat size_report.txt
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+# --size-report has a row for each bundled library and accounts for every
+# byte of the output.
+for lib in lib.so base.so; do
+    grep -q "^${lib} " size_report.txt
+done
+grep -q "^Output file bytes: $(stat -c %s sold_out/lib.so)$" size_report.txt
+
+# --size-report-top must be a number.
+if ../../build/sold original/lib.so -o sold_out/bad_top.so --size-report-top ten 2> bad_top.txt; then
+    echo "sold accepted --size-report-top ten"
+    exit 1
+fi
+grep -q "^Invalid --size-report-top: ten$" bad_top.txt
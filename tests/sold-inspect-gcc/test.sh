@@ -0,0 +1,18 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o libmax2.o libmax2.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,libmax.so -Wl,--version-script,libmax2.def -o original/libmax.so libmax2.o
+gcc -Wl,--hash-style=gnu -o original/vertest2 vertest2.c original/libmax.so
+
+LD_LIBRARY_PATH=original ../../build/sold -e libmax.so -o sold_out/vertest2 original/vertest2 --section-headers
+LD_LIBRARY_PATH=original ./sold_out/vertest2
+
+# sold-inspect shows the version required from libmax.so, finds no error in
+# the output and every report is a line of valid JSON.
+../../build/sold-inspect versions sold_out/vertest2 | grep -q "file=libmax.so name=LIBMAX_2.0"
+../../build/sold-inspect verify original/vertest2 sold_out/vertest2 > verify.txt
+grep -q "^# verify sold_out/vertest2$" verify.txt
+[ "$(grep -c "^summary: errors=0$" verify.txt)" = 2 ]
+for command in dynsym relocs tls versions ehframe hash verify; do
+    ../../build/sold-inspect --json ${command} sold_out/vertest2 | python3 -m json.tool > /dev/null
+done
@@ -0,0 +1,7 @@
+#include "libmax2.h"
+#include <stdio.h>
+
+int main(void){
+    printf("max(1, 2, 3) = %d\n", max(1,2,3));
+    return 0;
+}
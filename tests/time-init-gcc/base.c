@@ -0,0 +1,12 @@
+#include <time.h>
+#include "base.h"
+
+static int ready;
+
+__attribute__((constructor)) static void init_base() {
+    struct timespec ts = {0, BASE_INIT_MS * 1000000};
+    nanosleep(&ts, NULL);
+    ready = 1;
+}
+
+int base_ready() { return ready; }
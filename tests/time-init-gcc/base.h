@@ -0,0 +1,3 @@
+#define BASE_INIT_MS 20
+
+int base_ready();
@@ -0,0 +1,8 @@
+#include "base.h"
+#include "lib.h"
+
+static int ready;
+
+__attribute__((constructor)) static void init_lib() { ready = base_ready(); }
+
+int lib_ready() { return ready; }
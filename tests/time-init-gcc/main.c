@@ -0,0 +1,48 @@
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "base.h"
+#include "lib.h"
+
+// The layout of sold_init_timings. See TimeInitBuilder.
+struct Entry {
+    int64_t start_sec, start_nsec, end_sec, end_nsec;
+    uint64_t name_offset, name_size;
+};
+
+struct Timings {
+    uint32_t version;
+    uint32_t count;
+    struct Entry entries[];
+};
+
+static int64_t ns(int64_t sec, int64_t nsec) { return sec * 1000000000 + nsec; }
+
+int main() {
+    if (!lib_ready()) {
+        fprintf(stderr, "constructors ran in a wrong order\n");
+        return 1;
+    }
+
+    // We must not refer sold_init_timings directly because a copy
+    // relocation would copy it before constructors fill it.
+    const struct Timings* timings = dlsym(RTLD_DEFAULT, "sold_init_timings");
+    if (!timings || timings->version != 1 || timings->count != 2) {
+        fprintf(stderr, "unexpected sold_init_timings\n");
+        return 1;
+    }
+
+    // .init_array runs base.so first.
+    const char* names[] = {"base.so", "lib.so"};
+    for (uint32_t i = 0; i < timings->count; i++) {
+        const struct Entry* e = &timings->entries[i];
+        const char* name = (const char*)e + e->name_offset;
+        const int64_t took = ns(e->end_sec, e->end_nsec) - ns(e->start_sec, e->start_nsec);
+        printf("%s %lld\n", name, (long long)took);
+        if (strlen(name) != e->name_size || strcmp(name, names[i]) != 0 || took < 0) return 1;
+        if (i == 0 && took < BASE_INIT_MS * 1000000LL) return 1;
+        if (i > 0 && ns(e->start_sec, e->start_nsec) < ns(e[-1].end_sec, e[-1].end_nsec)) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --time-init
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so -ldl
+LD_LIBRARY_PATH=sold_out ./main.out 2> stderr.txt
+if grep sold: stderr.txt; then
+    echo "sold printed timings without SOLD_TIME_INIT"
+    exit 1
+fi
+
+SOLD_TIME_INIT=1 LD_LIBRARY_PATH=sold_out ./main.out 2> stderr.txt
+cat stderr.txt
+grep -E '^sold: init of base.so took [0-9]+ ns$' stderr.txt
+grep -E '^sold: init of lib.so took [0-9]+ ns$' stderr.txt
@@ -0,0 +1,3 @@
+#include "base.h"
+
+int lib_add3(int a, int b, int c);
@@ -0,0 +1,33 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o lib.o lib.c
+gcc -fPIC -c -o base.o base.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --time-report --trace-json trace.json > time_report.txt
+cat time_report.txt
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+# --time-report has a row for each phase indented by its depth.
+grep -q "^phase  *wall(ms)  *cpu(ms)  *peak RSS(MB)$" time_report.txt
+for phase in Total "  Resolve" "  Link" "    CollectSymbols" "    Relocate" "    Emit"; do
+    grep -q "^${phase}  *[0-9.]*  *[0-9.]*  *[0-9.]*$" time_report.txt
+done
+
+# --trace-json is a Chrome trace with phases and a span for each library.
+python3 - <<'PYEOF'
+import json
+
+events = json.load(open("trace.json"))["traceEvents"]
+names = {e["name"] for e in events}
+for name in ["Total", "Resolve", "Link", "Relocate", "Emit", "Load base.so", "LoadDynSymtab base.so", "RelocateBinary lib.so"]:
+    assert name in names, name
+for e in events:
+    assert e["ph"] == "X" and e["dur"] >= 0 and e["args"]["peak_rss_kb"] > 0, e
+# The peak RSS of a phase never exceeds that of the phases enclosing it.
+total = next(e for e in events if e["name"] == "Total")
+assert all(e["args"]["peak_rss_kb"] <= total["args"]["peak_rss_kb"] for e in events)
+PYEOF
@@ -0,0 +1,12 @@
+#include "base.h"
+
+__thread int base_data = 10;
+__thread int base_bss[BASE_BSS_SIZE];
+
+int get_base_bss(int i) {
+    return base_bss[i];
+}
+
+void set_base_bss(int i, int v) {
+    base_bss[i] = v;
+}
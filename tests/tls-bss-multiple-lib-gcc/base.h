@@ -0,0 +1,7 @@
+#define BASE_BSS_SIZE 1024
+
+extern __thread int base_data;
+extern __thread int base_bss[BASE_BSS_SIZE];
+
+int get_base_bss(int i);
+void set_base_bss(int i, int v);
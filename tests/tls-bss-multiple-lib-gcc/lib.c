@@ -0,0 +1,30 @@
+#include "lib.h"
+
+__thread long lib_data[8] = {20, 21, 22, 23, 24, 25, 26, 27};
+__thread long lib_bss;
+
+long get_lib_bss() {
+    return lib_bss;
+}
+
+void set_lib_bss(long v) {
+    lib_bss = v;
+}
+
+int read_base_data() {
+    return base_data;
+}
+
+int read_base_bss(int i) {
+    return get_base_bss(i);
+}
+
+void write_base_bss(int i, int v) {
+    set_base_bss(i, v);
+}
+
+int sum_base_bss() {
+    int sum = 0;
+    for (int i = 0; i < BASE_BSS_SIZE; i++) sum += base_bss[i];
+    return sum;
+}
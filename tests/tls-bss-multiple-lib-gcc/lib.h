@@ -0,0 +1,11 @@
+#include "base.h"
+
+extern __thread long lib_data[8];
+extern __thread long lib_bss;
+
+long get_lib_bss();
+void set_lib_bss(long v);
+int read_base_data();
+int read_base_bss(int i);
+void write_base_bss(int i, int v);
+int sum_base_bss();
@@ -0,0 +1,48 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "lib.h"
+
+#define EXPECT(cond)                                     \
+    do {                                                 \
+        if (!(cond)) {                                   \
+            fprintf(stderr, "%s failed\n", #cond);       \
+            exit(1);                                     \
+        }                                                \
+    } while (0)
+
+// Checks that .tbss of both libraries starts zero-filled in each thread and
+// that writes to one of them overwrite neither the other nor .tdata. lib_data
+// is larger than the .tbss of lib.so, so lib_bss would overlap base_bss if
+// sold placed it lib_data bytes too far.
+void* check(void* arg) {
+    const int seed = *(int*)arg;
+    EXPECT(get_lib_bss() == 0);
+    EXPECT(sum_base_bss() == 0);
+
+    set_lib_bss(seed * 1000L);
+    for (int i = 0; i < BASE_BSS_SIZE; i++) write_base_bss(i, seed + i);
+    lib_bss += 5;
+
+    EXPECT(lib_bss == seed * 1000L + 5);
+    EXPECT(get_lib_bss() == seed * 1000L + 5);
+    EXPECT(sum_base_bss() == seed * BASE_BSS_SIZE + BASE_BSS_SIZE * (BASE_BSS_SIZE - 1) / 2);
+    EXPECT(read_base_bss(BASE_BSS_SIZE - 1) == seed + BASE_BSS_SIZE - 1);
+    EXPECT(lib_data[0] == 20 && lib_data[7] == 27);
+    EXPECT(read_base_data() == 10);
+    return NULL;
+}
+
+int main() {
+    int seeds[2] = {1, 2};
+    check(&seeds[0]);
+
+    pthread_t thread;
+    EXPECT(pthread_create(&thread, NULL, check, &seeds[1]) == 0);
+    EXPECT(pthread_join(thread, NULL) == 0);
+
+    EXPECT(get_lib_bss() == 1005L);
+    EXPECT(read_base_bss(0) == 1);
+    printf("OK\n");
+    return 0;
+}
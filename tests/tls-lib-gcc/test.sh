@@ -11,7 +11,22 @@ gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o answer/lib.so lib.o base.
 # LD_LIBRARY_PATH=original ./main.out
 
 LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers --check-output
- 
+
+# Each input has its own .text and .data, and .tbss of base.so lies in PT_TLS.
+readelf -SW sold_out/lib.so > sections.txt
+test $(grep -c " \.text  *PROGBITS " sections.txt) -eq 2
+test $(grep -c " \.data  *PROGBITS " sections.txt) -eq 2
+read tbss_addr tbss_size < <(awk '$2 == ".tbss" {print "0x" $4, "0x" $6}' sections.txt)
+read tls_addr tls_memsz < <(readelf -lW sold_out/lib.so | awk '$1 == "TLS" {print $3, $6}')
+test $((tbss_addr)) -ge $((tls_addr))
+test $((tbss_addr + tbss_size)) -le $((tls_addr + tls_memsz))
+
+# The merged .symtab has symbols of both inputs.
+nm sold_out/lib.so > symbols.txt
+grep -q " T return_tls_i$" symbols.txt
+grep -q " D thread_local_i$" symbols.txt
+grep -q " B thread_local_j$" symbols.txt
+
 LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
 LD_LIBRARY_PATH=sold_out ./main.out
 
@@ -0,0 +1,65 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// The original implementation of TopologicalSort in sold.cc, which works on
+// names with std::list. Each element of nodes is (name, names of neededs).
+// Returns indices of nodes in the sorted order. This is used as the reference
+// of TopologicalSort in topological_sort.h.
+inline std::vector<int> ReferenceTopologicalSort(const std::vector<std::pair<std::string, std::vector<std::string>>>& nodes) {
+    if (nodes.size() < 1) {
+        return {};
+    }
+
+    // The third element of tuple is `seen' variable in glibc/elf/dl-sort-maps.c
+    std::list<std::tuple<std::string, int, int>> buf;
+    for (size_t i = 0; i < nodes.size(); ++i) buf.emplace_back(nodes[i].first, i, 0);
+
+    auto i_it = buf.begin();
+    int n_rest = buf.size();
+    while (1) {
+        std::get<2>(*i_it)++;
+
+        auto k_it = buf.end();
+        k_it--;
+        while (i_it != k_it) {
+            const auto& neededs = nodes[std::get<1>(*k_it)].second;
+            if (std::find(neededs.begin(), neededs.end(), std::get<0>(*i_it)) != neededs.end()) {
+                buf.insert(buf.end(), *i_it);
+                i_it = buf.erase(i_it);
+                if (std::get<2>(*i_it) > n_rest) break;
+
+                goto next;
+            }
+            --k_it;
+        }
+        if (i_it == buf.end() || ++i_it == buf.end()) break;
+        for (auto it = i_it; it != buf.end(); it++) std::get<2>(*it) = 0;
+    next:;
+    }
+
+    std::vector<int> ret;
+    for (const auto& t : buf) ret.emplace_back(std::get<1>(t));
+
+    return ret;
+}
@@ -0,0 +1,94 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Checks that TopologicalSort returns the same order as the original
+// implementation in ReferenceTopologicalSort for random dependency graphs.
+
+#include <iostream>
+#include <random>
+
+#include "topological_sort.h"
+#include "topological_sort_reference.h"
+
+namespace {
+
+// Makes a graph with n nodes. Each edge exists with probability density. When
+// acyclic is true, nodes depend only on nodes with larger IDs like shared
+// objects found in BFS order.
+std::vector<std::vector<int>> MakeGraph(std::mt19937& rng, int n, double density, bool acyclic) {
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    std::vector<std::vector<int>> neededs(n);
+    for (int i = 0; i < n; ++i) {
+        for (int j = acyclic ? i + 1 : 0; j < n; ++j) {
+            if (dist(rng) < density) neededs[i].push_back(j);
+        }
+        // DT_NEEDED may have unknown names and duplicates.
+        if (dist(rng) < 0.1) neededs[i].push_back(n);
+        if (!neededs[i].empty() && dist(rng) < 0.1) neededs[i].push_back(neededs[i].front());
+        std::shuffle(neededs[i].begin(), neededs[i].end(), rng);
+    }
+    return neededs;
+}
+
+bool Check(const std::vector<std::vector<int>>& neededs) {
+    const int n = neededs.size();
+    auto name = [](int i) { return "lib" + std::to_string(i) + ".so"; };
+    std::vector<std::pair<std::string, std::vector<std::string>>> nodes;
+    std::vector<std::vector<int>> known_neededs(n);
+    for (int i = 0; i < n; ++i) {
+        std::vector<std::string> names;
+        for (int d : neededs[i]) {
+            names.push_back(name(d));
+            if (d < n) known_neededs[i].push_back(d);
+        }
+        nodes.emplace_back(name(i), names);
+    }
+
+    const std::vector<int> expected = ReferenceTopologicalSort(nodes);
+    const std::vector<int> actual = TopologicalSort(known_neededs);
+    if (expected == actual) return true;
+
+    std::cerr << "Mismatch for the graph:" << std::endl;
+    for (int i = 0; i < n; ++i) {
+        std::cerr << i << ":";
+        for (int d : neededs[i]) std::cerr << " " << d;
+        std::cerr << std::endl;
+    }
+    std::cerr << "expected:";
+    for (int i : expected) std::cerr << " " << i;
+    std::cerr << std::endl << "actual:";
+    for (int i : actual) std::cerr << " " << i;
+    std::cerr << std::endl;
+    return false;
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> num_nodes(0, 40);
+    std::uniform_real_distribution<double> density(0.0, 0.3);
+
+    int failures = 0;
+    for (int t = 0; t < 3000; ++t) {
+        if (!Check(MakeGraph(rng, num_nodes(rng), density(rng), t % 2 == 0))) failures++;
+    }
+    if (failures) {
+        std::cerr << failures << " cases failed" << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1 @@
+__thread int thread_local_i = 3;
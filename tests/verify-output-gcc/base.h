@@ -0,0 +1 @@
+extern __thread int thread_local_i;
@@ -0,0 +1,75 @@
+#! /bin/bash -eu
+
+gcc -fPIC -c -o base.o base.c
+gcc -fPIC -c -o lib.o lib.c
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,base.so -o original/base.so base.o
+gcc -Wl,--hash-style=gnu -shared -Wl,-soname,lib.so -o original/lib.so lib.o original/base.so
+
+LD_LIBRARY_PATH=original ../../build/sold original/lib.so -o sold_out/lib.so --section-headers
+
+LD_LIBRARY_PATH=sold_out gcc -Wl,--hash-style=gnu -o main.out main.c sold_out/lib.so
+LD_LIBRARY_PATH=sold_out ./main.out
+
+../../build/sold-inspect verify sold_out/lib.so
+
+# sold-inspect verify rejects broken outputs: a bloom filter without the bits
+# of symbols, relocations outside PT_LOADs and a TLS symbol beyond PT_TLS.
+python3 - <<'PYEOF'
+import struct
+
+DT_SYMTAB = 6
+DT_RELA = 7
+DT_RELASZ = 8
+DT_GNU_HASH = 0x6ffffef5
+PT_LOAD = 1
+PT_DYNAMIC = 2
+PT_TLS = 7
+STT_TLS = 6
+
+data = open('sold_out/lib.so', 'rb').read()
+phoff, = struct.unpack_from('<Q', data, 0x20)
+phnum, = struct.unpack_from('<H', data, 0x38)
+phdrs = [struct.unpack_from('<IIQQQQQQ', data, phoff + 56 * i) for i in range(phnum)]
+
+
+def file_offset(vaddr):
+    for p_type, _, offset, p_vaddr, _, filesz, _, _ in phdrs:
+        if p_type == PT_LOAD and p_vaddr <= vaddr < p_vaddr + filesz:
+            return offset + vaddr - p_vaddr
+    raise Exception('%x is not in the file' % vaddr)
+
+
+dynamic = [p for p in phdrs if p[0] == PT_DYNAMIC][0]
+dyns = {}
+for off in range(dynamic[2], dynamic[2] + dynamic[5], 16):
+    tag, val = struct.unpack_from('<qQ', data, off)
+    dyns.setdefault(tag, val)
+tls_memsz = [p for p in phdrs if p[0] == PT_TLS][0][6]
+
+
+def write(name, offsets, value):
+    out = bytearray(data)
+    for offset in offsets:
+        struct.pack_into('<Q', out, offset, value)
+    open('sold_out/' + name, 'wb').write(out)
+
+
+write('bad_bloom.so', [file_offset(dyns[DT_GNU_HASH]) + 16], 0)
+# Every relocation, which are more than the errors listed per check.
+rela = file_offset(dyns[DT_RELA])
+write('bad_reloc.so', range(rela, rela + dyns[DT_RELASZ], 24), 0xdead0000)
+sym = file_offset(dyns[DT_SYMTAB]) + 24
+while data[sym + 4] & 0xf != STT_TLS:
+    sym += 24
+write('bad_tls.so', [sym + 8], tls_memsz)
+PYEOF
+for bad in bad_bloom bad_reloc bad_tls; do
+    if ../../build/sold-inspect verify sold_out/${bad}.so > ${bad}.txt; then
+        echo "sold-inspect verify accepted ${bad}.so"
+        exit 1
+    fi
+done
+grep -q "Bloom filter of .gnu.hash rejects symbol" bad_bloom.txt
+grep -q "at 0x0*DEAD0000 is not in a PT_LOAD" bad_reloc.txt
+grep -q "^summary: errors=$(readelf -rW sold_out/lib.so | awk '/^[0-9a-f]+ /' | wc -l)$" bad_reloc.txt
+grep -q "TLS symbol .* is out of PT_TLS" bad_tls.txt
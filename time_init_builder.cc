@@ -0,0 +1,163 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "time_init_builder.h"
+
+#include "mprotect_builder.h"
+
+constexpr uint32_t TimeInitBuilder::kVersion;
+constexpr uint8_t TimeInitBuilder::report_code_x86_64[];
+constexpr uint8_t TimeInitBuilder::begin_code_x86_64[];
+constexpr uint8_t TimeInitBuilder::end_code_x86_64[];
+constexpr uint8_t TimeInitBuilder::report_code_aarch64[];
+
+namespace {
+
+void Put32(std::vector<uint8_t>& code, size_t pos, uint32_t v) { memcpy(&code[pos], &v, sizeof(v)); }
+
+void PutInsts(std::vector<uint8_t>& code, const std::vector<uint32_t>& insts) {
+    for (uint32_t inst : insts) {
+        const size_t pos = code.size();
+        code.resize(pos + sizeof(inst));
+        Put32(code, pos, inst);
+    }
+}
+
+}  // namespace
+
+uintptr_t TimeInitBuilder::ReportSize() const {
+    if (machine_type_ == EM_X86_64) {
+        return sizeof(report_code_x86_64);
+    } else if (machine_type_ == EM_AARCH64) {
+        return sizeof(report_code_aarch64);
+    }
+    CHECK(false) << SOLD_LOG_KEY(machine_type_) << " is not supported.";
+}
+
+uintptr_t TimeInitBuilder::BeginStubSize() const {
+    if (machine_type_ == EM_X86_64) {
+        return sizeof(begin_code_x86_64);
+    } else if (machine_type_ == EM_AARCH64) {
+        return begin_code_length_aarch64;
+    }
+    CHECK(false) << SOLD_LOG_KEY(machine_type_) << " is not supported.";
+}
+
+uintptr_t TimeInitBuilder::EndStubSize() const {
+    if (machine_type_ == EM_X86_64) {
+        return sizeof(end_code_x86_64);
+    } else if (machine_type_ == EM_AARCH64) {
+        return end_code_length_aarch64;
+    }
+    CHECK(false) << SOLD_LOG_KEY(machine_type_) << " is not supported.";
+}
+
+uintptr_t TimeInitBuilder::DataSize() const {
+    uintptr_t size = EntryOffset(names_.size());
+    for (const std::string& name : names_) {
+        size += name.size() + 1;
+    }
+    return size;
+}
+
+void TimeInitBuilder::EmitCode(FILE* fp, uintptr_t code_offset, uintptr_t data_offset) {
+    std::vector<uint8_t> code;
+    if (machine_type_ == EM_X86_64) {
+        EmitCodeX86_64(code, code_offset, data_offset);
+    } else if (machine_type_ == EM_AARCH64) {
+        EmitCodeAarch64(code, code_offset, data_offset);
+    } else {
+        CHECK(false) << SOLD_LOG_KEY(machine_type_) << " is not supported.";
+    }
+    SOLD_CHECK_EQ(code.size(), CodeSize());
+    WriteBuf(fp, code.data(), code.size());
+}
+
+void TimeInitBuilder::EmitCodeX86_64(std::vector<uint8_t>& code, uintptr_t code_offset, uintptr_t data_offset) {
+    // Displacements of rip-relative operands are from the end of the instruction.
+    auto rel32 = [&](uintptr_t to, size_t operand_pos) {
+        const int64_t rel = static_cast<int64_t>(to) - static_cast<int64_t>(code_offset + operand_pos + 4);
+        CHECK(rel == static_cast<int32_t>(rel)) << SOLD_LOG_BITS(rel);
+        return static_cast<uint32_t>(rel);
+    };
+
+    code.assign(report_code_x86_64, report_code_x86_64 + sizeof(report_code_x86_64));
+    for (size_t i = 0; i < names_.size(); ++i) {
+        const uintptr_t entry = data_offset + EntryOffset(i);
+        LOG(INFO) << "TimeInitBuilder::Emit: " << names_[i] << SOLD_LOG_BITS(entry);
+
+        size_t pos = code.size();
+        SOLD_CHECK_EQ(pos, BeginOffset(i));
+        code.insert(code.end(), begin_code_x86_64, begin_code_x86_64 + sizeof(begin_code_x86_64));
+        Put32(code, pos + begin_addr_offset_x86_64, rel32(entry, pos + begin_addr_offset_x86_64));
+
+        pos = code.size();
+        SOLD_CHECK_EQ(pos, EndOffset(i));
+        code.insert(code.end(), end_code_x86_64, end_code_x86_64 + sizeof(end_code_x86_64));
+        Put32(code, pos + end_addr_offset_x86_64, rel32(entry + 16, pos + end_addr_offset_x86_64));
+        Put32(code, pos + end_report_offset_x86_64, rel32(code_offset, pos + end_report_offset_x86_64));
+    }
+}
+
+void TimeInitBuilder::EmitCodeAarch64(std::vector<uint8_t>& code, uintptr_t code_offset, uintptr_t data_offset) {
+    code.assign(report_code_aarch64, report_code_aarch64 + sizeof(report_code_aarch64));
+    for (size_t i = 0; i < names_.size(); ++i) {
+        const uintptr_t entry = data_offset + EntryOffset(i);
+        LOG(INFO) << "TimeInitBuilder::Emit: " << names_[i] << SOLD_LOG_BITS(entry);
+
+        // 4 is the length of x1 <- entry using 4 movk instructions
+        const uintptr_t begin = code_offset + BeginOffset(i);
+        PutInsts(code, set_immediate_to_register_aarch64(entry - (begin + 4 * 4), 1));
+        PutInsts(code, {
+                           0x10000003,  // adr x3, 0
+                           0x8B030021,  // add x1, x1, x3
+                           0xD2800020,  // mov x0, 1(CLOCK_MONOTONIC)
+                           0xD2800E28,  // mov x8, 113(clock_gettime)
+                           0xD4000001,  // svc 0
+                           0xD65F03C0,  // ret
+                       });
+        SOLD_CHECK_EQ(code.size(), EndOffset(i));
+
+        const uintptr_t end = code_offset + EndOffset(i);
+        PutInsts(code, set_immediate_to_register_aarch64(entry + 16 - (end + 4 * 4), 1));
+        PutInsts(code, {
+                           0x10000003,  // adr x3, 0
+                           0x8B030021,  // add x1, x1, x3
+                           0xD2800020,  // mov x0, 1(CLOCK_MONOTONIC)
+                           0xD2800E28,  // mov x8, 113(clock_gettime)
+                           0xD4000001,  // svc 0
+                           0xD1004020,  // sub x0, x1, 16
+                       });
+        // b report. The report routine is at the beginning of the code.
+        const int64_t to_report = -static_cast<int64_t>(code.size()) / 4;
+        PutInsts(code, {0x14000000 | static_cast<uint32_t>(to_report & 0x3ffffff)});
+    }
+}
+
+void TimeInitBuilder::EmitData(FILE* fp) {
+    Write(fp, kVersion);
+    Write(fp, static_cast<uint32_t>(names_.size()));
+    uint64_t name_offset = EntryOffset(names_.size());
+    for (size_t i = 0; i < names_.size(); ++i) {
+        const int64_t times[4] = {0, 0, 0, 0};
+        WriteBuf(fp, times, sizeof(times));
+        Write(fp, static_cast<uint64_t>(name_offset - EntryOffset(i)));
+        Write(fp, static_cast<uint64_t>(names_[i].size()));
+        name_offset += names_[i].size() + 1;
+    }
+    for (const std::string& name : names_) {
+        WriteBuf(fp, name.c_str(), name.size() + 1);
+    }
+}
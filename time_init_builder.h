@@ -0,0 +1,290 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+// TimeInitBuilder makes the code and the data of Sold::EnableTimeInit. For
+// each library with .init_array, .init_array of the output calls a begin
+// stub, the entries of the library and then an end stub. The stubs read
+// CLOCK_MONOTONIC with the clock_gettime syscall into an entry of the data,
+// which the output exports as sold_init_timings:
+//
+//   uint32_t version;  // 1
+//   uint32_t count;
+//   struct {
+//       int64_t start_sec, start_nsec, end_sec, end_nsec;
+//       // The offset of the NUL-terminated name of the library from this entry.
+//       uint64_t name_offset;
+//       uint64_t name_size;
+//   } entries[count];
+//   char names[];
+//
+// The end stub jumps to the report routine, which writes the time to stderr
+// when the environment has SOLD_TIME_INIT. Functions in .init_array get envp
+// in their third argument, so the routine does not need libc.
+class TimeInitBuilder {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uintptr_t kHeaderSize = 8;
+    static constexpr uintptr_t kEntrySize = 48;
+
+    void SetMachineType(const Elf64_Half machine_type) {
+        CHECK(machine_type == EM_X86_64 || machine_type == EM_AARCH64);
+        machine_type_ = machine_type;
+    }
+
+    // Registers a library in the order of .init_array of the output.
+    void Add(const std::string& name) { names_.emplace_back(name); }
+
+    size_t NumLibraries() const { return names_.size(); }
+
+    uintptr_t CodeSize() const { return ReportSize() + (BeginStubSize() + EndStubSize()) * names_.size(); }
+
+    uintptr_t DataSize() const;
+
+    // The offsets of the stubs of the i-th library from the beginning of the code.
+    uintptr_t BeginOffset(size_t i) const { return ReportSize() + (BeginStubSize() + EndStubSize()) * i; }
+    uintptr_t EndOffset(size_t i) const { return BeginOffset(i) + BeginStubSize(); }
+
+    // code_offset and data_offset are the addresses of the code and the data
+    // in the output.
+    void EmitCode(FILE* fp, uintptr_t code_offset, uintptr_t data_offset);
+
+    void EmitData(FILE* fp);
+
+    // rdi: the entry, rdx: envp
+    //
+    //     test %rdx, %rdx
+    //     jz   done
+    // env_loop:
+    //     mov  (%rdx), %rsi
+    //     test %rsi, %rsi
+    //     jz   done
+    //     add  $8, %rdx
+    //     lea  env_name(%rip), %rcx
+    // cmp_loop:
+    //     movzbl (%rcx), %eax
+    //     test %al, %al
+    //     jz   found
+    //     cmp  (%rsi), %al
+    //     jne  env_loop
+    //     inc  %rcx
+    //     inc  %rsi
+    //     jmp  cmp_loop
+    // found:
+    //     mov  %rdi, %r8
+    //     mov  16(%r8), %rax
+    //     sub  (%r8), %rax
+    //     imul $1000000000, %rax, %rax
+    //     add  24(%r8), %rax
+    //     sub  8(%r8), %rax
+    //     sub  $32, %rsp
+    //     lea  32(%rsp), %rsi
+    //     mov  $10, %ecx
+    // dec_loop:
+    //     xor  %edx, %edx
+    //     div  %rcx
+    //     add  $0x30, %dl
+    //     dec  %rsi
+    //     mov  %dl, (%rsi)
+    //     test %rax, %rax
+    //     jnz  dec_loop
+    //     mov  %rsi, %r9
+    //     lea  msg_prefix(%rip), %rsi
+    //     mov  $14, %edx
+    //     call write_stderr
+    //     mov  32(%r8), %rsi
+    //     add  %r8, %rsi
+    //     mov  40(%r8), %rdx
+    //     call write_stderr
+    //     lea  msg_took(%rip), %rsi
+    //     mov  $6, %edx
+    //     call write_stderr
+    //     mov  %r9, %rsi
+    //     lea  32(%rsp), %rdx
+    //     sub  %rsi, %rdx
+    //     call write_stderr
+    //     lea  msg_ns(%rip), %rsi
+    //     mov  $4, %edx
+    //     call write_stderr
+    //     add  $32, %rsp
+    // done:
+    //     ret
+    // write_stderr:
+    //     mov  $2, %edi
+    //     mov  $1, %eax (1 = SYS_write)
+    //     syscall
+    //     ret
+    // env_name:   .asciz "SOLD_TIME_INIT="
+    // msg_prefix: .ascii "sold: init of "
+    // msg_took:   .ascii " took "
+    // msg_ns:     .ascii " ns\n"
+    static constexpr uint8_t report_code_x86_64[] = {
+        0x48, 0x85, 0xd2, 0x0f, 0x84, 0xbd, 0x00, 0x00, 0x00, 0x48, 0x8b, 0x32, 0x48, 0x85, 0xf6, 0x0f, 0x84, 0xb1, 0x00, 0x00,
+        0x00, 0x48, 0x83, 0xc2, 0x08, 0x48, 0x8d, 0x0d, 0xb4, 0x00, 0x00, 0x00, 0x0f, 0xb6, 0x01, 0x84, 0xc0, 0x74, 0x0c, 0x3a,
+        0x06, 0x75, 0xde, 0x48, 0xff, 0xc1, 0x48, 0xff, 0xc6, 0xeb, 0xed, 0x49, 0x89, 0xf8, 0x49, 0x8b, 0x40, 0x10, 0x49, 0x2b,
+        0x00, 0x48, 0x69, 0xc0, 0x00, 0xca, 0x9a, 0x3b, 0x49, 0x03, 0x40, 0x18, 0x49, 0x2b, 0x40, 0x08, 0x48, 0x83, 0xec, 0x20,
+        0x48, 0x8d, 0x74, 0x24, 0x20, 0xb9, 0x0a, 0x00, 0x00, 0x00, 0x31, 0xd2, 0x48, 0xf7, 0xf1, 0x80, 0xc2, 0x30, 0x48, 0xff,
+        0xce, 0x88, 0x16, 0x48, 0x85, 0xc0, 0x75, 0xee, 0x49, 0x89, 0xf1, 0x48, 0x8d, 0x35, 0x6e, 0x00, 0x00, 0x00, 0xba, 0x0e,
+        0x00, 0x00, 0x00, 0xe8, 0x47, 0x00, 0x00, 0x00, 0x49, 0x8b, 0x70, 0x20, 0x4c, 0x01, 0xc6, 0x49, 0x8b, 0x50, 0x28, 0xe8,
+        0x37, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x35, 0x5b, 0x00, 0x00, 0x00, 0xba, 0x06, 0x00, 0x00, 0x00, 0xe8, 0x26, 0x00, 0x00,
+        0x00, 0x4c, 0x89, 0xce, 0x48, 0x8d, 0x54, 0x24, 0x20, 0x48, 0x29, 0xf2, 0xe8, 0x16, 0x00, 0x00, 0x00, 0x48, 0x8d, 0x35,
+        0x40, 0x00, 0x00, 0x00, 0xba, 0x04, 0x00, 0x00, 0x00, 0xe8, 0x05, 0x00, 0x00, 0x00, 0x48, 0x83, 0xc4, 0x20, 0xc3, 0xbf,
+        0x02, 0x00, 0x00, 0x00, 0xb8, 0x01, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc3, 0x53, 0x4f, 0x4c, 0x44, 0x5f, 0x54, 0x49, 0x4d,
+        0x45, 0x5f, 0x49, 0x4e, 0x49, 0x54, 0x3d, 0x00, 0x73, 0x6f, 0x6c, 0x64, 0x3a, 0x20, 0x69, 0x6e, 0x69, 0x74, 0x20, 0x6f,
+        0x66, 0x20, 0x20, 0x74, 0x6f, 0x6f, 0x6b, 0x20, 0x20, 0x6e, 0x73, 0x0a};
+
+    // lea START(%rip), %rsi
+    // mov $1, %edi (1 = CLOCK_MONOTONIC)
+    // mov $228, %eax (228 = SYS_clock_gettime)
+    // syscall
+    // ret
+    static constexpr uint8_t begin_code_x86_64[] = {0x48, 0x8d, 0x35, 0x00, 0x00, 0x00, 0x00, 0xbf, 0x01, 0x00,
+                                                    0x00, 0x00, 0xb8, 0xe4, 0x00, 0x00, 0x00, 0x0f, 0x05, 0xc3};
+    // offset to START
+    static constexpr int begin_addr_offset_x86_64 = 3;
+
+    // lea END(%rip), %rsi
+    // mov $1, %edi
+    // mov $228, %eax
+    // syscall
+    // lea -16(%rsi), %rdi
+    // jmp report
+    static constexpr uint8_t end_code_x86_64[] = {0x48, 0x8d, 0x35, 0x00, 0x00, 0x00, 0x00, 0xbf, 0x01, 0x00, 0x00, 0x00, 0xb8, 0xe4,
+                                                  0x00, 0x00, 0x00, 0x0f, 0x05, 0x48, 0x8d, 0x7e, 0xf0, 0xe9, 0x00, 0x00, 0x00, 0x00};
+    // offset to END
+    static constexpr int end_addr_offset_x86_64 = 3;
+    // offset to report
+    static constexpr int end_report_offset_x86_64 = 24;
+
+    // x0: the entry, x2: envp
+    //
+    //     cbz  x2, done
+    //     mov  x9, x0
+    // env_loop:
+    //     ldr  x3, [x2], #8
+    //     cbz  x3, done
+    //     adr  x4, env_name
+    // cmp_loop:
+    //     ldrb w5, [x4], #1
+    //     cbz  w5, found
+    //     ldrb w6, [x3], #1
+    //     cmp  w5, w6
+    //     b.ne env_loop
+    //     b    cmp_loop
+    // found:
+    //     mov  x15, x30
+    //     ldp  x3, x4, [x9]
+    //     ldp  x5, x6, [x9, #16]
+    //     sub  x5, x5, x3
+    //     movz x7, #0xca00
+    //     movk x7, #0x3b9a, lsl #16
+    //     mul  x5, x5, x7
+    //     add  x5, x5, x6
+    //     sub  x5, x5, x4
+    //     sub  sp, sp, #32
+    //     add  x10, sp, #32
+    //     mov  x11, x10
+    //     mov  x7, #10
+    // dec_loop:
+    //     udiv x12, x5, x7
+    //     msub x13, x12, x7, x5
+    //     add  w13, w13, #0x30
+    //     strb w13, [x11, #-1]!
+    //     mov  x5, x12
+    //     cbnz x5, dec_loop
+    //     adr  x1, msg_prefix
+    //     mov  x2, #14
+    //     bl   write_stderr
+    //     ldr  x1, [x9, #32]
+    //     add  x1, x1, x9
+    //     ldr  x2, [x9, #40]
+    //     bl   write_stderr
+    //     adr  x1, msg_took
+    //     mov  x2, #6
+    //     bl   write_stderr
+    //     mov  x1, x11
+    //     sub  x2, x10, x11
+    //     bl   write_stderr
+    //     adr  x1, msg_ns
+    //     mov  x2, #4
+    //     bl   write_stderr
+    //     add  sp, sp, #32
+    //     mov  x30, x15
+    // done:
+    //     ret
+    // write_stderr:
+    //     mov  x0, #2
+    //     mov  x8, #64 (64 = write)
+    //     svc  #0
+    //     ret
+    // env_name:   .asciz "SOLD_TIME_INIT="
+    // msg_prefix: .ascii "sold: init of "
+    // msg_took:   .ascii " took "
+    // msg_ns:     .ascii " ns\n"
+    static constexpr uint8_t report_code_aarch64[] = {
+        0x02, 0x06, 0x00, 0xb4, 0xe9, 0x03, 0x00, 0xaa, 0x43, 0x84, 0x40, 0xf8, 0xa3, 0x05, 0x00, 0xb4, 0x24, 0x06, 0x00, 0x10,
+        0x85, 0x14, 0x40, 0x38, 0xa5, 0x00, 0x00, 0x34, 0x66, 0x14, 0x40, 0x38, 0xbf, 0x00, 0x06, 0x6b, 0x21, 0xff, 0xff, 0x54,
+        0xfb, 0xff, 0xff, 0x17, 0xef, 0x03, 0x1e, 0xaa, 0x23, 0x11, 0x40, 0xa9, 0x25, 0x19, 0x41, 0xa9, 0xa5, 0x00, 0x03, 0xcb,
+        0x07, 0x40, 0x99, 0xd2, 0x47, 0x73, 0xa7, 0xf2, 0xa5, 0x7c, 0x07, 0x9b, 0xa5, 0x00, 0x06, 0x8b, 0xa5, 0x00, 0x04, 0xcb,
+        0xff, 0x83, 0x00, 0xd1, 0xea, 0x83, 0x00, 0x91, 0xeb, 0x03, 0x0a, 0xaa, 0x47, 0x01, 0x80, 0xd2, 0xac, 0x08, 0xc7, 0x9a,
+        0x8d, 0x95, 0x07, 0x9b, 0xad, 0xc1, 0x00, 0x11, 0x6d, 0xfd, 0x1f, 0x38, 0xe5, 0x03, 0x0c, 0xaa, 0x65, 0xff, 0xff, 0xb5,
+        0x61, 0x03, 0x00, 0x10, 0xc2, 0x01, 0x80, 0xd2, 0x11, 0x00, 0x00, 0x94, 0x21, 0x11, 0x40, 0xf9, 0x21, 0x00, 0x09, 0x8b,
+        0x22, 0x15, 0x40, 0xf9, 0x0d, 0x00, 0x00, 0x94, 0xe1, 0x02, 0x00, 0x50, 0xc2, 0x00, 0x80, 0xd2, 0x0a, 0x00, 0x00, 0x94,
+        0xe1, 0x03, 0x0b, 0xaa, 0x42, 0x01, 0x0b, 0xcb, 0x07, 0x00, 0x00, 0x94, 0x61, 0x02, 0x00, 0x10, 0x82, 0x00, 0x80, 0xd2,
+        0x04, 0x00, 0x00, 0x94, 0xff, 0x83, 0x00, 0x91, 0xfe, 0x03, 0x0f, 0xaa, 0xc0, 0x03, 0x5f, 0xd6, 0x40, 0x00, 0x80, 0xd2,
+        0x08, 0x08, 0x80, 0xd2, 0x01, 0x00, 0x00, 0xd4, 0xc0, 0x03, 0x5f, 0xd6, 0x53, 0x4f, 0x4c, 0x44, 0x5f, 0x54, 0x49, 0x4d,
+        0x45, 0x5f, 0x49, 0x4e, 0x49, 0x54, 0x3d, 0x00, 0x73, 0x6f, 0x6c, 0x64, 0x3a, 0x20, 0x69, 0x6e, 0x69, 0x74, 0x20, 0x6f,
+        0x66, 0x20, 0x20, 0x74, 0x6f, 0x6f, 0x6b, 0x20, 0x20, 0x6e, 0x73, 0x0a};
+
+    // x1 <- START - (the address of adr) using 4 movk instructions
+    // adr x3, 0
+    // add x1, x1, x3
+    // mov x0, #1 (1 = CLOCK_MONOTONIC)
+    // mov x8, #113 (113 = clock_gettime)
+    // svc #0
+    // ret
+    static constexpr int begin_code_length_aarch64 = 10 * 4;
+
+    // x1 <- END - (the address of adr) using 4 movk instructions
+    // adr x3, 0
+    // add x1, x1, x3
+    // mov x0, #1
+    // mov x8, #113
+    // svc #0
+    // sub x0, x1, #16
+    // b report
+    static constexpr int end_code_length_aarch64 = 11 * 4;
+
+private:
+    uintptr_t ReportSize() const;
+    uintptr_t BeginStubSize() const;
+    uintptr_t EndStubSize() const;
+
+    // The offset of the i-th entry from the beginning of the data.
+    static uintptr_t EntryOffset(size_t i) { return kHeaderSize + kEntrySize * i; }
+
+    void EmitCodeX86_64(std::vector<uint8_t>& code, uintptr_t code_offset, uintptr_t data_offset);
+    void EmitCodeAarch64(std::vector<uint8_t>& code, uintptr_t code_offset, uintptr_t data_offset);
+
+    Elf64_Half machine_type_{EM_NONE};
+    std::vector<std::string> names_;
+};
@@ -0,0 +1,203 @@
+# Usage:
+#
+# $ python3 memory_attribution.py out.map.json 27136
+# $ python3 memory_attribution.py --json out.map.json 27136
+#
+# Reports RSS, PSS and private dirty bytes of a process per original library
+# bundled in a sold output and per segment type. The first argument is a link
+# map written by `sold --map` in JSON or TSV. Pages of the output which no
+# segment of the link map covers, e.g. headers and .eh_frame_hdr, belong to
+# "(sold)".
+#
+# Each page is classified with /proc/PID/pagemap: a present page is resident
+# and a present anonymous page in the file mapping is a private dirty copy
+# made by relocations or writes. PSS of a page is exact when /proc/kpagecount
+# is readable (i.e. as root). Otherwise, PSS of each mapping in
+# /proc/PID/smaps is split among its resident pages, giving anonymous pages
+# their full size.
+
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+
+PAGE_SIZE = os.sysconf('SC_PAGE_SIZE')
+
+PF_X = 1
+PF_W = 2
+
+PM_PRESENT = 1 << 63
+PM_FILE = 1 << 61
+PM_PFN_MASK = (1 << 55) - 1
+
+
+def parse_link_map(map_filename):
+    with open(map_filename) as f:
+        content = f.read()
+    if content.lstrip().startswith('{'):
+        link_map = json.loads(content)
+        output = link_map['output']
+        segments = link_map['segments']
+    else:
+        lines = content.splitlines()
+        output = lines[0].split(' output=')[1].split(' ')[0]
+        lines = [l for l in lines if l and not l.startswith('#')]
+        header = lines[0].split('\t')
+        segments = [dict(zip(header, l.split('\t'))) for l in lines[1:]]
+        segments = [s for s in segments if s['kind'] == 'load']
+    loads = []
+    for s in segments:
+        loads.append({
+            'library': s['path'],
+            'vaddr': int(s['output_vaddr']),
+            'filesz': int(s['filesz']),
+            'memsz': int(s['memsz']),
+            'flags': int(s['input_flags']),
+        })
+    loads.sort(key=lambda l: l['vaddr'])
+    return output, loads
+
+
+def parse_smaps(pid):
+    mappings = []
+    for line in open('/proc/%d/smaps' % pid):
+        toks = line.split()
+        if '-' in toks[0] and not toks[0].endswith(':'):
+            begin, end = [int(a, 16) for a in toks[0].split('-')]
+            mappings.append({
+                'begin': begin,
+                'end': end,
+                'perms': toks[1],
+                'offset': int(toks[2], 16),
+                'path': toks[5] if len(toks) > 5 else '',
+                'Pss': 0,
+            })
+        elif toks[0] == 'Pss:':
+            mappings[-1]['Pss'] = int(toks[1]) * 1024
+    return mappings
+
+
+def segment_type(load, vaddr):
+    if load['flags'] & PF_X:
+        return 'text'
+    if not load['flags'] & PF_W:
+        return 'rodata'
+    if vaddr >= load['vaddr'] + load['filesz']:
+        return 'bss'
+    return 'data'
+
+
+def own_type(mapping):
+    if 'x' in mapping['perms']:
+        return 'text'
+    return 'data' if 'w' in mapping['perms'] else 'rodata'
+
+
+def find_load(loads, vaddr):
+    # A library has a few PT_LOADs, so a linear scan is enough.
+    for load in loads:
+        if load['vaddr'] <= vaddr < load['vaddr'] + load['memsz']:
+            return load
+    return None
+
+
+def read_pagemap(pid, begin, end):
+    with open('/proc/%d/pagemap' % pid, 'rb') as f:
+        f.seek(begin // PAGE_SIZE * 8)
+        data = f.read((end - begin) // PAGE_SIZE * 8)
+    return struct.unpack('<%dQ' % (len(data) // 8), data)
+
+
+class KPageCount:
+    def __init__(self):
+        try:
+            self.f = open('/proc/kpagecount', 'rb')
+        except (IOError, OSError):
+            self.f = None
+
+    def get(self, pfn):
+        if not self.f or not pfn:
+            return 0
+        self.f.seek(pfn * 8)
+        return struct.unpack('<Q', self.f.read(8))[0]
+
+
+def attribute(pid, output, loads):
+    name = os.path.basename(output)
+    mappings = parse_smaps(pid)
+    files = [m for m in mappings if os.path.basename(m['path']) == name]
+    if not files:
+        sys.exit('%s is not mapped in process %d' % (name, pid))
+
+    # ld.so maps the first PT_LOAD, which has vaddr 0 and offset 0, at the
+    # lowest address. Anonymous mappings for .bss between and right after
+    # file mappings belong to the output too.
+    base = files[0]['begin'] - files[0]['offset']
+    end = max(files[-1]['end'], base + max(l['vaddr'] + l['memsz'] for l in loads))
+    mappings = [m for m in mappings if base <= m['begin'] and m['end'] <= end and m['path'] in ('', files[0]['path'])]
+
+    kpagecount = KPageCount()
+    exact = True
+    rows = {}
+    for mapping in mappings:
+        entries = read_pagemap(pid, mapping['begin'], mapping['end'])
+        pages = []
+        for i, entry in enumerate(entries):
+            if not entry & PM_PRESENT:
+                continue
+            vaddr = mapping['begin'] + i * PAGE_SIZE - base
+            load = find_load(loads, vaddr)
+            if load:
+                key = (load['library'], segment_type(load, vaddr))
+            else:
+                key = ('(sold)', own_type(mapping))
+            anon = not entry & PM_FILE
+            count = kpagecount.get(entry & PM_PFN_MASK)
+            pages.append((key, anon, count))
+
+        # Without kpagecount, PSS of the mapping is shared by its file pages.
+        anon_pages = sum(1 for p in pages if p[1])
+        file_pages = len(pages) - anon_pages
+        file_pss = max(0, mapping['Pss'] - anon_pages * PAGE_SIZE) / file_pages if file_pages else 0
+        for key, anon, count in pages:
+            row = rows.setdefault(key, {'rss': 0, 'pss': 0, 'private_dirty': 0})
+            row['rss'] += PAGE_SIZE
+            if anon:
+                row['private_dirty'] += PAGE_SIZE
+            if count:
+                row['pss'] += PAGE_SIZE / count
+            else:
+                exact = False
+                row['pss'] += PAGE_SIZE if anon else file_pss
+    return rows, exact
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Attribute memory of a process to libraries bundled by sold.')
+    parser.add_argument('--json', action='store_true', help='print a line of JSON')
+    parser.add_argument('map', type=str, help='path to the link map written by sold --map')
+    parser.add_argument('pid', type=int, help='process which loads the output of sold')
+    args = parser.parse_args()
+
+    output, loads = parse_link_map(args.map)
+    rows, exact = attribute(args.pid, output, loads)
+    rows = [dict(library=k[0], type=k[1], **v) for k, v in sorted(rows.items())]
+    for row in rows:
+        row['pss'] = int(row['pss'])
+
+    if args.json:
+        print(json.dumps({'output': output, 'pid': args.pid, 'pss_exact': exact, 'rows': rows}, sort_keys=True))
+        return
+
+    print('%-40s %-8s %12s %12s %14s' % ('library', 'type', 'rss', 'pss', 'private_dirty'))
+    for row in rows:
+        print('%-40s %-8s %12d %12d %14d' % (row['library'], row['type'], row['rss'], row['pss'], row['private_dirty']))
+    if not exact:
+        print('PSS is estimated because /proc/kpagecount is not readable')
+
+
+if __name__ == '__main__':
+    main()
@@ -1,10 +1,14 @@
 # Usage:
 #
 # $ python3 resolve_addr.py sold.INFO /proc/27136/maps 0x7f41080088c9
+# $ python3 resolve_addr.py out.map.json /proc/27136/maps 0x7f41080088c9
 #
+# The first argument is either a link map written by `sold --map` in JSON or
+# TSV, or a log of sold with PT_LOAD mapping lines.
 
 
 import argparse
+import json
 import re
 
 
@@ -24,6 +28,38 @@ def parse_log(log_filename):
     return loads
 
 
+def parse_link_map(map_filename):
+    with open(map_filename) as f:
+        content = f.read()
+    if content.lstrip().startswith('{'):
+        segments = json.loads(content)['segments']
+    else:
+        lines = [l for l in content.splitlines() if l and not l.startswith('#')]
+        header = lines[0].split('\t')
+        segments = [dict(zip(header, l.split('\t'))) for l in lines[1:]]
+        segments = [s for s in segments if s['kind'] == 'load']
+    loads = []
+    for s in segments:
+        loads.append({
+            'name': s['path'],
+            'vaddr': int(s['output_vaddr']),
+            'memsz': int(s['memsz']),
+            'offset': int(s['output_offset']),
+            'filesz': int(s['filesz']),
+            'orig_vaddr': int(s['input_vaddr']),
+            'orig_offset': int(s['input_offset']),
+        })
+    return loads
+
+
+def parse_loads(filename):
+    with open(filename) as f:
+        head = f.read(64)
+    if head.lstrip().startswith('{') or head.startswith('# sold link map'):
+        return parse_link_map(filename)
+    return parse_log(filename)
+
+
 def parse_maps(maps_filename):
     base_addrs = {}
     maps = []
@@ -73,12 +109,12 @@ def show_addr(maps, addr, loads=None):
 
 def main():
     parser = argparse.ArgumentParser()
-    parser.add_argument('log', type=str, help="Path to the log file")
+    parser.add_argument('log', type=str, help="Path to the link map or the log file")
     parser.add_argument('maps', type=str, help="Path to the /proc/<pid>/maps file")
     parser.add_argument('addr', type=str, help="Address to be resolved")
     args = parser.parse_args()
 
-    loads = parse_log(args.log)
+    loads = parse_loads(args.log)
     maps = parse_maps(args.maps)
     addr = eval(args.addr)
 
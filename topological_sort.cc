@@ -0,0 +1,77 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "topological_sort.h"
+
+#include <algorithm>
+#include <deque>
+
+// _dl_sort_maps visits nodes from the head. When a node after the visited one
+// depends on it, the visited node moves to the tail. Otherwise, the visited
+// node is fixed and the next one is visited. To break cycles, a node which has
+// been visited more than the number of nodes is fixed without checking.
+//
+// Nodes which are not fixed yet always form a queue whose head is the visited
+// node, so we keep them in a deque. Whether a node after the visited one
+// depends on it is the same as whether any unfixed node other than itself
+// depends on it, which we keep in num_unfixed_dependents. Visit counts are
+// reset every time a node is fixed, so we version them with epoch.
+std::vector<int> TopologicalSort(const std::vector<std::vector<int>>& neededs) {
+    const int n = neededs.size();
+    if (n < 1) {
+        return {};
+    }
+
+    // Remove duplicated and self edges which do not change the order.
+    std::vector<std::vector<int>> deps(n);
+    std::vector<int> num_unfixed_dependents(n, 0);
+    for (int i = 0; i < n; ++i) {
+        deps[i] = neededs[i];
+        std::sort(deps[i].begin(), deps[i].end());
+        deps[i].erase(std::unique(deps[i].begin(), deps[i].end()), deps[i].end());
+        deps[i].erase(std::remove(deps[i].begin(), deps[i].end(), i), deps[i].end());
+        for (int d : deps[i]) num_unfixed_dependents[d]++;
+    }
+
+    std::vector<int> seen(n, 0);
+    std::vector<int> seen_epoch(n, 0);
+    int epoch = 0;
+    auto get_seen = [&](int i) { return seen_epoch[i] == epoch ? seen[i] : 0; };
+
+    std::deque<int> unfixed;
+    for (int i = 0; i < n; ++i) unfixed.push_back(i);
+    std::vector<int> sorted;
+    sorted.reserve(n);
+
+    while (true) {
+        const int i = unfixed.front();
+        seen[i] = get_seen(i) + 1;
+        seen_epoch[i] = epoch;
+
+        if (num_unfixed_dependents[i] > 0) {
+            unfixed.pop_front();
+            unfixed.push_back(i);
+            if (get_seen(unfixed.front()) <= n) continue;
+        }
+
+        const int fixed = unfixed.front();
+        unfixed.pop_front();
+        sorted.push_back(fixed);
+        for (int d : deps[fixed]) num_unfixed_dependents[d]--;
+        if (unfixed.empty()) break;
+        epoch++;
+    }
+    return sorted;
+}
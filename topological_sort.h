@@ -0,0 +1,28 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+// Returns the order in which the dynamic loader runs initializers of nodes,
+// which is compatible with _dl_sort_maps in glibc/elf/dl-sort-maps.c.
+// neededs[i] has the IDs of the nodes which node i depends on. IDs are
+// [0, neededs.size()) and node 0 is the root. The initial order is the order
+// of IDs.
+//
+// This takes O(V + E) time plus O(1) for each move of a node in
+// _dl_sort_maps.
+std::vector<int> TopologicalSort(const std::vector<std::vector<int>>& neededs);
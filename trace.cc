@@ -0,0 +1,193 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "trace.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+#include "json_writer.h"
+#include "utils.h"
+
+namespace {
+
+double ClockUs(clockid_t clock) {
+    struct timespec ts;
+    CHECK(clock_gettime(clock, &ts) == 0);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+}  // namespace
+
+long PeakRSSKb() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        long kb;
+        if (key == "VmHWM:" && status >> kb) return kb;
+        status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    struct rusage usage;
+    CHECK(getrusage(RUSAGE_SELF, &usage) == 0);
+    // ru_maxrss is in kilobytes on Linux.
+    return usage.ru_maxrss;
+}
+
+bool ResetPeakRSS() {
+    int fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (fd < 0) return false;
+    const bool ok = write(fd, "5", 1) == 1;
+    close(fd);
+    return ok;
+}
+
+Tracer& Tracer::Get() {
+    static Tracer tracer;
+    return tracer;
+}
+
+void Tracer::Enable() {
+    enabled_ = true;
+    origin_us_ = ClockUs(CLOCK_MONOTONIC);
+}
+
+void Tracer::Clear() {
+    CHECK(open_.empty());
+    spans_.clear();
+    cpu_start_us_.clear();
+}
+
+double Tracer::NowUs() const { return ClockUs(CLOCK_MONOTONIC) - origin_us_; }
+
+// The kernel keeps only one peak RSS, which we reset when a span begins. We
+// fold the peak so far into all open spans before that, so the peak of an
+// enclosing span includes those of the spans in it.
+void Tracer::FoldPeakRSS() {
+    const long peak_rss_kb = PeakRSSKb();
+    for (size_t index : open_) spans_[index].peak_rss_kb = std::max(spans_[index].peak_rss_kb, peak_rss_kb);
+}
+
+size_t Tracer::Begin(const std::string& name, const std::string& category, const std::string& library) {
+    FoldPeakRSS();
+    ResetPeakRSS();
+    spans_.push_back(Span{name, category, library, static_cast<int>(open_.size()), NowUs(), 0, 0, 0});
+    cpu_start_us_.push_back(ClockUs(CLOCK_PROCESS_CPUTIME_ID));
+    open_.push_back(spans_.size() - 1);
+    return spans_.size() - 1;
+}
+
+void Tracer::End(size_t index) {
+    CHECK(!open_.empty() && open_.back() == index);
+    Span& span = spans_[index];
+    span.wall_us = NowUs() - span.start_us;
+    span.cpu_us = ClockUs(CLOCK_PROCESS_CPUTIME_ID) - cpu_start_us_[index];
+    FoldPeakRSS();
+    open_.pop_back();
+}
+
+void Tracer::PrintReport(std::ostream& os) const {
+    os << std::left << std::setw(32) << "phase" << std::right << std::setw(12) << "wall(ms)" << std::setw(12) << "cpu(ms)"
+       << std::setw(16) << "peak RSS(MB)" << std::endl;
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2);
+    for (const Span& span : spans_) {
+        if (span.category != "phase") continue;
+        os << std::left << std::setw(32) << (std::string(span.depth * 2, ' ') + span.name) << std::right << std::setw(12)
+           << span.wall_us / 1000 << std::setw(12) << span.cpu_us / 1000 << std::setw(16) << span.peak_rss_kb / 1024.0 << std::endl;
+    }
+    os.flags(flags);
+}
+
+void Tracer::WritePhases(JSONWriter& w) const {
+    w.BeginArray();
+    for (const Span& span : spans_) {
+        if (span.category != "phase") continue;
+        w.BeginObject();
+        w.Key("name");
+        w.String(span.name);
+        w.Key("depth");
+        w.Int(span.depth);
+        w.Key("wall_ms");
+        w.Double(span.wall_us / 1000);
+        w.Key("cpu_ms");
+        w.Double(span.cpu_us / 1000);
+        w.Key("peak_rss_kb");
+        w.Int(span.peak_rss_kb);
+        w.EndObject();
+    }
+    w.EndArray();
+}
+
+void Tracer::WriteChromeTrace(std::ostream& os) const {
+    JSONWriter w(os);
+    w.BeginObject();
+    w.Key("displayTimeUnit");
+    w.String("ms");
+    w.Key("traceEvents");
+    w.BeginArray();
+    for (const Span& span : spans_) {
+        // Complete events. ts and dur are in microseconds.
+        w.BeginObject();
+        w.Key("name");
+        w.String(span.library.empty() ? span.name : span.name + " " + span.library);
+        w.Key("cat");
+        w.String(span.category);
+        w.Key("ph");
+        w.String("X");
+        w.Key("ts");
+        w.Double(span.start_us);
+        w.Key("dur");
+        w.Double(span.wall_us);
+        w.Key("pid");
+        w.Int(getpid());
+        w.Key("tid");
+        w.Int(0);
+        w.Key("args");
+        w.BeginObject();
+        if (!span.library.empty()) {
+            w.Key("library");
+            w.String(span.library);
+        }
+        w.Key("cpu_ms");
+        w.Double(span.cpu_us / 1000);
+        w.Key("peak_rss_kb");
+        w.Int(span.peak_rss_kb);
+        w.EndObject();
+        w.EndObject();
+    }
+    w.EndArray();
+    w.EndObject();
+    os << std::endl;
+}
+
+TraceSpan::TraceSpan(const char* name) : index_(0), enabled_(Tracer::Get().enabled()) {
+    if (enabled_) index_ = Tracer::Get().Begin(name, "phase", "");
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category, const std::string& library)
+    : index_(0), enabled_(Tracer::Get().enabled()) {
+    if (enabled_) index_ = Tracer::Get().Begin(name, category, library);
+}
+
+TraceSpan::~TraceSpan() {
+    if (enabled_) Tracer::Get().End(index_);
+}
@@ -0,0 +1,101 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class JSONWriter;
+
+// Returns the peak RSS of this process in kilobytes since the last
+// ResetPeakRSS, i.e. VmHWM in /proc/self/status.
+long PeakRSSKb();
+
+// Resets the peak RSS to the current RSS. Returns false when the kernel does
+// not allow it, and then PeakRSSKb keeps returning the peak of the process.
+bool ResetPeakRSS();
+
+// Tracer records spans of sold's phases for --time-report and --trace-json.
+// It is process-wide so that spans in Sold and sold_main, e.g. CheckOutput of
+// --check-output, share one timeline. Spans cost nothing but a branch unless
+// the tracer is enabled.
+class Tracer {
+public:
+    static Tracer& Get();
+
+    void Enable();
+    bool enabled() const { return enabled_; }
+
+    // Discards all spans. Spans must not be open.
+    void Clear();
+
+    // Returns the index of the new span, which must be passed to End.
+    size_t Begin(const std::string& name, const std::string& category, const std::string& library);
+    void End(size_t index);
+
+    // Prints wall time, CPU time and peak RSS of spans in category "phase".
+    void PrintReport(std::ostream& os) const;
+
+    // Writes spans in category "phase" as an array of objects with name,
+    // depth, wall_ms, cpu_ms and peak_rss_kb.
+    void WritePhases(JSONWriter& w) const;
+
+    // Writes spans in the Chrome trace event format, which Perfetto and
+    // chrome://tracing can show.
+    void WriteChromeTrace(std::ostream& os) const;
+
+private:
+    struct Span {
+        std::string name;
+        std::string category;
+        // The library which this span processes. Empty for phases.
+        std::string library;
+        int depth;
+        double start_us;
+        double wall_us;
+        double cpu_us;
+        // Peak RSS of the process while this span was open.
+        long peak_rss_kb;
+    };
+
+    double NowUs() const;
+    void FoldPeakRSS();
+
+    bool enabled_{false};
+    double origin_us_{0};
+    std::vector<Span> spans_;
+    // Indices of spans which have begun but not ended, outermost first.
+    std::vector<size_t> open_;
+    // CPU time at Begin for each span.
+    std::vector<double> cpu_start_us_;
+};
+
+// TraceSpan records a span from its construction to its destruction. Names
+// are copied into std::string only when the tracer is enabled.
+class TraceSpan {
+public:
+    // A span of category "phase".
+    explicit TraceSpan(const char* name);
+    TraceSpan(const char* name, const char* category, const std::string& library);
+    ~TraceSpan();
+
+private:
+    size_t index_;
+    bool enabled_;
+};
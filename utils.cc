@@ -50,6 +50,7 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #include "utils.h"
+#include "hash.h"
 #include <iomanip>
 
 std::vector<std::string> SplitString(const std::string& str, const std::string& sep) {
@@ -104,10 +105,15 @@ bool IsDefined(const Elf_Sym& sym) {
     return (sym.st_value || IsTLS(sym)) && sym.st_shndx != SHN_UNDEF;
 }
 
+SymbolName SymbolName::Make(const char* name) {
+    const size_t size = strlen(name);
+    return SymbolName{name, static_cast<uint32_t>(size), CalcGnuHash(name, size)};
+}
+
 std::ostream& operator<<(std::ostream& os, const Syminfo& s) {
     auto f = os.flags();
-    os << "Syminfo{name=" << s.name << ", soname=" << s.soname << ", version=" << s.version << ", versym=" << s.versym << ", sym=0x"
-       << std::hex << std::setfill('0') << std::setw(16) << s.sym << "}";
+    os << "Syminfo{name=" << s.name << ", soname=" << InternedString(s.key.soname) << ", version=" << InternedString(s.key.version)
+       << ", versym=" << s.versym << ", sym=0x" << std::hex << std::setfill('0') << std::setw(16) << s.sym << "}";
     os.flags(f);
     return os;
 }
@@ -266,6 +272,36 @@ std::string ShowRelocationType(int type) {
     }
 }
 
+std::string ShowRelocationType(Elf_Half machine, int type) {
+    if (machine != EM_AARCH64) return ShowRelocationType(type);
+    switch (type) {
+        case R_AARCH64_NONE:
+            return "R_AARCH64_NONE";
+        case R_AARCH64_ABS64:
+            return "R_AARCH64_ABS64";
+        case R_AARCH64_COPY:
+            return "R_AARCH64_COPY";
+        case R_AARCH64_GLOB_DAT:
+            return "R_AARCH64_GLOB_DAT";
+        case R_AARCH64_JUMP_SLOT:
+            return "R_AARCH64_JUMP_SLOT";
+        case R_AARCH64_RELATIVE:
+            return "R_AARCH64_RELATIVE";
+        case R_AARCH64_TLS_DTPMOD:
+            return "R_AARCH64_TLS_DTPMOD";
+        case R_AARCH64_TLS_DTPREL:
+            return "R_AARCH64_TLS_DTPREL";
+        case R_AARCH64_TLS_TPREL:
+            return "R_AARCH64_TLS_TPREL";
+        case R_AARCH64_TLSDESC:
+            return "R_AARCH64_TLSDESC";
+        case R_AARCH64_IRELATIVE:
+            return "R_AARCH64_IRELATIVE";
+        default:
+            return HexString(type, 4);
+    }
+}
+
 std::ostream& operator<<(std::ostream& os, const Elf_Rel& r) {
     os << "Elf_Rela{r_offset=" << SOLD_LOG_32BITS(r.r_offset) << ", r_info=" << SOLD_LOG_32BITS(r.r_info)
        << ", ELF_R_SYM(r.r_info)=" << SOLD_LOG_16BITS(ELF_R_SYM(r.r_info))
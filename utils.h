@@ -53,6 +53,7 @@
 
 #include <elf.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <cassert>
 #include <iomanip>
@@ -63,6 +64,8 @@
 
 #include <glog/logging.h>
 
+#include "string_interner.h"
+
 #define SOLD_LOG_KEY_VALUE(key, value) " " << key << "=" << value
 #define SOLD_LOG_KEY(key) SOLD_LOG_KEY_VALUE(#key, key)
 #define SOLD_LOG_64BITS(key) SOLD_LOG_KEY_VALUE(#key, HexString(key, 16))
@@ -88,6 +91,7 @@
 #define Elf_Verdaux Elf64_Verdaux
 #define Elf_Verneed Elf64_Verneed
 #define Elf_Verdef Elf64_Verdef
+#define Elf_Nhdr Elf64_Nhdr
 #define ELF_ST_BIND(val) ELF64_ST_BIND(val)
 #define ELF_ST_TYPE(val) ELF64_ST_TYPE(val)
 #define ELF_ST_INFO(bind, type) ELF64_ST_INFO(bind, type)
@@ -157,15 +161,54 @@ bool IsDefined(const Elf_Sym& sym);
 
 class ELFBinary;
 
+// SymbolName refers to a symbol name in .dynstr or .strtab of an input,
+// which stays mapped while we link, so names are never copied. We compute
+// the GNU hash of the name only once in SymbolName::Make and reuse it for
+// hash tables and .gnu.hash.
+struct SymbolName {
+    const char* str{""};
+    uint32_t size{0};
+    uint32_t gnu_hash{0};
+
+    static SymbolName Make(const char* name);
+
+    bool operator==(const SymbolName& n) const { return gnu_hash == n.gnu_hash && size == n.size && memcmp(str, n.str, size) == 0; }
+};
+
+struct SymbolNameHash {
+    size_t operator()(const SymbolName& n) const { return n.gnu_hash; }
+};
+
+// SymbolKey identifies a symbol with (name, soname, version). Sonames and
+// versions are interned.
+struct SymbolKey {
+    SymbolName name;
+    StrId soname;
+    StrId version;
+
+    static SymbolKey Make(const char* name, StrId soname, StrId version) { return SymbolKey{SymbolName::Make(name), soname, version}; }
+
+    bool operator==(const SymbolKey& k) const { return soname == k.soname && version == k.version && name == k.name; }
+};
+
+struct SymbolKeyHash {
+    size_t operator()(const SymbolKey& k) const {
+        return k.name.gnu_hash ^ (static_cast<size_t>(k.soname) << 32) ^ (static_cast<size_t>(k.version) << 48);
+    }
+};
+
 struct Syminfo {
-    std::string name;
-    std::string soname;
-    std::string version;
+    // The same as key.name.str, which points to .dynstr of the ELF binary
+    // which has the symbol. We never copy it.
+    const char* name;
+    SymbolKey key;
     Elf_Versym versym;
     Elf_Sym* sym;
 };
 
 std::string ShowRelocationType(int type);
+// Same as above but for relocations of machine, e.g. EM_AARCH64.
+std::string ShowRelocationType(Elf_Half machine, int type);
 std::string ShowDW_EH_PE(uint8_t type);
 std::ostream& operator<<(std::ostream& os, const Syminfo& s);
 std::ostream& operator<<(std::ostream& os, const Elf_Rel& s);
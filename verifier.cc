@@ -0,0 +1,836 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "verifier.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <set>
+#include <thread>
+
+#include "hash.h"
+#include "utils.h"
+
+namespace {
+
+// We report at most this number of problems of each check.
+const size_t kMaxErrorsPerCheck = 20;
+// The number of relocations or .eh_frame_hdr entries checked by a task.
+const size_t kItemsPerTask = 1 << 16;
+
+class ErrorList {
+public:
+    void Add(const std::string& msg) {
+        if (messages_.size() < kMaxErrorsPerCheck) messages_.push_back(msg);
+        count_++;
+    }
+
+    void Merge(const ErrorList& other) {
+        for (const std::string& msg : other.messages_) {
+            if (messages_.size() < kMaxErrorsPerCheck) messages_.push_back(msg);
+        }
+        count_ += other.count_;
+    }
+
+    void AppendTo(std::vector<std::string>* out) const {
+        out->insert(out->end(), messages_.begin(), messages_.end());
+        if (count_ > messages_.size()) out->push_back("... and " + std::to_string(count_ - messages_.size()) + " more");
+    }
+
+    // The number of errors including those not kept in messages_.
+    size_t count() const { return count_; }
+
+private:
+    std::vector<std::string> messages_;
+    size_t count_{0};
+};
+
+template <class... Args>
+std::string Concat(const Args&... args) {
+    std::stringstream ss;
+    using Expand = int[];
+    (void)Expand{0, ((ss << args), 0)...};
+    return ss.str();
+}
+
+bool IsPowerOf2(uint64_t v) {
+    return v && !(v & (v - 1));
+}
+
+uintptr_t PageDown(uintptr_t a) {
+    return a & ~(LINUX_PAGE_SIZE - 1);
+}
+
+template <class T>
+T Read(const char* p) {
+    T v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+std::string SegmentName(size_t index, const Elf_Phdr& phdr) {
+    std::string type;
+    switch (phdr.p_type) {
+        case PT_LOAD:
+            type = "PT_LOAD";
+            break;
+        case PT_DYNAMIC:
+            type = "PT_DYNAMIC";
+            break;
+        case PT_INTERP:
+            type = "PT_INTERP";
+            break;
+        case PT_NOTE:
+            type = "PT_NOTE";
+            break;
+        case PT_PHDR:
+            type = "PT_PHDR";
+            break;
+        case PT_TLS:
+            type = "PT_TLS";
+            break;
+        case PT_GNU_EH_FRAME:
+            type = "PT_GNU_EH_FRAME";
+            break;
+        case PT_GNU_RELRO:
+            type = "PT_GNU_RELRO";
+            break;
+        default:
+            type = "segment of type " + HexString(phdr.p_type);
+    }
+    return Concat("phdr[", index, "] (", type, ")");
+}
+
+// Returns true when type is an offset in the TLS block of a module, which
+// must be in PT_TLS of this object when the relocation has no symbol or a
+// symbol defined here.
+bool IsTLSOffset(Elf_Half machine, uint32_t type) {
+    if (machine == EM_X86_64) return type == R_X86_64_DTPOFF64 || type == R_X86_64_TPOFF64;
+    if (machine == EM_AARCH64) return type == R_AARCH64_TLS_DTPREL || type == R_AARCH64_TLS_TPREL;
+    return false;
+}
+
+// Reads LEB128 at *p and advances *p. Returns false at end.
+bool ReadLEB128(const char** p, const char* end, bool is_signed, int64_t* out) {
+    uint64_t v = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        if (*p >= end || shift >= 64) return false;
+        b = **p;
+        (*p)++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    if (is_signed && shift < 64 && (b & 0x40)) v |= ~0ULL << shift;
+    *out = v;
+    return true;
+}
+
+// Returns the size of a value encoded with DW_EH_PE_*, or 0 for LEB128 and
+// unknown formats.
+size_t EncodedSize(uint8_t enc) {
+    switch (enc & 0x0f) {
+        case DW_EH_PE_absptr:
+        case DW_EH_PE_udata8:
+        case DW_EH_PE_sdata8:
+            return 8;
+        case DW_EH_PE_udata4:
+        case DW_EH_PE_sdata4:
+            return 4;
+        case DW_EH_PE_udata2:
+        case DW_EH_PE_sdata2:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+class Verifier {
+public:
+    Verifier(const char* head, size_t size) : head_(head), size_(size) {}
+
+    // Fills *num_errors with the number of errors, which can be larger than
+    // the number of returned messages.
+    std::vector<std::string> Verify(size_t* num_errors);
+
+private:
+    bool Parse(ErrorList* errors);
+    void ParseGnuHash(ErrorList* errors);
+    void ParseEHFrameHeader(ErrorList* errors);
+
+    void CheckSegments(ErrorList* errors) const;
+    void CheckTLS(ErrorList* errors) const;
+    void CheckTLSSymbols(ErrorList* errors) const;
+    void CheckRelocs(const char* section, const Elf_Rel* rels, size_t begin, size_t end, ErrorList* errors) const;
+    void CheckGnuHash(ErrorList* errors) const;
+    void CheckVersions(ErrorList* errors) const;
+    void CheckEHFrameHeader(size_t begin, size_t end, ErrorList* errors) const;
+    // Returns the DW_EH_PE_* of pc_begin in FDEs of the CIE at addr.
+    bool ParseCIE(Elf_Addr addr, uint8_t* fde_encoding, std::string* error) const;
+
+    // Returns the PT_LOAD which has [addr, addr + size) in memory or nullptr.
+    const Elf_Phdr* FindLoad(Elf_Addr addr, size_t size) const;
+    // Returns the contents of [addr, addr + size) or nullptr when they are
+    // not in the file.
+    const char* Ptr(Elf_Addr addr, size_t size) const;
+    // Returns the name-th string in .dynstr or nullptr.
+    const char* Str(Elf_Word name) const { return name < dynstr_size_ ? dynstr_ + name : nullptr; }
+    Elf_Xword Dyn(Elf64_Sxword tag) const {
+        auto found = dyns_.find(tag);
+        return found == dyns_.end() ? 0 : found->second;
+    }
+    std::string SymName(size_t index) const {
+        const char* name = dynsym_ ? Str(dynsym_[index].st_name) : nullptr;
+        return Concat(name ? name : "?", " (", index, ")");
+    }
+
+    const char* head_;
+    size_t size_;
+
+    const Elf_Ehdr* ehdr_{nullptr};
+    std::vector<const Elf_Phdr*> phdrs_;
+    // PT_LOADs sorted by p_vaddr.
+    std::vector<const Elf_Phdr*> loads_;
+    const Elf_Phdr* tls_{nullptr};
+    const Elf_Phdr* eh_frame_hdr_{nullptr};
+    // The first value of each tag in PT_DYNAMIC.
+    std::map<Elf64_Sxword, Elf_Xword> dyns_;
+
+    const char* dynstr_{nullptr};
+    size_t dynstr_size_{0};
+    const Elf_Sym* dynsym_{nullptr};
+    size_t num_syms_{0};
+    const Elf_Rel* rela_{nullptr};
+    size_t num_relas_{0};
+    const Elf_Rel* jmprel_{nullptr};
+    size_t num_jmprels_{0};
+
+    const Elf_GnuHash* gnu_hash_{nullptr};
+    const Elf_Addr* bloom_{nullptr};
+    const uint32_t* buckets_{nullptr};
+    const uint32_t* hashvals_{nullptr};
+
+    const EHFrameHeader::FDETableEntry* fde_table_{nullptr};
+    size_t num_fdes_{0};
+};
+
+const Elf_Phdr* Verifier::FindLoad(Elf_Addr addr, size_t size) const {
+    auto found = std::upper_bound(loads_.begin(), loads_.end(), addr, [](Elf_Addr a, const Elf_Phdr* p) { return a < p->p_vaddr; });
+    if (found == loads_.begin()) return nullptr;
+    const Elf_Phdr* load = *(found - 1);
+    if (size > load->p_memsz || addr - load->p_vaddr > load->p_memsz - size) return nullptr;
+    return load;
+}
+
+const char* Verifier::Ptr(Elf_Addr addr, size_t size) const {
+    const Elf_Phdr* load = FindLoad(addr, size);
+    if (!load || size > load->p_filesz || addr - load->p_vaddr > load->p_filesz - size) return nullptr;
+    const uint64_t offset = load->p_offset + (addr - load->p_vaddr);
+    if (offset > size_ || size > size_ - offset) return nullptr;
+    return head_ + offset;
+}
+
+bool Verifier::Parse(ErrorList* errors) {
+    if (size_ < sizeof(Elf_Ehdr) || memcmp(head_, ELFMAG, SELFMAG) != 0) {
+        errors->Add("Not an ELF file");
+        return false;
+    }
+    ehdr_ = reinterpret_cast<const Elf_Ehdr*>(head_);
+    if (ehdr_->e_ident[EI_CLASS] != ELFCLASS64) {
+        errors->Add("Not a 64-bit ELF file");
+        return false;
+    }
+    if (ehdr_->e_phentsize != sizeof(Elf_Phdr) || ehdr_->e_phoff > size_ || (size_ - ehdr_->e_phoff) / sizeof(Elf_Phdr) < ehdr_->e_phnum) {
+        errors->Add("Program headers are out of the file");
+        return false;
+    }
+
+    const Elf_Phdr* dynamic = nullptr;
+    for (size_t i = 0; i < ehdr_->e_phnum; ++i) {
+        const Elf_Phdr* phdr = reinterpret_cast<const Elf_Phdr*>(head_ + ehdr_->e_phoff) + i;
+        phdrs_.push_back(phdr);
+        if (phdr->p_type == PT_LOAD) {
+            loads_.push_back(phdr);
+        } else if (phdr->p_type == PT_DYNAMIC) {
+            dynamic = phdr;
+        } else if (phdr->p_type == PT_TLS) {
+            if (tls_) errors->Add(Concat(SegmentName(i, *phdr), " is the second PT_TLS"));
+            tls_ = phdr;
+        } else if (phdr->p_type == PT_GNU_EH_FRAME) {
+            eh_frame_hdr_ = phdr;
+        }
+    }
+    // CheckSegments reports PT_LOADs which are not sorted.
+    std::stable_sort(loads_.begin(), loads_.end(), [](const Elf_Phdr* a, const Elf_Phdr* b) { return a->p_vaddr < b->p_vaddr; });
+
+    if (!dynamic || dynamic->p_offset > size_ || dynamic->p_filesz > size_ - dynamic->p_offset) {
+        errors->Add("No PT_DYNAMIC in the file");
+        return false;
+    }
+    for (size_t off = 0; off + sizeof(Elf_Dyn) <= dynamic->p_filesz; off += sizeof(Elf_Dyn)) {
+        const Elf_Dyn dyn = Read<Elf_Dyn>(head_ + dynamic->p_offset + off);
+        if (dyn.d_tag == DT_NULL) break;
+        dyns_.emplace(dyn.d_tag, dyn.d_un.d_val);
+    }
+
+    dynstr_size_ = Dyn(DT_STRSZ);
+    dynstr_ = Ptr(Dyn(DT_STRTAB), dynstr_size_);
+    if (!dynstr_) {
+        errors->Add(Concat("DT_STRTAB at ", HexString(Dyn(DT_STRTAB)), " of size ", dynstr_size_, " is out of the file"));
+        dynstr_size_ = 0;
+    }
+
+    if (Dyn(DT_RELA)) {
+        if (Dyn(DT_RELAENT) != sizeof(Elf_Rel)) errors->Add(Concat("DT_RELAENT is ", Dyn(DT_RELAENT)));
+        rela_ = reinterpret_cast<const Elf_Rel*>(Ptr(Dyn(DT_RELA), Dyn(DT_RELASZ)));
+        if (rela_) {
+            num_relas_ = Dyn(DT_RELASZ) / sizeof(Elf_Rel);
+        } else {
+            errors->Add(Concat("DT_RELA at ", HexString(Dyn(DT_RELA)), " of size ", Dyn(DT_RELASZ), " is out of the file"));
+        }
+    }
+    if (Dyn(DT_JMPREL)) {
+        if (Dyn(DT_PLTREL) != DT_RELA) errors->Add(Concat("DT_PLTREL is ", Dyn(DT_PLTREL)));
+        jmprel_ = reinterpret_cast<const Elf_Rel*>(Ptr(Dyn(DT_JMPREL), Dyn(DT_PLTRELSZ)));
+        if (jmprel_) {
+            num_jmprels_ = Dyn(DT_PLTRELSZ) / sizeof(Elf_Rel);
+        } else {
+            errors->Add(Concat("DT_JMPREL at ", HexString(Dyn(DT_JMPREL)), " of size ", Dyn(DT_PLTRELSZ), " is out of the file"));
+        }
+    }
+
+    // .dynsym has no size in PT_DYNAMIC, so we count symbols in the hash table.
+    if (Dyn(DT_GNU_HASH)) {
+        ParseGnuHash(errors);
+    } else if (const char* hash = Ptr(Dyn(DT_HASH), sizeof(uint32_t) * 2)) {
+        num_syms_ = Read<uint32_t>(hash + sizeof(uint32_t));
+    }
+    if (Dyn(DT_SYMENT) && Dyn(DT_SYMENT) != sizeof(Elf_Sym)) errors->Add(Concat("DT_SYMENT is ", Dyn(DT_SYMENT)));
+    dynsym_ = reinterpret_cast<const Elf_Sym*>(Ptr(Dyn(DT_SYMTAB), num_syms_ * sizeof(Elf_Sym)));
+    if (!dynsym_ && num_syms_) {
+        errors->Add(Concat("DT_SYMTAB at ", HexString(Dyn(DT_SYMTAB)), " with ", num_syms_, " symbols is out of the file"));
+        num_syms_ = 0;
+        gnu_hash_ = nullptr;
+    }
+
+    if (eh_frame_hdr_) ParseEHFrameHeader(errors);
+    return true;
+}
+
+void Verifier::ParseGnuHash(ErrorList* errors) {
+    const Elf_Addr addr = Dyn(DT_GNU_HASH);
+    const char* header = Ptr(addr, sizeof(uint32_t) * 4);
+    if (!header) {
+        errors->Add(Concat("DT_GNU_HASH at ", HexString(addr), " is out of the file"));
+        return;
+    }
+    const Elf_GnuHash* gnu_hash = reinterpret_cast<const Elf_GnuHash*>(header);
+    if (!gnu_hash->nbuckets || !IsPowerOf2(gnu_hash->maskwords)) {
+        errors->Add(Concat(".gnu.hash has ", gnu_hash->nbuckets, " buckets and ", gnu_hash->maskwords, " bloom filter words"));
+        return;
+    }
+    const Elf_Addr buckets_addr = addr + sizeof(uint32_t) * 4 + sizeof(Elf_Addr) * gnu_hash->maskwords;
+    const Elf_Addr hashvals_addr = buckets_addr + sizeof(uint32_t) * gnu_hash->nbuckets;
+    if (!Ptr(addr, hashvals_addr - addr)) {
+        errors->Add(".gnu.hash is out of the file");
+        return;
+    }
+    const uint32_t* buckets = reinterpret_cast<const uint32_t*>(Ptr(buckets_addr, 0));
+    const uint32_t* hashvals = reinterpret_cast<const uint32_t*>(Ptr(hashvals_addr, 0));
+    const Elf_Phdr* load = FindLoad(hashvals_addr, 0);
+    const size_t num_hashvals = (load->p_vaddr + load->p_filesz - hashvals_addr) / sizeof(uint32_t);
+
+    // The last symbol is the end of the last chain.
+    num_syms_ = gnu_hash->symndx;
+    for (size_t b = 0; b < gnu_hash->nbuckets; ++b) {
+        if (!buckets[b]) continue;
+        if (buckets[b] < gnu_hash->symndx) {
+            errors->Add(Concat(".gnu.hash bucket ", b, " points at symbol ", buckets[b], " below symndx ", gnu_hash->symndx));
+            return;
+        }
+        const size_t len = GnuHashChainLength(*gnu_hash, b, num_hashvals);
+        if (len == kBrokenGnuHashChain) {
+            errors->Add(Concat(".gnu.hash chain of bucket ", b, " does not end in the file"));
+            return;
+        }
+        num_syms_ = std::max<size_t>(num_syms_, buckets[b] + len);
+    }
+
+    gnu_hash_ = gnu_hash;
+    bloom_ = reinterpret_cast<const Elf_Addr*>(header + sizeof(uint32_t) * 4);
+    buckets_ = buckets;
+    hashvals_ = hashvals;
+}
+
+void Verifier::ParseEHFrameHeader(ErrorList* errors) {
+    const Elf_Addr addr = eh_frame_hdr_->p_vaddr;
+    const char* p = Ptr(addr, 4 + sizeof(int32_t) + sizeof(uint32_t));
+    if (!p) {
+        errors->Add(Concat(".eh_frame_hdr at ", HexString(addr), " is out of the file"));
+        return;
+    }
+    const uint8_t version = p[0], eh_frame_ptr_enc = p[1], fde_count_enc = p[2], table_enc = p[3];
+    if (version != 1) {
+        errors->Add(Concat(".eh_frame_hdr has version ", static_cast<int>(version)));
+        return;
+    }
+    if (fde_count_enc == DW_EH_PE_omit) return;
+    if (eh_frame_ptr_enc != (DW_EH_PE_sdata4 | DW_EH_PE_pcrel) || fde_count_enc != DW_EH_PE_udata4 ||
+        table_enc != (DW_EH_PE_sdata4 | DW_EH_PE_datarel)) {
+        errors->Add(Concat(".eh_frame_hdr has unsupported encodings ", ShowDW_EH_PE(eh_frame_ptr_enc), " ", ShowDW_EH_PE(fde_count_enc), " ",
+                           ShowDW_EH_PE(table_enc)));
+        return;
+    }
+    const uint32_t fde_count = Read<uint32_t>(p + 4 + sizeof(int32_t));
+    const size_t table_offset = 4 + sizeof(int32_t) + sizeof(uint32_t);
+    const char* table = Ptr(addr + table_offset, sizeof(EHFrameHeader::FDETableEntry) * fde_count);
+    if (!table || table_offset + sizeof(EHFrameHeader::FDETableEntry) * fde_count > eh_frame_hdr_->p_filesz) {
+        errors->Add(Concat(".eh_frame_hdr table of ", fde_count, " entries is out of PT_GNU_EH_FRAME"));
+        return;
+    }
+    fde_table_ = reinterpret_cast<const EHFrameHeader::FDETableEntry*>(table);
+    num_fdes_ = fde_count;
+}
+
+void Verifier::CheckSegments(ErrorList* errors) const {
+    const Elf_Phdr* prev_load = nullptr;
+    size_t prev_index = 0;
+    for (size_t i = 0; i < phdrs_.size(); ++i) {
+        const Elf_Phdr& phdr = *phdrs_[i];
+        const std::string name = SegmentName(i, phdr);
+        if (phdr.p_offset > size_ || phdr.p_filesz > size_ - phdr.p_offset) {
+            errors->Add(Concat(name, " at offset ", HexString(phdr.p_offset), " of size ", HexString(phdr.p_filesz), " is out of the file"));
+        }
+
+        if (phdr.p_type == PT_LOAD) {
+            if (phdr.p_filesz > phdr.p_memsz) errors->Add(Concat(name, " has p_filesz larger than p_memsz"));
+            if (phdr.p_align > 1 && !IsPowerOf2(phdr.p_align)) {
+                errors->Add(Concat(name, " has p_align ", HexString(phdr.p_align), " which is not a power of 2"));
+            } else if (phdr.p_align > 1 && (phdr.p_vaddr - phdr.p_offset) % phdr.p_align) {
+                errors->Add(Concat(name, " has p_vaddr ", HexString(phdr.p_vaddr), " and p_offset ", HexString(phdr.p_offset),
+                                   " which are not congruent modulo p_align ", HexString(phdr.p_align)));
+            }
+            if (prev_load) {
+                const std::string prev_name = SegmentName(prev_index, *prev_load);
+                if (phdr.p_vaddr < prev_load->p_vaddr) {
+                    errors->Add(Concat(name, " is not sorted by p_vaddr after ", prev_name));
+                } else if (PageDown(phdr.p_vaddr) < AlignNext(prev_load->p_vaddr + prev_load->p_memsz)) {
+                    errors->Add(Concat(name, " at ", HexString(phdr.p_vaddr), " shares a page with ", prev_name, " ending at ",
+                                       HexString(prev_load->p_vaddr + prev_load->p_memsz)));
+                }
+            }
+            prev_load = &phdr;
+            prev_index = i;
+        } else if (phdr.p_type == PT_DYNAMIC || phdr.p_type == PT_INTERP || phdr.p_type == PT_NOTE || phdr.p_type == PT_PHDR ||
+                   phdr.p_type == PT_GNU_EH_FRAME) {
+            const Elf_Phdr* load = FindLoad(phdr.p_vaddr, phdr.p_memsz);
+            if (!load) {
+                errors->Add(Concat(name, " at ", HexString(phdr.p_vaddr), " of size ", HexString(phdr.p_memsz), " is not in a PT_LOAD"));
+            } else if (phdr.p_offset - load->p_offset != phdr.p_vaddr - load->p_vaddr) {
+                errors->Add(Concat(name, " has p_offset ", HexString(phdr.p_offset), " which does not match its PT_LOAD"));
+            }
+        } else if (phdr.p_type == PT_GNU_RELRO) {
+            if (!FindLoad(phdr.p_vaddr, 0)) errors->Add(Concat(name, " at ", HexString(phdr.p_vaddr), " is not in a PT_LOAD"));
+        }
+    }
+}
+
+void Verifier::CheckTLS(ErrorList* errors) const {
+    if (!tls_) return;
+    if (tls_->p_filesz > tls_->p_memsz) errors->Add("PT_TLS has p_filesz larger than p_memsz");
+    if (tls_->p_align > 1 && !IsPowerOf2(tls_->p_align)) errors->Add(Concat("PT_TLS has p_align ", HexString(tls_->p_align)));
+    if (!tls_->p_filesz) return;
+    // ld.so copies the TLS initialization image from memory.
+    const Elf_Phdr* load = FindLoad(tls_->p_vaddr, tls_->p_filesz);
+    if (!load || tls_->p_vaddr + tls_->p_filesz > load->p_vaddr + load->p_filesz) {
+        errors->Add(Concat("TLS initialization image at ", HexString(tls_->p_vaddr), " of size ", HexString(tls_->p_filesz),
+                           " is not in the file part of a PT_LOAD"));
+    } else if (tls_->p_offset - load->p_offset != tls_->p_vaddr - load->p_vaddr) {
+        errors->Add(Concat("PT_TLS has p_offset ", HexString(tls_->p_offset), " which does not match its PT_LOAD"));
+    }
+}
+
+void Verifier::CheckTLSSymbols(ErrorList* errors) const {
+    for (size_t i = 0; i < num_syms_; ++i) {
+        const Elf_Sym& sym = dynsym_[i];
+        if (ELF_ST_TYPE(sym.st_info) != STT_TLS || sym.st_shndx == SHN_UNDEF) continue;
+        if (!tls_ || sym.st_value > tls_->p_memsz || sym.st_size > tls_->p_memsz - sym.st_value) {
+            errors->Add(Concat("TLS symbol ", SymName(i), " at ", HexString(sym.st_value), " of size ", HexString(sym.st_size),
+                               " is out of PT_TLS"));
+        }
+    }
+}
+
+void Verifier::CheckRelocs(const char* section, const Elf_Rel* rels, size_t begin, size_t end, ErrorList* errors) const {
+    const Elf_Half machine = ehdr_->e_machine;
+    for (size_t i = begin; i < end; ++i) {
+        const Elf_Rel& rel = rels[i];
+        const uint32_t type = ELF_R_TYPE(rel.r_info);
+        const uint32_t sym = ELF_R_SYM(rel.r_info);
+        // R_X86_64_NONE and R_AARCH64_NONE
+        if (type == 0) continue;
+
+        const std::string name = Concat(section, "[", i, "] (", ShowRelocationType(machine, type), ") at ", HexString(rel.r_offset));
+        const size_t size = (machine == EM_AARCH64 && type == R_AARCH64_TLSDESC) ? 16 : sizeof(Elf_Addr);
+        const Elf_Phdr* load = FindLoad(rel.r_offset, size);
+        if (!load) {
+            errors->Add(Concat(name, " is not in a PT_LOAD"));
+        } else if (!(load->p_flags & PF_W)) {
+            errors->Add(Concat(name, " is in a PT_LOAD at ", HexString(load->p_vaddr), " which is not writable"));
+        }
+        if (sym >= num_syms_) {
+            errors->Add(Concat(name, " refers to symbol ", sym, " but .dynsym has ", num_syms_, " symbols"));
+        }
+        if (!IsTLSOffset(machine, type) || sym >= num_syms_) continue;
+        // Offsets to TLS of other modules are checked with their symbols.
+        if (sym && dynsym_[sym].st_shndx == SHN_UNDEF) continue;
+        const Elf_Xword offset = (sym ? dynsym_[sym].st_value : 0) + rel.r_addend;
+        if (!tls_ || offset >= tls_->p_memsz) {
+            errors->Add(Concat(name, sym ? Concat(" to ", SymName(sym)) : std::string(), " has TLS offset ", HexString(offset),
+                               " out of PT_TLS"));
+        }
+    }
+}
+
+void Verifier::CheckGnuHash(ErrorList* errors) const {
+    if (!gnu_hash_) return;
+    const uint32_t symndx = gnu_hash_->symndx;
+    const uint32_t nbuckets = gnu_hash_->nbuckets;
+    // Buckets of symbols from symndx.
+    std::vector<uint32_t> sym_buckets;
+    for (size_t i = symndx; i < num_syms_; ++i) {
+        const char* name = Str(dynsym_[i].st_name);
+        if (!name) {
+            errors->Add(Concat("Symbol ", i, " has st_name out of .dynstr"));
+            sym_buckets.push_back(nbuckets);
+            continue;
+        }
+        const uint32_t h = CalcGnuHash(name);
+        const uint32_t b = h % nbuckets;
+        sym_buckets.push_back(b);
+        const uint32_t hashval = hashvals_[i - symndx];
+        if ((hashval | 1) != (h | 1)) {
+            errors->Add(Concat(".gnu.hash has hash value ", HexString(hashval), " for symbol ", SymName(i), " whose hash is ", HexString(h)));
+        }
+
+        const Elf_Addr word = bloom_[(h / 64) % gnu_hash_->maskwords];
+        const Elf_Addr mask = (1ULL << (h % 64)) | (1ULL << ((h >> gnu_hash_->shift2) % 64));
+        if ((word & mask) != mask) errors->Add(Concat("Bloom filter of .gnu.hash rejects symbol ", SymName(i)));
+
+        // Symbols in a bucket must be contiguous from buckets_[b] and the
+        // last one has the lowest bit of its hash value.
+        const bool starts_chain = i == symndx || sym_buckets[i - 1 - symndx] != b;
+        if (starts_chain && buckets_[b] != i) {
+            errors->Add(Concat("Symbol ", SymName(i), " is in bucket ", b, " of .gnu.hash which starts at symbol ", buckets_[b]));
+        } else if (!starts_chain && (hashvals_[i - 1 - symndx] & 1)) {
+            errors->Add(Concat("Chain of bucket ", b, " of .gnu.hash ends before symbol ", SymName(i)));
+        }
+    }
+    for (size_t b = 0; b < nbuckets; ++b) {
+        if (buckets_[b] && sym_buckets[buckets_[b] - symndx] != b) {
+            errors->Add(Concat("Bucket ", b, " of .gnu.hash points at symbol ", SymName(buckets_[b]), " of another bucket"));
+        }
+    }
+}
+
+void Verifier::CheckVersions(ErrorList* errors) const {
+    if (!Dyn(DT_VERSYM)) return;
+    const Elf_Versym* versyms = reinterpret_cast<const Elf_Versym*>(Ptr(Dyn(DT_VERSYM), num_syms_ * sizeof(Elf_Versym)));
+    if (!versyms) {
+        errors->Add(Concat("DT_VERSYM at ", HexString(Dyn(DT_VERSYM)), " is out of the file"));
+        return;
+    }
+
+    std::set<Elf_Versym> defined = {VER_NDX_LOCAL, VER_NDX_GLOBAL};
+    Elf_Addr addr = Dyn(DT_VERDEF);
+    for (size_t i = 0; addr && i < Dyn(DT_VERDEFNUM); ++i) {
+        const char* p = Ptr(addr, sizeof(Elf_Verdef));
+        if (!p) {
+            errors->Add(Concat("Verdef at ", HexString(addr), " is out of the file"));
+            break;
+        }
+        const Elf_Verdef verdef = Read<Elf_Verdef>(p);
+        defined.insert(verdef.vd_ndx & VERSYM_VERSION);
+        const char* aux = Ptr(addr + verdef.vd_aux, sizeof(Elf_Verdaux));
+        if (!aux || !Str(Read<Elf_Verdaux>(aux).vda_name)) errors->Add(Concat("Verdef at ", HexString(addr), " has a broken name"));
+        if (!verdef.vd_next) {
+            if (i + 1 < Dyn(DT_VERDEFNUM)) errors->Add(Concat(".gnu.version_d has ", i + 1, " entries but DT_VERDEFNUM is ", Dyn(DT_VERDEFNUM)));
+            break;
+        }
+        addr += verdef.vd_next;
+    }
+
+    addr = Dyn(DT_VERNEED);
+    for (size_t i = 0; addr && i < Dyn(DT_VERNEEDNUM); ++i) {
+        const char* p = Ptr(addr, sizeof(Elf_Verneed));
+        if (!p) {
+            errors->Add(Concat("Verneed at ", HexString(addr), " is out of the file"));
+            break;
+        }
+        const Elf_Verneed verneed = Read<Elf_Verneed>(p);
+        if (!Str(verneed.vn_file)) errors->Add(Concat("Verneed at ", HexString(addr), " has vn_file out of .dynstr"));
+        Elf_Addr aux_addr = addr + verneed.vn_aux;
+        for (size_t j = 0; j < verneed.vn_cnt; ++j) {
+            const char* aux = Ptr(aux_addr, sizeof(Elf_Vernaux));
+            if (!aux) {
+                errors->Add(Concat("Vernaux at ", HexString(aux_addr), " is out of the file"));
+                break;
+            }
+            const Elf_Vernaux vernaux = Read<Elf_Vernaux>(aux);
+            if (!Str(vernaux.vna_name)) errors->Add(Concat("Vernaux at ", HexString(aux_addr), " has vna_name out of .dynstr"));
+            defined.insert(vernaux.vna_other & VERSYM_VERSION);
+            if (!vernaux.vna_next) break;
+            aux_addr += vernaux.vna_next;
+        }
+        if (!verneed.vn_next) {
+            if (i + 1 < Dyn(DT_VERNEEDNUM)) errors->Add(Concat(".gnu.version_r has ", i + 1, " entries but DT_VERNEEDNUM is ", Dyn(DT_VERNEEDNUM)));
+            break;
+        }
+        addr += verneed.vn_next;
+    }
+
+    for (size_t i = 0; i < num_syms_; ++i) {
+        const Elf_Versym v = Read<Elf_Versym>(reinterpret_cast<const char*>(versyms + i)) & VERSYM_VERSION;
+        if (!defined.count(v)) errors->Add(Concat("Symbol ", SymName(i), " has version index ", v, " which is not defined"));
+    }
+}
+
+bool Verifier::ParseCIE(Elf_Addr addr, uint8_t* fde_encoding, std::string* error) const {
+    const char* p = Ptr(addr, sizeof(uint32_t) * 2);
+    if (!p) {
+        *error = "is out of the file";
+        return false;
+    }
+    const uint32_t length = Read<uint32_t>(p);
+    if (length == 0xffffffff) {
+        *error = "has a 64-bit length which is not supported";
+        return false;
+    }
+    const char* end = Ptr(addr, sizeof(uint32_t) + length);
+    if (!end || length < sizeof(uint32_t) + 2) {
+        *error = "runs out of its PT_LOAD";
+        return false;
+    }
+    end += sizeof(uint32_t) + length;
+    if (Read<uint32_t>(p + sizeof(uint32_t))) {
+        *error = "is not a CIE";
+        return false;
+    }
+
+    const uint8_t version = p[sizeof(uint32_t) * 2];
+    const char* aug = p + sizeof(uint32_t) * 2 + 1;
+    const char* q = static_cast<const char*>(memchr(aug, '\0', end - aug));
+    *fde_encoding = DW_EH_PE_absptr;
+    if (!q) {
+        *error = "has a broken augmentation string";
+        return false;
+    }
+    if (aug[0] != 'z') return true;
+    q++;
+
+    int64_t v;
+    // Code alignment factor, data alignment factor, return address register
+    // and augmentation length.
+    bool ok = ReadLEB128(&q, end, false, &v) && ReadLEB128(&q, end, true, &v);
+    if (version == 1) {
+        q++;
+    } else {
+        ok = ok && ReadLEB128(&q, end, false, &v);
+    }
+    ok = ok && ReadLEB128(&q, end, false, &v);
+    for (const char* a = aug + 1; ok && *a; ++a) {
+        if (q >= end) {
+            ok = false;
+        } else if (*a == 'R') {
+            *fde_encoding = *q++;
+        } else if (*a == 'L') {
+            q++;
+        } else if (*a == 'P') {
+            const uint8_t enc = *q++;
+            const size_t size = EncodedSize(enc);
+            if (size) {
+                q += size;
+            } else {
+                ok = ReadLEB128(&q, end, enc & DW_EH_PE_signed, &v);
+            }
+        } else if (*a != 'S' && *a != 'B' && *a != 'G') {
+            break;
+        }
+    }
+    if (!ok || q > end) {
+        *error = "has broken augmentation data";
+        return false;
+    }
+    return true;
+}
+
+void Verifier::CheckEHFrameHeader(size_t begin, size_t end, ErrorList* errors) const {
+    const Elf_Addr hdr = eh_frame_hdr_->p_vaddr;
+    // FDE encodings of CIEs.
+    std::map<Elf_Addr, uint8_t> cies;
+    for (size_t i = begin; i < end; ++i) {
+        const Elf_Addr pc = hdr + fde_table_[i].initial_loc;
+        const Elf_Addr fde = hdr + fde_table_[i].fde_ptr;
+        const std::string name = Concat(".eh_frame_hdr[", i, "] for ", HexString(pc));
+        if (i && static_cast<int64_t>(hdr + fde_table_[i - 1].initial_loc) > static_cast<int64_t>(pc)) {
+            errors->Add(Concat(name, " is not sorted"));
+        }
+        if (!FindLoad(pc, 0)) errors->Add(Concat(name, " is not in a PT_LOAD"));
+
+        const char* p = Ptr(fde, sizeof(uint32_t) * 2);
+        if (!p) {
+            errors->Add(Concat(name, " points at FDE at ", HexString(fde), " out of the file"));
+            continue;
+        }
+        const uint32_t length = Read<uint32_t>(p);
+        if (length == 0xffffffff) continue;
+        const uint32_t cie_ptr = Read<uint32_t>(p + sizeof(uint32_t));
+        if (length < sizeof(uint32_t) || !cie_ptr) {
+            errors->Add(Concat(name, " points at ", HexString(fde), " which is not an FDE"));
+            continue;
+        }
+        if (!Ptr(fde, sizeof(uint32_t) + length)) {
+            errors->Add(Concat(name, " points at FDE at ", HexString(fde), " which runs out of its PT_LOAD"));
+            continue;
+        }
+
+        const Elf_Addr cie = fde + sizeof(uint32_t) - cie_ptr;
+        auto found = cies.find(cie);
+        if (found == cies.end()) {
+            uint8_t enc;
+            std::string error;
+            if (!ParseCIE(cie, &enc, &error)) {
+                errors->Add(Concat(name, " points at FDE at ", HexString(fde), " whose CIE at ", HexString(cie), " ", error));
+                continue;
+            }
+            found = cies.emplace(cie, enc).first;
+        }
+
+        // Compare pc_begin of the FDE with the table.
+        const uint8_t enc = found->second;
+        const size_t size = EncodedSize(enc);
+        const Elf_Addr field = fde + sizeof(uint32_t) * 2;
+        const char* q = Ptr(field, size);
+        if (!size || (enc & DW_EH_PE_indirect) || ((enc & 0x70) != DW_EH_PE_absptr && (enc & 0x70) != DW_EH_PE_pcrel) || !q) continue;
+        uint64_t pc_begin;
+        if (size == 8) {
+            pc_begin = Read<uint64_t>(q);
+        } else if (size == 4) {
+            pc_begin = (enc & DW_EH_PE_signed) ? static_cast<int64_t>(Read<int32_t>(q)) : Read<uint32_t>(q);
+        } else {
+            pc_begin = (enc & DW_EH_PE_signed) ? static_cast<int64_t>(Read<int16_t>(q)) : Read<uint16_t>(q);
+        }
+        if ((enc & 0x70) == DW_EH_PE_pcrel) pc_begin += field;
+        if (pc_begin != pc) errors->Add(Concat(name, " points at FDE at ", HexString(fde), " for ", HexString(pc_begin)));
+    }
+}
+
+std::vector<std::string> Verifier::Verify(size_t* num_errors) {
+    std::vector<std::string> result;
+    ErrorList parse_errors;
+    const bool parsed = Parse(&parse_errors);
+    parse_errors.AppendTo(&result);
+    *num_errors = parse_errors.count();
+    if (!parsed) return result;
+
+    // Tasks of the same check share its ErrorList after they finish.
+    struct Task {
+        size_t check;
+        std::function<void(ErrorList*)> run;
+    };
+    std::vector<Task> tasks;
+    tasks.push_back({0, [this](ErrorList* e) {
+                         CheckSegments(e);
+                         CheckTLS(e);
+                         CheckTLSSymbols(e);
+                     }});
+    tasks.push_back({1, [this](ErrorList* e) { CheckGnuHash(e); }});
+    tasks.push_back({2, [this](ErrorList* e) { CheckVersions(e); }});
+    for (size_t i = 0; i < num_relas_; i += kItemsPerTask) {
+        tasks.push_back({3, [this, i](ErrorList* e) { CheckRelocs(".rela.dyn", rela_, i, std::min(num_relas_, i + kItemsPerTask), e); }});
+    }
+    for (size_t i = 0; i < num_jmprels_; i += kItemsPerTask) {
+        tasks.push_back({4, [this, i](ErrorList* e) { CheckRelocs(".rela.plt", jmprel_, i, std::min(num_jmprels_, i + kItemsPerTask), e); }});
+    }
+    for (size_t i = 0; i < num_fdes_; i += kItemsPerTask) {
+        tasks.push_back({5, [this, i](ErrorList* e) { CheckEHFrameHeader(i, std::min(num_fdes_, i + kItemsPerTask), e); }});
+    }
+
+    std::vector<ErrorList> task_errors(tasks.size());
+    std::atomic<size_t> next{0};
+    auto work = [&tasks, &task_errors, &next]() {
+        for (size_t i; (i = next++) < tasks.size();) {
+            tasks[i].run(&task_errors[i]);
+        }
+    };
+    const size_t num_threads = std::min<size_t>(tasks.size(), std::max(1U, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    std::vector<ErrorList> check_errors(6);
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        check_errors[tasks[i].check].Merge(task_errors[i]);
+    }
+    for (const ErrorList& errors : check_errors) {
+        errors.AppendTo(&result);
+        *num_errors += errors.count();
+    }
+    return result;
+}
+
+}  // namespace
+
+std::vector<std::string> VerifyOutput(const std::string& filename, size_t* num_errors) {
+    size_t unused;
+    if (!num_errors) num_errors = &unused;
+    // Failures before Verify are a single error.
+    *num_errors = 1;
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return {Concat("open failed: ", strerror(errno))};
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        const int e = errno;
+        close(fd);
+        return {Concat("fstat failed: ", strerror(e))};
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return {"Empty file"};
+    }
+    char* p = static_cast<char*>(mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+    const int e = errno;
+    close(fd);
+    if (p == MAP_FAILED) return {Concat("mmap failed: ", strerror(e))};
+
+    std::vector<std::string> errors = Verifier(p, st.st_size).Verify(num_errors);
+    munmap(p, st.st_size);
+    return errors;
+}
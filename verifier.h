@@ -0,0 +1,40 @@
+// Copyright (C) 2021 The sold authors
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+// Checks the structure of an output of sold without linking it again. The
+// output is mapped once and the checks below run in parallel:
+//
+// - PT_LOADs are sorted, do not share pages and are aligned, and other
+//   segments lie in PT_LOADs.
+// - Relocations target writable PT_LOADs and refer to existing symbols.
+// - .gnu.hash finds every symbol in .dynsym after symndx.
+// - Version indices in .gnu.version are defined in .gnu.version_d or
+//   .gnu.version_r.
+// - .eh_frame_hdr is sorted and its entries point at FDEs of the same
+//   functions.
+// - PT_TLS is in a PT_LOAD, and TLS symbols defined in .dynsym and offsets
+//   of TLS relocations to this object are in PT_TLS.
+//
+// Returns the problems found, including failures to read filename. An empty
+// result means the output is fine. Only the first problems of each check are
+// returned and *num_errors, when given, has the number of all of them.
+std::vector<std::string> VerifyOutput(const std::string& filename, size_t* num_errors = nullptr);
@@ -15,8 +15,16 @@
 
 #include "version_builder.h"
 
-void VersionBuilder::Add(Elf_Versym versym, const std::string& soname, const std::string& version, StrtabBuilder& strtab,
-                         const unsigned char st_info) {
+#include <algorithm>
+
+void VersionBuilder::SetSonameToFilename(const std::map<std::string, std::string>& soname_to_filename) {
+    soname_to_filename_.reserve(soname_to_filename.size());
+    for (const auto& p : soname_to_filename) {
+        soname_to_filename_[InternString(p.first)] = InternString(p.second);
+    }
+}
+
+void VersionBuilder::Add(Elf_Versym versym, StrId soname, StrId version, StrtabBuilder& strtab, const unsigned char st_info) {
     // When the corresponding shared object doesn't have version information,
     // we cannot help inferring it from st_info.
     if (versym == NO_VERSION_INFO) {
@@ -24,52 +32,57 @@ void VersionBuilder::Add(Elf_Versym versym, const std::string& soname, const std
     }
 
     if (is_special_ver_ndx(versym)) {
-        CHECK(soname.empty() && version.empty()) << " excess soname or version information is given.";
+        CHECK(soname == EMPTY_STR_ID && version == EMPTY_STR_ID) << " excess soname or version information is given.";
         LOG(INFO) << "VersionBuilder::" << special_ver_ndx_to_str(versym);
 
         vers.push_back(versym);
     } else {
-        CHECK(!soname.empty() && !version.empty()) << " versym=" << special_ver_ndx_to_str(versym);
-
-        auto found_filename = soname_to_filename_.find(soname);
-        CHECK(found_filename != soname_to_filename_.end())
-            << soname << " does not exists in soname_to_filename." << SOLD_LOG_KEY(soname) << SOLD_LOG_KEY(version);
-        std::string filename = found_filename->second;
-
-        strtab.Add(filename);
-        strtab.Add(version);
-
-        if (data.find(filename) != data.end()) {
-            if (data[filename].find(version) != data[filename].end()) {
-                ;
-            } else {
-                data[filename][version] = vernum;
-                vernum++;
+        CHECK(soname != EMPTY_STR_ID && version != EMPTY_STR_ID) << " versym=" << special_ver_ndx_to_str(versym);
+
+        const StrId* found_filename = soname_to_filename_.Find(soname);
+        CHECK(found_filename != nullptr) << InternedString(soname) << " does not exists in soname_to_filename."
+                                         << SOLD_LOG_KEY(InternedString(soname)) << SOLD_LOG_KEY(InternedString(version));
+        StrId filename = *found_filename;
+
+        auto inserted = vernums_.Insert((static_cast<uint64_t>(filename) << 32) | version, vernum);
+        if (inserted.second) {
+            // Adding the same string to strtab again is no-op, so we add only
+            // strings of new (filename, version) pairs.
+            strtab.Add(InternedString(filename));
+            strtab.Add(InternedString(version));
+
+            auto found = verneed_index_.Insert(filename, verneeds_.size());
+            if (found.second) {
+                verneeds_.push_back(Verneed{filename, {}});
             }
-        } else {
-            std::map<std::string, int> ma;
-            ma[version] = vernum;
-            data[filename] = ma;
+            verneeds_[*found.first].vernauxs.emplace_back(version, vernum);
+            num_vernauxs_++;
             vernum++;
         }
-        LOG(INFO) << "VersionBuilder::Add(" << data[filename][version] << ", " << soname << ", " << version << ")";
-        vers.push_back(data[filename][version]);
+        int v = *inserted.first;
+        LOG(INFO) << "VersionBuilder::Add(" << v << ", " << InternedString(soname) << ", " << InternedString(version) << ")";
+        vers.push_back(v);
     }
 }
 
 uintptr_t VersionBuilder::SizeVerneed() const {
-    uintptr_t s = 0;
-    for (const auto& m1 : data) {
-        s += sizeof(Elf_Verneed);
-        for (const auto& m2 : m1.second) {
-            s += sizeof(Elf_Vernaux);
-        }
+    return verneeds_.size() * sizeof(Elf_Verneed) + num_vernauxs_ * sizeof(Elf_Vernaux);
+}
+
+std::vector<VersionBuilder::Verneed> VersionBuilder::SortedVerneeds() const {
+    std::vector<Verneed> sorted = verneeds_;
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Verneed& a, const Verneed& b) { return InternedString(a.filename) < InternedString(b.filename); });
+    for (Verneed& vn : sorted) {
+        std::sort(vn.vernauxs.begin(), vn.vernauxs.end(), [](const std::pair<StrId, int>& a, const std::pair<StrId, int>& b) {
+            return InternedString(a.first) < InternedString(b.first);
+        });
     }
-    return s;
+    return sorted;
 }
 
 void VersionBuilder::EmitVersym(FILE* fp) {
-    if (data.size() > 0) {
+    if (!verneeds_.empty()) {
         for (auto v : vers) {
             CHECK(fwrite(&v, sizeof(v), 1, fp) == 1);
         }
@@ -77,29 +90,31 @@ void VersionBuilder::EmitVersym(FILE* fp) {
 }
 
 void VersionBuilder::EmitVerneed(FILE* fp, StrtabBuilder& strtab) {
+    const std::vector<Verneed> sorted = SortedVerneeds();
     int n_verneed = 0;
-    for (const auto& m1 : data) {
+    for (const auto& m1 : sorted) {
         n_verneed++;
 
         Elf_Verneed v;
         v.vn_version = VER_NEED_CURRENT;
-        v.vn_cnt = m1.second.size();
-        v.vn_file = strtab.GetPos(m1.first);
+        v.vn_cnt = m1.vernauxs.size();
+        v.vn_file = strtab.GetPos(InternedString(m1.filename));
         v.vn_aux = sizeof(Elf_Verneed);
-        v.vn_next = (n_verneed == data.size()) ? 0 : sizeof(Elf_Verneed) + m1.second.size() * sizeof(Elf_Vernaux);
+        v.vn_next = (n_verneed == sorted.size()) ? 0 : sizeof(Elf_Verneed) + m1.vernauxs.size() * sizeof(Elf_Vernaux);
 
         CHECK(fwrite(&v, sizeof(v), 1, fp) == 1);
 
         int n_vernaux = 0;
-        for (const auto& m2 : m1.second) {
+        for (const auto& m2 : m1.vernauxs) {
             n_vernaux++;
 
+            const std::string& version = InternedString(m2.first);
             Elf_Vernaux a;
-            a.vna_hash = CalcHash(m2.first);
+            a.vna_hash = CalcHash(version);
             a.vna_flags = VER_FLG_WEAK;
             a.vna_other = m2.second;
-            a.vna_name = strtab.GetPos(m2.first);
-            a.vna_next = (n_vernaux == m1.second.size()) ? 0 : sizeof(Elf_Vernaux);
+            a.vna_name = strtab.GetPos(version);
+            a.vna_next = (n_vernaux == m1.vernauxs.size()) ? 0 : sizeof(Elf_Vernaux);
 
             CHECK(fwrite(&a, sizeof(a), 1, fp) == 1);
         }
@@ -18,31 +18,48 @@
 #include <stdio.h>
 
 #include <map>
+#include <vector>
 
 #include "hash.h"
+#include "hash_table.h"
 #include "strtab_builder.h"
 #include "utils.h"
 
 class VersionBuilder {
 public:
-    void Add(Elf_Versym versym, const std::string& soname, const std::string& version, StrtabBuilder& strtab, const unsigned char st_info);
+    void Add(Elf_Versym versym, StrId soname, StrId version, StrtabBuilder& strtab, const unsigned char st_info);
 
-    uintptr_t SizeVersym() const { return (data.size() > 0) ? vers.size() * sizeof(Elf_Versym) : 0; }
+    uintptr_t SizeVersym() const { return (!verneeds_.empty()) ? vers.size() * sizeof(Elf_Versym) : 0; }
 
     uintptr_t SizeVerneed() const;
 
-    int NumVerneed() const { return data.size(); }
+    int NumVerneed() const { return verneeds_.size(); }
 
     void EmitVersym(FILE* fp);
 
     void EmitVerneed(FILE* fp, StrtabBuilder& strtab);
 
-    void SetSonameToFilename(const std::map<std::string, std::string>& soname_to_filename) { soname_to_filename_ = soname_to_filename; }
+    void SetSonameToFilename(const std::map<std::string, std::string>& soname_to_filename);
 
 private:
+    struct Verneed {
+        StrId filename;
+        // (version, vernum) in the order of Add.
+        std::vector<std::pair<StrId, int>> vernauxs;
+    };
+
+    // Returns verneeds_ and their vernauxs sorted by name so that the output
+    // does not depend on the order of Add.
+    std::vector<Verneed> SortedVerneeds() const;
+
     // vernum starts from 2 because 0 and 1 are used as VER_NDX_LOCAL and VER_NDX_GLOBAL.
     int vernum = 2;
-    std::map<std::string, std::map<std::string, int>> data;
+    std::vector<Verneed> verneeds_;
+    // map from filename to the index in verneeds_
+    OpenHashMap<StrId, size_t> verneed_index_;
+    // map from (filename << 32 | version) to vernum
+    OpenHashMap<uint64_t, int> vernums_;
+    uintptr_t num_vernauxs_{0};
     std::vector<Elf_Versym> vers;
-    std::map<std::string, std::string> soname_to_filename_;
+    OpenHashMap<StrId, StrId> soname_to_filename_;
 };